@@ -11823,9 +11823,9 @@ const char* getNamedResource (const char* resourceNameUTF8, int& numBytes) throw
         case 0xde5493f9:  numBytes = 317; return defaultPattern_png;
         case 0x607fea3a:  numBytes = 2608; return ColourSchemes_xml;
         case 0xec23d88d:  numBytes = 6876; return DefaultArps_xml;
-        case 0x6644d5b8:  numBytes = 9601; return DefaultHotkeys_xml;
+        case 0x6644d5b8:  numBytes = 10191; return DefaultHotkeys_xml;
         case 0x712a9842:  numBytes = 4741; return DefaultScales_xml;
-        case 0x7502f27b:  numBytes = 185385; return DefaultTranslations_xml;
+        case 0x7502f27b:  numBytes = 223349; return DefaultTranslations_xml;
         default: break;
     }
 
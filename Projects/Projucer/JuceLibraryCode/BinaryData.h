@@ -357,13 +357,13 @@ namespace BinaryData
     const int            DefaultArps_xmlSize = 6876;
 
     extern const char*   DefaultHotkeys_xml;
-    const int            DefaultHotkeys_xmlSize = 9601;
+    const int            DefaultHotkeys_xmlSize = 10191;
 
     extern const char*   DefaultScales_xml;
     const int            DefaultScales_xmlSize = 4741;
 
     extern const char*   DefaultTranslations_xml;
-    const int            DefaultTranslations_xmlSize = 185385;
+    const int            DefaultTranslations_xmlSize = 223349;
 
     // Points to the start of a list of resource names.
     extern const char* namedResourceList[];
@@ -32,6 +32,7 @@
 #include "InternalClipboard.h"
 #include "FontSerializer.h"
 #include "FileUtils.h"
+#include "Tracer.h"
 
 #include "MainLayout.h"
 #include "Document.h"
@@ -274,6 +275,10 @@ void App::initialise(const String &commandLine)
         Desktop::getInstance().setOrientationsEnabled(Desktop::rotatedClockwise + Desktop::rotatedAntiClockwise);
         FileUtils::fixCurrentWorkingDirectory();
         
+        // Tracing is off by default, and can be enabled in any build
+        // to diagnose dropouts and stalls without a debugger attached
+        Tracer::setEnabled(commandLine.contains("--trace"));
+
         Logger::setCurrentLogger(&this->logger);
         Logger::writeToLog("Helio Workstation");
         Logger::writeToLog("Ver. " + App::getAppReadableVersion());
@@ -349,6 +354,12 @@ void App::shutdown()
         ArpeggiatorsManager::getInstance().shutdown();
         TranslationManager::getInstance().shutdown();
         
+        if (Tracer::isEnabled())
+        {
+            Tracer::exportChromeTrace(FileUtils::getDocumentSlot("Helio-trace.json"));
+            Tracer::setEnabled(false);
+        }
+
         Logger::setCurrentLogger(nullptr);
     }
     else if (this->runMode == App::PLUGIN_CHECK)
@@ -41,27 +41,32 @@ bool Config::hasNewMachineId()
 
 void Config::set(const String &keyName, const var &value)
 {
-    App::Helio()->getConfig()->setValue(keyName, value);
+    App::Helio()->getConfig()->setProperty(keyName, value);
 }
 
 void Config::set(const String &keyName, const XmlElement *xml)
 {
-    App::Helio()->getConfig()->setValue(keyName, xml);
+    App::Helio()->getConfig()->setProperty(keyName, xml);
 }
 
 String Config::get(StringRef keyName, const String &defaultReturnValue /*= String::empty*/)
 {
-    return App::Helio()->getConfig()->getValue(keyName, defaultReturnValue);
+    return App::Helio()->getConfig()->getProperty(keyName, defaultReturnValue).toString();
+}
+
+var Config::getValue(StringRef keyName, const var &defaultReturnValue /*= var()*/)
+{
+    return App::Helio()->getConfig()->getProperty(keyName, defaultReturnValue);
 }
 
 bool Config::contains(StringRef keyName)
 {
-    return App::Helio()->getConfig()->containsKey(keyName);
+    return App::Helio()->getConfig()->containsProperty(keyName);
 }
 
 XmlElement *Config::getXml(StringRef keyName)
 {
-    return App::Helio()->getConfig()->getXmlValue(keyName);
+    return App::Helio()->getConfig()->getXmlProperty(keyName);
 }
 
 void Config::save(const String &key, const Serializable *serializer)
@@ -75,10 +80,86 @@ void Config::load(const String &key, Serializable *serializer)
 }
 
 
+//===----------------------------------------------------------------------===//
+// Sections
+//===----------------------------------------------------------------------===//
+
+// The legacy format is a single obfuscated xml document, see DataEncoder
+static const int kLegacyMagicNumber =
+    static_cast<int>(ByteOrder::littleEndianInt("PR::"));
+
+static const int kSectionedMagicNumber =
+    static_cast<int>(ByteOrder::littleEndianInt("PRC2"));
+
+enum SectionType
+{
+    valueSection = 0,
+    xmlSection = 1
+};
+
+Config::Entry::Entry(const String &key, const var &value) :
+    key(key),
+    value(value),
+    hasSection(false) {}
+
+Config::Entry::Entry(const String &key, XmlElement *ownedXml) :
+    key(key),
+    xml(ownedXml),
+    hasSection(false) {}
+
+void Config::Entry::encodeSection()
+{
+    MemoryOutputStream payload;
+
+    if (this->xml != nullptr)
+    {
+        this->xml->writeToStream(payload, StringRef(), true, false);
+    }
+    else
+    {
+        this->value.writeToStream(payload);
+    }
+
+    const MemoryBlock data(DataEncoder::obfuscateBlock(payload.getMemoryBlock()));
+
+    this->section.reset();
+    MemoryOutputStream out(this->section, false);
+    out.writeString(this->key);
+    out.writeByte(static_cast<char>(this->xml != nullptr ? xmlSection : valueSection));
+    out.writeInt(static_cast<int>(data.getSize()));
+    out.write(data.getData(), data.getSize());
+    out.flush();
+
+    this->hasSection = true;
+}
+
+Config::Entry *Config::Entry::createFromSection(const String &key, int type, const MemoryBlock &data)
+{
+    const MemoryBlock payload(DataEncoder::deobfuscateBlock(data));
+
+    if (type == xmlSection)
+    {
+        if (XmlElement *xml = XmlDocument::parse(payload.toString()))
+        {
+            return new Entry(key, xml);
+        }
+
+        return nullptr;
+    }
+
+    MemoryInputStream in(payload, false);
+    return new Entry(key, var::readFromStream(in));
+}
+
+
+//===----------------------------------------------------------------------===//
+// Config
+//===----------------------------------------------------------------------===//
 
 Config::Config(const int millisecondsBeforeSaving) :
+    Thread("Config"),
     fileLock("Config Lock"),
-    needsWriting(false),
+    needsWriting(0),
     saveTimeout(millisecondsBeforeSaving)
 {
     // Deal with legacy settings file
@@ -92,22 +173,110 @@ Config::Config(const int millisecondsBeforeSaving) :
 
     this->propertiesFile = newSettingsFile;
     this->reload();
+
+    this->startThread(3);
 }
 
 Config::~Config()
 {
-    this->setValue(Serialization::Core::machineID, this->getMachineId());
+    this->setProperty(Serialization::Core::machineID, this->getMachineId());
+
+    this->stopTimer();
+    this->stopThread(1000);
     this->saveIfNeeded();
 }
 
 bool Config::machineIdChanged()
 {
-    const String storedID = this->getValue(Serialization::Core::machineID);
+    const String storedID = this->getProperty(Serialization::Core::machineID, var()).toString();
     const String currentID = this->getMachineId();
     Logger::writeToLog("Config::machineIdChanged " + storedID + " : " + currentID);
     return (storedID != currentID);
 }
 
+void Config::setProperty(const String &key, const var &value)
+{
+    if (const Entry::Ptr existing = this->findEntry(key))
+    {
+        if (existing->xml == nullptr && existing->value == value)
+        {
+            return;
+        }
+    }
+
+    this->setEntry(new Entry(key, value));
+}
+
+void Config::setProperty(const String &key, const XmlElement *xml)
+{
+    if (xml == nullptr)
+    {
+        this->setProperty(key, var());
+        return;
+    }
+
+    this->setEntry(new Entry(key, new XmlElement(*xml)));
+}
+
+var Config::getProperty(StringRef key, const var &defaultReturnValue) const
+{
+    if (const Entry::Ptr entry = this->findEntry(key))
+    {
+        if (entry->xml != nullptr)
+        {
+            return entry->xml->createDocument(String::empty, true);
+        }
+
+        return entry->value;
+    }
+
+    return defaultReturnValue;
+}
+
+XmlElement *Config::getXmlProperty(StringRef key) const
+{
+    if (const Entry::Ptr entry = this->findEntry(key))
+    {
+        if (entry->xml != nullptr)
+        {
+            return new XmlElement(*entry->xml);
+        }
+
+        // Some values are xml documents stored as plain strings
+        return XmlDocument::parse(entry->value.toString());
+    }
+
+    return nullptr;
+}
+
+bool Config::containsProperty(StringRef key) const
+{
+    return this->findEntry(key) != nullptr;
+}
+
+void Config::setEntry(Entry *entry)
+{
+    {
+        const ScopedLock lock(this->entriesLock);
+        this->entries[entry->key] = entry;
+    }
+
+    this->propertyChanged();
+}
+
+Config::Entry::Ptr Config::findEntry(StringRef key) const
+{
+    const ScopedLock lock(this->entriesLock);
+    const auto found = this->entries.find(String(key));
+
+    if (found != this->entries.end())
+    {
+        return found->second;
+    }
+
+    return nullptr;
+}
+
 bool Config::saveIfNeeded()
 {
     if (this->propertiesFile.getFullPathName().isEmpty())
@@ -115,42 +284,72 @@ bool Config::saveIfNeeded()
         return false;
     }
 
+    const ScopedLock writerLock(this->writeLock);
+
+    if (this->needsWriting.exchange(0) == 0)
+    {
+        return true;
+    }
+
     Logger::writeToLog("Config::saveIfNeeded - " + this->propertiesFile.getFullPathName());
 
-    XmlElement doc(Serialization::Core::globalConfig);
+    ReferenceCountedArray<Entry> snapshot;
 
-    for (int i = 0; i < getAllProperties().size(); ++i)
     {
-        XmlElement *const e = doc.createNewChildElement(Serialization::Core::valueTag);
-        e->setAttribute(Serialization::Core::nameAttribute, getAllProperties().getAllKeys() [i]);
-
-        // if the value seems to contain xml, store it as such..
-        if (XmlElement *const childElement = XmlDocument::parse(getAllProperties().getAllValues()[i]))
+        const ScopedLock lock(this->entriesLock);
+        snapshot.ensureStorageAllocated(int(this->entries.size()));
+        for (const auto &e : this->entries)
         {
-            e->addChildElement(childElement);
+            snapshot.add(e.second);
         }
-        else
+    }
+
+    // Only the values changed since the last write need encoding,
+    // the rest of sections are written as they were
+    for (auto *entry : snapshot)
+    {
+        if (!entry->hasSection)
         {
-            e->setAttribute(Serialization::Core::valueAttribute,
-                            getAllProperties().getAllValues() [i]);
+            entry->encodeSection();
         }
     }
 
-
     InterProcessLock::ScopedLockType fLock(this->fileLock);
 
     if (!fLock.isLocked())
     {
         Logger::writeToLog("Config !fLock.isLocked()");
+        this->needsWriting = 1;
         return false;
     }
 
-    if (DataEncoder::saveObfuscated(this->propertiesFile, &doc))
+    TemporaryFile tempFile(this->propertiesFile);
+    ScopedPointer<FileOutputStream> out(tempFile.getFile().createOutputStream());
+
+    if (out == nullptr)
+    {
+        Logger::writeToLog("Config::saveIfNeeded failed");
+        this->needsWriting = 1;
+        return false;
+    }
+
+    out->writeInt(kSectionedMagicNumber);
+    out->writeInt(snapshot.size());
+
+    for (auto *entry : snapshot)
+    {
+        out->write(entry->section.getData(), entry->section.getSize());
+    }
+
+    out->flush();
+    out = nullptr;
+
+    if (tempFile.overwriteTargetFileWithTemporary())
     {
-        needsWriting = false;
         return true;
     }
 
+    this->needsWriting = 1;
     return false;
 }
 
@@ -165,62 +364,144 @@ bool Config::reload()
 
     InterProcessLock::ScopedLockType fLock(this->fileLock);
 
-    //if (!fLock.isLocked()) { return false; }
+    MemoryBlock fileData;
+    if (!this->propertiesFile.loadFileAsData(fileData))
+    {
+        return false;
+    }
+
+    MemoryInputStream in(fileData, false);
+    const int magicNumber = in.readInt();
+
+    if (magicNumber == kLegacyMagicNumber)
+    {
+        return this->reloadLegacy();
+    }
+
+    if (magicNumber != kSectionedMagicNumber)
+    {
+        return false;
+    }
+
+    const int numSections = in.readInt();
+    const ScopedLock lock(this->entriesLock);
+
+    for (int i = 0; i < numSections && !in.isExhausted(); ++i)
+    {
+        const int64 sectionStart = in.getPosition();
+        const String key(in.readString());
+        const int type = in.readByte();
+        const int size = in.readInt();
+
+        if (size < 0 || size > in.getNumBytesRemaining())
+        {
+            Logger::writeToLog("Config::reload - truncated section " + key);
+            break;
+        }
+
+        MemoryBlock data;
+        in.readIntoMemoryBlock(data, size);
+
+        if (Entry *entry = Entry::createFromSection(key, type, data))
+        {
+            // Keep the section as is, so that it is not re-encoded until changed
+            entry->section = MemoryBlock(addBytesToPointer(fileData.getData(), sectionStart),
+                                         size_t(in.getPosition() - sectionStart));
+            entry->hasSection = true;
+            this->entries[key] = entry;
+        }
+    }
+
+    return true;
+}
 
+bool Config::reloadLegacy()
+{
     ScopedPointer<XmlElement> doc(DataEncoder::loadObfuscated(this->propertiesFile));
 
-    if (doc != nullptr)
+    if (doc == nullptr || !doc->hasTagName(Serialization::Core::globalConfig))
+    {
+        return false;
+    }
+
+    const ScopedLock lock(this->entriesLock);
+
+    forEachXmlChildElementWithTagName(*doc, e, Serialization::Core::valueTag)
     {
-        if (doc->hasTagName(Serialization::Core::globalConfig))
+        const String name(e->getStringAttribute(Serialization::Core::nameAttribute));
+
+        if (name.isNotEmpty())
         {
-            forEachXmlChildElementWithTagName(*doc, e, Serialization::Core::valueTag)
+            if (XmlElement *child = e->getFirstChildElement())
             {
-                const String name(e->getStringAttribute(Serialization::Core::nameAttribute));
-
-                if (name.isNotEmpty())
-                {
-                    getAllProperties().set(name,
-                                           e->getFirstChildElement() != nullptr
-                                           ? e->getFirstChildElement()->createDocument(String::empty, true)
-                                           : e->getStringAttribute(Serialization::Core::valueAttribute));
-                }
+                this->entries[name] = new Entry(name, new XmlElement(*child));
+            }
+            else
+            {
+                this->entries[name] = new Entry(name, e->getStringAttribute(Serialization::Core::valueAttribute));
             }
-
-            return true;
         }
     }
 
-    return false;
+    // Convert to the sectioned format on the next save
+    this->needsWriting = 1;
+    return true;
 }
 
 
 void Config::timerCallback()
 {
-    this->saveIfNeeded();
     this->stopTimer();
+    this->notify();
+}
+
+void Config::run()
+{
+    while (!this->threadShouldExit())
+    {
+        this->wait(-1);
+
+        if (this->threadShouldExit())
+        {
+            return;
+        }
+
+        this->saveIfNeeded();
+    }
 }
 
 
 void Config::saveConfig(const String &key, const Serializable *serializer)
 {
-    ScopedPointer<XmlElement> serialized(serializer->serialize());
-    this->setValue(key, serialized);
+    if (XmlElement *serialized = serializer->serialize())
+    {
+        this->setEntry(new Entry(key, serialized));
+    }
 }
 
 void Config::loadConfig(const String &key, Serializable *serializer)
 {
-    ScopedPointer<XmlElement> xml(this->getXmlValue(key));
+    const Entry::Ptr entry(this->findEntry(key));
 
-    if (xml)
+    if (entry != nullptr && entry->xml != nullptr)
     {
-        serializer->deserialize(*xml);
+        serializer->deserialize(*entry->xml);
+    }
+    else if (entry != nullptr)
+    {
+        ScopedPointer<XmlElement> xml(XmlDocument::parse(entry->value.toString()));
+
+        if (xml != nullptr)
+        {
+            serializer->deserialize(*xml);
+        }
     }
 }
 
 
 void Config::propertyChanged()
 {
-    this->needsWriting = true;
+    this->needsWriting = 1;
 
     if (this->saveTimeout > 0)
     {
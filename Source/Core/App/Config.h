@@ -19,9 +19,14 @@
 
 class Serializable;
 
+// Keeps native values and pre-parsed xml trees in memory;
+// each key is stored in its own section of the settings file,
+// and only the sections changed since the last flush get re-encoded.
+// The file itself is written on a background thread.
+
 class Config :
-    public PropertySet,
-    private Timer
+    private Timer,
+    private Thread
 {
 public:
 
@@ -34,6 +39,8 @@ public:
     static void set(const String &keyName, const XmlElement *xml);
 
     static String get(StringRef keyName, const String &defaultReturnValue = String::empty);
+
+    static var getValue(StringRef keyName, const var &defaultReturnValue = var());
     
     static bool contains(StringRef keyName);
 
@@ -52,6 +59,16 @@ public:
 
     bool machineIdChanged();
 
+    void setProperty(const String &key, const var &value);
+
+    void setProperty(const String &key, const XmlElement *xml);
+
+    var getProperty(StringRef key, const var &defaultReturnValue) const;
+
+    XmlElement *getXmlProperty(StringRef key) const;
+
+    bool containsProperty(StringRef key) const;
+
     void saveConfig(const String &key, const Serializable *serializer);
 
     void loadConfig(const String &key, Serializable *serializer);
@@ -62,17 +79,56 @@ protected:
 
     bool reload();
 
-    void propertyChanged() override;
-
 private:
 
+    class Entry : public ReferenceCountedObject
+    {
+    public:
+
+        typedef ReferenceCountedObjectPtr<Entry> Ptr;
+
+        Entry(const String &key, const var &value);
+        Entry(const String &key, XmlElement *ownedXml);
+
+        const String key;
+        const var value;
+        const ScopedPointer<XmlElement> xml;
+
+        // Cached on-disk section, only accessed by the writer
+        MemoryBlock section;
+        bool hasSection;
+
+        void encodeSection();
+        static Entry *createFromSection(const String &key, int type, const MemoryBlock &data);
+
+    private:
+
+        JUCE_DECLARE_NON_COPYABLE(Entry)
+    };
+
+    void setEntry(Entry *entry);
+
+    Entry::Ptr findEntry(StringRef key) const;
+
+    bool reloadLegacy();
+
+    void propertyChanged();
+
     void timerCallback() override;
 
+    void run() override;
+
+    CriticalSection entriesLock;
+    SparseHashMap<String, Entry::Ptr, StringHash> entries;
+
+    // Serializes background writes and the final flush on exit
+    CriticalSection writeLock;
+
     InterProcessLock fileLock;
 
     File propertiesFile;
     
-    bool needsWriting;
+    Atomic<int> needsWriting;
     
     int saveTimeout;
 
@@ -17,38 +17,89 @@
 
 #pragma once
 
+#include "Tracer.h"
+
+#define HELIO_LOGGER_MAX_LINES 1000
+
+// Keeps the last HELIO_LOGGER_MAX_LINES lines in a ring,
+// collapsing consecutive repeats into a single "(xN)" line,
+// so that the log never grows unbounded in release builds.
+// Every message is also mirrored into the tracer as an instant event.
+
 class HelioLogger : public Logger,
                     public ChangeBroadcaster
 {
 public:
 
+    HelioLogger() :
+        firstLine(0),
+        numLines(0),
+        numRepeats(0) {}
+
     String getText()
     {
-#if JUCE_DEBUG
-        const ScopedReadLock lock(this->logLock);
-        return this->log;
-#else
-        return String::empty;
-#endif
+        const ScopedLock lock(this->logLock);
+
+        String result;
+        for (int i = 0; i < this->numLines; ++i)
+        {
+            result += this->lines[(this->firstLine + i) % HELIO_LOGGER_MAX_LINES];
+            result += "\n";
+        }
+
+        return result;
     }
 
 protected:
 
     void logMessage(const String &message) override
     {
+        Tracer::instant("log", message);
+
 #if JUCE_DEBUG
-        const ScopedWriteLock lock(this->logLock);
-        this->log += message;
-        this->log += "\n";
         Logger::outputDebugString(message);
-        this->sendChangeMessage();
 #endif
+
+        {
+            const ScopedLock lock(this->logLock);
+
+            if (this->numLines > 0 && message == this->lastMessage)
+            {
+                this->numRepeats++;
+                const int lastLine = (this->firstLine + this->numLines - 1) % HELIO_LOGGER_MAX_LINES;
+                this->lines[lastLine] = message + " (x" + String(this->numRepeats) + ")";
+            }
+            else
+            {
+                this->lastMessage = message;
+                this->numRepeats = 1;
+
+                if (this->numLines < HELIO_LOGGER_MAX_LINES)
+                {
+                    this->lines[(this->firstLine + this->numLines) % HELIO_LOGGER_MAX_LINES] = message;
+                    this->numLines++;
+                }
+                else
+                {
+                    this->lines[this->firstLine] = message;
+                    this->firstLine = (this->firstLine + 1) % HELIO_LOGGER_MAX_LINES;
+                }
+            }
+        }
+
+        // Change messages are coalesced, so the log view is synced once per dispatch
+        this->sendChangeMessage();
     }
 
 private:
 
-    ReadWriteLock logLock;
+    CriticalSection logLock;
+
+    String lines[HELIO_LOGGER_MAX_LINES];
+    int firstLine;
+    int numLines;
 
-    String log;
+    String lastMessage;
+    int numRepeats;
 
 };
@@ -0,0 +1,375 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "Tracer.h"
+
+#define TRACER_MAX_THREADS 16
+#define TRACER_EVENTS_PER_THREAD 1024
+#define TRACER_MAX_TEXT_LENGTH 48
+#define TRACER_MAX_THREAD_NAME_LENGTH 32
+
+namespace
+{
+    enum EventType
+    {
+        SpanBegin,
+        SpanEnd,
+        Counter,
+        Instant
+    };
+
+    struct TraceEvent
+    {
+        int64 ticks;
+        const char *name;
+        double value;
+        int type;
+        char text[TRACER_MAX_TEXT_LENGTH];
+    };
+
+    enum BufferState
+    {
+        Free,
+        Naming,
+        Active,
+        Released // the owner thread has exited, events are kept until reuse
+    };
+
+    // Single producer (the owning thread), single consumer (the exporter).
+    // writeIndex grows monotonically, slots are addressed modulo capacity;
+    // it is never reset on reuse, so the new owner just starts at firstIndex.
+    struct ThreadBuffer
+    {
+        Atomic<int> state;
+        Atomic<int> generation;
+        Atomic<uint32> writeIndex;
+        uint32 firstIndex;
+        char threadName[TRACER_MAX_THREAD_NAME_LENGTH];
+        TraceEvent events[TRACER_EVENTS_PER_THREAD];
+    };
+
+    Atomic<int> tracingEnabled(0);
+    ThreadBuffer buffers[TRACER_MAX_THREADS];
+    const int64 startTicks = Time::getHighResolutionTicks();
+
+    // Gives the buffer back when its thread exits,
+    // so that short-living threads don't exhaust the pool
+    struct ThreadBufferOwner
+    {
+        ~ThreadBufferOwner()
+        {
+            if (this->buffer != nullptr)
+            {
+                this->buffer->state.set(Released);
+            }
+        }
+
+        ThreadBuffer *buffer = nullptr;
+        bool hasNoBuffer = false;
+    };
+
+    thread_local ThreadBufferOwner currentThread;
+
+    ThreadBuffer *claimBufferInState(BufferState state) noexcept
+    {
+        for (auto &buffer : buffers)
+        {
+            if (buffer.state.compareAndSetBool(Naming, state))
+            {
+                return &buffer;
+            }
+        }
+
+        return nullptr;
+    }
+
+    ThreadBuffer *claimThreadBuffer() noexcept
+    {
+        // Prefer the never used ones, so that the events
+        // of exited threads are kept as long as possible
+        if (ThreadBuffer *buffer = claimBufferInState(Free))
+        {
+            return buffer;
+        }
+
+        return claimBufferInState(Released);
+    }
+
+    // The name is written right into the buffer, so that the first event
+    // of the audio thread doesn't allocate anything either
+    void copyThreadName(char *target, const char *name) noexcept
+    {
+        int i = 0;
+        for (; i < TRACER_MAX_THREAD_NAME_LENGTH - 1 && name[i] != 0; ++i)
+        {
+            target[i] = name[i];
+        }
+
+        target[i] = 0;
+    }
+
+    void copyThreadId(char *target, Thread::ThreadID threadId) noexcept
+    {
+        static const char *digits = "0123456789abcdef";
+        const uint64 id = uint64(pointer_sized_int(threadId));
+
+        // "Thread " and at most 16 hex digits always fit
+        char name[TRACER_MAX_THREAD_NAME_LENGTH] = "Thread ";
+        int length = 7;
+
+        for (int shift = 60; shift >= 0; shift -= 4)
+        {
+            if ((id >> shift) != 0 || shift == 0)
+            {
+                name[length++] = digits[(id >> shift) & 0xf];
+            }
+        }
+
+        name[length] = 0;
+        copyThreadName(target, name);
+    }
+
+    void nameThreadBuffer(ThreadBuffer *buffer) noexcept
+    {
+        if (Thread *thread = Thread::getCurrentThread())
+        {
+            thread->getThreadName().copyToUTF8(buffer->threadName, TRACER_MAX_THREAD_NAME_LENGTH);
+        }
+        else if (MessageManager::getInstanceWithoutCreating() != nullptr &&
+                 MessageManager::getInstanceWithoutCreating()->isThisTheMessageThread())
+        {
+            copyThreadName(buffer->threadName, "Message thread");
+        }
+        else
+        {
+            copyThreadId(buffer->threadName, Thread::getCurrentThreadId());
+        }
+
+        buffer->firstIndex = buffer->writeIndex.get();
+        buffer->generation.set(buffer->generation.get() + 1);
+        buffer->state.set(Active);
+    }
+
+    inline ThreadBuffer *getThreadBuffer() noexcept
+    {
+        if (currentThread.buffer != nullptr)
+        {
+            return currentThread.buffer;
+        }
+
+        if (currentThread.hasNoBuffer)
+        {
+            return nullptr;
+        }
+
+        // Happens once per thread, and takes a few compare-and-swaps at most
+        currentThread.buffer = claimThreadBuffer();
+        currentThread.hasNoBuffer = (currentThread.buffer == nullptr);
+
+        if (currentThread.buffer != nullptr)
+        {
+            nameThreadBuffer(currentThread.buffer);
+        }
+
+        return currentThread.buffer;
+    }
+
+    inline TraceEvent *beginWrite(ThreadBuffer *&buffer, uint32 &index) noexcept
+    {
+        if (tracingEnabled.get() == 0)
+        {
+            return nullptr;
+        }
+
+        buffer = getThreadBuffer();
+        if (buffer == nullptr)
+        {
+            return nullptr;
+        }
+
+        index = buffer->writeIndex.get();
+        TraceEvent *event = &buffer->events[index % TRACER_EVENTS_PER_THREAD];
+        event->ticks = Time::getHighResolutionTicks();
+        return event;
+    }
+
+    inline void endWrite(ThreadBuffer *buffer, uint32 index) noexcept
+    {
+        // Publishes the event to the consumer
+        buffer->writeIndex.set(index + 1);
+    }
+
+    void record(int type, const char *name, double value) noexcept
+    {
+        ThreadBuffer *buffer = nullptr;
+        uint32 index = 0;
+        if (TraceEvent *event = beginWrite(buffer, index))
+        {
+            event->type = type;
+            event->name = name;
+            event->value = value;
+            event->text[0] = 0;
+            endWrite(buffer, index);
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Recording
+//===----------------------------------------------------------------------===//
+
+void Tracer::setEnabled(bool shouldBeEnabled) noexcept
+{
+    tracingEnabled.set(shouldBeEnabled ? 1 : 0);
+}
+
+bool Tracer::isEnabled() noexcept
+{
+    return (tracingEnabled.get() != 0);
+}
+
+void Tracer::beginSpan(const char *name) noexcept
+{
+    record(SpanBegin, name, 0.0);
+}
+
+void Tracer::endSpan(const char *name) noexcept
+{
+    record(SpanEnd, name, 0.0);
+}
+
+void Tracer::counter(const char *name, double value) noexcept
+{
+    record(Counter, name, value);
+}
+
+void Tracer::instant(const char *name, const String &message) noexcept
+{
+    ThreadBuffer *buffer = nullptr;
+    uint32 index = 0;
+    if (TraceEvent *event = beginWrite(buffer, index))
+    {
+        event->type = Instant;
+        event->name = name;
+        event->value = 0.0;
+        message.copyToUTF8(event->text, TRACER_MAX_TEXT_LENGTH);
+        endWrite(buffer, index);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Export
+//===----------------------------------------------------------------------===//
+
+static Array<TraceEvent> takeSnapshot(ThreadBuffer &buffer)
+{
+    Array<TraceEvent> result;
+
+    const uint32 end = buffer.writeIndex.get();
+    const uint32 numAvailable = jmin(end - buffer.firstIndex, uint32(TRACER_EVENTS_PER_THREAD));
+    const uint32 start = end - numAvailable;
+
+    result.ensureStorageAllocated(int(numAvailable));
+    for (uint32 i = start; i != end; ++i)
+    {
+        result.add(buffer.events[i % TRACER_EVENTS_PER_THREAD]);
+    }
+
+    // The producer kept writing while we were copying:
+    // everything it could have overwritten since is discarded
+    // (including the slot it might be writing right now).
+    const uint32 newEnd = buffer.writeIndex.get();
+    const uint32 firstValid = (newEnd >= TRACER_EVENTS_PER_THREAD) ?
+        (newEnd - TRACER_EVENTS_PER_THREAD + 1) : 0;
+
+    if (firstValid > start)
+    {
+        result.removeRange(0, int(jmin(firstValid - start, numAvailable)));
+    }
+
+    return result;
+}
+
+static var serializeEvent(const TraceEvent &event, int threadIndex)
+{
+    static const char *phases[] = { "B", "E", "C", "i" };
+
+    DynamicObject::Ptr json(new DynamicObject());
+    json->setProperty("name", String(CharPointer_UTF8(event.name)));
+    json->setProperty("ph", phases[event.type]);
+    json->setProperty("pid", 1);
+    json->setProperty("tid", threadIndex);
+    json->setProperty("ts", Time::highResolutionTicksToSeconds(event.ticks - startTicks) * 1000000.0);
+
+    if (event.type == Counter)
+    {
+        DynamicObject::Ptr args(new DynamicObject());
+        args->setProperty("value", event.value);
+        json->setProperty("args", var(args));
+    }
+    else if (event.type == Instant)
+    {
+        DynamicObject::Ptr args(new DynamicObject());
+        args->setProperty("message", String(CharPointer_UTF8(event.text)));
+        json->setProperty("args", var(args));
+        json->setProperty("s", "t");
+    }
+
+    return var(json);
+}
+
+bool Tracer::exportChromeTrace(const File &file)
+{
+    Array<var> traceEvents;
+
+    for (int i = 0; i < TRACER_MAX_THREADS; ++i)
+    {
+        ThreadBuffer &buffer = buffers[i];
+        const int state = buffer.state.get();
+        if (state != Active && state != Released)
+        {
+            continue; // unused or still being named
+        }
+
+        // A reused buffer belongs to another thread, so it gets another tid
+        const int threadIndex = i + TRACER_MAX_THREADS * (buffer.generation.get() - 1);
+
+        DynamicObject::Ptr threadName(new DynamicObject());
+        DynamicObject::Ptr threadNameArgs(new DynamicObject());
+        threadNameArgs->setProperty("name", String(CharPointer_UTF8(buffer.threadName)));
+        threadName->setProperty("name", "thread_name");
+        threadName->setProperty("ph", "M");
+        threadName->setProperty("pid", 1);
+        threadName->setProperty("tid", threadIndex);
+        threadName->setProperty("args", var(threadNameArgs));
+        traceEvents.add(var(threadName));
+
+        const Array<TraceEvent> events(takeSnapshot(buffer));
+        for (const auto &event : events)
+        {
+            traceEvents.add(serializeEvent(event, threadIndex));
+        }
+    }
+
+    DynamicObject::Ptr root(new DynamicObject());
+    root->setProperty("traceEvents", traceEvents);
+    root->setProperty("displayTimeUnit", "ms");
+
+    Logger::writeToLog("Exporting " + String(traceEvents.size()) + " trace events to " + file.getFullPathName());
+    return file.replaceWithText(JSON::toString(var(root), true));
+}
@@ -0,0 +1,80 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Realtime-safe event tracing.
+// Every thread that emits an event claims its own preallocated ring buffer
+// once, and from then on writes into it without locks or allocations,
+// so spans and counters can be emitted from the audio and player threads.
+// The buffer is released when its thread exits and can be reused later.
+// Old events are overwritten; the exporter takes a consistent snapshot
+// of whatever is still in the rings and writes a Chrome trace json.
+
+class Tracer
+{
+public:
+
+    static void setEnabled(bool shouldBeEnabled) noexcept;
+
+    static bool isEnabled() noexcept;
+
+    // All names must be string literals (only the pointers are stored)
+    static void beginSpan(const char *name) noexcept;
+
+    static void endSpan(const char *name) noexcept;
+
+    static void counter(const char *name, double value) noexcept;
+
+    // The message is truncated to a fixed-size buffer
+    static void instant(const char *name, const String &message) noexcept;
+
+    static bool exportChromeTrace(const File &file);
+
+    class ScopedSpan
+    {
+    public:
+
+        explicit ScopedSpan(const char *spanName) noexcept :
+            name(Tracer::isEnabled() ? spanName : nullptr)
+        {
+            if (this->name != nullptr)
+            {
+                Tracer::beginSpan(this->name);
+            }
+        }
+
+        ~ScopedSpan() noexcept
+        {
+            if (this->name != nullptr)
+            {
+                Tracer::endSpan(this->name);
+            }
+        }
+
+    private:
+
+        const char *name;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedSpan)
+
+    };
+
+};
+
+#define TRACE_SCOPE(name) \
+    const Tracer::ScopedSpan JUCE_JOIN_MACRO(traceSpan, __LINE__)(name)
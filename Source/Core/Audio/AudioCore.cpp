@@ -22,6 +22,7 @@
 #include "PluginWindow.h"
 #include "OrchestraPit.h"
 #include "Instrument.h"
+#include "InstrumentLoader.h"
 #include "DataEncoder.h"
 #include "SerializationKeys.h"
 #include "AudioMonitor.h"
@@ -43,6 +44,9 @@ AudioCore::AudioCore()
 
     AudioCore::initAudioFormats(this->formatManager);
 
+    this->instrumentLoader = new InstrumentLoader(this->formatManager,
+        [this](Instrument *instrument) { this->broadcastInstrumentLoaded(instrument); });
+
     // requesting 0 inputs and only 2 outputs because of fucking alsa
     this->deviceManager.initialise(0, 2, nullptr, true);
 
@@ -109,7 +113,7 @@ AudioMonitor *AudioCore::getMonitor() const noexcept
 Instrument *AudioCore::addInstrument(const PluginDescription &pluginDescription,
                                      const String &name)
 {
-    auto instrument = new Instrument(formatManager, name);
+    auto instrument = new Instrument(this->formatManager, *this->instrumentLoader, name);
     this->addInstrumentToDevice(instrument);
 
     instrument->initializeFrom(pluginDescription);
@@ -281,7 +285,7 @@ void AudioCore::deserialize(const XmlElement &xml)
         {
             //Logger::writeToLog("--- instrument ---");
             //Logger::writeToLog(instrumentNode->createDocument(""));
-            Instrument *instrument = new Instrument(this->formatManager, "");
+            Instrument *instrument = new Instrument(this->formatManager, *this->instrumentLoader, "");
             this->addInstrumentToDevice(instrument);
             instrument->deserialize(*instrumentNode);
             this->instruments.add(instrument);
@@ -18,6 +18,7 @@
 #pragma once
 
 class Instrument;
+class InstrumentLoader;
 class AudioMonitor;
 
 #include "Serializable.h"
@@ -122,6 +123,11 @@ private:
     ScopedPointer<AudioMonitor> audioMonitor;
 
     AudioPluginFormatManager formatManager;
+
+    // Stops its jobs before the formats are gone;
+    // the instruments don't use it on destruction
+    ScopedPointer<InstrumentLoader> instrumentLoader;
+
     AudioDeviceManager deviceManager;
     
     WeakReference<AudioCore>::Master masterReference;
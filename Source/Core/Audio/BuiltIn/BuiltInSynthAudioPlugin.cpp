@@ -19,8 +19,50 @@
 #include "BuiltInSynthAudioPlugin.h"
 #include "BuiltInSynthFormat.h"
 
-BuiltInSynthAudioPlugin::BuiltInSynthAudioPlugin()
+BuiltInSynthAudioPlugin::BuiltInSynthAudioPlugin() :
+    hasPendingTuning(0)
 {
+    Tuning::fillEqualTemperament(this->keyFrequencies);
+    Tuning::fillEqualTemperament(this->pendingKeyFrequencies);
+}
+
+void BuiltInSynthAudioPlugin::setTuning(const Tuning &tuning)
+{
+    const SpinLock::ScopedLockType lock(this->tuningLock);
+
+    for (int key = 0; key < TUNING_NUM_KEYS; ++key)
+    {
+        this->pendingKeyFrequencies[key] = tuning.getFrequency(key);
+    }
+
+    this->hasPendingTuning = 1;
+}
+
+void BuiltInSynthAudioPlugin::updateTuning(const MidiBuffer &midiMessages) noexcept
+{
+    if (this->hasPendingTuning.get() != 0)
+    {
+        // Never waits for the message thread: if it is busy
+        // with the table right now, the next block will take it
+        const SpinLock::ScopedTryLockType lock(this->tuningLock);
+        if (lock.isLocked())
+        {
+            memcpy(this->keyFrequencies, this->pendingKeyFrequencies, sizeof(this->keyFrequencies));
+            this->hasPendingTuning = 0;
+        }
+    }
+
+    MidiBuffer::Iterator it(midiMessages);
+    const uint8 *data = nullptr;
+    int numBytes = 0;
+    int samplePosition = 0;
+    while (it.getNextEvent(data, numBytes, samplePosition))
+    {
+        if (numBytes > 2 && data[0] == 0xf0)
+        {
+            Tuning::applyTuningMessage(data + 1, numBytes - 2, this->keyFrequencies);
+        }
+    }
 }
 
 
@@ -51,6 +93,7 @@ void BuiltInSynthAudioPlugin::fillInPluginDescription(PluginDescription &descrip
 void BuiltInSynthAudioPlugin::processBlock(AudioSampleBuffer &buffer, MidiBuffer &midiMessages)
 {
     buffer.clear(0, buffer.getNumSamples());
+    this->updateTuning(midiMessages);
     this->synth.renderNextBlock(buffer, midiMessages, 0, buffer.getNumSamples());
 
     //// This is the place where you'd normally do the guts of your plugin's
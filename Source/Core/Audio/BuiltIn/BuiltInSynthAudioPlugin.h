@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include "Tuning.h"
+
 #define BUILTIN_SYNTH_NUM_VOICES 32
 
 class BuiltInSynthAudioPlugin : public AudioPluginInstance
@@ -25,6 +27,11 @@ public:
 
     BuiltInSynthAudioPlugin();
 
+    // Called from the message thread, the voices
+    // pick up the new tuning at the next audio block;
+    // MIDI Tuning Standard messages are also understood
+    void setTuning(const Tuning &tuning);
+
     //===------------------------------------------------------------------===//
     // AudioPluginInstance
     //===------------------------------------------------------------------===//
@@ -105,4 +112,15 @@ protected:
 
     Synthesiser synth;
 
+    // Read by the voices, only changed on the audio thread
+    double keyFrequencies[TUNING_NUM_KEYS];
+
+private:
+
+    void updateTuning(const MidiBuffer &midiMessages) noexcept;
+
+    double pendingKeyFrequencies[TUNING_NUM_KEYS];
+    Atomic<int> hasPendingTuning;
+    SpinLock tuningLock;
+
 };
@@ -17,6 +17,7 @@
 
 #include "Common.h"
 #include "BuiltInSynthPiano.h"
+#include "BuiltInSynthVoice.h"
 #include "BinaryData.h"
 
 #define ATTACK_TIME 0.0
@@ -64,7 +65,7 @@ void BuiltInSynthPiano::initVoices()
 {
     for (int i = BUILTIN_SYNTH_NUM_VOICES; --i >= 0;)
     {
-        this->synth.addVoice(new SamplerVoice());
+        this->synth.addVoice(new BuiltInSynthVoice(this->keyFrequencies));
     }
 }
 
@@ -93,13 +94,13 @@ void BuiltInSynthPiano::initSampler()
 
     for (auto s : this->samples)
     {
-        this->synth.addSound(new SamplerSound(s->name,
-                                              *s->reader,
-                                              s->midiNotes,
-                                              s->midiNoteForNormalPitch,
-                                              ATTACK_TIME,
-                                              RELEASE_TIME,
-                                              MAX_PLAY_TIME));
+        this->synth.addSound(new BuiltInSynthSound(s->name,
+                                                   *s->reader,
+                                                   s->midiNotes,
+                                                   s->midiNoteForNormalPitch,
+                                                   ATTACK_TIME,
+                                                   RELEASE_TIME,
+                                                   MAX_PLAY_TIME));
     }
 }
 
@@ -0,0 +1,190 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "BuiltInSynthVoice.h"
+
+#define BUILTIN_SYNTH_PITCH_WHEEL_RANGE 2.0
+
+BuiltInSynthSound::BuiltInSynthSound(const String &name,
+    AudioFormatReader &source,
+    const BigInteger &midiNotes,
+    int midiNoteForNormalPitch,
+    double attackTimeSecs,
+    double releaseTimeSecs,
+    double maxSampleLengthSeconds) :
+    SamplerSound(name, source, midiNotes, midiNoteForNormalPitch,
+        attackTimeSecs, releaseTimeSecs, maxSampleLengthSeconds),
+    rootKey(midiNoteForNormalPitch),
+    sourceSampleRate(source.sampleRate),
+    length(jmin(int(source.lengthInSamples), int(maxSampleLengthSeconds * source.sampleRate))),
+    attackSamples(roundToInt(attackTimeSecs * source.sampleRate)),
+    releaseSamples(roundToInt(releaseTimeSecs * source.sampleRate)) {}
+
+BuiltInSynthVoice::BuiltInSynthVoice(const double *keyFrequencies) :
+    keyFrequencies(keyFrequencies),
+    pitchRatio(0.0),
+    pitchWheelRatio(1.0),
+    sourceSamplePosition(0.0),
+    gain(0.f),
+    attackReleaseLevel(0.f),
+    attackDelta(0.f),
+    releaseDelta(0.f),
+    isInAttack(false),
+    isInRelease(false) {}
+
+bool BuiltInSynthVoice::canPlaySound(SynthesiserSound *sound)
+{
+    return (dynamic_cast<const BuiltInSynthSound *>(sound) != nullptr);
+}
+
+double BuiltInSynthVoice::getPitchWheelRatio(int pitchWheelPosition) noexcept
+{
+    const double semitones = (pitchWheelPosition - 8192) / 8192.0 * BUILTIN_SYNTH_PITCH_WHEEL_RANGE;
+    return pow(2.0, semitones / 12.0);
+}
+
+void BuiltInSynthVoice::startNote(int midiNoteNumber, float velocity,
+    SynthesiserSound *s, int currentPitchWheelPosition)
+{
+    const auto sound = dynamic_cast<const BuiltInSynthSound *>(s);
+    const double frequency = this->keyFrequencies[midiNoteNumber & 0x7f];
+
+    // The keys left unmapped by the tuning are silent
+    if (sound == nullptr || frequency <= 0.0)
+    {
+        this->clearCurrentNote();
+        return;
+    }
+
+    this->pitchRatio = frequency / MidiMessage::getMidiNoteInHertz(sound->rootKey) *
+        sound->sourceSampleRate / this->getSampleRate();
+
+    this->pitchWheelRatio = getPitchWheelRatio(currentPitchWheelPosition);
+    this->sourceSamplePosition = 0.0;
+    this->gain = velocity;
+    this->isInAttack = (sound->attackSamples > 0);
+    this->isInRelease = false;
+
+    if (this->isInAttack)
+    {
+        this->attackReleaseLevel = 0.f;
+        this->attackDelta = float(this->pitchRatio / sound->attackSamples);
+    }
+    else
+    {
+        this->attackReleaseLevel = 1.f;
+        this->attackDelta = 0.f;
+    }
+
+    this->releaseDelta = (sound->releaseSamples > 0) ?
+        float(-this->pitchRatio / sound->releaseSamples) : -1.f;
+}
+
+void BuiltInSynthVoice::stopNote(float velocity, bool allowTailOff)
+{
+    if (allowTailOff)
+    {
+        this->isInAttack = false;
+        this->isInRelease = true;
+    }
+    else
+    {
+        this->clearCurrentNote();
+    }
+}
+
+void BuiltInSynthVoice::pitchWheelMoved(int newValue)
+{
+    this->pitchWheelRatio = getPitchWheelRatio(newValue);
+}
+
+void BuiltInSynthVoice::controllerMoved(int controllerNumber, int newValue)
+{
+}
+
+void BuiltInSynthVoice::renderNextBlock(AudioSampleBuffer &outputBuffer, int startSample, int numSamples)
+{
+    const auto sound = static_cast<const BuiltInSynthSound *>(this->getCurrentlyPlayingSound().get());
+    if (sound == nullptr)
+    {
+        return;
+    }
+
+    const AudioSampleBuffer &data = *sound->getAudioData();
+    const float *const inL = data.getReadPointer(0);
+    const float *const inR = (data.getNumChannels() > 1) ? data.getReadPointer(1) : nullptr;
+
+    float *outL = outputBuffer.getWritePointer(0, startSample);
+    float *outR = (outputBuffer.getNumChannels() > 1) ? outputBuffer.getWritePointer(1, startSample) : nullptr;
+
+    const double step = this->pitchRatio * this->pitchWheelRatio;
+
+    while (--numSamples >= 0)
+    {
+        const int pos = int(this->sourceSamplePosition);
+        const float alpha = float(this->sourceSamplePosition - pos);
+        const float invAlpha = 1.f - alpha;
+
+        float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha) * this->gain;
+        float r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) * this->gain : l;
+
+        if (this->isInAttack)
+        {
+            l *= this->attackReleaseLevel;
+            r *= this->attackReleaseLevel;
+            this->attackReleaseLevel += this->attackDelta;
+
+            if (this->attackReleaseLevel >= 1.f)
+            {
+                this->attackReleaseLevel = 1.f;
+                this->isInAttack = false;
+            }
+        }
+        else if (this->isInRelease)
+        {
+            l *= this->attackReleaseLevel;
+            r *= this->attackReleaseLevel;
+            this->attackReleaseLevel += this->releaseDelta;
+
+            if (this->attackReleaseLevel <= 0.f)
+            {
+                this->stopNote(0.f, false);
+                break;
+            }
+        }
+
+        if (outR != nullptr)
+        {
+            *outL++ += l;
+            *outR++ += r;
+        }
+        else
+        {
+            *outL++ += (l + r) * 0.5f;
+        }
+
+        this->sourceSamplePosition += step;
+
+        if (this->sourceSamplePosition > sound->length)
+        {
+            this->stopNote(0.f, false);
+            break;
+        }
+    }
+}
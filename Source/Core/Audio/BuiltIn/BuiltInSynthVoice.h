@@ -0,0 +1,86 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+// The same as juce's sampler, except that the voices are tuned
+// by a table of key frequencies instead of the equal temperament,
+// and they follow the pitch wheel
+
+class BuiltInSynthSound final : public SamplerSound
+{
+public:
+
+    BuiltInSynthSound(const String &name,
+        AudioFormatReader &source,
+        const BigInteger &midiNotes,
+        int midiNoteForNormalPitch,
+        double attackTimeSecs,
+        double releaseTimeSecs,
+        double maxSampleLengthSeconds);
+
+    // SamplerSound only shares these with SamplerVoice
+    const int rootKey;
+    const double sourceSampleRate;
+    const int length;
+    const int attackSamples;
+    const int releaseSamples;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BuiltInSynthSound)
+};
+
+class BuiltInSynthVoice final : public SynthesiserVoice
+{
+public:
+
+    // The frequencies table is owned by the synth
+    // and is only changed on the audio thread
+    explicit BuiltInSynthVoice(const double *keyFrequencies);
+
+    bool canPlaySound(SynthesiserSound *sound) override;
+
+    void startNote(int midiNoteNumber, float velocity,
+        SynthesiserSound *sound, int currentPitchWheelPosition) override;
+    void stopNote(float velocity, bool allowTailOff) override;
+
+    void pitchWheelMoved(int newValue) override;
+    void controllerMoved(int controllerNumber, int newValue) override;
+
+    void renderNextBlock(AudioSampleBuffer &outputBuffer,
+        int startSample, int numSamples) override;
+
+private:
+
+    static double getPitchWheelRatio(int pitchWheelPosition) noexcept;
+
+    const double *keyFrequencies;
+
+    double pitchRatio;
+    double pitchWheelRatio;
+    double sourceSamplePosition;
+
+    float gain;
+    float attackReleaseLevel;
+    float attackDelta;
+    float releaseDelta;
+
+    bool isInAttack;
+    bool isInRelease;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BuiltInSynthVoice)
+};
@@ -17,6 +17,7 @@
 
 #include "Common.h"
 #include "Instrument.h"
+#include "InstrumentLoader.h"
 #include "PluginWindow.h"
 #include "InternalPluginFormat.h"
 #include "PluginSmartDescription.h"
@@ -24,8 +25,10 @@
 
 const int Instrument::midiChannelNumber = 0x1000;
 
-Instrument::Instrument(AudioPluginFormatManager &formatManager, String name) :
+Instrument::Instrument(AudioPluginFormatManager &formatManager,
+    InstrumentLoader &loader, String name) :
     formatManager(formatManager),
+    loader(loader),
     instrumentName(std::move(name)),
     lastUID(0),
     instrumentID()
@@ -342,8 +345,55 @@ void Instrument::removeConnection(AudioProcessorGraph::Connection connection)
     this->sendChangeMessage();
 }
 
+//===----------------------------------------------------------------------===//
+// External MIDI output
+//===----------------------------------------------------------------------===//
+
+void Instrument::setMidiOutput(const String &deviceName, double latencyMs)
+{
+    MidiOutputSender::Ptr newSender;
+
+    if (deviceName.isNotEmpty())
+    {
+        const MidiOutputSender::Ptr currentSender(this->getMidiOutputSender());
+        if (currentSender != nullptr && currentSender->getDeviceName() == deviceName)
+        {
+            currentSender->setLatency(latencyMs);
+            return;
+        }
+
+        newSender = MidiOutputSender::openDevice(deviceName, latencyMs);
+
+        if (newSender != nullptr && currentSender != nullptr)
+        {
+            newSender->setTuningMode(currentSender->getTuningMode());
+        }
+    }
+
+    {
+        const SpinLock::ScopedLockType lock(this->midiOutputLock);
+        this->midiOutputSender = newSender;
+    }
+
+    this->sendChangeMessage();
+}
+
+String Instrument::getMidiOutputName() const noexcept
+{
+    const MidiOutputSender::Ptr sender(this->getMidiOutputSender());
+    return (sender != nullptr) ? sender->getDeviceName() : String::empty;
+}
+
+MidiOutputSender::Ptr Instrument::getMidiOutputSender() const noexcept
+{
+    const SpinLock::ScopedLockType lock(this->midiOutputLock);
+    return this->midiOutputSender;
+}
+
 void Instrument::reset()
 {
+    this->loader.cancel(*this);
+    this->pendingXml = nullptr;
     PluginWindow::closeAllCurrentlyOpenWindows();
     this->processorGraph->clear();
     this->sendChangeMessage();
@@ -360,6 +410,13 @@ XmlElement *Instrument::serialize() const
     xml->setAttribute(Serialization::Core::instrumentId, this->instrumentID.toString());
     xml->setAttribute(Serialization::Core::instrumentName, this->instrumentName);
 
+    if (const MidiOutputSender::Ptr sender = this->getMidiOutputSender())
+    {
+        xml->setAttribute(Serialization::Core::instrumentMidiOutput, sender->getDeviceName());
+        xml->setAttribute(Serialization::Core::instrumentMidiOutputLatency, sender->getLatency());
+        xml->setAttribute(Serialization::Core::instrumentMidiOutputTuning, int(sender->getTuningMode()));
+    }
+
     const int numNodes = this->processorGraph->getNumNodes();
     for (int i = 0; i < numNodes; ++i)
     {
@@ -376,6 +433,20 @@ XmlElement *Instrument::serialize() const
         xml->addChildElement(e);
     }
 
+    // Saving while the nodes are still loading should not lose them
+    if (this->pendingXml != nullptr)
+    {
+        forEachXmlChildElementWithTagName(*this->pendingXml, e, Serialization::Core::instrumentNode)
+        {
+            xml->addChildElement(new XmlElement(*e));
+        }
+
+        forEachXmlChildElementWithTagName(*this->pendingXml, e, Serialization::Core::instrumentConnection)
+        {
+            xml->addChildElement(new XmlElement(*e));
+        }
+    }
+
     return xml;
 }
 
@@ -392,46 +463,25 @@ void Instrument::deserialize(const XmlElement &xml)
     this->instrumentID = root->getStringAttribute(Serialization::Core::instrumentId, this->instrumentID.toString());
     this->instrumentName = root->getStringAttribute(Serialization::Core::instrumentName, this->instrumentName);
 
-    // Well this hack of an incredible ugliness
-    // is here to handle loading of async-loaded AUv3 plugins
-    
-    // Fill up the connections info for further processing
-    struct ConnectionDescription
-    {
-        uint32 srcFilter;
-        uint32 dstFilter;
-        int srcChannel;
-        int dstChannel;
-    };
-    
-    Array<ConnectionDescription> connectionDescriptions;
-    
-    forEachXmlChildElementWithTagName(*root, e, Serialization::Core::instrumentConnection)
+    this->setMidiOutput(root->getStringAttribute(Serialization::Core::instrumentMidiOutput),
+        root->getDoubleAttribute(Serialization::Core::instrumentMidiOutputLatency));
+
+    if (const MidiOutputSender::Ptr sender = this->getMidiOutputSender())
     {
-        connectionDescriptions.add({
-            static_cast<uint32>(e->getIntAttribute("srcFilter")),
-            static_cast<uint32>(e->getIntAttribute("dstFilter")),
-            e->getIntAttribute("srcChannel"),
-            e->getIntAttribute("dstChannel")
-        });
+        const int tuningMode = root->getIntAttribute(Serialization::Core::instrumentMidiOutputTuning);
+        sender->setTuningMode(MidiOutputSender::TuningMode(jlimit(0, 2, tuningMode)));
     }
-    
+
+    // The uids of the nodes being loaded are reserved right away,
+    // so that the nodes added in the meantime never take them
     forEachXmlChildElementWithTagName(*root, e, Serialization::Core::instrumentNode)
     {
-        this->createNodeFromXmlAsync(*e,
-            [this, connectionDescriptions](AudioProcessorGraph::Node::Ptr)
-            {
-                // Try to create as many connections as possible
-                for (const auto &connectionInfo : connectionDescriptions)
-                {
-                    this->addConnection(connectionInfo.srcFilter, connectionInfo.srcChannel,
-                                        connectionInfo.dstFilter, connectionInfo.dstChannel);
-                }
-                                         
-                this->processorGraph->removeIllegalConnections();
-                this->sendChangeMessage();
-            });
+        const auto uid = static_cast<AudioProcessorGraph::NodeID>(e->getIntAttribute("uid"));
+        this->lastUID = jmax(this->lastUID, uid);
     }
+
+    this->pendingXml = new XmlElement(*root);
+    this->loader.loadNodes(*this, *root);
 }
 
 XmlElement *Instrument::createNodeXml(AudioProcessorGraph::Node::Ptr node) const
@@ -464,108 +514,6 @@ XmlElement *Instrument::createNodeXml(AudioProcessorGraph::Node::Ptr node) const
     return nullptr;
 }
 
-void Instrument::createNodeFromXmlAsync(const XmlElement &xml,
-    std::function<void (AudioProcessorGraph::Node::Ptr)> f)
-{
-    PluginSmartDescription pd;
-    
-    forEachXmlChildElement(xml, e)
-    {
-        if (pd.loadFromXml(*e))
-        { break; }
-    }
-    
-    MemoryBlock nodeStateBlock;
-    const XmlElement *const state = xml.getChildByName(Serialization::Core::pluginState);
-    if (state != nullptr)
-    {
-        nodeStateBlock.fromBase64Encoding(state->getAllSubText());
-    }
-    
-    const uint32 nodeUid = xml.getIntAttribute("uid");
-    const String nodeHash = xml.getStringAttribute("hash");
-    const double nodeX = xml.getDoubleAttribute("x");
-    const double nodeY = xml.getDoubleAttribute("y");
-    const double nodeLastX = xml.getDoubleAttribute("uiLastX");
-    const double nodeLastY = xml.getDoubleAttribute("uiLastY");
-    
-    formatManager.
-    createPluginInstanceAsync(pd,
-        this->processorGraph->getSampleRate(),
-        this->processorGraph->getBlockSize(),
-        [this, nodeStateBlock, nodeUid, nodeHash, nodeX, nodeY, nodeLastX, nodeLastY, f]
-        (AudioPluginInstance *instance, const String &error)
-        {
-            if (instance == nullptr)
-            {
-                f(nullptr);
-                return;
-            }
-
-            AudioProcessorGraph::Node::Ptr node(this->processorGraph->addNode(instance, nodeUid));
-
-            if (nodeStateBlock.getSize() > 0)
-            {
-                node->getProcessor()->
-                    setStateInformation(nodeStateBlock.getData(),
-                        static_cast<int>(nodeStateBlock.getSize()));
-            }
-
-            Uuid fallbackRandomHash;
-            node->properties.set("x", nodeX);
-            node->properties.set("y", nodeY);
-            node->properties.set("hash", nodeHash.isNotEmpty() ? nodeHash : fallbackRandomHash.toString());
-            node->properties.set("uiLastX", nodeLastX);
-            node->properties.set("uiLastY", nodeLastY);
-
-            f(node);
-        });
-}
-
-void Instrument::createNodeFromXml(const XmlElement &xml)
-{
-    PluginSmartDescription pd;
-
-    forEachXmlChildElement(xml, e)
-    {
-        if (pd.loadFromXml(*e))
-        { break; }
-    }
-    
-    String errorMessage;
-
-    AudioPluginInstance *instance =
-        formatManager.createPluginInstance(pd,
-                                           this->processorGraph->getSampleRate(),
-                                           this->processorGraph->getBlockSize(),
-                                           errorMessage);
-
-    if (instance == nullptr)
-    {
-        return;
-    }
-
-    AudioProcessorGraph::Node::Ptr node(this->processorGraph->addNode(instance, xml.getIntAttribute("uid")));
-
-    const XmlElement *const state = xml.getChildByName(Serialization::Core::pluginState);
-
-    if (state != nullptr)
-    {
-        MemoryBlock m;
-        m.fromBase64Encoding(state->getAllSubText());
-        node->getProcessor()->setStateInformation(m.getData(), static_cast<int>( m.getSize()));
-    }
-
-    const String& hash = xml.getStringAttribute("hash");
-    Uuid fallbackRandomHash;
-    
-    node->properties.set("x", xml.getDoubleAttribute("x"));
-    node->properties.set("y", xml.getDoubleAttribute("y"));
-    node->properties.set("hash", hash.isNotEmpty() ? hash : fallbackRandomHash.toString());
-    node->properties.set("uiLastX", xml.getIntAttribute("uiLastX"));
-    node->properties.set("uiLastY", xml.getIntAttribute("uiLastY"));
-}
-
 void Instrument::initializeDefaultNodes()
 {
     InternalPluginFormat internalFormat;
@@ -20,8 +20,10 @@
 class AudioCore;
 class FilterInGraph;
 class Instrument;
+class InstrumentLoader;
 
 #include "Serializable.h"
+#include "MidiOutputSender.h"
 
 class Instrument :
     public Serializable,
@@ -29,7 +31,8 @@ class Instrument :
 {
 public:
 
-    Instrument(AudioPluginFormatManager &formatManager, String name);
+    Instrument(AudioPluginFormatManager &formatManager,
+        InstrumentLoader &loader, String name);
     ~Instrument() override;
 
     String getName() const;
@@ -90,11 +93,27 @@ public:
     bool addConnection(AudioProcessorGraph::NodeID sourceID, int sourceChannel,
         AudioProcessorGraph::NodeID destinationID, int destinationChannel);
 
+    //===------------------------------------------------------------------===//
+    // External MIDI output
+    //===------------------------------------------------------------------===//
+
+    // Everything sent to this instrument is also sent to the output device;
+    // pass an empty device name to disconnect
+    void setMidiOutput(const String &deviceName, double latencyMs = 0.0);
+    String getMidiOutputName() const noexcept;
+
+    // The player thread takes its own reference at playback start,
+    // so changing the output never pulls the sender from under it
+    MidiOutputSender::Ptr getMidiOutputSender() const noexcept;
+
     //===------------------------------------------------------------------===//
     // Serializable
     //===------------------------------------------------------------------===//
 
     XmlElement *serialize() const override;
+
+    // Only restores the properties right away, the nodes are restored
+    // by the loader in background, and activated when all of them are ready
     void deserialize(const XmlElement &xml) override;
     void reset() override;
 
@@ -125,20 +144,26 @@ private:
 
     friend class Transport;
     friend class AudioCore;
+    friend class InstrumentLoader;
     
 private:
 
     AudioPluginFormatManager &formatManager;
+    InstrumentLoader &loader;
     AudioProcessorPlayer processorPlayer;
     ScopedPointer<AudioProcessorGraph> processorGraph;
 
+    MidiOutputSender::Ptr midiOutputSender;
+    mutable SpinLock midiOutputLock;
+
     AudioProcessorGraph::NodeID lastUID;
     AudioProcessorGraph::NodeID getNextUID() noexcept;
 
+    // The nodes and connections that are still being restored by the loader;
+    // kept to be saved as is, since the graph is empty until they're ready
+    ScopedPointer<XmlElement> pendingXml;
+
     XmlElement *createNodeXml(AudioProcessorGraph::Node::Ptr node) const;
-    void createNodeFromXml(const XmlElement &xml);
-    void createNodeFromXmlAsync(const XmlElement &xml,
-        std::function<void (AudioProcessorGraph::Node::Ptr)> f);
 
 private:
 
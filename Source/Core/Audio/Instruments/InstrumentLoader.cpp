@@ -0,0 +1,405 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "InstrumentLoader.h"
+#include "Instrument.h"
+#include "InternalPluginFormat.h"
+#include "BuiltInSynthFormat.h"
+#include "PluginSmartDescription.h"
+#include "SerializationKeys.h"
+
+struct InstrumentLoader::NodeLoad final : public ReferenceCountedObject
+{
+    enum State
+    {
+        Decoding,
+        WaitsForMessageThread,
+        Creating,
+        Ready,
+        Failed
+    };
+
+    void restoreState()
+    {
+        if (this->stateData.getSize() > 0)
+        {
+            this->instance->setStateInformation(this->stateData.getData(),
+                static_cast<int>(this->stateData.getSize()));
+        }
+
+        this->stateData.reset();
+    }
+
+    bool isFinished() const noexcept
+    {
+        return this->state.get() == Ready || this->state.get() == Failed;
+    }
+
+    // Filled on the message thread before the job starts
+    PluginDescription description;
+    AudioPluginFormat *threadSafeFormat;
+    double sampleRate;
+    int blockSize;
+    String encodedState;
+
+    AudioProcessorGraph::NodeID uid;
+    String hash;
+    double x;
+    double y;
+    double lastX;
+    double lastY;
+
+    // Filled by whoever gets to create the plugin
+    MemoryBlock stateData;
+    ScopedPointer<AudioPluginInstance> instance;
+
+    Atomic<int> state;
+    Atomic<int> isCancelled;
+
+    typedef ReferenceCountedObjectPtr<NodeLoad> Ptr;
+};
+
+struct InstrumentLoader::InstrumentLoad final
+{
+    struct ConnectionDescription
+    {
+        uint32 srcFilter;
+        uint32 dstFilter;
+        int srcChannel;
+        int dstChannel;
+    };
+
+    bool isFinished() const noexcept
+    {
+        for (const auto node : this->nodes)
+        {
+            if (! node->isFinished())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void cancel()
+    {
+        for (const auto node : this->nodes)
+        {
+            node->isCancelled.set(1);
+        }
+    }
+
+    WeakReference<Instrument> instrument;
+    ReferenceCountedArray<NodeLoad> nodes;
+    Array<ConnectionDescription> connections;
+    double startTimeMs;
+};
+
+class InstrumentLoader::NodeJob final : public ThreadPoolJob
+{
+public:
+
+    NodeJob(InstrumentLoader &loader, NodeLoad *node) :
+        ThreadPoolJob("Instrument node loading"),
+        loader(loader),
+        node(node) {}
+
+    JobStatus runJob() override
+    {
+        if (this->node->isCancelled.get() == 0)
+        {
+            this->loadNode();
+        }
+
+        this->loader.triggerAsyncUpdate();
+        return jobHasFinished;
+    }
+
+private:
+
+    void loadNode()
+    {
+        NodeLoad &n = *this->node;
+        n.stateData.fromBase64Encoding(n.encodedState);
+        n.encodedState = String::empty;
+
+        if (n.threadSafeFormat == nullptr)
+        {
+            n.state.set(NodeLoad::WaitsForMessageThread);
+            return;
+        }
+
+        String errorMessage;
+        n.instance = n.threadSafeFormat->createInstanceFromDescription(n.description,
+            n.sampleRate, n.blockSize, errorMessage);
+
+        if (n.instance == nullptr)
+        {
+            Logger::writeToLog("Failed to load " + n.description.name + ": " + errorMessage);
+            n.state.set(NodeLoad::Failed);
+            return;
+        }
+
+        n.restoreState();
+        n.state.set(NodeLoad::Ready);
+    }
+
+    InstrumentLoader &loader;
+    const NodeLoad::Ptr node;
+
+    JUCE_DECLARE_NON_COPYABLE(NodeJob)
+};
+
+//===----------------------------------------------------------------------===//
+// InstrumentLoader
+//===----------------------------------------------------------------------===//
+
+InstrumentLoader::InstrumentLoader(AudioPluginFormatManager &formatManager,
+    std::function<void (Instrument *)> onInstrumentLoaded) :
+    formatManager(formatManager),
+    onInstrumentLoaded(std::move(onInstrumentLoaded)),
+    pool(jlimit(1, 8, SystemStats::getNumCpus() - 1)) {}
+
+InstrumentLoader::~InstrumentLoader()
+{
+    this->pool.removeAllJobs(true, 5000);
+    this->cancelPendingUpdate();
+    this->masterReference.clear();
+}
+
+void InstrumentLoader::loadNodes(Instrument &instrument, const XmlElement &instrumentXml)
+{
+    this->cancel(instrument);
+
+    ScopedPointer<InstrumentLoad> load(new InstrumentLoad());
+    load->instrument = &instrument;
+    load->startTimeMs = Time::getMillisecondCounterHiRes();
+
+    forEachXmlChildElementWithTagName(instrumentXml, e, Serialization::Core::instrumentConnection)
+    {
+        load->connections.add({
+            static_cast<uint32>(e->getIntAttribute("srcFilter")),
+            static_cast<uint32>(e->getIntAttribute("dstFilter")),
+            e->getIntAttribute("srcChannel"),
+            e->getIntAttribute("dstChannel")
+        });
+    }
+
+    forEachXmlChildElementWithTagName(instrumentXml, e, Serialization::Core::instrumentNode)
+    {
+        NodeLoad::Ptr node(new NodeLoad());
+
+        PluginSmartDescription pd;
+        forEachXmlChildElement(*e, d)
+        {
+            if (pd.loadFromXml(*d))
+            { break; }
+        }
+
+        node->description = pd;
+        node->threadSafeFormat = this->findThreadSafeFormat(pd);
+        node->sampleRate = instrument.processorGraph->getSampleRate();
+        node->blockSize = instrument.processorGraph->getBlockSize();
+
+        if (const XmlElement *state = e->getChildByName(Serialization::Core::pluginState))
+        {
+            node->encodedState = state->getAllSubText();
+        }
+
+        node->uid = static_cast<uint32>(e->getIntAttribute("uid"));
+        node->hash = e->getStringAttribute("hash");
+        node->x = e->getDoubleAttribute("x");
+        node->y = e->getDoubleAttribute("y");
+        node->lastX = e->getDoubleAttribute("uiLastX");
+        node->lastY = e->getDoubleAttribute("uiLastY");
+
+        load->nodes.add(node);
+    }
+
+    for (const auto node : load->nodes)
+    {
+        this->pool.addJob(new NodeJob(*this, node), true);
+    }
+
+    this->loads.add(load.release());
+    this->triggerAsyncUpdate();
+}
+
+void InstrumentLoader::cancel(const Instrument &instrument)
+{
+    for (int i = this->loads.size(); --i >= 0; )
+    {
+        InstrumentLoad *load = this->loads.getUnchecked(i);
+        if (load->instrument.get() == &instrument)
+        {
+            load->cancel();
+            this->loads.remove(i);
+        }
+    }
+}
+
+void InstrumentLoader::handleAsyncUpdate()
+{
+    for (int i = this->loads.size(); --i >= 0; )
+    {
+        InstrumentLoad *load = this->loads.getUnchecked(i);
+
+        // Deleted while loading
+        if (load->instrument.get() == nullptr)
+        {
+            load->cancel();
+            this->loads.remove(i);
+            continue;
+        }
+
+        if (load->isFinished())
+        {
+            this->activate(*load);
+            this->loads.remove(i);
+        }
+    }
+
+    this->createNextNodeOnMessageThread();
+}
+
+void InstrumentLoader::createNextNodeOnMessageThread()
+{
+    if (this->nodeBeingCreated != nullptr)
+    {
+        return;
+    }
+
+    for (const auto load : this->loads)
+    {
+        for (const auto node : load->nodes)
+        {
+            if (node->state.get() != NodeLoad::WaitsForMessageThread)
+            {
+                continue;
+            }
+
+            node->state.set(NodeLoad::Creating);
+            this->nodeBeingCreated = node;
+
+            // Creation is posted as a separate message (or done asynchronously,
+            // if the format requires so), and only one plugin is created at a time,
+            // so the message thread is never blocked for long
+            const NodeLoad::Ptr target(node);
+            const WeakReference<InstrumentLoader> loader(this);
+
+            this->formatManager.
+            createPluginInstanceAsync(node->description, node->sampleRate, node->blockSize,
+                [target, loader](AudioPluginInstance *instance, const String &error)
+                {
+                    target->instance = instance;
+
+                    if (instance == nullptr)
+                    {
+                        Logger::writeToLog("Failed to load " + target->description.name + ": " + error);
+                        target->state.set(NodeLoad::Failed);
+                    }
+                    else
+                    {
+                        target->restoreState();
+                        target->state.set(NodeLoad::Ready);
+                    }
+
+                    if (InstrumentLoader *self = loader.get())
+                    {
+                        self->nodeBeingCreated = nullptr;
+                        self->triggerAsyncUpdate();
+                    }
+                });
+
+            return;
+        }
+    }
+}
+
+void InstrumentLoader::activate(InstrumentLoad &load)
+{
+    Instrument *instrument = load.instrument;
+    AudioProcessorGraph &graph = *instrument->processorGraph;
+    instrument->pendingXml = nullptr;
+
+    for (const auto node : load.nodes)
+    {
+        if (node->instance == nullptr)
+        {
+            continue;
+        }
+
+        AudioPluginInstance *instance = node->instance.release();
+        AudioProcessorGraph::Node::Ptr graphNode(graph.addNode(instance, node->uid));
+
+        if (graphNode == nullptr)
+        {
+            delete instance;
+            continue;
+        }
+
+        Uuid fallbackRandomHash;
+        graphNode->properties.set("x", node->x);
+        graphNode->properties.set("y", node->y);
+        graphNode->properties.set("hash", node->hash.isNotEmpty() ? node->hash : fallbackRandomHash.toString());
+        graphNode->properties.set("uiLastX", node->lastX);
+        graphNode->properties.set("uiLastY", node->lastY);
+    }
+
+    for (const auto &connectionInfo : load.connections)
+    {
+        instrument->addConnection(connectionInfo.srcFilter, connectionInfo.srcChannel,
+                                  connectionInfo.dstFilter, connectionInfo.dstChannel);
+    }
+
+    graph.removeIllegalConnections();
+    instrument->sendChangeMessage();
+
+    Logger::writeToLog("Loaded instrument " + instrument->getName() + " in " +
+        String(Time::getMillisecondCounterHiRes() - load.startTimeMs, 0) + " ms");
+
+    if (this->onInstrumentLoaded != nullptr)
+    {
+        this->onInstrumentLoaded(instrument);
+    }
+}
+
+// The built-in formats just construct their processors, which is safe
+// on any thread; others are never assumed to be
+AudioPluginFormat *InstrumentLoader::findThreadSafeFormat(const PluginDescription &description) const
+{
+    for (int i = 0; i < this->formatManager.getNumFormats(); ++i)
+    {
+        AudioPluginFormat *format = this->formatManager.getFormat(i);
+        if (format->getName() != description.pluginFormatName)
+        {
+            continue;
+        }
+
+        if (dynamic_cast<InternalPluginFormat *>(format) != nullptr ||
+            dynamic_cast<BuiltInSynthFormat *>(format) != nullptr)
+        {
+            return format;
+        }
+
+        return nullptr;
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,76 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Restores the plugin nodes of the instruments in background.
+//
+// Creating the plugins and restoring their states is what takes most
+// of the time when a workspace is opened. Instead of doing it node after
+// node on the message thread, the loader decodes all the states on a thread
+// pool, and for the formats that don't care about threads (the built-in ones)
+// also creates the plugins and restores their states right there, in parallel.
+// Other formats (VST, VST3, AU) expect to be created and restored
+// on the message thread, so they are created there one at a time,
+// letting the other messages through in between.
+//
+// An instrument remains a silent placeholder, with no nodes at all,
+// until all of its nodes are ready; then they are added to the graph and
+// connected at once, so every instrument starts playing as soon as it is
+// loaded, without waiting for the others.
+
+class Instrument;
+
+class InstrumentLoader final : private AsyncUpdater
+{
+public:
+
+    InstrumentLoader(AudioPluginFormatManager &formatManager,
+        std::function<void (Instrument *)> onInstrumentLoaded);
+
+    ~InstrumentLoader() override;
+
+    // Cancels the previous loading of this instrument, if any
+    void loadNodes(Instrument &instrument, const XmlElement &instrumentXml);
+    void cancel(const Instrument &instrument);
+
+private:
+
+    struct NodeLoad;
+    struct InstrumentLoad;
+    class NodeJob;
+
+    void handleAsyncUpdate() override;
+
+    void createNextNodeOnMessageThread();
+    void activate(InstrumentLoad &load);
+
+    AudioPluginFormat *findThreadSafeFormat(const PluginDescription &description) const;
+
+    AudioPluginFormatManager &formatManager;
+    std::function<void (Instrument *)> onInstrumentLoaded;
+
+    OwnedArray<InstrumentLoad> loads;
+    ReferenceCountedObjectPtr<NodeLoad> nodeBeingCreated;
+
+    ThreadPool pool;
+
+    WeakReference<InstrumentLoader>::Master masterReference;
+    friend class WeakReference<InstrumentLoader>;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InstrumentLoader)
+};
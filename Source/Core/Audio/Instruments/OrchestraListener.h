@@ -27,6 +27,9 @@ public:
 
     virtual void instrumentAdded(Instrument *instrument) = 0;
 
+    // All of its nodes have been restored in background
+    virtual void instrumentLoaded(Instrument *instrument) = 0;
+
     virtual void instrumentRemoved(Instrument *instrument) = 0;
 
     virtual void instrumentRemovedPostAction() = 0;
@@ -60,3 +60,8 @@ void OrchestraPit::broadcastInstrumentAdded(Instrument *instrument)
 {
     this->orchestraListeners.call(&OrchestraListener::instrumentAdded, instrument);
 }
+
+void OrchestraPit::broadcastInstrumentLoaded(Instrument *instrument)
+{
+    this->orchestraListeners.call(&OrchestraListener::instrumentLoaded, instrument);
+}
@@ -47,6 +47,8 @@ protected:
 
     void broadcastInstrumentAdded(Instrument *instrument);
 
+    void broadcastInstrumentLoaded(Instrument *instrument);
+
 private:
 
     ListenerList<OrchestraListener> orchestraListeners;
@@ -19,6 +19,7 @@
 #include "AudioMonitor.h"
 #include "AudioCore.h"
 #include "AudiobusOutput.h"
+#include "Tracer.h"
 
 #define AUDIO_MONITOR_SPECTRUM_SIZE                 512
 #define AUDIO_MONITOR_DEFAULT_SAMPLERATE            44100
@@ -96,6 +97,8 @@ void AudioMonitor::audioDeviceIOCallback(const float **inputChannelData,
                                          int numOutputChannels,
                                          int numSamples)
 {
+    TRACE_SCOPE("AudioMonitor::audioDeviceIOCallback");
+
     const int numChannels =
     jmin(AUDIO_MONITOR_MAX_CHANNELS, numOutputChannels);
     
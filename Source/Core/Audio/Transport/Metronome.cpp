@@ -0,0 +1,443 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "Metronome.h"
+#include "SerializationKeys.h"
+#include "Config.h"
+
+#define METRONOME_MAX_BARS 8
+#define METRONOME_ACCENT_FREQUENCY 1760.0
+#define METRONOME_CLICK_FREQUENCY 1320.0
+#define METRONOME_ACCENT_LEVEL 0.5f
+#define METRONOME_CLICK_LEVEL 0.3f
+#define METRONOME_DECAY_TIME_MS 15.0
+#define METRONOME_SILENCE_LEVEL 0.0005f
+
+// Anchoring at the first block after the start may come late a bit;
+// clicks missed by more than that are skipped rather than played late
+#define METRONOME_MAX_LATENESS_MS 10.0
+
+Metronome::Metronome() :
+    sampleRate(44100.0),
+    session(0),
+    isPlaying(false),
+    needsAnchoring(false),
+    originTimeMs(0.0),
+    position(0)
+{
+    this->enabled = bool(Config::getValue(Serialization::Core::metronomeEnabled, false)) ? 1 : 0;
+    this->countInBars = jlimit(0, METRONOME_MAX_BARS,
+        int(Config::getValue(Serialization::Core::metronomeCountInBars, 0)));
+    this->preRollBars = jlimit(0, METRONOME_MAX_BARS,
+        int(Config::getValue(Serialization::Core::metronomePreRollBars, 0)));
+    this->includedInRenders = bool(Config::getValue(Serialization::Core::metronomeInRenders, false)) ? 1 : 0;
+}
+
+Metronome::~Metronome() {}
+
+//===----------------------------------------------------------------------===//
+// Settings
+//===----------------------------------------------------------------------===//
+
+bool Metronome::isEnabled() const noexcept
+{
+    return (this->enabled.get() != 0);
+}
+
+void Metronome::setEnabled(bool shouldBeEnabled)
+{
+    this->enabled = shouldBeEnabled ? 1 : 0;
+    Config::set(Serialization::Core::metronomeEnabled, shouldBeEnabled);
+}
+
+int Metronome::getCountInBars() const noexcept
+{
+    return this->countInBars.get();
+}
+
+void Metronome::setCountInBars(int numBars)
+{
+    this->countInBars = jlimit(0, METRONOME_MAX_BARS, numBars);
+    Config::set(Serialization::Core::metronomeCountInBars, this->countInBars.get());
+}
+
+int Metronome::getPreRollBars() const noexcept
+{
+    return this->preRollBars.get();
+}
+
+void Metronome::setPreRollBars(int numBars)
+{
+    this->preRollBars = jlimit(0, METRONOME_MAX_BARS, numBars);
+    Config::set(Serialization::Core::metronomePreRollBars, this->preRollBars.get());
+}
+
+bool Metronome::isIncludedInRenders() const noexcept
+{
+    return (this->includedInRenders.get() != 0);
+}
+
+void Metronome::setIncludedInRenders(bool shouldBeIncluded)
+{
+    this->includedInRenders = shouldBeIncluded ? 1 : 0;
+    Config::set(Serialization::Core::metronomeInRenders, shouldBeIncluded);
+}
+
+//===----------------------------------------------------------------------===//
+// Click track
+//===----------------------------------------------------------------------===//
+
+namespace
+{
+    struct TempoChange
+    {
+        double tick;
+        double msPerTick;
+    };
+
+    struct MeterChange
+    {
+        double tick;
+        int numerator;
+        int denominator;
+
+        double getClickLengthInTicks() const noexcept
+        {
+            return MS_PER_BEAT * 4.0 / double(this->denominator);
+        }
+    };
+
+    void collectTempoAndMeter(ProjectSequences &sequences, double ticksOffset,
+        Array<TempoChange> &outTempos, Array<MeterChange> &outMeters)
+    {
+        // Until the first time signature, it's 4/4 from the project's beat zero
+        outMeters.add({ -ticksOffset, NUM_BEATS_IN_BAR, 4 });
+
+        sequences.seekToZeroIndexes();
+        MessageWrapper wrapper;
+
+        while (sequences.getNextMessage(wrapper))
+        {
+            const MidiMessage &message = wrapper.message;
+
+            if (message.isTempoMetaEvent())
+            {
+                const double msPerTick = message.getTempoSecondsPerQuarterNote() * 1000.0 / MS_PER_BEAT;
+                outTempos.add({ message.getTimeStamp(), msPerTick });
+            }
+            else if (message.isTimeSignatureMetaEvent())
+            {
+                int numerator = 0;
+                int denominator = 0;
+                message.getTimeSignatureInfo(numerator, denominator);
+                if (numerator <= 0 || denominator <= 0)
+                {
+                    continue;
+                }
+
+                const MeterChange meter({ message.getTimeStamp(), numerator, denominator });
+                if (outMeters.getLast().tick >= meter.tick)
+                {
+                    outMeters.getReference(outMeters.size() - 1) = meter;
+                }
+                else
+                {
+                    outMeters.add(meter);
+                }
+            }
+        }
+    }
+
+    int findMeterAt(const Array<MeterChange> &meters, double tick) noexcept
+    {
+        int index = 0;
+        while (index < meters.size() - 1 && meters.getUnchecked(index + 1).tick <= tick)
+        {
+            ++index;
+        }
+
+        return index;
+    }
+}
+
+void Metronome::createClicks(ProjectSequences &sequences, double ticksOffset,
+    double startTick, double endTick, double defaultMsPerTick, int numCountInBars,
+    Array<Click> &outClicks, int &outNumCountInClicks,
+    double &outCountInMs, double &outRangeMs)
+{
+    Array<TempoChange> tempos;
+    Array<MeterChange> meters;
+    collectTempoAndMeter(sequences, ticksOffset, tempos, meters);
+
+    // The tempo before the first tempo event is the first event's tempo,
+    // the same way the player thread does it
+    int nextTempoIndex = 0;
+    double msPerTick = tempos.isEmpty() ? defaultMsPerTick : tempos.getFirst().msPerTick;
+    while (nextTempoIndex < tempos.size() && tempos.getUnchecked(nextTempoIndex).tick <= startTick)
+    {
+        msPerTick = tempos.getUnchecked(nextTempoIndex).msPerTick;
+        ++nextTempoIndex;
+    }
+
+    const double msPerTickAtStart = msPerTick;
+    double cursorTick = startTick;
+    double cursorMs = 0.0;
+
+    // Only called with increasing ticks
+    auto getTimeAt = [&](double tick)
+    {
+        while (nextTempoIndex < tempos.size() && tempos.getUnchecked(nextTempoIndex).tick <= tick)
+        {
+            const TempoChange &tempo = tempos.getUnchecked(nextTempoIndex);
+            cursorMs += (tempo.tick - cursorTick) * msPerTick;
+            cursorTick = tempo.tick;
+            msPerTick = tempo.msPerTick;
+            ++nextTempoIndex;
+        }
+
+        return cursorMs + (tick - cursorTick) * msPerTick;
+    };
+
+    outClicks.clearQuick();
+
+    // Count-in bars follow the meter and the tempo at the start
+    const int startMeterIndex = findMeterAt(meters, startTick);
+    const MeterChange &startMeter = meters.getReference(startMeterIndex);
+    const double countInClickMs = startMeter.getClickLengthInTicks() * msPerTickAtStart;
+
+    outNumCountInClicks = jmax(0, numCountInBars) * startMeter.numerator;
+    outCountInMs = outNumCountInClicks * countInClickMs;
+
+    for (int i = 0; i < outNumCountInClicks; ++i)
+    {
+        outClicks.add({ i * countInClickMs - outCountInMs, (i % startMeter.numerator) == 0 });
+    }
+
+    for (int i = startMeterIndex; i < meters.size(); ++i)
+    {
+        const MeterChange &meter = meters.getReference(i);
+        const double meterEndTick = (i < meters.size() - 1) ? jmin(endTick, meters.getReference(i + 1).tick) : endTick;
+        const double clickLength = meter.getClickLengthInTicks();
+
+        int64 clickIndex = int64(ceil((jmax(startTick, meter.tick) - meter.tick) / clickLength - 0.0001));
+        double tick = meter.tick + clickIndex * clickLength;
+
+        while (tick < meterEndTick)
+        {
+            outClicks.add({ getTimeAt(tick), (clickIndex % meter.numerator) == 0 });
+            ++clickIndex;
+            tick = meter.tick + clickIndex * clickLength;
+        }
+    }
+
+    outRangeMs = getTimeAt(endTick);
+}
+
+double Metronome::getBarLengthInTicks(ProjectSequences &sequences, double ticksOffset, double tick)
+{
+    Array<TempoChange> tempos;
+    Array<MeterChange> meters;
+    collectTempoAndMeter(sequences, ticksOffset, tempos, meters);
+
+    const MeterChange &meter = meters.getReference(findMeterAt(meters, tick));
+    return meter.numerator * meter.getClickLengthInTicks();
+}
+
+//===----------------------------------------------------------------------===//
+// Click renderer
+//===----------------------------------------------------------------------===//
+
+Metronome::ClickRenderer::ClickRenderer() :
+    numCountInClicks(0),
+    cycleMs(0.0),
+    sampleRate(44100.0),
+    nextClickIndex(0),
+    numCycles(0),
+    nextClickSample(0),
+    hasNextClick(false),
+    phase(0.0),
+    phaseDelta(0.0),
+    level(0.f),
+    decay(0.f) {}
+
+void Metronome::ClickRenderer::reset(const Array<Click> &newClicks,
+    int newNumCountInClicks, double newCycleMs, double newSampleRate)
+{
+    this->clicks = newClicks;
+    this->numCountInClicks = newNumCountInClicks;
+    this->cycleMs = newCycleMs;
+    this->sampleRate = newSampleRate;
+    this->decay = float(exp(-1000.0 / (METRONOME_DECAY_TIME_MS * newSampleRate)));
+
+    this->nextClickIndex = 0;
+    this->numCycles = 0;
+    this->level = 0.f;
+    this->updateNextClick();
+}
+
+void Metronome::ClickRenderer::updateNextClick() noexcept
+{
+    if (this->nextClickIndex >= this->clicks.size())
+    {
+        // Count-in clicks are only played once
+        const bool canRepeat = (this->cycleMs > 0.0 && this->clicks.size() > this->numCountInClicks);
+        if (! canRepeat)
+        {
+            this->hasNextClick = false;
+            return;
+        }
+
+        ++this->numCycles;
+        this->nextClickIndex = this->numCountInClicks;
+    }
+
+    const double timeMs = this->clicks.getReference(this->nextClickIndex).timeMs + this->numCycles * this->cycleMs;
+    this->nextClickSample = int64(floor(timeMs * this->sampleRate / 1000.0 + 0.5));
+    this->hasNextClick = true;
+}
+
+void Metronome::ClickRenderer::trigger(bool isAccent) noexcept
+{
+    const double frequency = isAccent ? METRONOME_ACCENT_FREQUENCY : METRONOME_CLICK_FREQUENCY;
+    this->phase = 0.0;
+    this->phaseDelta = 2.0 * double_Pi * frequency / this->sampleRate;
+    this->level = isAccent ? METRONOME_ACCENT_LEVEL : METRONOME_CLICK_LEVEL;
+}
+
+void Metronome::ClickRenderer::render(float **channels, int numChannels,
+    int numSamples, int64 position) noexcept
+{
+    const int64 maxLateness = int64(METRONOME_MAX_LATENESS_MS * this->sampleRate / 1000.0);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int64 sample = position + i;
+
+        while (this->hasNextClick && this->nextClickSample <= sample)
+        {
+            if (sample - this->nextClickSample <= maxLateness)
+            {
+                this->trigger(this->clicks.getReference(this->nextClickIndex).isAccent);
+            }
+
+            ++this->nextClickIndex;
+            this->updateNextClick();
+        }
+
+        if (this->level < METRONOME_SILENCE_LEVEL)
+        {
+            if (! this->hasNextClick)
+            {
+                return;
+            }
+
+            // Skip right to the next click
+            const int64 numSilentSamples = this->nextClickSample - sample - 1;
+            i += int(jmin(numSilentSamples, int64(numSamples - i - 1)));
+            continue;
+        }
+
+        const float value = float(std::sin(this->phase)) * this->level;
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            if (channels[channel] != nullptr)
+            {
+                channels[channel][i] += value;
+            }
+        }
+
+        this->phase += this->phaseDelta;
+        this->level *= this->decay;
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Playback
+//===----------------------------------------------------------------------===//
+
+int Metronome::start(const Array<Click> &clicks, int numCountInClicks,
+    double newOriginTimeMs, double cycleMs)
+{
+    const SpinLock::ScopedLockType lock(this->playbackLock);
+    this->renderer.reset(clicks, numCountInClicks, cycleMs, this->sampleRate.get());
+    this->originTimeMs = newOriginTimeMs;
+    this->needsAnchoring = true;
+    this->isPlaying = true;
+    return ++this->session;
+}
+
+void Metronome::stop(int stoppedSession)
+{
+    const SpinLock::ScopedLockType lock(this->playbackLock);
+    if (stoppedSession == this->session)
+    {
+        this->isPlaying = false;
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// AudioIODeviceCallback
+//===----------------------------------------------------------------------===//
+
+void Metronome::audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
+    float **outputChannelData, int numOutputChannels, int numSamples)
+{
+    for (int i = 0; i < numOutputChannels; ++i)
+    {
+        if (outputChannelData[i] != nullptr)
+        {
+            FloatVectorOperations::clear(outputChannelData[i], numSamples);
+        }
+    }
+
+    // Never wait here: the lock is only held for a moment when (re)starting,
+    // and missing a block then is better than blocking the audio thread
+    const SpinLock::ScopedTryLockType lock(this->playbackLock);
+    if (! lock.isLocked() || ! this->isPlaying)
+    {
+        return;
+    }
+
+    // From now on, the clicks are counted in samples
+    if (this->needsAnchoring)
+    {
+        const double msSinceOrigin = Time::getMillisecondCounterHiRes() - this->originTimeMs;
+        this->position = int64(floor(msSinceOrigin * this->sampleRate.get() / 1000.0));
+        this->needsAnchoring = false;
+    }
+
+    // Keeps counting when muted, so that it can be unmuted during playback
+    if (this->isEnabled())
+    {
+        this->renderer.render(outputChannelData, numOutputChannels, numSamples, this->position);
+    }
+
+    this->position += numSamples;
+}
+
+void Metronome::audioDeviceAboutToStart(AudioIODevice *device)
+{
+    this->sampleRate = device->getCurrentSampleRate();
+
+    // The clicks were laid out for the old sample rate
+    const SpinLock::ScopedLockType lock(this->playbackLock);
+    this->isPlaying = false;
+}
+
+void Metronome::audioDeviceStopped() {}
@@ -0,0 +1,157 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "ProjectSequencesWrapper.h"
+
+// A built-in click track.
+//
+// The clicks are derived from the project's tempo and time signature events
+// and rendered right into the audio stream by a separate device callback:
+// the player thread only tells when the playback origin is due,
+// and from then on the clicks are counted in samples, so they don't
+// depend on how precisely the player thread happens to wake up.
+// The same renderer is used to mix the clicks into the offline renders.
+
+class Metronome final : public AudioIODeviceCallback
+{
+public:
+
+    Metronome();
+    ~Metronome() override;
+
+    struct Click
+    {
+        // Relative to the playback origin, count-in clicks are negative
+        double timeMs;
+        bool isAccent;
+    };
+
+    //===------------------------------------------------------------------===//
+    // Settings, stored in config
+    //===------------------------------------------------------------------===//
+
+    bool isEnabled() const noexcept;
+    void setEnabled(bool shouldBeEnabled);
+
+    int getCountInBars() const noexcept;
+    void setCountInBars(int numBars);
+
+    int getPreRollBars() const noexcept;
+    void setPreRollBars(int numBars);
+
+    bool isIncludedInRenders() const noexcept;
+    void setIncludedInRenders(bool shouldBeIncluded);
+
+    //===------------------------------------------------------------------===//
+    // Click track
+    //===------------------------------------------------------------------===//
+
+    // Walks the tempo and time signature events of the sequences (which
+    // are offset by ticksOffset from the project's beat zero) and lays out
+    // the clicks between two ticks, plus a given number of count-in bars;
+    // the default tempo is only used if there are no tempo events at all.
+    // Note that this changes the sequences' current indexes.
+    static void createClicks(ProjectSequences &sequences, double ticksOffset,
+        double startTick, double endTick, double defaultMsPerTick, int numCountInBars,
+        Array<Click> &outClicks, int &outNumCountInClicks,
+        double &outCountInMs, double &outRangeMs);
+
+    // The length of a bar at the given tick, according to the time signatures
+    static double getBarLengthInTicks(ProjectSequences &sequences,
+        double ticksOffset, double tick);
+
+    // Renders a list of clicks, position is in samples since the origin;
+    // with a non-zero cycle length all but the count-in clicks are repeated
+    class ClickRenderer final
+    {
+    public:
+
+        ClickRenderer();
+
+        void reset(const Array<Click> &clicks, int numCountInClicks,
+            double cycleMs, double sampleRate);
+
+        void render(float **channels, int numChannels,
+            int numSamples, int64 position) noexcept;
+
+    private:
+
+        Array<Click> clicks;
+        int numCountInClicks;
+        double cycleMs;
+        double sampleRate;
+
+        int nextClickIndex;
+        int64 numCycles;
+        int64 nextClickSample;
+        bool hasNextClick;
+
+        double phase;
+        double phaseDelta;
+        float level;
+        float decay;
+
+        void updateNextClick() noexcept;
+        void trigger(bool isAccent) noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE(ClickRenderer)
+    };
+
+    //===------------------------------------------------------------------===//
+    // Playback, called from the player thread
+    //===------------------------------------------------------------------===//
+
+    // Returns the session id for the stop call: the player thread that
+    // is still stopping might interfere with the new one otherwise
+    int start(const Array<Click> &clicks, int numCountInClicks,
+        double originTimeMs, double cycleMs);
+
+    void stop(int session);
+
+    //===------------------------------------------------------------------===//
+    // AudioIODeviceCallback
+    //===------------------------------------------------------------------===//
+
+    void audioDeviceIOCallback(const float **inputChannelData, int numInputChannels,
+        float **outputChannelData, int numOutputChannels, int numSamples) override;
+
+    void audioDeviceAboutToStart(AudioIODevice *device) override;
+    void audioDeviceStopped() override;
+
+private:
+
+    Atomic<int> enabled;
+    Atomic<int> countInBars;
+    Atomic<int> preRollBars;
+    Atomic<int> includedInRenders;
+
+    Atomic<double> sampleRate;
+
+    int session;
+    bool isPlaying;
+    bool needsAnchoring;
+    double originTimeMs;
+    int64 position;
+
+    ClickRenderer renderer;
+    SpinLock playbackLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Metronome)
+};
@@ -0,0 +1,443 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "MidiOutputSender.h"
+#include "SerializationKeys.h"
+#include "Config.h"
+#include "Tracer.h"
+
+#define MIDI_OUTPUT_FIFO_SIZE 4096
+#define MIDI_OUTPUT_DEFAULT_LOOKAHEAD_MS 10.0
+#define MIDI_OUTPUT_MAX_LOOKAHEAD_MS 500.0
+#define MIDI_OUTPUT_SPIN_THRESHOLD_MS 2.0
+#define MIDI_OUTPUT_IDLE_WAIT_MS 100
+#define MIDI_OUTPUT_FIRST_MEMBER_CHANNEL 2
+#define MIDI_OUTPUT_NUM_MEMBER_CHANNELS 15
+
+MidiOutputSender *MidiOutputSender::openDevice(const String &deviceName, double latencyMs)
+{
+    const int deviceIndex = MidiOutput::getDevices().indexOf(deviceName);
+    if (deviceIndex < 0)
+    {
+        Logger::writeToLog("MIDI output not found: " + deviceName);
+        return nullptr;
+    }
+
+    MidiOutput *output = MidiOutput::openDevice(deviceIndex);
+    if (output == nullptr)
+    {
+        Logger::writeToLog("Failed to open MIDI output: " + deviceName);
+        return nullptr;
+    }
+
+    return new MidiOutputSender(output, deviceName, latencyMs, getDefaultLookahead());
+}
+
+MidiOutputSender::MidiOutputSender(MidiOutput *output, const String &deviceName,
+    double latencyMs, double lookaheadMs) :
+    Thread("MidiOutputSender"),
+    output(output),
+    deviceName(deviceName),
+    latencyMs(latencyMs),
+    lookaheadMs(lookaheadMs),
+    generation(0),
+    session(0),
+    fifo(MIDI_OUTPUT_FIFO_SIZE),
+    lastPurgedGeneration(0),
+    tuningMode(NoTuning),
+    retuneWithPitchBends(false),
+    numRetunedNotes(0),
+    numMessagesSent(0),
+    totalTimingError(0.0),
+    maxTimingError(0.0)
+{
+    zeromem(this->soundingNotes, sizeof(this->soundingNotes));
+    zeromem(this->retunedNotes, sizeof(this->retunedNotes));
+    zeromem(this->memberChannelNotes, sizeof(this->memberChannelNotes));
+    zeromem(this->memberChannelLastUsed, sizeof(this->memberChannelLastUsed));
+
+    this->fifoBuffer.resize(MIDI_OUTPUT_FIFO_SIZE);
+    this->pendingMessages.ensureStorageAllocated(MIDI_OUTPUT_FIFO_SIZE);
+
+    // The highest priority available, as the thread mostly sleeps anyway
+    this->startThread(10);
+}
+
+MidiOutputSender::~MidiOutputSender()
+{
+    this->stopThread(1000);
+}
+
+String MidiOutputSender::getDeviceName() const noexcept
+{
+    return this->deviceName;
+}
+
+double MidiOutputSender::getLatency() const noexcept
+{
+    return this->latencyMs.get();
+}
+
+void MidiOutputSender::setLatency(double ms) noexcept
+{
+    this->latencyMs = ms;
+}
+
+double MidiOutputSender::getDefaultLookahead()
+{
+    const double lookahead = Config::getValue(Serialization::Core::midiOutputLookahead,
+        MIDI_OUTPUT_DEFAULT_LOOKAHEAD_MS);
+
+    return jlimit(0.0, MIDI_OUTPUT_MAX_LOOKAHEAD_MS, lookahead);
+}
+
+void MidiOutputSender::setDefaultLookahead(double ms)
+{
+    Config::set(Serialization::Core::midiOutputLookahead, jlimit(0.0, MIDI_OUTPUT_MAX_LOOKAHEAD_MS, ms));
+}
+
+//===----------------------------------------------------------------------===//
+// Scheduling
+//===----------------------------------------------------------------------===//
+
+int MidiOutputSender::startSession(const Tuning &newTuning)
+{
+    const SpinLock::ScopedLockType lock(this->producerLock);
+
+    // Whatever the previous session still holds is released with its tuning,
+    // as its own note-offs will be ignored from now on
+    this->releaseSoundingNotes(Time::getMillisecondCounterHiRes());
+    this->resetStats();
+    this->prepareTuning(newTuning);
+    return ++this->session;
+}
+
+void MidiOutputSender::schedule(int playbackSession, const MidiMessage &message, double idealTimeMs) noexcept
+{
+    const SpinLock::ScopedLockType lock(this->producerLock);
+
+    if (playbackSession != this->session)
+    {
+        return;
+    }
+
+    if (message.isNoteOn())
+    {
+        this->soundingNotes[message.getChannel() - 1][message.getNoteNumber()] = 1;
+    }
+    else if (message.isNoteOff())
+    {
+        this->soundingNotes[message.getChannel() - 1][message.getNoteNumber()] = 0;
+    }
+
+    this->scheduleLocked(message, idealTimeMs);
+}
+
+void MidiOutputSender::schedule(const MidiMessage &message, double idealTimeMs) noexcept
+{
+    const SpinLock::ScopedLockType lock(this->producerLock);
+    this->scheduleLocked(message, idealTimeMs);
+}
+
+void MidiOutputSender::releaseSoundingNotes(double sendTimeMs) noexcept
+{
+    for (int channel = 0; channel < 16; ++channel)
+    {
+        for (int key = 0; key < 128; ++key)
+        {
+            if (this->soundingNotes[channel][key] != 0)
+            {
+                this->soundingNotes[channel][key] = 0;
+                this->scheduleLocked(MidiMessage::noteOff(channel + 1, key), sendTimeMs);
+            }
+        }
+    }
+}
+
+void MidiOutputSender::scheduleLocked(const MidiMessage &message, double idealTimeMs) noexcept
+{
+    // Latency compensation cannot move a message before the moment it was scheduled
+    const double sendTimeMs = idealTimeMs + jmax(0.0, this->lookaheadMs - this->latencyMs.get());
+
+    if (this->retuneWithPitchBends && (message.isNoteOn() || message.isNoteOff()))
+    {
+        this->scheduleRetuned(message, sendTimeMs);
+        return;
+    }
+
+    this->push(message, sendTimeMs);
+}
+
+void MidiOutputSender::push(const MidiMessage &message, double sendTimeMs) noexcept
+{
+    int start1, size1, start2, size2;
+    this->fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        Tracer::instant("MidiOutputSender", "FIFO overflow");
+        return;
+    }
+
+    ScheduledMessage &slot = this->fifoBuffer.getReference(size1 > 0 ? start1 : start2);
+    slot.message = message;
+    slot.sendTimeMs = sendTimeMs;
+    slot.generation = this->generation.get();
+
+    this->fifo.finishedWrite(1);
+    this->notify();
+}
+
+//===----------------------------------------------------------------------===//
+// Tuning
+//===----------------------------------------------------------------------===//
+
+MidiOutputSender::TuningMode MidiOutputSender::getTuningMode() const noexcept
+{
+    return TuningMode(this->tuningMode.get());
+}
+
+void MidiOutputSender::setTuningMode(TuningMode mode) noexcept
+{
+    this->tuningMode = int(mode);
+}
+
+void MidiOutputSender::prepareTuning(const Tuning &newTuning)
+{
+    const double nowMs = Time::getMillisecondCounterHiRes();
+    const TuningMode mode = this->getTuningMode();
+
+    this->tuning = newTuning;
+    this->retuneWithPitchBends = (mode == PitchBendTuning && ! newTuning.isEqualTemperament());
+    zeromem(this->retunedNotes, sizeof(this->retunedNotes));
+    zeromem(this->memberChannelNotes, sizeof(this->memberChannelNotes));
+
+    if (mode == TuningDump)
+    {
+        this->push(newTuning.createBulkDumpMessage(), nowMs);
+    }
+    else if (this->retuneWithPitchBends)
+    {
+        // Pitch bend sensitivity (RPN 0) for all member channels
+        for (int i = 0; i < MIDI_OUTPUT_NUM_MEMBER_CHANNELS; ++i)
+        {
+            const int channel = MIDI_OUTPUT_FIRST_MEMBER_CHANNEL + i;
+            this->push(MidiMessage::controllerEvent(channel, 101, 0), nowMs);
+            this->push(MidiMessage::controllerEvent(channel, 100, 0), nowMs);
+            this->push(MidiMessage::controllerEvent(channel, 6, TUNING_PITCH_BEND_RANGE), nowMs);
+            this->push(MidiMessage::controllerEvent(channel, 38, 0), nowMs);
+        }
+    }
+}
+
+void MidiOutputSender::scheduleRetuned(const MidiMessage &message, double sendTimeMs) noexcept
+{
+    const int channel = message.getChannel() - 1;
+    const int key = message.getNoteNumber();
+    RetunedNote &note = this->retunedNotes[channel][key];
+
+    // Releases the previous note on the same key, if any
+    if (note.memberChannel != 0)
+    {
+        this->push(MidiMessage::noteOff(note.memberChannel, note.key), sendTimeMs);
+        this->memberChannelNotes[note.memberChannel - MIDI_OUTPUT_FIRST_MEMBER_CHANNEL]--;
+        note.memberChannel = 0;
+    }
+
+    if (message.isNoteOff() || ! this->tuning.isKeyMapped(key))
+    {
+        return;
+    }
+
+    // Takes a free channel used the longest time ago,
+    // or the least busy one, if there are no free ones
+    int memberIndex = 0;
+    for (int i = 1; i < MIDI_OUTPUT_NUM_MEMBER_CHANNELS; ++i)
+    {
+        const int notes = this->memberChannelNotes[i];
+        const int bestNotes = this->memberChannelNotes[memberIndex];
+        if (notes < bestNotes || (notes == bestNotes &&
+            this->memberChannelLastUsed[i] < this->memberChannelLastUsed[memberIndex]))
+        {
+            memberIndex = i;
+        }
+    }
+
+    this->memberChannelNotes[memberIndex]++;
+    this->memberChannelLastUsed[memberIndex] = ++this->numRetunedNotes;
+
+    note.memberChannel = int8(MIDI_OUTPUT_FIRST_MEMBER_CHANNEL + memberIndex);
+    note.key = uint8(this->tuning.getPitchBendKey(key));
+
+    this->push(MidiMessage::pitchWheel(note.memberChannel, this->tuning.getPitchBendValue(key)), sendTimeMs);
+    this->push(MidiMessage::noteOn(note.memberChannel, note.key, message.getVelocity()), sendTimeMs);
+}
+
+void MidiOutputSender::cancelPending() noexcept
+{
+    this->generation = this->generation.get() + 1;
+    this->notify();
+}
+
+void MidiOutputSender::takeScheduledMessages()
+{
+    int start1, size1, start2, size2;
+    this->fifo.prepareToRead(this->fifo.getNumReady(), start1, size1, start2, size2);
+
+    auto insertSorted = [this](const ScheduledMessage &m)
+    {
+        // Messages mostly come in order, so search from the end;
+        // equal times keep their scheduling order
+        int index = this->pendingMessages.size();
+        while (index > 0 && this->pendingMessages.getReference(index - 1).sendTimeMs > m.sendTimeMs)
+        {
+            --index;
+        }
+
+        this->pendingMessages.insert(index, m);
+    };
+
+    for (int i = 0; i < size1; ++i)
+    {
+        insertSorted(this->fifoBuffer.getReference(start1 + i));
+    }
+
+    for (int i = 0; i < size2; ++i)
+    {
+        insertSorted(this->fifoBuffer.getReference(start2 + i));
+    }
+
+    this->fifo.finishedRead(size1 + size2);
+
+    // Forget the messages cancelled since they were scheduled;
+    // checking just the first one is not enough, as the messages scheduled
+    // right after the cancellation (e.g. a stop) may well go before the stale ones
+    const int currentGeneration = this->generation.get();
+    if (this->lastPurgedGeneration != currentGeneration)
+    {
+        this->lastPurgedGeneration = currentGeneration;
+
+        int i = 0;
+        while (i < this->pendingMessages.size())
+        {
+            if (this->pendingMessages.getReference(i).generation != currentGeneration)
+            {
+                this->pendingMessages.remove(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+}
+
+void MidiOutputSender::run()
+{
+    while (! this->threadShouldExit())
+    {
+        this->takeScheduledMessages();
+
+        if (this->pendingMessages.isEmpty())
+        {
+            this->wait(MIDI_OUTPUT_IDLE_WAIT_MS);
+            continue;
+        }
+
+        const double nextSendTimeMs = this->pendingMessages.getReference(0).sendTimeMs;
+        const double timeLeftMs = nextSendTimeMs - Time::getMillisecondCounterHiRes();
+
+        if (timeLeftMs > MIDI_OUTPUT_SPIN_THRESHOLD_MS)
+        {
+            // Will be woken up earlier, if something new is scheduled
+            this->wait(int(timeLeftMs - MIDI_OUTPUT_SPIN_THRESHOLD_MS));
+            continue;
+        }
+
+        while (Time::getMillisecondCounterHiRes() < nextSendTimeMs)
+        {
+            if (this->threadShouldExit())
+            {
+                return;
+            }
+
+            Thread::yield();
+        }
+
+        // Send everything that is due by now, unless cancelled while spinning
+        const int currentGeneration = this->generation.get();
+        int numDue = 0;
+        while (numDue < this->pendingMessages.size())
+        {
+            const ScheduledMessage &m = this->pendingMessages.getReference(numDue);
+            const double nowMs = Time::getMillisecondCounterHiRes();
+            if (m.sendTimeMs > nowMs)
+            {
+                break;
+            }
+
+            if (m.generation != currentGeneration)
+            {
+                ++numDue;
+                continue;
+            }
+
+            this->output->sendMessageNow(m.message);
+
+            const double errorMs = Time::getMillisecondCounterHiRes() - m.sendTimeMs;
+            this->numMessagesSent = this->numMessagesSent.get() + 1;
+            this->totalTimingError = this->totalTimingError.get() + errorMs;
+            if (errorMs > this->maxTimingError.get())
+            {
+                this->maxTimingError = errorMs;
+            }
+
+            Tracer::counter("MIDI output timing error, ms", errorMs);
+            ++numDue;
+        }
+
+        this->pendingMessages.removeRange(0, numDue);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Timing stats
+//===----------------------------------------------------------------------===//
+
+void MidiOutputSender::resetStats() noexcept
+{
+    this->numMessagesSent = 0;
+    this->totalTimingError = 0.0;
+    this->maxTimingError = 0.0;
+}
+
+int MidiOutputSender::getNumMessagesSent() const noexcept
+{
+    return this->numMessagesSent.get();
+}
+
+double MidiOutputSender::getMeanTimingError() const noexcept
+{
+    const int numSent = this->numMessagesSent.get();
+    return (numSent > 0) ? (this->totalTimingError.get() / numSent) : 0.0;
+}
+
+double MidiOutputSender::getMaxTimingError() const noexcept
+{
+    return this->maxTimingError.get();
+}
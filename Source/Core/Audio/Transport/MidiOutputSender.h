@@ -0,0 +1,154 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Sends messages to an external midi output at precise times.
+//
+// The player thread wakes up with a millisecond-ish jitter, so instead of
+// sending the messages right away it schedules them at their ideal time
+// plus a constant lookahead (minus the port's latency compensation).
+// The sender thread sleeps until shortly before the next message is due,
+// then spins on the high resolution counter for the rest of the way,
+// and keeps track of the timing error it actually achieved.
+//
+// Devices that cannot be retuned with the MIDI Tuning Standard can
+// be retuned with pitch bends: every note then gets a channel of its own
+// (channels 2-16, like in MPE), the nearest equal-tempered key,
+// and a pitch bend, all taken from the tuning's precomputed tables.
+
+#include "Tuning.h"
+
+class MidiOutputSender :
+    public ReferenceCountedObject,
+    private Thread
+{
+public:
+
+    // Returns nullptr if the device cannot be opened
+    static MidiOutputSender *openDevice(const String &deviceName, double latencyMs);
+
+    ~MidiOutputSender() override;
+
+    String getDeviceName() const noexcept;
+
+    double getLatency() const noexcept;
+    void setLatency(double ms) noexcept;
+
+    static double getDefaultLookahead();
+    static void setDefaultLookahead(double ms);
+
+    enum TuningMode
+    {
+        NoTuning = 0,
+        TuningDump = 1,
+        PitchBendTuning = 2
+    };
+
+    TuningMode getTuningMode() const noexcept;
+    void setTuningMode(TuningMode mode) noexcept;
+
+    // Called from the player thread at playback start: releases the notes
+    // the previous playback has left sounding, resets the stats, sends
+    // the tuning dump or the pitch bend ranges, depending on the mode,
+    // and retunes the notes scheduled from then on.
+    // Returns the session id the schedule calls should pass; the player
+    // thread that is still stopping may keep calling with its old id,
+    // and all those calls are ignored.
+    int startSession(const Tuning &tuning);
+
+    void schedule(int session, const MidiMessage &message, double idealTimeMs) noexcept;
+
+    // For the senders not shared between playbacks (see MidiSync)
+    void schedule(const MidiMessage &message, double idealTimeMs) noexcept;
+
+    // Drops everything scheduled so far, but not the messages scheduled after this call
+    void cancelPending() noexcept;
+
+    int getNumMessagesSent() const noexcept;
+    double getMeanTimingError() const noexcept;
+    double getMaxTimingError() const noexcept;
+
+    typedef ReferenceCountedObjectPtr<MidiOutputSender> Ptr;
+
+private:
+
+    MidiOutputSender(MidiOutput *output, const String &deviceName,
+        double latencyMs, double lookaheadMs);
+
+    void run() override;
+
+    void takeScheduledMessages();
+
+    void resetStats() noexcept;
+    void prepareTuning(const Tuning &tuning);
+    void releaseSoundingNotes(double sendTimeMs) noexcept;
+
+    void scheduleLocked(const MidiMessage &message, double idealTimeMs) noexcept;
+    void push(const MidiMessage &message, double sendTimeMs) noexcept;
+    void scheduleRetuned(const MidiMessage &message, double sendTimeMs) noexcept;
+
+    struct ScheduledMessage
+    {
+        MidiMessage message;
+        double sendTimeMs;
+        int generation;
+    };
+
+    ScopedPointer<MidiOutput> output;
+    const String deviceName;
+
+    Atomic<double> latencyMs;
+    const double lookaheadMs;
+
+    Atomic<int> generation;
+
+    // The fifo has a single producer, but the player thread of the next
+    // playback may start while the previous one is still sending note-offs
+    SpinLock producerLock;
+    int session;
+    uint8 soundingNotes[16][128];
+
+    AbstractFifo fifo;
+    Array<ScheduledMessage> fifoBuffer;
+
+    // Owned by the sender thread, sorted by send time
+    Array<ScheduledMessage> pendingMessages;
+    int lastPurgedGeneration;
+
+    Atomic<int> tuningMode;
+
+    // Pitch bend retuning state, guarded by producerLock
+    struct RetunedNote
+    {
+        int8 memberChannel; // zero if not sounding
+        uint8 key;
+    };
+
+    Tuning tuning;
+    bool retuneWithPitchBends;
+    RetunedNote retunedNotes[16][TUNING_NUM_KEYS];
+    int memberChannelNotes[15];
+    uint32 memberChannelLastUsed[15];
+    uint32 numRetunedNotes;
+
+    Atomic<int> numMessagesSent;
+    Atomic<double> totalTimingError;
+    Atomic<double> maxTimingError;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiOutputSender)
+};
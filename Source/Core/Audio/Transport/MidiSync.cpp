@@ -0,0 +1,489 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "MidiSync.h"
+#include "Transport.h"
+#include "SerializationKeys.h"
+#include "Config.h"
+#include "Tracer.h"
+
+#define MIDI_SYNC_CLOCKS_PER_BEAT 24
+#define MIDI_SYNC_CLOCKS_PER_SIXTEENTH 6
+#define MIDI_SYNC_MAX_SONG_POSITION 16383
+#define MIDI_SYNC_SCHEDULING_HORIZON_MS 2000.0
+#define MIDI_SYNC_START_ADVANCE_MS 1.0
+
+// Clocks more than that apart (below 10 bpm) mean the clock has stopped
+#define MIDI_SYNC_CLOCK_TIMEOUT_MS 250.0
+#define MIDI_SYNC_MIN_CLOCKS_TO_LOCK 3
+#define MIDI_SYNC_PHASE_GAIN 0.2
+#define MIDI_SYNC_PERIOD_GAIN 0.02
+
+static const double ticksPerClock = MS_PER_BEAT / MIDI_SYNC_CLOCKS_PER_BEAT;
+
+MidiSync::MidiSync(Transport &transport) :
+    transport(transport),
+    mode(Off),
+    masterSession(0),
+    needsStart(false)
+{
+    this->clockSegment = { 0, -1, 0.0, 0.0 };
+    this->clockState = { false, false, 0, 0, 0.0, 0.0, 0.0 };
+
+    this->mode = int(Config::getValue(Serialization::Core::midiSyncMode, int(Off)));
+    this->inputDeviceName = Config::get(Serialization::Core::midiSyncInput);
+    this->outputDeviceName = Config::get(Serialization::Core::midiSyncOutput);
+    this->openDevices();
+}
+
+MidiSync::~MidiSync()
+{
+    this->cancelPendingUpdate();
+    this->closeDevices();
+}
+
+MidiSync::Mode MidiSync::getMode() const noexcept
+{
+    return Mode(this->mode.get());
+}
+
+String MidiSync::getInputDeviceName() const noexcept
+{
+    return this->inputDeviceName;
+}
+
+String MidiSync::getOutputDeviceName() const noexcept
+{
+    return this->outputDeviceName;
+}
+
+void MidiSync::setMode(Mode newMode, const String &newInputDeviceName, const String &newOutputDeviceName)
+{
+    this->closeDevices();
+
+    this->mode = int(newMode);
+    this->inputDeviceName = newInputDeviceName;
+    this->outputDeviceName = newOutputDeviceName;
+
+    Config::set(Serialization::Core::midiSyncMode, int(newMode));
+    Config::set(Serialization::Core::midiSyncInput, newInputDeviceName);
+    Config::set(Serialization::Core::midiSyncOutput, newOutputDeviceName);
+
+    this->openDevices();
+}
+
+void MidiSync::openDevices()
+{
+    if (this->getMode() == Master && this->outputDeviceName.isNotEmpty())
+    {
+        MidiOutputSender::Ptr output(MidiOutputSender::openDevice(this->outputDeviceName, 0.0));
+        const SpinLock::ScopedLockType lock(this->masterLock);
+        this->clockOutput = output;
+    }
+    else if (this->getMode() == Slave && this->inputDeviceName.isNotEmpty())
+    {
+        const int deviceIndex = MidiInput::getDevices().indexOf(this->inputDeviceName);
+        if (deviceIndex < 0)
+        {
+            Logger::writeToLog("MIDI sync input not found: " + this->inputDeviceName);
+            return;
+        }
+
+        this->clockInput = MidiInput::openDevice(deviceIndex, this);
+        if (this->clockInput != nullptr)
+        {
+            this->clockInput->start();
+        }
+    }
+}
+
+void MidiSync::closeDevices()
+{
+    if (this->clockInput != nullptr)
+    {
+        this->clockInput->stop();
+        this->clockInput = nullptr;
+    }
+
+    {
+        const SpinLock::ScopedLockType lock(this->clockStateLock);
+        this->clockState = { false, false, 0, 0, 0.0, 0.0, 0.0 };
+    }
+
+    MidiOutputSender::Ptr output;
+
+    {
+        const SpinLock::ScopedLockType lock(this->masterLock);
+        output = this->clockOutput;
+        this->clockOutput = nullptr;
+        this->masterSession++;
+    }
+
+    // The sender's thread is stopped outside of the lock
+    output = nullptr;
+}
+
+double MidiSync::getTicksOffset() const noexcept
+{
+    // The sequences timeline starts at the project's first beat
+    return this->transport.trackStartMs.get();
+}
+
+//===----------------------------------------------------------------------===//
+// Master
+//===----------------------------------------------------------------------===//
+
+bool MidiSync::isMaster() const noexcept
+{
+    return (this->getMode() == Master);
+}
+
+int MidiSync::masterStart()
+{
+    const SpinLock::ScopedLockType lock(this->masterLock);
+
+    if (this->clockOutput == nullptr)
+    {
+        return 0;
+    }
+
+    // Whatever the previous session has scheduled is not relevant anymore
+    this->clockOutput->cancelPending();
+    this->clockSegment = { 0, -1, 0.0, 0.0 };
+    this->needsStart = true;
+    return ++this->masterSession;
+}
+
+void MidiSync::masterReposition(int session, double idealTimeMs)
+{
+    const SpinLock::ScopedLockType lock(this->masterLock);
+
+    if (this->clockOutput == nullptr || session != this->masterSession)
+    {
+        return;
+    }
+
+    // The receivers only accept the song position when stopped
+    this->clockOutput->schedule(MidiMessage::midiStop(), idealTimeMs);
+    this->clockSegment = { 0, -1, 0.0, 0.0 };
+    this->needsStart = true;
+}
+
+void MidiSync::masterStop(int session)
+{
+    const SpinLock::ScopedLockType lock(this->masterLock);
+
+    if (this->clockOutput == nullptr || session != this->masterSession)
+    {
+        return;
+    }
+
+    this->clockOutput->cancelPending();
+    this->clockOutput->schedule(MidiMessage::midiStop(), Time::getMillisecondCounterHiRes());
+    this->clockSegment = { 0, -1, 0.0, 0.0 };
+    this->needsStart = false;
+}
+
+void MidiSync::masterScheduleClocks(int session, double fromTick, double toTick,
+    double idealTimeMsAtFromTick, double msPerTick)
+{
+    const SpinLock::ScopedLockType lock(this->masterLock);
+
+    if (this->clockOutput == nullptr || session != this->masterSession)
+    {
+        return;
+    }
+
+    // Clocks are on the absolute beat grid, not relative to the playback start;
+    // the epsilon keeps the clock that falls exactly at the boundary
+    // from being scheduled twice due to the rounding errors
+    const double fromClock = (fromTick + this->getTicksOffset()) / ticksPerClock;
+    const double toClock = (toTick + this->getTicksOffset()) / ticksPerClock;
+    const double msPerClock = msPerTick * ticksPerClock;
+
+    this->clockSegment.nextClock = int64(ceil(fromClock - 0.0001));
+    this->clockSegment.lastClock = int64(ceil(toClock - 0.0001)) - 1;
+    this->clockSegment.msPerClock = msPerClock;
+    this->clockSegment.idealTimeMsAtClockZero = idealTimeMsAtFromTick - fromClock * msPerClock;
+
+    this->scheduleClocksUntil(this->clockOutput,
+        Time::getMillisecondCounterHiRes() + MIDI_SYNC_SCHEDULING_HORIZON_MS);
+}
+
+void MidiSync::masterUpdateClocks(int session)
+{
+    const SpinLock::ScopedLockType lock(this->masterLock);
+
+    if (this->clockOutput == nullptr || session != this->masterSession)
+    {
+        return;
+    }
+
+    this->scheduleClocksUntil(this->clockOutput,
+        Time::getMillisecondCounterHiRes() + MIDI_SYNC_SCHEDULING_HORIZON_MS);
+}
+
+void MidiSync::scheduleClocksUntil(MidiOutputSender *output, double horizonMs)
+{
+    ClockSegment &segment = this->clockSegment;
+
+    while (segment.nextClock <= segment.lastClock)
+    {
+        // Song position cannot be negative
+        if (segment.nextClock < 0)
+        {
+            segment.nextClock = 0;
+            continue;
+        }
+
+        // The song position is measured in sixteenths, so after a (re)start
+        // the clocks are only resumed at the next sixteenth
+        if (this->needsStart && (segment.nextClock % MIDI_SYNC_CLOCKS_PER_SIXTEENTH) != 0)
+        {
+            segment.nextClock += MIDI_SYNC_CLOCKS_PER_SIXTEENTH -
+                (segment.nextClock % MIDI_SYNC_CLOCKS_PER_SIXTEENTH);
+            continue;
+        }
+
+        const double clockTimeMs = segment.idealTimeMsAtClockZero +
+            double(segment.nextClock) * segment.msPerClock;
+
+        if (clockTimeMs > horizonMs)
+        {
+            return;
+        }
+
+        if (this->needsStart)
+        {
+            const int64 songPosition = segment.nextClock / MIDI_SYNC_CLOCKS_PER_SIXTEENTH;
+            const double startTimeMs = clockTimeMs - MIDI_SYNC_START_ADVANCE_MS;
+
+            if (songPosition == 0)
+            {
+                output->schedule(MidiMessage::midiStart(), startTimeMs);
+            }
+            else
+            {
+                const int position = int(jmin(songPosition, int64(MIDI_SYNC_MAX_SONG_POSITION)));
+                output->schedule(MidiMessage::songPositionPointer(position), startTimeMs);
+                output->schedule(MidiMessage::midiContinue(), startTimeMs);
+            }
+
+            this->needsStart = false;
+        }
+
+        output->schedule(MidiMessage::midiClock(), clockTimeMs);
+        segment.nextClock++;
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Slave
+//===----------------------------------------------------------------------===//
+
+bool MidiSync::isSlave() const noexcept
+{
+    return (this->getMode() == Slave);
+}
+
+bool MidiSync::getSlaveTimeForTick(double tick, double &outTimeMs) const noexcept
+{
+    const SpinLock::ScopedLockType lock(this->clockStateLock);
+    const ClockState &state = this->clockState;
+
+    if (!state.isRunning ||
+        state.periodMs <= 0.0 ||
+        state.numClocksReceived < MIDI_SYNC_MIN_CLOCKS_TO_LOCK ||
+        Time::getMillisecondCounterHiRes() - state.lastRawTimeMs > MIDI_SYNC_CLOCK_TIMEOUT_MS)
+    {
+        return false;
+    }
+
+    // Right after the start, the position refers to the clock that is yet to come
+    const double anchorTimeMs = state.isWaitingForFirstClock ?
+        (state.filteredTimeMs + state.periodMs) : state.filteredTimeMs;
+
+    const double clockAtTick = (tick + this->getTicksOffset()) / ticksPerClock;
+    outTimeMs = anchorTimeMs + (clockAtTick - double(state.position)) * state.periodMs;
+    return true;
+}
+
+double MidiSync::getSlaveMsPerTick() const noexcept
+{
+    const SpinLock::ScopedLockType lock(this->clockStateLock);
+    return this->clockState.periodMs / ticksPerClock;
+}
+
+void MidiSync::handleIncomingMidiMessage(MidiInput *source, const MidiMessage &message)
+{
+    if (message.isMidiClock())
+    {
+        // Timestamps are in seconds of the same counter the player uses
+        this->handleClock(message.getTimeStamp() * 1000.0);
+        return;
+    }
+
+    PendingCommand command = { StopCommand, 0 };
+
+    {
+        const SpinLock::ScopedLockType lock(this->clockStateLock);
+        ClockState &state = this->clockState;
+
+        if (message.isMidiStart())
+        {
+            state.isRunning = true;
+            state.isWaitingForFirstClock = true;
+            state.position = 0;
+            command = { StartCommand, 0 };
+        }
+        else if (message.isMidiContinue())
+        {
+            state.isRunning = true;
+            state.isWaitingForFirstClock = true;
+            command = { ContinueCommand, state.position };
+        }
+        else if (message.isMidiStop())
+        {
+            state.isRunning = false;
+            command = { StopCommand, state.position };
+        }
+        else if (message.isSongPositionPointer())
+        {
+            state.position = int64(message.getSongPositionPointerMidiBeat()) * MIDI_SYNC_CLOCKS_PER_SIXTEENTH;
+            command = { SeekCommand, state.position };
+        }
+        else
+        {
+            return;
+        }
+    }
+
+    Tracer::instant("MidiSync", message.getDescription());
+
+    {
+        const SpinLock::ScopedLockType lock(this->pendingCommandsLock);
+        this->pendingCommands.add(command);
+    }
+
+    this->triggerAsyncUpdate();
+}
+
+void MidiSync::handleClock(double timeMs)
+{
+    const SpinLock::ScopedLockType lock(this->clockStateLock);
+    ClockState &state = this->clockState;
+
+    const double rawPeriodMs = timeMs - state.lastRawTimeMs;
+
+    if (state.numClocksReceived == 0 || rawPeriodMs > MIDI_SYNC_CLOCK_TIMEOUT_MS)
+    {
+        state.filteredTimeMs = timeMs;
+        state.periodMs = 0.0;
+        state.numClocksReceived = 1;
+    }
+    else if (state.periodMs <= 0.0)
+    {
+        state.filteredTimeMs = timeMs;
+        state.periodMs = rawPeriodMs;
+        state.numClocksReceived++;
+    }
+    else
+    {
+        // A second-order loop: the phase follows the incoming clocks
+        // with some smoothing, and the period slowly drifts towards the real one
+        const double predictedTimeMs = state.filteredTimeMs + state.periodMs;
+        const double errorMs = timeMs - predictedTimeMs;
+
+        if (fabs(errorMs) > state.periodMs)
+        {
+            // The tempo has jumped, or some clocks were lost: start over
+            state.filteredTimeMs = timeMs;
+            state.periodMs = rawPeriodMs;
+            state.numClocksReceived = 2;
+        }
+        else
+        {
+            state.filteredTimeMs = predictedTimeMs + MIDI_SYNC_PHASE_GAIN * errorMs;
+            state.periodMs += MIDI_SYNC_PERIOD_GAIN * errorMs;
+            state.numClocksReceived++;
+        }
+
+        Tracer::counter("MIDI sync clock error, ms", errorMs);
+    }
+
+    state.lastRawTimeMs = timeMs;
+
+    if (state.isRunning)
+    {
+        if (state.isWaitingForFirstClock)
+        {
+            state.isWaitingForFirstClock = false;
+        }
+        else
+        {
+            state.position++;
+        }
+    }
+}
+
+void MidiSync::handleAsyncUpdate()
+{
+    Array<PendingCommand> commands;
+
+    {
+        const SpinLock::ScopedLockType lock(this->pendingCommandsLock);
+        commands.swapWith(this->pendingCommands);
+    }
+
+    auto seekToClock = [this](int64 position)
+    {
+        const double beat = double(position) / MIDI_SYNC_CLOCKS_PER_BEAT;
+        const double firstBeat = double(this->transport.projectFirstBeat.get());
+        const double lastBeat = double(this->transport.projectLastBeat.get());
+        const double beatRange = lastBeat - firstBeat;
+        const double absPosition = (beatRange > 0.0) ? ((beat - firstBeat) / beatRange) : 0.0;
+        this->transport.seekToPosition(jlimit(0.0, 1.0, absPosition));
+    };
+
+    for (const auto &command : commands)
+    {
+        switch (command.command)
+        {
+        case StartCommand:
+            this->transport.stopPlayback();
+            seekToClock(command.position);
+            this->transport.startPlayback();
+            break;
+        case ContinueCommand:
+            if (!this->transport.isPlaying())
+            {
+                this->transport.startPlayback();
+            }
+            break;
+        case StopCommand:
+            this->transport.stopPlayback();
+            break;
+        case SeekCommand:
+            seekToClock(command.position);
+            break;
+        default:
+            break;
+        }
+    }
+}
@@ -0,0 +1,174 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+class Transport;
+
+#include "MidiOutputSender.h"
+
+// MIDI beat clock and song position pointer sync.
+//
+// As a master, the player thread asks to schedule 24 clocks per quarter note
+// on the project's beat grid, along with the start, stop and song position
+// messages; they go through a MidiOutputSender, so they are sent at their
+// ideal times rather than whenever the player thread wakes up.
+//
+// As a slave, incoming clocks drive a simple phase-locked loop,
+// which smooths out the jitter and estimates the clock period;
+// the player thread then asks when a given tick is due by the external clock,
+// and start, stop and song position messages are applied to the transport.
+
+class MidiSync final :
+    private MidiInputCallback,
+    private AsyncUpdater
+{
+public:
+
+    enum Mode
+    {
+        Off = 0,
+        Master = 1,
+        Slave = 2
+    };
+
+    explicit MidiSync(Transport &transport);
+    ~MidiSync() override;
+
+    Mode getMode() const noexcept;
+    String getInputDeviceName() const noexcept;
+    String getOutputDeviceName() const noexcept;
+
+    // Opens the devices and stores the settings in config
+    void setMode(Mode newMode, const String &inputDeviceName, const String &outputDeviceName);
+
+    //===------------------------------------------------------------------===//
+    // Master, called from the player thread
+    //===------------------------------------------------------------------===//
+
+    bool isMaster() const noexcept;
+
+    // Returns the session id the other calls should pass, or 0 if not a master.
+    // The player thread that is still stopping might call these concurrently
+    // with the new one, so all the calls from a stale session are ignored.
+    int masterStart();
+
+    // The loop jumps back: sends a stop, then the new song position
+    // and a continue right before the next clock
+    void masterReposition(int session, double idealTimeMs);
+
+    void masterStop(int session);
+
+    // Sets up the clocks between two ticks of the timeline;
+    // only those falling within a couple of seconds are scheduled right away,
+    // the rest are scheduled by the following calls to masterUpdateClocks
+    void masterScheduleClocks(int session, double fromTick, double toTick,
+        double idealTimeMsAtFromTick, double msPerTick);
+    void masterUpdateClocks(int session);
+
+    //===------------------------------------------------------------------===//
+    // Slave
+    //===------------------------------------------------------------------===//
+
+    bool isSlave() const noexcept;
+
+    // Returns false until the external clock is running and stable
+    bool getSlaveTimeForTick(double tick, double &outTimeMs) const noexcept;
+    double getSlaveMsPerTick() const noexcept;
+
+private:
+
+    Transport &transport;
+
+    Atomic<int> mode;
+    String inputDeviceName;
+    String outputDeviceName;
+
+    void openDevices();
+    void closeDevices();
+
+    double getTicksOffset() const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Master
+    //===------------------------------------------------------------------===//
+
+    MidiOutputSender::Ptr clockOutput;
+
+    struct ClockSegment
+    {
+        int64 nextClock;
+        int64 lastClock;
+        double idealTimeMsAtClockZero;
+        double msPerClock;
+    };
+
+    int masterSession;
+    bool needsStart;
+    ClockSegment clockSegment;
+    SpinLock masterLock;
+
+    void scheduleClocksUntil(MidiOutputSender *output, double horizonMs);
+
+    //===------------------------------------------------------------------===//
+    // Slave
+    //===------------------------------------------------------------------===//
+
+    ScopedPointer<MidiInput> clockInput;
+
+    void handleIncomingMidiMessage(MidiInput *source, const MidiMessage &message) override;
+    void handleClock(double timeMs);
+
+    struct ClockState
+    {
+        bool isRunning;
+        bool isWaitingForFirstClock;
+        int numClocksReceived;
+
+        // Absolute position of the last clock, in clocks from the song start
+        int64 position;
+
+        double lastRawTimeMs;
+        double filteredTimeMs;
+        double periodMs;
+    };
+
+    ClockState clockState;
+    mutable SpinLock clockStateLock;
+
+    enum Command
+    {
+        StartCommand,
+        ContinueCommand,
+        StopCommand,
+        SeekCommand
+    };
+
+    struct PendingCommand
+    {
+        Command command;
+        int64 position;
+    };
+
+    Array<PendingCommand> pendingCommands;
+    SpinLock pendingCommandsLock;
+
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiSync)
+};
@@ -20,9 +20,12 @@
 
 #include "PlayerThread.h"
 #include "Instrument.h"
+#include "MidiSync.h"
+#include "Metronome.h"
 #include "MidiSequence.h"
 
 #include "DataEncoder.h"
+#include "Tracer.h"
 
 #define MINIMUM_STOP_CHECK_TIME_MS 1000
 
@@ -66,18 +69,37 @@ void PlayerThread::run()
                                        currentTimeMs,
                                        msPerTick);
     
+    const double totalTime = this->transport.getTotalTime();
+    double startPositionInTime = round(absStartPosition * totalTime);
+    const double endPositionInTime = round(absEndPosition * totalTime);
+
+    // Pre-roll starts the playback a few bars earlier than the seek position
+    Metronome &metronome = this->transport.getMetronome();
+    const double ticksOffset = this->transport.trackStartMs.get();
+    if (! this->transport.isLooped() && metronome.getPreRollBars() > 0)
+    {
+        const double barLength = Metronome::getBarLengthInTicks(sequences, ticksOffset, startPositionInTime);
+        startPositionInTime = jmax(0.0, startPositionInTime - barLength * metronome.getPreRollBars());
+        this->transport.calcTimeAndTempoAt(startPositionInTime / totalTime, currentTimeMs, msPerTick);
+    }
+
+    // On every loop, the tempo starts over from here
+    const double msPerTickAtStart = msPerTick;
+
     if (this->broadcastMode)
     {
         this->transport.broadcastTempoChanged(msPerTick);
     }
     
-    const double totalTime = this->transport.getTotalTime();
-    const double startPositionInTime = round(absStartPosition * totalTime);
-    const double endPositionInTime = round(absEndPosition * totalTime);
-    
-    sequences.seekToTime(startPositionInTime);
-    double prevTimeStamp = startPositionInTime;
-    
+    // Instruments routed to external midi outputs are resolved once per playback;
+    // their messages are scheduled at the ideal time, not at the moment we wake up
+    struct ExternalOutput
+    {
+        Instrument *instrument;
+        MidiOutputSender::Ptr sender;
+        int session;
+    };
+
     // This hack is here to keep track of still playing events
     // to be able to send noteOff's when playback interrupts.
     struct HoldingNote
@@ -85,9 +107,66 @@ void PlayerThread::run()
         int key;
         int channel;
         MidiMessageCollector *listener;
+        const ExternalOutput *output;
     };
     // (some plugins just don't understand allNotesOff message)
     Array<HoldingNote> holdingNotes;
+
+    const Tuning tuning(this->transport.getTuning());
+
+    Array<ExternalOutput> externalOutputs;
+    for (auto &instrument : uniqueInstruments)
+    {
+        if (MidiOutputSender::Ptr sender = instrument->getMidiOutputSender())
+        {
+            const int session = sender->startSession(tuning);
+            externalOutputs.add({ instrument, sender, session });
+        }
+    }
+
+    // Not resized from now on, so the pointers stay valid
+    auto findExternalOutput = [&externalOutputs](const Instrument *instrument) -> const ExternalOutput *
+    {
+        for (const auto &output : externalOutputs)
+        {
+            if (output.instrument == instrument)
+            {
+                return &output;
+            }
+        }
+
+        return nullptr;
+    };
+
+    // As a master, schedules the beat clock along with the playback;
+    // as a slave, follows the external clock once it gets stable
+    MidiSync &sync = this->transport.getMidiSync();
+    const int syncSession = sync.masterStart();
+    const bool isSyncSlave = sync.isSlave();
+
+    auto followExternalClock = [&sync, isSyncSlave](double tick, double &idealTimeMs, double &timeDelta)
+    {
+        double syncedTimeMs = 0.0;
+        if (isSyncSlave && sync.getSlaveTimeForTick(tick, syncedTimeMs))
+        {
+            idealTimeMs = syncedTimeMs;
+            timeDelta = jmax(0.0, syncedTimeMs - Time::getMillisecondCounterHiRes());
+        }
+    };
+
+    // The clicks are rendered by the metronome's audio callback,
+    // all it needs to know is when the playback starts after the count-in;
+    // there's no count-in when following an external clock
+    Array<Metronome::Click> clicks;
+    int numCountInClicks = 0;
+    double countInMs = 0.0;
+    double rangeMs = 0.0;
+    const int countInBars = (metronome.isEnabled() && ! isSyncSlave) ? metronome.getCountInBars() : 0;
+    Metronome::createClicks(sequences, ticksOffset, startPositionInTime, endPositionInTime,
+        msPerTick, countInBars, clicks, numCountInClicks, countInMs, rangeMs);
+
+    sequences.seekToTime(startPositionInTime);
+    double prevTimeStamp = startPositionInTime;
     
     // Some shorthands:
     auto sendMidiStart = [&uniqueInstruments]()
@@ -100,13 +179,33 @@ void PlayerThread::run()
         }
     };
 
-    auto sendHoldingNotesOffAndMidiStop = [&holdingNotes, &uniqueInstruments]()
+    int metronomeSession = 0;
+
+    auto sendHoldingNotesOffAndMidiStop = [&holdingNotes, &uniqueInstruments, &externalOutputs,
+        &sync, syncSession, &metronome, &metronomeSession]()
     {
+        sync.masterStop(syncSession);
+        metronome.stop(metronomeSession);
+
         for (const auto &holding : holdingNotes)
         {
             MidiMessage noteOff(MidiMessage::noteOff(holding.channel, holding.key, 0.f));
             noteOff.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
             holding.listener->addMessageToQueue(noteOff);
+
+            if (holding.output != nullptr)
+            {
+                holding.output->sender->schedule(holding.output->session,
+                    noteOff, Time::getMillisecondCounterHiRes());
+            }
+        }
+
+        for (const auto &output : externalOutputs)
+        {
+            Logger::writeToLog("MIDI output " + output.sender->getDeviceName() +
+                ": " + String(output.sender->getNumMessagesSent()) + " messages, timing error " +
+                String(output.sender->getMeanTimingError(), 3) + " ms mean, " +
+                String(output.sender->getMaxTimingError(), 3) + " ms max");
         }
         
         MidiMessage stopPlayback(MidiMessage::midiStop());
@@ -131,6 +230,24 @@ void PlayerThread::run()
     
     // And here we go.
     sendMidiStart();
+
+    // The timeline all the waits are measured against, so that
+    // the rounding and wake-up errors don't accumulate over time
+    double idealTimeMs = Time::getMillisecondCounterHiRes() + countInMs;
+    metronomeSession = metronome.start(clicks, numCountInClicks,
+        idealTimeMs, this->transport.isLooped() ? rangeMs : 0.0);
+
+    // Let the count-in play out, still checking if we should stop
+    while (Time::getMillisecondCounterHiRes() < idealTimeMs)
+    {
+        const double timeLeftMs = idealTimeMs - Time::getMillisecondCounterHiRes();
+        Thread::sleep(jmin(MINIMUM_STOP_CHECK_TIME_MS, int(timeLeftMs) + 1));
+        if (this->threadShouldExit())
+        {
+            sendHoldingNotesOffAndMidiStop();
+            return;
+        }
+    }
     
     while (1)
     {
@@ -140,13 +257,17 @@ void PlayerThread::run()
         if (!sequences.getNextMessage(wrapper))
         {
             nextEventTimeDelta = msPerTick * (endPositionInTime - prevTimeStamp);
-            const uint32 targetTime = Time::getMillisecondCounter() + uint32(nextEventTimeDelta);
+            sync.masterScheduleClocks(syncSession, prevTimeStamp, endPositionInTime, idealTimeMs, msPerTick);
+            idealTimeMs += nextEventTimeDelta;
+            followExternalClock(endPositionInTime, idealTimeMs, nextEventTimeDelta);
+            const uint32 targetTime = uint32(idealTimeMs);
 
             // Give thread a chance to exit by checking at least once a, say, second
             while (nextEventTimeDelta > MINIMUM_STOP_CHECK_TIME_MS)
             {
                 nextEventTimeDelta -= MINIMUM_STOP_CHECK_TIME_MS;
                 Thread::sleep(MINIMUM_STOP_CHECK_TIME_MS);
+                sync.masterUpdateClocks(syncSession);
                 if (this->threadShouldExit())
                 {
                     sendHoldingNotesOffAndMidiStop();
@@ -159,8 +280,10 @@ void PlayerThread::run()
             if (this->transport.isLooped())
             {
                 //Logger::writeToLog("Seek to time " + String(startPositionInTime));
+                sync.masterReposition(syncSession, idealTimeMs);
                 sequences.seekToTime(startPositionInTime);
                 prevTimeStamp = startPositionInTime;
+                msPerTick = msPerTickAtStart;
                 continue;
             }
             else
@@ -186,17 +309,21 @@ void PlayerThread::run()
             shouldRewind ? endPositionInTime : wrapper.message.getTimeStamp();
 
         nextEventTimeDelta = msPerTick * (nextEventTimeStamp - prevTimeStamp);
+        sync.masterScheduleClocks(syncSession, prevTimeStamp, nextEventTimeStamp, idealTimeMs, msPerTick);
         currentTimeMs += nextEventTimeDelta;
+        idealTimeMs += nextEventTimeDelta;
+        followExternalClock(nextEventTimeStamp, idealTimeMs, nextEventTimeDelta);
         prevTimeStamp = nextEventTimeStamp;
 
         // Zero-delay check (we're playing a chord or so)
         if (uint32(nextEventTimeDelta) != 0)
         {
-            const uint32 targetTime = Time::getMillisecondCounter() + uint32(nextEventTimeDelta);
+            const uint32 targetTime = uint32(idealTimeMs);
             while (nextEventTimeDelta > MINIMUM_STOP_CHECK_TIME_MS)
             {
                 nextEventTimeDelta -= MINIMUM_STOP_CHECK_TIME_MS;
                 Thread::sleep(MINIMUM_STOP_CHECK_TIME_MS);
+                sync.masterUpdateClocks(syncSession);
                 if (this->threadShouldExit())
                 {
                     sendHoldingNotesOffAndMidiStop();
@@ -205,6 +332,7 @@ void PlayerThread::run()
             }
 
             Time::waitForMillisecondCounter(targetTime);
+            Tracer::counter("PlayerThread lateness, ms", double(int(Time::getMillisecondCounter() - targetTime)));
 
             if (this->threadShouldExit())
             {
@@ -220,13 +348,17 @@ void PlayerThread::run()
         
         if (shouldRewind)
         {
+            sync.masterReposition(syncSession, idealTimeMs);
             sequences.seekToTime(startPositionInTime);
             prevTimeStamp = startPositionInTime;
+            msPerTick = msPerTickAtStart;
         }
         else
         {
+            TRACE_SCOPE("PlayerThread::dispatch");
             const int key = wrapper.message.getNoteNumber();
             const int channel = wrapper.message.getChannel();
+            const ExternalOutput *output = findExternalOutput(wrapper.instrument);
             wrapper.message.setTimeStamp(Time::getMillisecondCounterHiRes() * 0.001);
             
             // Master tempo event is sent to everybody
@@ -246,11 +378,16 @@ void PlayerThread::run()
             {
                 //Logger::writeToLog(String(wrapper.message.getNoteNumber()));
                 wrapper.listener->addMessageToQueue(wrapper.message);
+
+                if (output != nullptr)
+                {
+                    output->sender->schedule(output->session, wrapper.message, idealTimeMs);
+                }
             }
             
             if (wrapper.message.isNoteOn())
             {
-                holdingNotes.add(HoldingNote({key, channel, wrapper.listener}));
+                holdingNotes.add(HoldingNote({key, channel, wrapper.listener, output}));
             }
             
             if (wrapper.message.isNoteOff())
@@ -18,6 +18,7 @@
 #include "Common.h"
 #include "RendererThread.h"
 #include "Instrument.h"
+#include "Metronome.h"
 #include "Supervisor.h"
 #include "SerializationKeys.h"
 #include "App.h"
@@ -182,6 +183,22 @@ void RendererThread::run()
         graph->setNonRealtime(true);
     }
 
+    // step 2a. lay out the metronome clicks, if needed.
+    Metronome::ClickRenderer clickRenderer;
+    const bool shouldRenderClicks = this->transport.getMetronome().isIncludedInRenders();
+
+    if (shouldRenderClicks)
+    {
+        Array<Metronome::Click> clicks;
+        int numCountInClicks = 0;
+        double countInMs = 0.0;
+        double rangeMs = 0.0;
+        Metronome::createClicks(sequences, this->transport.trackStartMs.get(),
+            0.0, this->transport.getTotalTime(), msPerTick * 1000.0 / TPQN, 0,
+            clicks, numCountInClicks, countInMs, rangeMs);
+        clickRenderer.reset(clicks, numCountInClicks, 0.0, sampleRate);
+    }
+
     // step 3. render loop itself.
     sequences.seekToTime(0.0);
     
@@ -277,6 +294,12 @@ void RendererThread::run()
             }
         }
 
+        if (shouldRenderClicks)
+        {
+            clickRenderer.render(mixingBuffer.getArrayOfWritePointers(),
+                numOutChannels, bufferSize, int64(currentFrame));
+        }
+
         // step 3d. write resulting buffer to disk.
         {
             const ScopedLock sl(this->writerLock);
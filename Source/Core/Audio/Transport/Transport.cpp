@@ -21,6 +21,8 @@
 #include "OrchestraPit.h"
 #include "PlayerThread.h"
 #include "RendererThread.h"
+#include "MidiSync.h"
+#include "Metronome.h"
 #include "MidiSequence.h"
 #include "MidiEvent.h"
 #include "MidiTrack.h"
@@ -28,6 +30,7 @@
 #include "Workspace.h"
 #include "AudioCore.h"
 #include "HybridRoll.h"
+#include "BuiltInSynthAudioPlugin.h"
 
 class PlayerThreadPool final
 {
@@ -144,6 +147,9 @@ Transport::Transport(OrchestraPit &orchestraPit) :
 {
     this->player = new PlayerThreadPool(*this);
     this->renderer = new RendererThread(*this);
+    this->midiSync = new MidiSync(*this);
+    this->metronome = new Metronome();
+    App::Workspace().getAudioCore().getDevice().addAudioCallback(this->metronome);
     this->orchestra.addOrchestraListener(this);
 }
 
@@ -152,6 +158,9 @@ Transport::~Transport()
     this->orchestra.removeOrchestraListener(this);
     this->renderer = nullptr;
     this->player = nullptr;
+    App::Workspace().getAudioCore().getDevice().removeAudioCallback(this->metronome);
+    this->metronome = nullptr;
+    this->midiSync = nullptr;
     this->transportListeners.clear();
 }
 
@@ -309,6 +318,7 @@ void Transport::probeSequence(const MidiMessageSequence &sequence)
 void Transport::startPlayback()
 {
     this->rebuildSequencesIfNeeded();
+    this->retuneInstruments();
     if (this->player->isPlaying())
     {
         this->player->stopPlayback();
@@ -323,6 +333,7 @@ void Transport::startPlayback()
 void Transport::startPlaybackLooped(double absLoopStart, double absLoopEnd)
 {
     this->rebuildSequencesIfNeeded();
+    this->retuneInstruments();
     
     if (this->player->isPlaying())
     {
@@ -384,6 +395,7 @@ void Transport::startRender(const String &fileName)
     }
     
     App::Workspace().getAudioCore().mute();
+    this->retuneInstruments();
     
     File file(File::getCurrentWorkingDirectory().getChildFile(fileName));
     this->renderer->startRecording(file);
@@ -512,6 +524,21 @@ void Transport::instrumentAdded(Instrument *instrument)
     }
 }
 
+void Transport::instrumentLoaded(Instrument *instrument)
+{
+    // Doesn't stop the playback: the tracks linked to this instrument
+    // just start sounding, and the others are not interrupted;
+    // but the hashes have changed, and the new synths need retuning
+    this->sequencesAreOutdated = true;
+
+    for (int i = 0; i < this->tracksCache.size(); ++i)
+    {
+        this->updateLinkForTrack(this->tracksCache.getUnchecked(i));
+    }
+
+    this->retuneInstruments();
+}
+
 void Transport::instrumentRemoved(Instrument *instrument)
 {
     // the instrument stack have still not changed here,
@@ -732,6 +759,53 @@ MidiMessage Transport::findFirstTempoEvent()
     return MidiMessage::tempoMetaEvent(int(MS_PER_BEAT) * 1000);
 }
 
+MidiSync &Transport::getMidiSync() const noexcept
+{
+    return *this->midiSync;
+}
+
+Metronome &Transport::getMetronome() const noexcept
+{
+    return *this->metronome;
+}
+
+
+//===----------------------------------------------------------------------===//
+// Tuning
+//===----------------------------------------------------------------------===//
+
+void Transport::setTuning(const Tuning &newTuning)
+{
+    {
+        const SpinLock::ScopedLockType lock(this->tuningLock);
+        this->tuning = newTuning;
+    }
+
+    this->retuneInstruments();
+}
+
+Tuning Transport::getTuning() const
+{
+    const SpinLock::ScopedLockType lock(this->tuningLock);
+    return this->tuning;
+}
+
+void Transport::retuneInstruments() const
+{
+    const Tuning currentTuning(this->getTuning());
+
+    for (auto instrument : this->orchestra.getInstruments())
+    {
+        for (int i = 0; i < instrument->getNumNodes(); ++i)
+        {
+            if (auto synth = dynamic_cast<BuiltInSynthAudioPlugin *>(instrument->getNode(i)->getProcessor()))
+            {
+                synth->setTuning(currentTuning);
+            }
+        }
+    }
+}
+
 
 //===----------------------------------------------------------------------===//
 // Sequences management
@@ -22,11 +22,14 @@ class OrchestraPit;
 class PlayerThread;
 class PlayerThreadPool;
 class RendererThread;
+class MidiSync;
+class Metronome;
 
 #include "TransportListener.h"
 #include "ProjectSequencesWrapper.h"
 #include "ProjectListener.h"
 #include "OrchestraListener.h"
+#include "Tuning.h"
 
 class Transport : public ProjectListener, private OrchestraListener
 {
@@ -73,6 +76,18 @@ public:
 
     MidiMessage findFirstTempoEvent();
 
+    MidiSync &getMidiSync() const noexcept;
+    Metronome &getMetronome() const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Tuning
+    //===------------------------------------------------------------------===//
+
+    // The built-in instruments are retuned right away,
+    // the external outputs get the tuning at playback start
+    void setTuning(const Tuning &newTuning);
+    Tuning getTuning() const;
+
     //===------------------------------------------------------------------===//
     // Sending messages at real-time
     //===------------------------------------------------------------------===//
@@ -86,6 +101,7 @@ public:
     //===------------------------------------------------------------------===//
 
     void instrumentAdded(Instrument *instrument) override;
+    void instrumentLoaded(Instrument *instrument) override;
     void instrumentRemoved(Instrument *instrument) override;
     void instrumentRemovedPostAction() override;
 
@@ -133,9 +149,12 @@ private:
 
     ScopedPointer<PlayerThreadPool> player;
     ScopedPointer<RendererThread> renderer;
+    ScopedPointer<MidiSync> midiSync;
+    ScopedPointer<Metronome> metronome;
 
     friend class RendererThread;
     friend class PlayerThread;
+    friend class MidiSync;
 
 private:
 
@@ -151,6 +170,15 @@ private:
     
     void updateLinkForTrack(const MidiTrack *track);
     void removeLinkForTrack(const MidiTrack *track);
+
+private:
+
+    // Instruments are shared between projects,
+    // so they are retuned every time the playback starts
+    void retuneInstruments() const;
+
+    mutable SpinLock tuningLock;
+    Tuning tuning;
     
 private:
     
@@ -102,6 +102,16 @@ bool MidiTrack::isOnOffTrack() const noexcept
         this->getTrackControllerNumber() <= 69);
 }
 
+bool MidiTrack::isPitchBendTrack() const noexcept
+{
+    return (this->getTrackControllerNumber() == MidiTrack::pitchBendController);
+}
+
+bool MidiTrack::isChannelPressureTrack() const noexcept
+{
+    return (this->getTrackControllerNumber() == MidiTrack::channelPressureController);
+}
+
 String MidiTrack::getTrackMuteStateAsString() const
 {
     return (this->isTrackMuted() ? "yes" : "no");
@@ -77,15 +77,21 @@ public:
     void serializeTrackProperties(XmlElement &xml) const;
     void deserializeTrackProperties(const XmlElement &xml);
 
+    // The channel messages other than controllers
+    // get the numbers outside of the controllers range
     enum DefaultControllers
     {
         sustainPedalController = 64,
         tempoController = 81,
+        pitchBendController = 128,
+        channelPressureController = 129
     };
 
     bool isTempoTrack() const noexcept;
     bool isSustainPedalTrack() const noexcept;
     bool isOnOffTrack() const noexcept;
+    bool isPitchBendTrack() const noexcept;
+    bool isChannelPressureTrack() const noexcept;
 
     String getTrackMuteStateAsString() const;
     static bool isTrackMuted(const String &muteState);
@@ -23,6 +23,11 @@
 #include "ProjectListener.h"
 #include "MidiTrackTreeItem.h"
 #include "UndoStack.h"
+#include "ExpressionCurve.h"
+
+// Thinning errors for the imported curves (of 14 bits)
+#define AUTOMATION_PITCH_BEND_IMPORT_TOLERANCE 32
+#define AUTOMATION_7BIT_IMPORT_TOLERANCE 64
 
 AutomationSequence::AutomationSequence(MidiTrack &track,
     ProjectEventDispatcher &dispatcher) :
@@ -37,20 +42,42 @@ void AutomationSequence::importMidi(const MidiMessageSequence &sequence)
     this->clearUndoHistory();
     this->checkpoint();
     this->reset();
+
+    const MidiTrack &track = *this->getTrack();
+    const int controllerNumber = track.getTrackControllerNumber();
+
+    // Recorded curves may have thousands of points per second,
+    // so they are thinned before they become the events
+    ExpressionCurve curve;
     
     for (int i = 0; i < sequence.getNumEvents(); ++i)
     {
         const MidiMessage &message = sequence.getEventPointer(i)->message;
-        
-        if (message.isController())
+        const float beat = float(message.getTimeStamp() / MIDI_IMPORT_SCALE);
+
+        if (track.isPitchBendTrack() && message.isPitchWheel())
+        {
+            curve.addPoint(beat, message.getPitchWheelValue());
+        }
+        else if (track.isChannelPressureTrack() && message.isChannelPressure())
         {
-            const double startTimestamp = message.getTimeStamp() / MIDI_IMPORT_SCALE;
-            const int controllerValue = message.getControllerValue();
-            const float beat = float(startTimestamp);
-            
-            const AutomationEvent event(this, beat, float(controllerValue));
-            this->silentImport(event);
+            curve.addPoint(beat, message.getChannelPressureValue() << 7);
         }
+        else if (message.isController() && message.getControllerNumber() == controllerNumber)
+        {
+            curve.addPoint(beat, message.getControllerValue() << 7);
+        }
+    }
+
+    curve.simplify(track.isPitchBendTrack() ?
+        AUTOMATION_PITCH_BEND_IMPORT_TOLERANCE : AUTOMATION_7BIT_IMPORT_TOLERANCE);
+
+    for (int i = 0; i < curve.size(); ++i)
+    {
+        const ExpressionCurve::Point &point = curve.getPoint(i);
+        const float controllerValue = float(point.value) / float(ExpressionCurve::maxValue);
+        const AutomationEvent event(this, point.beat, controllerValue);
+        this->silentImport(event);
     }
     
     this->updateBeatRange(false);
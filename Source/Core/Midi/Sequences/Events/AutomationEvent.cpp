@@ -25,6 +25,8 @@
 #define AUTOEVENT_DEFAULT_CURVATURE (0.5f)
 #define MIN_INTERPOLATED_CONTROLLER_DELTA (0.01f)
 #define INTERPOLATED_EVENTS_STEP_MS (350)
+#define MIN_INTERPOLATED_HIGH_RESOLUTION_DELTA (0.001f)
+#define INTERPOLATED_HIGH_RESOLUTION_EVENTS_STEP_MS (20)
 
 AutomationEvent::AutomationEvent() : MidiEvent(nullptr, MidiEvent::Auto, 0.f)
 {
@@ -86,6 +88,25 @@ float exponentalInterpolation(float y0, float y1, float factor, float easing)
 }
 
 
+static MidiMessage createMessage(const MidiTrack &track,
+    int channel, int controllerNumber, float value)
+{
+    if (track.isTempoTrack())
+    {
+        return MidiMessage::tempoMetaEvent(int((1.f - value) * MS_PER_BEAT * 1000));
+    }
+    else if (track.isPitchBendTrack())
+    {
+        return MidiMessage::pitchWheel(channel, roundToInt(value * 16383.f));
+    }
+    else if (track.isChannelPressureTrack())
+    {
+        return MidiMessage::channelPressureChange(channel, int(value * 127));
+    }
+
+    return MidiMessage::controllerEvent(channel, controllerNumber, int(value * 127));
+}
+
 Array<MidiMessage> AutomationEvent::toMidiMessages() const
 {
     Array<MidiMessage> result;
@@ -93,21 +114,18 @@ Array<MidiMessage> AutomationEvent::toMidiMessages() const
     // теперь пусть все треки автоматизации ведут себя одинаково
     //if (this->getSequence()->isTempoLayer())
     {
-        MidiMessage cc;
-        const bool isTempoTrack = this->getSequence()->getTrack()->isTempoTrack();
-
-        if (isTempoTrack)
-        {
-            cc = MidiMessage::tempoMetaEvent(int((1.f - this->controllerValue) * MS_PER_BEAT * 1000));
-        }
-        else
-        {
-            cc = MidiMessage::controllerEvent(this->getChannel(),
-                                              this->getControllerNumber(),
-                                              int(this->controllerValue * 127));
-        
-        }
-
+        const MidiTrack &track = *this->getSequence()->getTrack();
+        const int channel = this->getChannel();
+        const int controllerNumber = this->getControllerNumber();
+
+        // Pitch bends are 14-bit, and the ear is way more sensitive to them
+        const bool isHighResolution = track.isPitchBendTrack();
+        const float minInterpolatedDelta = isHighResolution ?
+            MIN_INTERPOLATED_HIGH_RESOLUTION_DELTA : MIN_INTERPOLATED_CONTROLLER_DELTA;
+        const double interpolationStep = isHighResolution ?
+            INTERPOLATED_HIGH_RESOLUTION_EVENTS_STEP_MS : INTERPOLATED_EVENTS_STEP_MS;
+
+        MidiMessage cc(createMessage(track, channel, controllerNumber, this->controllerValue));
         const double startTime = round(this->beat * MS_PER_BEAT);
         cc.setTimeStamp(startTime);
         result.add(cc);
@@ -120,10 +138,10 @@ Array<MidiMessage> AutomationEvent::toMidiMessages() const
             const AutomationEvent *nextEvent = static_cast<AutomationEvent *>(this->getSequence()->getUnchecked(indexOfThis + 1));
             const float controllerDelta = fabs(this->controllerValue - nextEvent->controllerValue);
             
-            if (controllerDelta > MIN_INTERPOLATED_CONTROLLER_DELTA)
+            if (controllerDelta > minInterpolatedDelta)
             {
                 const double nextTime = nextEvent->beat * MS_PER_BEAT;
-                double interpolatedEventTimeStamp = round(startTime + INTERPOLATED_EVENTS_STEP_MS);
+                double interpolatedEventTimeStamp = round(startTime + interpolationStep);
                 
                 while (interpolatedEventTimeStamp < nextTime)
                 {
@@ -135,26 +153,11 @@ Array<MidiMessage> AutomationEvent::toMidiMessages() const
                                                                                       lerpFactor,
                                                                                       c);
                     
-                    //Logger::writeToLog(String(this->curvature) + " :: " + String((interpolatedControllerValue - this->controllerValue) / (nextEvent->controllerValue - this->controllerValue) - lerpFactor));
-                    
-                    //Logger::writeToLog(String(this->controllerValue) + " - " + String(interpolatedControllerValue) + " - " + String(nextEvent->controllerValue));
-                    
-                    if (isTempoTrack)
-                    {
-                        MidiMessage ci(MidiMessage::tempoMetaEvent(int((1.f - interpolatedControllerValue) * MS_PER_BEAT * 1000)));
-                        ci.setTimeStamp(interpolatedEventTimeStamp);
-                        result.add(ci);
-                    }
-                    else
-                    {
-                        MidiMessage ci(MidiMessage::controllerEvent(this->getChannel(),
-                                                                    this->getControllerNumber(),
-                                                                    int(this->controllerValue * 127)));
-                        ci.setTimeStamp(interpolatedEventTimeStamp);
-                        result.add(ci);
-                    }
+                    MidiMessage ci(createMessage(track, channel, controllerNumber, interpolatedControllerValue));
+                    ci.setTimeStamp(interpolatedEventTimeStamp);
+                    result.add(ci);
                     
-                    interpolatedEventTimeStamp += INTERPOLATED_EVENTS_STEP_MS;
+                    interpolatedEventTimeStamp += interpolationStep;
                 }
             }
         }
@@ -0,0 +1,293 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "ExpressionCurve.h"
+
+ExpressionCurve::ExpressionCurve() {}
+
+ExpressionCurve::ExpressionCurve(const ExpressionCurve &other) :
+    points(other.points) {}
+
+ExpressionCurve &ExpressionCurve::operator=(const ExpressionCurve &other)
+{
+    this->points = other.points;
+    return *this;
+}
+
+void ExpressionCurve::addPoint(float beat, int value)
+{
+    const Point point = { beat, uint16(jlimit(0, maxValue, value)) };
+
+    if (this->points.size() > 0 && this->points.getReference(this->points.size() - 1).beat >= beat)
+    {
+        jassert(this->points.getReference(this->points.size() - 1).beat == beat);
+        this->points.getReference(this->points.size() - 1) = point;
+        return;
+    }
+
+    this->points.add(point);
+}
+
+void ExpressionCurve::clear() noexcept
+{
+    this->points.clearQuick();
+}
+
+bool ExpressionCurve::isEmpty() const noexcept
+{
+    return this->points.isEmpty();
+}
+
+int ExpressionCurve::size() const noexcept
+{
+    return this->points.size();
+}
+
+const ExpressionCurve::Point &ExpressionCurve::getPoint(int index) const noexcept
+{
+    return this->points.getReference(index);
+}
+
+//===----------------------------------------------------------------------===//
+// Lookup
+//===----------------------------------------------------------------------===//
+
+int ExpressionCurve::findLastIndexBefore(float beat) const noexcept
+{
+    // The last point at or before the beat, or 0 if there's none
+    int low = 0;
+    int high = this->points.size();
+
+    while (high - low > 1)
+    {
+        const int middle = (low + high) / 2;
+        if (this->points.getReference(middle).beat <= beat)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+int ExpressionCurve::interpolate(int index, float beat) const noexcept
+{
+    const Point &point = this->points.getReference(index);
+    if (beat <= point.beat || index >= this->points.size() - 1)
+    {
+        return point.value;
+    }
+
+    const Point &next = this->points.getReference(index + 1);
+    const float factor = (beat - point.beat) / (next.beat - point.beat);
+    return roundToInt(point.value + (int(next.value) - int(point.value)) * jmin(1.f, factor));
+}
+
+int ExpressionCurve::getValueAt(float beat) const noexcept
+{
+    if (this->points.isEmpty())
+    {
+        return centreValue;
+    }
+
+    return this->interpolate(this->findLastIndexBefore(beat), beat);
+}
+
+//===----------------------------------------------------------------------===//
+// Thinning
+//===----------------------------------------------------------------------===//
+
+void ExpressionCurve::simplify(int tolerance)
+{
+    const int numPoints = this->points.size();
+    if (numPoints < 3)
+    {
+        return;
+    }
+
+    Array<bool> shouldKeep;
+    shouldKeep.insertMultiple(0, false, numPoints);
+    shouldKeep.set(0, true);
+    shouldKeep.set(numPoints - 1, true);
+
+    // No recursion here, as a recorded curve can be really long
+    Array<Range<int>> segments;
+    segments.add({ 0, numPoints - 1 });
+
+    while (segments.size() > 0)
+    {
+        const Range<int> segment = segments.getLast();
+        segments.removeLast();
+
+        const Point &first = this->points.getReference(segment.getStart());
+        const Point &last = this->points.getReference(segment.getEnd());
+        const float beatRange = last.beat - first.beat;
+
+        int farthestIndex = -1;
+        float farthestDistance = float(tolerance);
+
+        for (int i = segment.getStart() + 1; i < segment.getEnd(); ++i)
+        {
+            const Point &point = this->points.getReference(i);
+            const float factor = (beatRange > 0.f) ? ((point.beat - first.beat) / beatRange) : 0.f;
+            const float lerpValue = first.value + (float(last.value) - float(first.value)) * factor;
+            const float distance = fabsf(lerpValue - point.value);
+
+            if (distance > farthestDistance)
+            {
+                farthestDistance = distance;
+                farthestIndex = i;
+            }
+        }
+
+        if (farthestIndex > 0)
+        {
+            shouldKeep.set(farthestIndex, true);
+            segments.add({ segment.getStart(), farthestIndex });
+            segments.add({ farthestIndex, segment.getEnd() });
+        }
+    }
+
+    int numKept = 0;
+    for (int i = 0; i < numPoints; ++i)
+    {
+        if (shouldKeep.getUnchecked(i))
+        {
+            this->points.setUnchecked(numKept++, this->points.getUnchecked(i));
+        }
+    }
+
+    this->points.removeRange(numKept, numPoints - numKept);
+    this->points.minimiseStorageOverheads();
+}
+
+//===----------------------------------------------------------------------===//
+// Drawing
+//===----------------------------------------------------------------------===//
+
+void ExpressionCurve::getColumnRanges(float startBeat, float endBeat,
+    Range<int> *outRanges, int numColumns) const noexcept
+{
+    if (numColumns <= 0)
+    {
+        return;
+    }
+
+    if (this->points.isEmpty())
+    {
+        for (int i = 0; i < numColumns; ++i)
+        {
+            outRanges[i] = Range<int>(centreValue, centreValue);
+        }
+
+        return;
+    }
+
+    const float columnLength = (endBeat - startBeat) / numColumns;
+    int index = this->findLastIndexBefore(startBeat);
+
+    for (int column = 0; column < numColumns; ++column)
+    {
+        const float columnStart = startBeat + column * columnLength;
+        const float columnEnd = columnStart + columnLength;
+
+        while (index < this->points.size() - 1 &&
+            this->points.getReference(index + 1).beat <= columnStart)
+        {
+            ++index;
+        }
+
+        const int startValue = this->interpolate(index, columnStart);
+        Range<int> range(startValue, startValue);
+
+        int endIndex = index;
+        while (endIndex < this->points.size() - 1 &&
+            this->points.getReference(endIndex + 1).beat <= columnEnd)
+        {
+            ++endIndex;
+            range = range.getUnionWith(int(this->points.getReference(endIndex).value));
+        }
+
+        range = range.getUnionWith(this->interpolate(endIndex, columnEnd));
+
+        outRanges[column] = range;
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Serialization
+//===----------------------------------------------------------------------===//
+
+bool ExpressionCurve::operator==(const ExpressionCurve &other) const noexcept
+{
+    if (this->points.size() != other.points.size())
+    {
+        return false;
+    }
+
+    for (int i = 0; i < this->points.size(); ++i)
+    {
+        const Point &a = this->points.getReference(i);
+        const Point &b = other.points.getReference(i);
+        if (a.beat != b.beat || a.value != b.value)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+String ExpressionCurve::toBase64() const
+{
+    MemoryOutputStream stream;
+
+    for (const auto &point : this->points)
+    {
+        stream.writeFloat(point.beat);
+        stream.writeShort(short(point.value));
+    }
+
+    return stream.getMemoryBlock().toBase64Encoding();
+}
+
+void ExpressionCurve::fromBase64(const String &encoded)
+{
+    this->points.clearQuick();
+
+    MemoryBlock block;
+    if (! block.fromBase64Encoding(encoded))
+    {
+        return;
+    }
+
+    MemoryInputStream stream(block, false);
+    this->points.ensureStorageAllocated(int(block.getSize() / 6));
+
+    while (stream.getNumBytesRemaining() >= 6)
+    {
+        const float beat = stream.readFloat();
+        const int value = int(uint16(stream.readShort()));
+        this->addPoint(beat, value);
+    }
+}
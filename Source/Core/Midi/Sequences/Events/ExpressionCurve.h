@@ -0,0 +1,78 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+// A dense, high-resolution controller curve, like a recorded pitch bend.
+//
+// Thousands of points per second would be way too much for the regular
+// events, each having its own id and xml element, so here the points
+// are just packed (beat, 14-bit value) pairs, sorted by beat,
+// serialized as a single base64 blob and linearly interpolated.
+
+class ExpressionCurve final
+{
+public:
+
+    ExpressionCurve();
+    ExpressionCurve(const ExpressionCurve &other);
+    ExpressionCurve &operator=(const ExpressionCurve &other);
+
+    static const int maxValue = 16383;
+    static const int centreValue = 8192;
+
+    struct Point
+    {
+        float beat;
+        uint16 value;
+    };
+
+    // Points should come in order; a point at the same beat as the last one replaces it
+    void addPoint(float beat, int value);
+
+    void clear() noexcept;
+    bool isEmpty() const noexcept;
+    int size() const noexcept;
+    const Point &getPoint(int index) const noexcept;
+
+    int getValueAt(float beat) const noexcept;
+
+    // Drops the points that linear interpolation restores within the tolerance
+    // (Ramer-Douglas-Peucker), which leaves a few points for a smooth gesture
+    void simplify(int tolerance);
+
+    // Sweeps the curve once, filling in the value range covered by each
+    // of the equal columns between the two beats: this is what gets drawn,
+    // no matter how many points are there within a pixel
+    void getColumnRanges(float startBeat, float endBeat,
+        Range<int> *outRanges, int numColumns) const noexcept;
+
+    bool operator==(const ExpressionCurve &other) const noexcept;
+
+    String toBase64() const;
+    void fromBase64(const String &encoded);
+
+private:
+
+    Array<Point> points;
+
+    int findLastIndexBefore(float beat) const noexcept;
+    int interpolate(int index, float beat) const noexcept;
+
+    JUCE_LEAK_DETECTOR(ExpressionCurve);
+};
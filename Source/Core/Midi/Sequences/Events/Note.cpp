@@ -38,26 +38,52 @@ Note::Note(const Note &other) :
     MidiEvent(other),
     key(other.key),
     length(other.length),
-    velocity(other.velocity) {}
+    velocity(other.velocity),
+    expression(other.expression) {}
 
 Note::Note(WeakReference<MidiSequence> owner, const Note &parametersToCopy) :
     MidiEvent(owner, parametersToCopy),
     key(parametersToCopy.key),
     length(parametersToCopy.length),
-    velocity(parametersToCopy.velocity) {}
+    velocity(parametersToCopy.velocity),
+    expression(parametersToCopy.expression) {}
 
 Array<MidiMessage> Note::toMidiMessages() const
+{
+    return this->toMidiMessages(this->getChannel());
+}
+
+Array<MidiMessage> Note::toMidiMessages(int channel) const
 {
     Array<MidiMessage> result;
 
-    MidiMessage eventNoteOn(MidiMessage::noteOn(this->getChannel(), this->key, velocity));
+    MidiMessage eventNoteOn(MidiMessage::noteOn(channel, this->key, velocity));
     const double startTime = round(double(this->beat) * MS_PER_BEAT);
     eventNoteOn.setTimeStamp(startTime);
 
-    MidiMessage eventNoteOff(MidiMessage::noteOff(this->getChannel(), this->key));
+    MidiMessage eventNoteOff(MidiMessage::noteOff(channel, this->key));
     const double endTime = round(double(this->beat + this->length) * MS_PER_BEAT);
     eventNoteOff.setTimeStamp(endTime);
 
+    if (this->hasExpression())
+    {
+        Array<MidiMessage> changes;
+        this->expression->toMidiMessages(channel, startTime, endTime, result, changes);
+        result.add(eventNoteOn);
+        result.addArray(changes);
+        result.add(eventNoteOff);
+
+        // The release tail should not keep the bend
+        if (this->expression->hasDimension(NoteExpression::PitchBend))
+        {
+            MidiMessage resetPitchBend(MidiMessage::pitchWheel(channel, ExpressionCurve::centreValue));
+            resetPitchBend.setTimeStamp(endTime);
+            result.add(resetPitchBend);
+        }
+
+        return result;
+    }
+
     result.add(eventNoteOn);
     result.add(eventNoteOff);
 
@@ -128,6 +154,13 @@ Note Note::withVelocity(float newVelocity) const
     return other;
 }
 
+Note Note::withExpression(NoteExpression::Ptr newExpression) const
+{
+    Note other(*this);
+    other.expression = (newExpression != nullptr && ! newExpression->isEmpty()) ? newExpression : nullptr;
+    return other;
+}
+
 Note Note::withParameters(const XmlElement &xml) const
 {
     Note n(*this);
@@ -154,6 +187,27 @@ float Note::getVelocity() const noexcept
     return this->velocity;
 }
 
+bool Note::hasExpression() const noexcept
+{
+    return (this->expression != nullptr);
+}
+
+const NoteExpression *Note::getExpression() const noexcept
+{
+    return this->expression.get();
+}
+
+bool Note::hasSameExpression(const Note &other) const noexcept
+{
+    if (this->expression == other.expression)
+    {
+        return true;
+    }
+
+    return (this->expression != nullptr && other.expression != nullptr &&
+        *this->expression == *other.expression);
+}
+
 //===----------------------------------------------------------------------===//
 // Serializable
 //===----------------------------------------------------------------------===//
@@ -169,6 +223,12 @@ XmlElement *Note::serialize() const
     xml->setAttribute("len", this->length);
     xml->setAttribute("vel", roundFloatToInt(this->velocity * VELOCITY_SAVE_ACCURACY));
     xml->setAttribute("id", this->id);
+
+    if (this->hasExpression())
+    {
+        xml->addChildElement(this->expression->serialize());
+    }
+
     return xml;
 }
 
@@ -187,9 +247,19 @@ void Note::deserialize(const XmlElement &xml)
     this->length = xmlLength;
     this->velocity = jmax(jmin(xmlVelocity, 1.f), 0.f);
     this->id = xmlId;
+
+    if (const XmlElement *expressionXml = xml.getChildByName(Serialization::Core::noteExpression))
+    {
+        NoteExpression::Ptr newExpression(new NoteExpression());
+        newExpression->deserialize(*expressionXml);
+        this->expression = newExpression->isEmpty() ? nullptr : newExpression;
+    }
 }
 
-void Note::reset() {}
+void Note::reset()
+{
+    this->expression = nullptr;
+}
 
 void Note::applyChanges(const Note &other)
 {
@@ -198,6 +268,7 @@ void Note::applyChanges(const Note &other)
     this->key = other.key;
     this->length = other.length;
     this->velocity = other.velocity;
+    this->expression = other.expression;
 }
 
 int Note::compareElements(const MidiEvent *const first, const MidiEvent *const second)
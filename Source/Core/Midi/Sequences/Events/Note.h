@@ -18,6 +18,7 @@
 #pragma once
 
 #include "MidiEvent.h"
+#include "NoteExpression.h"
 
 #define KEY_C5 60
 
@@ -36,6 +37,9 @@ public:
          float lengthVal = 1.f, float velocityVal = 1.f);
 
     Array<MidiMessage> toMidiMessages() const override;
+
+    // MPE-style: the note with its expression goes to a member channel of its own
+    Array<MidiMessage> toMidiMessages(int memberChannel) const;
     
     Note copyWithNewId(WeakReference<MidiSequence> owner = nullptr) const;
     Note withBeat(float newBeat) const;
@@ -45,6 +49,7 @@ public:
     Note withLength(float newLength) const;
     Note withDeltaLength(float deltaLength) const;
     Note withVelocity(float newVelocity) const;
+    Note withExpression(NoteExpression::Ptr newExpression) const;
     Note withParameters(const XmlElement &xml) const;
 
     //===------------------------------------------------------------------===//
@@ -55,6 +60,10 @@ public:
     float getLength() const noexcept;
     float getVelocity() const noexcept;
 
+    bool hasExpression() const noexcept;
+    const NoteExpression *getExpression() const noexcept;
+    bool hasSameExpression(const Note &other) const noexcept;
+
     //===------------------------------------------------------------------===//
     // Serializable
     //===------------------------------------------------------------------===//
@@ -79,6 +88,9 @@ protected:
     float length;
     float velocity;
 
+    // Shared and immutable, null for most of the notes
+    NoteExpression::Ptr expression;
+
 private:
 
     JUCE_LEAK_DETECTOR(Note);
@@ -0,0 +1,180 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "NoteExpression.h"
+#include "SerializationKeys.h"
+
+// Plenty for the pitch bends to sound smooth, yet far from flooding the port
+#define NOTE_EXPRESSION_STEP_TICKS 10.0
+#define NOTE_EXPRESSION_TIMBRE_CONTROLLER 74
+
+static const char *dimensionAttributes[] = { "pitch", "pressure", "timbre" };
+
+NoteExpression::NoteExpression() {}
+
+NoteExpression::NoteExpression(const NoteExpression &other)
+{
+    for (int i = 0; i < numDimensions; ++i)
+    {
+        this->curves[i] = other.curves[i];
+    }
+}
+
+const ExpressionCurve &NoteExpression::getCurve(Dimension dimension) const noexcept
+{
+    return this->curves[dimension];
+}
+
+ExpressionCurve &NoteExpression::getCurve(Dimension dimension) noexcept
+{
+    return this->curves[dimension];
+}
+
+bool NoteExpression::isEmpty() const noexcept
+{
+    for (const auto &curve : this->curves)
+    {
+        if (! curve.isEmpty())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool NoteExpression::hasDimension(Dimension dimension) const noexcept
+{
+    return ! this->curves[dimension].isEmpty();
+}
+
+bool NoteExpression::operator==(const NoteExpression &other) const noexcept
+{
+    for (int i = 0; i < numDimensions; ++i)
+    {
+        if (! (this->curves[i] == other.curves[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Playback
+//===----------------------------------------------------------------------===//
+
+static MidiMessage createMessage(NoteExpression::Dimension dimension, int channel, int value)
+{
+    switch (dimension)
+    {
+    case NoteExpression::PitchBend:
+        return MidiMessage::pitchWheel(channel, value);
+    case NoteExpression::Pressure:
+        return MidiMessage::channelPressureChange(channel, value >> 7);
+    case NoteExpression::Timbre:
+    default:
+        return MidiMessage::controllerEvent(channel, NOTE_EXPRESSION_TIMBRE_CONTROLLER, value >> 7);
+    }
+}
+
+// Pressure and timbre only have 7 bits
+static inline int getResolutionShift(NoteExpression::Dimension dimension)
+{
+    return (dimension == NoteExpression::PitchBend) ? 0 : 7;
+}
+
+void NoteExpression::toMidiMessages(int channel, double noteOnTime, double noteOffTime,
+    Array<MidiMessage> &outInitialValues, Array<MidiMessage> &outChanges) const
+{
+    for (int i = 0; i < numDimensions; ++i)
+    {
+        const Dimension dimension = Dimension(i);
+        const ExpressionCurve &curve = this->curves[i];
+        if (curve.isEmpty())
+        {
+            continue;
+        }
+
+        const int shift = getResolutionShift(dimension);
+        int lastValue = curve.getValueAt(0.f);
+
+        MidiMessage initialValue(createMessage(dimension, channel, lastValue));
+        initialValue.setTimeStamp(noteOnTime);
+        outInitialValues.add(initialValue);
+
+        // Dense curves are resampled, and flat segments send nothing
+        for (double time = noteOnTime + NOTE_EXPRESSION_STEP_TICKS;
+            time < noteOffTime; time += NOTE_EXPRESSION_STEP_TICKS)
+        {
+            const int value = curve.getValueAt(float((time - noteOnTime) / MS_PER_BEAT));
+            if ((value >> shift) == (lastValue >> shift))
+            {
+                continue;
+            }
+
+            MidiMessage change(createMessage(dimension, channel, value));
+            change.setTimeStamp(round(time));
+            outChanges.add(change);
+            lastValue = value;
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Serializable
+//===----------------------------------------------------------------------===//
+
+XmlElement *NoteExpression::serialize() const
+{
+    auto xml = new XmlElement(Serialization::Core::noteExpression);
+
+    for (int i = 0; i < numDimensions; ++i)
+    {
+        if (! this->curves[i].isEmpty())
+        {
+            xml->setAttribute(dimensionAttributes[i], this->curves[i].toBase64());
+        }
+    }
+
+    return xml;
+}
+
+void NoteExpression::deserialize(const XmlElement &xml)
+{
+    this->reset();
+
+    for (int i = 0; i < numDimensions; ++i)
+    {
+        const String encoded = xml.getStringAttribute(dimensionAttributes[i]);
+        if (encoded.isNotEmpty())
+        {
+            this->curves[i].fromBase64(encoded);
+        }
+    }
+}
+
+void NoteExpression::reset()
+{
+    for (auto &curve : this->curves)
+    {
+        curve.clear();
+    }
+}
@@ -0,0 +1,77 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "Serializable.h"
+#include "ExpressionCurve.h"
+
+// MPE-style per-note expression: pitch bend, pressure and timbre (cc74)
+// curves bound to a note; the beats are relative to the note's start,
+// so the curves move along with the note.
+//
+// Notes share it as an immutable object, so that copying a note
+// in undo actions and previews stays cheap: to change it, make a new one.
+
+class NoteExpression final :
+    public Serializable,
+    public ReferenceCountedObject
+{
+public:
+
+    NoteExpression();
+    NoteExpression(const NoteExpression &other);
+
+    enum Dimension
+    {
+        PitchBend = 0,
+        Pressure = 1,
+        Timbre = 2
+    };
+
+    static const int numDimensions = 3;
+
+    const ExpressionCurve &getCurve(Dimension dimension) const noexcept;
+    ExpressionCurve &getCurve(Dimension dimension) noexcept;
+
+    bool isEmpty() const noexcept;
+    bool hasDimension(Dimension dimension) const noexcept;
+
+    bool operator==(const NoteExpression &other) const noexcept;
+
+    // The initial values are to be sent right before the note-on,
+    // the changes are sampled at a fixed rate while the note sounds
+    void toMidiMessages(int channel, double noteOnTime, double noteOffTime,
+        Array<MidiMessage> &outInitialValues, Array<MidiMessage> &outChanges) const;
+
+    //===------------------------------------------------------------------===//
+    // Serializable
+    //===------------------------------------------------------------------===//
+
+    XmlElement *serialize() const override;
+    void deserialize(const XmlElement &xml) override;
+    void reset() override;
+
+    typedef ReferenceCountedObjectPtr<NoteExpression> Ptr;
+
+private:
+
+    ExpressionCurve curves[numDimensions];
+
+    JUCE_LEAK_DETECTOR(NoteExpression);
+};
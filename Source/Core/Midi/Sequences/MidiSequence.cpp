@@ -105,20 +105,7 @@ MidiMessageSequence MidiSequence::exportMidi() const
     if (this->cacheIsOutdated)
     {
         this->cachedSequence.clear();
-
-        for (auto event : this->midiEvents)
-        {
-            const auto &track = event->toMidiMessages();
-
-            for (auto &message : track)
-            {
-                this->cachedSequence.addEvent(message);
-            }
-
-            // need to call it here?
-            //this->cachedSequence.updateMatchedPairs();
-        }
-
+        this->exportEvents(this->cachedSequence);
         this->cachedSequence.updateMatchedPairs();
         //this->cachedSequence.sort(); // will be sorted by caller
         this->cacheIsOutdated = false;
@@ -127,6 +114,19 @@ MidiMessageSequence MidiSequence::exportMidi() const
     return this->cachedSequence;
 }
 
+void MidiSequence::exportEvents(MidiMessageSequence &outSequence) const
+{
+    for (auto event : this->midiEvents)
+    {
+        const auto &track = event->toMidiMessages();
+
+        for (auto &message : track)
+        {
+            outSequence.addEvent(message);
+        }
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Accessors
 //===----------------------------------------------------------------------===//
@@ -230,12 +230,15 @@ void MidiSequence::updateBeatRange(bool shouldNotifyIfChanged)
 
 String MidiSequence::createUniqueEventId() const noexcept
 {
+    const ProjectTreeItem *project = this->eventDispatcher.getProject();
+    const String eventIdPrefix(project != nullptr ? project->getEventIdPrefix() : String::empty);
+
     uint8 length = 2;
-    String eventId = EventIdGenerator::generateId(length);
+    String eventId = eventIdPrefix + EventIdGenerator::generateId(length);
     while (this->usedEventIds.contains(eventId))
     {
         length++;
-        eventId = EventIdGenerator::generateId(length);
+        eventId = eventIdPrefix + EventIdGenerator::generateId(length);
     }
     
     this->usedEventIds.insert({eventId});
@@ -111,6 +111,7 @@ public:
     // Helpers
     //===------------------------------------------------------------------===//
 
+    // Starts with the project's event id prefix, if any
     String createUniqueEventId() const noexcept;
     String getTrackId() const noexcept;
     int getChannel() const noexcept;
@@ -133,6 +134,10 @@ protected:
     ProjectTreeItem *getProject();
     UndoStack *getUndoStack();
 
+    // Called by exportMidi when the cache is outdated;
+    // by default, just collects the messages of all events
+    virtual void exportEvents(MidiMessageSequence &outSequence) const;
+
     OwnedArray<MidiEvent> midiEvents;
     mutable SparseHashSet<MidiEvent::Id, StringHash> usedEventIds;
 
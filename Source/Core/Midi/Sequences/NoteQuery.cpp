@@ -0,0 +1,424 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "NoteQuery.h"
+#include "PianoSequence.h"
+#include "KeySignatureEvent.h"
+#include "ProjectTreeItem.h"
+#include "ProjectTimeline.h"
+
+#include <float.h>
+
+#define NOTE_QUERY_CHUNK_SIZE (16 * 1024)
+#define NOTE_QUERY_MIN_PARALLEL_SIZE (64 * 1024)
+
+//===----------------------------------------------------------------------===//
+// Filter
+//===----------------------------------------------------------------------===//
+
+NoteQuery::NoteQuery() :
+    startBeat(-FLT_MAX),
+    endBeat(FLT_MAX),
+    minKey(0),
+    maxKey(128),
+    minVelocity(0.f),
+    maxVelocity(1.f),
+    hasKeySignature(false),
+    keySignatureRoot(0),
+    scaleFilter(AnyKey) {}
+
+NoteQuery NoteQuery::withTrack(const String &trackId) const
+{
+    NoteQuery other(*this);
+    other.trackIds.addIfNotAlreadyThere(trackId);
+    return other;
+}
+
+NoteQuery NoteQuery::withBeatRange(float startBeat, float endBeat) const
+{
+    NoteQuery other(*this);
+    other.startBeat = startBeat;
+    other.endBeat = endBeat;
+    return other;
+}
+
+NoteQuery NoteQuery::withKeyRange(int minKey, int maxKey) const
+{
+    NoteQuery other(*this);
+    other.minKey = minKey;
+    other.maxKey = maxKey;
+    return other;
+}
+
+NoteQuery NoteQuery::withVelocityRange(float minVelocity, float maxVelocity) const
+{
+    NoteQuery other(*this);
+    other.minVelocity = minVelocity;
+    other.maxVelocity = maxVelocity;
+    return other;
+}
+
+NoteQuery NoteQuery::withKeySignature(Note::Key rootKey, const Scale &scale) const
+{
+    NoteQuery other(*this);
+    other.hasKeySignature = true;
+    other.keySignatureRoot = rootKey % CHROMATIC_SCALE_SIZE;
+    other.keySignatureScale = scale;
+    return other;
+}
+
+NoteQuery NoteQuery::withScaleFilter(ScaleFilter filter) const
+{
+    NoteQuery other(*this);
+    other.scaleFilter = filter;
+    return other;
+}
+
+bool NoteQuery::matchesTrack(const String &trackId) const noexcept
+{
+    return this->trackIds.isEmpty() || this->trackIds.contains(trackId);
+}
+
+bool NoteQuery::matches(const Note &note, const KeySignatureEvent *keySignature) const noexcept
+{
+    if (note.getBeat() < this->startBeat || note.getBeat() >= this->endBeat ||
+        note.getKey() < this->minKey || note.getKey() > this->maxKey ||
+        note.getVelocity() < this->minVelocity || note.getVelocity() > this->maxVelocity)
+    {
+        return false;
+    }
+
+    if (! this->dependsOnKeySignatures())
+    {
+        return true;
+    }
+
+    if (keySignature == nullptr)
+    {
+        return false;
+    }
+
+    if (this->hasKeySignature &&
+        (keySignature->getRootKey() % CHROMATIC_SCALE_SIZE != this->keySignatureRoot ||
+         ! keySignature->getScale().isEquivalentTo(this->keySignatureScale)))
+    {
+        return false;
+    }
+
+    if (this->scaleFilter != AnyKey)
+    {
+        const int degree = ((note.getKey() - keySignature->getRootKey()) %
+            CHROMATIC_SCALE_SIZE + CHROMATIC_SCALE_SIZE) % CHROMATIC_SCALE_SIZE;
+        const bool isInScale = keySignature->getScale().hasKey(degree);
+        return isInScale == (this->scaleFilter == KeysInScale);
+    }
+
+    return true;
+}
+
+float NoteQuery::getStartBeat() const noexcept
+{
+    return this->startBeat;
+}
+
+float NoteQuery::getEndBeat() const noexcept
+{
+    return this->endBeat;
+}
+
+bool NoteQuery::dependsOnKeySignatures() const noexcept
+{
+    return this->hasKeySignature || this->scaleFilter != AnyKey;
+}
+
+//===----------------------------------------------------------------------===//
+// Transform
+//===----------------------------------------------------------------------===//
+
+NoteTransform::NoteTransform() :
+    keyDelta(0),
+    velocityMultiplier(1.f),
+    beatDelta(0.f),
+    length(0.f) {}
+
+NoteTransform NoteTransform::withKeyDelta(int keyDelta) const
+{
+    NoteTransform other(*this);
+    other.keyDelta = keyDelta;
+    return other;
+}
+
+NoteTransform NoteTransform::withVelocityMultiplier(float multiplier) const
+{
+    NoteTransform other(*this);
+    other.velocityMultiplier = multiplier;
+    return other;
+}
+
+NoteTransform NoteTransform::withBeatDelta(float beatDelta) const
+{
+    NoteTransform other(*this);
+    other.beatDelta = beatDelta;
+    return other;
+}
+
+NoteTransform NoteTransform::withLength(float newLength) const
+{
+    NoteTransform other(*this);
+    other.length = newLength;
+    return other;
+}
+
+bool NoteTransform::isEmpty() const noexcept
+{
+    return this->keyDelta == 0 && this->velocityMultiplier == 1.f &&
+        this->beatDelta == 0.f && this->length <= 0.f;
+}
+
+Note NoteTransform::apply(const Note &note) const
+{
+    Note result(note);
+
+    if (this->keyDelta != 0)
+    {
+        result = result.withDeltaKey(this->keyDelta);
+    }
+
+    if (this->velocityMultiplier != 1.f)
+    {
+        result = result.withVelocity(note.getVelocity() * this->velocityMultiplier);
+    }
+
+    if (this->beatDelta != 0.f)
+    {
+        result = result.withDeltaBeat(this->beatDelta);
+    }
+
+    if (this->length > 0.f)
+    {
+        result = result.withLength(this->length);
+    }
+
+    return result;
+}
+
+//===----------------------------------------------------------------------===//
+// Engine
+//===----------------------------------------------------------------------===//
+
+// Index of the first note at or after the beat (the notes are sorted by beat)
+static int findFirstNoteAt(const PianoSequence &sequence, float beat)
+{
+    int start = 0;
+    int end = sequence.size();
+
+    while (start < end)
+    {
+        const int middle = (start + end) / 2;
+        if (sequence.getUnchecked(middle)->getBeat() < beat)
+        {
+            start = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
+    }
+
+    return start;
+}
+
+class NoteQueryJob final : public ThreadPoolJob
+{
+public:
+
+    NoteQueryJob(const PianoSequence &sequence, const NoteQuery &query,
+        const Array<const KeySignatureEvent *> &keySignatures,
+        int startIndex, int endIndex, int matchesIndex) :
+        ThreadPoolJob("Note query"),
+        sequence(sequence),
+        query(query),
+        keySignatures(keySignatures),
+        startIndex(startIndex),
+        endIndex(endIndex),
+        matchesIndex(matchesIndex) {}
+
+    JobStatus runJob() override
+    {
+        this->scan();
+        return jobHasFinished;
+    }
+
+    void scan()
+    {
+        this->indices.ensureStorageAllocated(this->endIndex - this->startIndex);
+
+        // Both the notes and the key signatures are sorted,
+        // so the active key signature only moves forward
+        int keySignatureIndex = -1;
+
+        for (int i = this->startIndex; i < this->endIndex; ++i)
+        {
+            const Note &note = static_cast<const Note &>(*this->sequence.getUnchecked(i));
+
+            while (keySignatureIndex + 1 < this->keySignatures.size() &&
+                this->keySignatures.getUnchecked(keySignatureIndex + 1)->getBeat() <= note.getBeat())
+            {
+                keySignatureIndex++;
+            }
+
+            const KeySignatureEvent *keySignature = (keySignatureIndex >= 0) ?
+                this->keySignatures.getUnchecked(keySignatureIndex) : nullptr;
+
+            if (this->query.matches(note, keySignature))
+            {
+                this->indices.add(i);
+            }
+        }
+    }
+
+    const PianoSequence &sequence;
+    const NoteQuery &query;
+    const Array<const KeySignatureEvent *> &keySignatures;
+
+    const int startIndex;
+    const int endIndex;
+    const int matchesIndex;
+
+    Array<int> indices;
+
+    JUCE_DECLARE_NON_COPYABLE(NoteQueryJob)
+};
+
+void NoteQueryEngine::find(const ProjectTreeItem &project,
+    const NoteQuery &query, OwnedArray<Matches> &result)
+{
+    result.clear();
+
+    Array<const KeySignatureEvent *> keySignatures;
+    if (query.dependsOnKeySignatures())
+    {
+        for (const auto event : *project.getTimeline()->getKeySignatures()->getSequence())
+        {
+            keySignatures.add(static_cast<const KeySignatureEvent *>(event));
+        }
+    }
+
+    OwnedArray<NoteQueryJob> jobs;
+    int numNotesToScan = 0;
+
+    for (const auto track : project.getTracks())
+    {
+        PianoSequence *sequence = dynamic_cast<PianoSequence *>(track->getSequence());
+        if (sequence == nullptr || ! query.matchesTrack(track->getTrackId().toString()))
+        {
+            continue;
+        }
+
+        Matches *matches = result.add(new Matches());
+        matches->sequence = sequence;
+
+        const int startIndex = findFirstNoteAt(*sequence, query.getStartBeat());
+        const int endIndex = findFirstNoteAt(*sequence, query.getEndBeat());
+        numNotesToScan += endIndex - startIndex;
+
+        for (int i = startIndex; i < endIndex; i += NOTE_QUERY_CHUNK_SIZE)
+        {
+            jobs.add(new NoteQueryJob(*sequence, query, keySignatures,
+                i, jmin(endIndex, i + NOTE_QUERY_CHUNK_SIZE), result.size() - 1));
+        }
+    }
+
+    if (numNotesToScan >= NOTE_QUERY_MIN_PARALLEL_SIZE)
+    {
+        ThreadPool pool(jmin(jobs.size(), SystemStats::getNumCpus()));
+
+        for (auto job : jobs)
+        {
+            pool.addJob(job, false);
+        }
+
+        for (auto job : jobs)
+        {
+            pool.waitForJobToFinish(job, -1);
+        }
+    }
+    else
+    {
+        for (auto job : jobs)
+        {
+            job->scan();
+        }
+    }
+
+    // The chunks of every sequence were added in order
+    for (const auto job : jobs)
+    {
+        result.getUnchecked(job->matchesIndex)->indices.addArray(job->indices);
+    }
+}
+
+int NoteQueryEngine::transform(ProjectTreeItem &project,
+    const NoteQuery &query, const NoteTransform &transform)
+{
+    if (transform.isEmpty())
+    {
+        return 0;
+    }
+
+    OwnedArray<Matches> found;
+    find(project, query, found);
+
+    int numChangedNotes = 0;
+    bool didCheckpoint = false;
+
+    project.beginBulkChange();
+
+    for (const auto matches : found)
+    {
+        if (matches->indices.size() == 0)
+        {
+            continue;
+        }
+
+        Array<Note> groupBefore;
+        Array<Note> groupAfter;
+        groupBefore.ensureStorageAllocated(matches->indices.size());
+        groupAfter.ensureStorageAllocated(matches->indices.size());
+
+        for (const int index : matches->indices)
+        {
+            const Note &note = static_cast<const Note &>(*matches->sequence->getUnchecked(index));
+            groupBefore.add(note);
+            groupAfter.add(transform.apply(note));
+        }
+
+        // All the tracks are changed in one undo transaction
+        if (! didCheckpoint)
+        {
+            matches->sequence->checkpoint();
+            didCheckpoint = true;
+        }
+
+        numChangedNotes += groupBefore.size();
+        matches->sequence->changeGroup(groupBefore, groupAfter, true);
+    }
+
+    project.endBulkChange();
+    return numChangedNotes;
+}
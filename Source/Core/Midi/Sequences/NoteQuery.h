@@ -0,0 +1,140 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+class ProjectTreeItem;
+class PianoSequence;
+class KeySignatureEvent;
+
+#include "Note.h"
+#include "Scale.h"
+
+//===----------------------------------------------------------------------===//
+// Filter
+//===----------------------------------------------------------------------===//
+
+// Selects the notes across the project's piano tracks;
+// an empty query matches all of them, every withX() narrows it down
+class NoteQuery final
+{
+public:
+
+    NoteQuery();
+
+    enum ScaleFilter
+    {
+        AnyKey = 0,
+        KeysInScale = 1,
+        KeysOutOfScale = 2
+    };
+
+    NoteQuery withTrack(const String &trackId) const;
+    NoteQuery withBeatRange(float startBeat, float endBeat) const;
+    NoteQuery withKeyRange(int minKey, int maxKey) const;
+    NoteQuery withVelocityRange(float minVelocity, float maxVelocity) const;
+    // Only the notes under this key signature
+    NoteQuery withKeySignature(Note::Key rootKey, const Scale &scale) const;
+    // In or out of the scale of the key signature they are under
+    NoteQuery withScaleFilter(ScaleFilter filter) const;
+
+    bool matchesTrack(const String &trackId) const noexcept;
+
+    // The key signature is the one active at the note's beat, or nullptr
+    bool matches(const Note &note, const KeySignatureEvent *keySignature) const noexcept;
+
+    float getStartBeat() const noexcept;
+    float getEndBeat() const noexcept;
+    bool dependsOnKeySignatures() const noexcept;
+
+private:
+
+    StringArray trackIds;
+
+    float startBeat;
+    float endBeat;
+    int minKey;
+    int maxKey;
+    float minVelocity;
+    float maxVelocity;
+
+    bool hasKeySignature;
+    Note::Key keySignatureRoot;
+    Scale keySignatureScale;
+    ScaleFilter scaleFilter;
+
+    JUCE_LEAK_DETECTOR(NoteQuery)
+};
+
+//===----------------------------------------------------------------------===//
+// Transform
+//===----------------------------------------------------------------------===//
+
+class NoteTransform final
+{
+public:
+
+    NoteTransform();
+
+    NoteTransform withKeyDelta(int keyDelta) const;
+    NoteTransform withVelocityMultiplier(float multiplier) const;
+    NoteTransform withBeatDelta(float beatDelta) const;
+    NoteTransform withLength(float newLength) const;
+
+    bool isEmpty() const noexcept;
+
+    Note apply(const Note &note) const;
+
+private:
+
+    int keyDelta;
+    float velocityMultiplier;
+    float beatDelta;
+    float length; // zero or less leaves the length as is
+
+    JUCE_LEAK_DETECTOR(NoteTransform)
+};
+
+//===----------------------------------------------------------------------===//
+// Engine
+//===----------------------------------------------------------------------===//
+
+// Runs the queries over all the piano tracks at once: the sorted notes arrays
+// are narrowed down to the beat range and split into chunks, which are
+// scanned in parallel on a thread pool. The transforms are then applied
+// on the message thread as a single undoable transaction,
+// with a single project reload at the end.
+
+class NoteQueryEngine final
+{
+public:
+
+    struct Matches
+    {
+        PianoSequence *sequence;
+        Array<int> indices; // into the sequence, sorted
+    };
+
+    // Must be called from the message thread, while the sequences are not being edited
+    static void find(const ProjectTreeItem &project,
+        const NoteQuery &query, OwnedArray<Matches> &result);
+
+    // Returns the number of the notes changed
+    static int transform(ProjectTreeItem &project,
+        const NoteQuery &query, const NoteTransform &transform);
+
+};
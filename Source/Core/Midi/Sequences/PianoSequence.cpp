@@ -27,6 +27,18 @@
 
 #include <float.h>
 
+// MPE lower zone: channel 1 is the master channel, the rest are member channels
+#define MPE_MASTER_CHANNEL 1
+#define MPE_NUM_MEMBER_CHANNELS 15
+#define MPE_TIMBRE_CONTROLLER 74
+
+// Recorded curves are thinned on import, within these errors (of 14 bits)
+#define MPE_PITCH_BEND_IMPORT_TOLERANCE 8
+#define MPE_7BIT_IMPORT_TOLERANCE 64
+
+// Groups bigger than that are changed in place and re-sorted at once
+#define PIANO_SEQUENCE_BULK_CHANGE_SIZE 128
+
 PianoSequence::PianoSequence(MidiTrack &track,
     ProjectEventDispatcher &dispatcher) :
     MidiSequence(track, dispatcher) {}
@@ -35,12 +47,86 @@ PianoSequence::PianoSequence(MidiTrack &track,
 // Import/export
 //===----------------------------------------------------------------------===//
 
+static bool isExpressionMessage(const MidiMessage &message)
+{
+    return message.isPitchWheel() || message.isChannelPressure() ||
+        (message.isController() && message.getControllerNumber() == MPE_TIMBRE_CONTROLLER);
+}
+
+// In MPE files, each note has a channel of its own, and the pitch bends,
+// pressure and timbre changes on that channel belong to that note only
+static NoteExpression::Ptr collectExpression(const Array<const MidiMessage *> &channelMessages,
+    double startTimestamp, double endTimestamp)
+{
+    NoteExpression::Ptr expression(new NoteExpression());
+
+    // The initial values come right before the note-on, at the same time
+    int index = 0;
+    while (index < channelMessages.size() &&
+        channelMessages.getUnchecked(index)->getTimeStamp() < startTimestamp)
+    {
+        ++index;
+    }
+
+    for (; index < channelMessages.size(); ++index)
+    {
+        const MidiMessage &message = *channelMessages.getUnchecked(index);
+        if (message.getTimeStamp() >= endTimestamp)
+        {
+            break;
+        }
+
+        const float beat = float((message.getTimeStamp() - startTimestamp) / MIDI_IMPORT_SCALE);
+
+        if (message.isPitchWheel())
+        {
+            expression->getCurve(NoteExpression::PitchBend).addPoint(beat, message.getPitchWheelValue());
+        }
+        else if (message.isChannelPressure())
+        {
+            expression->getCurve(NoteExpression::Pressure).addPoint(beat, message.getChannelPressureValue() << 7);
+        }
+        else
+        {
+            expression->getCurve(NoteExpression::Timbre).addPoint(beat, message.getControllerValue() << 7);
+        }
+    }
+
+    expression->getCurve(NoteExpression::PitchBend).simplify(MPE_PITCH_BEND_IMPORT_TOLERANCE);
+    expression->getCurve(NoteExpression::Pressure).simplify(MPE_7BIT_IMPORT_TOLERANCE);
+    expression->getCurve(NoteExpression::Timbre).simplify(MPE_7BIT_IMPORT_TOLERANCE);
+    return expression;
+}
+
 void PianoSequence::importMidi(const MidiMessageSequence &sequence)
 {
     this->clearUndoHistory();
     this->checkpoint();
     this->reset();
 
+    // Only the files with the notes spread over the channels are treated as MPE,
+    // otherwise a single pitch bend would be copied into every note
+    Array<const MidiMessage *> expressionMessages[16];
+    int noteChannelsMask = 0;
+
+    for (int i = 0; i < sequence.getNumEvents(); ++i)
+    {
+        const MidiMessage &message = sequence.getEventPointer(i)->message;
+        if (message.getChannel() > 0)
+        {
+            if (message.isNoteOn())
+            {
+                noteChannelsMask |= (1 << (message.getChannel() - 1));
+            }
+            else if (isExpressionMessage(message))
+            {
+                expressionMessages[message.getChannel() - 1].add(&message);
+            }
+        }
+    }
+
+    const bool isMpe = (noteChannelsMask & (noteChannelsMask - 1)) != 0;
+
     for (int i = 0; i < sequence.getNumEvents(); ++i)
     {
         const MidiMessage &messageOn = sequence.getEventPointer(i)->message;
@@ -66,7 +152,17 @@ void PianoSequence::importMidi(const MidiMessageSequence &sequence)
 
                     // bottleneck warning
                     const Note note(this, key, beat, length, velocity);
-                    this->silentImport(note);
+
+                    const auto &channelMessages = expressionMessages[messageOn.getChannel() - 1];
+                    if (isMpe && channelMessages.size() > 0)
+                    {
+                        this->silentImport(note.withExpression(collectExpression(channelMessages,
+                            messageOn.getTimeStamp(), messageOff.getTimeStamp())));
+                    }
+                    else
+                    {
+                        this->silentImport(note);
+                    }
                 }
             }
         }
@@ -76,6 +172,67 @@ void PianoSequence::importMidi(const MidiMessageSequence &sequence)
     this->invalidateSequenceCache();
 }
 
+void PianoSequence::exportEvents(MidiMessageSequence &outSequence) const
+{
+    bool hasExpressiveNotes = false;
+    for (const auto event : this->midiEvents)
+    {
+        if (static_cast<const Note *>(event)->hasExpression())
+        {
+            hasExpressiveNotes = true;
+            break;
+        }
+    }
+
+    if (! hasExpressiveNotes)
+    {
+        MidiSequence::exportEvents(outSequence);
+        return;
+    }
+
+    // Announce the zone with the MPE configuration message (RPN 6)
+    const double firstNoteTime = round(double(this->midiEvents.getFirst()->getBeat()) * MS_PER_BEAT);
+    const int configurationMessage[][2] = { { 101, 0 }, { 100, 6 }, { 6, MPE_NUM_MEMBER_CHANNELS } };
+    for (const auto &controller : configurationMessage)
+    {
+        MidiMessage message(MidiMessage::controllerEvent(MPE_MASTER_CHANNEL, controller[0], controller[1]));
+        message.setTimeStamp(firstNoteTime);
+        outSequence.addEvent(message);
+    }
+
+    // Every note gets the member channel released the longest time ago,
+    // so that the expression of a note does not affect the release tails
+    // of the others; if all the channels are busy, the one to be released
+    // first is shared
+    float channelsReleaseBeats[MPE_NUM_MEMBER_CHANNELS];
+    for (auto &beat : channelsReleaseBeats)
+    {
+        beat = -FLT_MAX;
+    }
+
+    for (const auto event : this->midiEvents)
+    {
+        const Note *note = static_cast<const Note *>(event);
+
+        int memberIndex = 0;
+        for (int i = 1; i < MPE_NUM_MEMBER_CHANNELS; ++i)
+        {
+            if (channelsReleaseBeats[i] < channelsReleaseBeats[memberIndex])
+            {
+                memberIndex = i;
+            }
+        }
+
+        channelsReleaseBeats[memberIndex] = note->getBeat() + note->getLength();
+
+        const int memberChannel = MPE_MASTER_CHANNEL + 1 + memberIndex;
+        for (const auto &message : note->toMidiMessages(memberChannel))
+        {
+            outSequence.addEvent(message);
+        }
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Undo-able track editing
 //===----------------------------------------------------------------------===//
@@ -244,6 +401,10 @@ bool PianoSequence::changeGroup(Array<Note> &groupBefore,
             perform(new NotesGroupChangeAction(*this->getProject(),
                 this->getTrackId(), groupBefore, groupAfter));
     }
+    else if (groupBefore.size() > PIANO_SEQUENCE_BULK_CHANGE_SIZE)
+    {
+        this->changeGroupInBulk(groupBefore, groupAfter);
+    }
     else
     {
         for (int i = 0; i < groupBefore.size(); ++i)
@@ -268,6 +429,54 @@ bool PianoSequence::changeGroup(Array<Note> &groupBefore,
     return true;
 }
 
+void PianoSequence::changeGroupInBulk(const Array<Note> &groupBefore, const Array<Note> &groupAfter)
+{
+    // Moving every note to its new place is quadratic for the big groups,
+    // so all the notes are found first (while the sequence is still sorted),
+    // then changed in place and sorted once; the project gets a single reload
+    Array<Note *> changedNotes;
+    changedNotes.ensureStorageAllocated(groupBefore.size());
+
+    for (int i = 0; i < groupBefore.size(); ++i)
+    {
+        const Note &oldParams = groupBefore.getReference(i);
+        const int index = this->midiEvents.indexOfSorted(oldParams, &oldParams);
+        jassert(index >= 0);
+        changedNotes.add((index >= 0) ? static_cast<Note *>(this->midiEvents.getUnchecked(index)) : nullptr);
+    }
+
+    for (int i = 0; i < changedNotes.size(); ++i)
+    {
+        if (Note *changedNote = changedNotes.getUnchecked(i))
+        {
+            changedNote->applyChanges(groupAfter.getReference(i));
+        }
+    }
+
+    this->sort();
+
+    ProjectTreeItem *project = this->getProject();
+    if (project != nullptr)
+    {
+        project->beginBulkChange();
+    }
+
+    for (int i = 0; i < changedNotes.size(); ++i)
+    {
+        if (const Note *changedNote = changedNotes.getUnchecked(i))
+        {
+            this->notifyEventChanged(groupBefore.getReference(i), *changedNote);
+        }
+    }
+
+    this->updateBeatRange(true);
+
+    if (project != nullptr)
+    {
+        project->endBulkChange();
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Batch operations
 //===----------------------------------------------------------------------===//
@@ -280,17 +489,14 @@ void PianoSequence::transposeAll(int keyDelta, bool shouldCheckpoint)
     }
 
     Array<Note> groupBefore, groupAfter;
+    groupBefore.ensureStorageAllocated(this->midiEvents.size());
+    groupAfter.ensureStorageAllocated(this->midiEvents.size());
 
     for (int i = 0; i < this->midiEvents.size(); ++i)
     {
-        if (Note *n = dynamic_cast<Note *>(this->midiEvents.getUnchecked(i)))
-        {
-            Note n1 = *n;
-            Note n2 = n1.withDeltaKey(keyDelta);
-
-            groupBefore.add(n1);
-            groupAfter.add(n2);
-        }
+        const Note &note = static_cast<const Note &>(*this->midiEvents.getUnchecked(i));
+        groupBefore.add(note);
+        groupAfter.add(note.withDeltaKey(keyDelta));
     }
 
     if (shouldCheckpoint)
@@ -72,7 +72,13 @@ public:
     void deserialize(const XmlElement &xml) override;
     void reset() override;
 
+protected:
+
+    void exportEvents(MidiMessageSequence &outSequence) const override;
+
 private:
 
+    void changeGroupInBulk(const Array<Note> &groupBefore, const Array<Note> &groupAfter);
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoSequence);
 };
@@ -0,0 +1,546 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "Tuning.h"
+#include "SerializationKeys.h"
+
+#define TUNING_DEFAULT_SIZE 12
+#define TUNING_MTS_DEVICE_ALL 0x7f
+#define TUNING_MTS_NAME_LENGTH 16
+#define TUNING_MTS_NO_CHANGE 0x7f
+#define TUNING_MTS_FRACTION_STEPS 16384
+#define TUNING_EQUAL_TEMPERAMENT_TOLERANCE_CENTS 0.01
+
+static inline int floorDivide(int a, int b) noexcept
+{
+    return (a >= 0) ? (a / b) : -((b - 1 - a) / b);
+}
+
+// 12-TET note number, 69 + 12 * log2(f / 440)
+static inline double frequencyToNote(double frequency) noexcept
+{
+    return 69.0 + 12.0 * log2(frequency / 440.0);
+}
+
+static inline double noteToFrequency(double note) noexcept
+{
+    return 440.0 * pow(2.0, (note - 69.0) / 12.0);
+}
+
+// Everything after the first whitespace is a comment
+static String getFirstToken(const String &line)
+{
+    return line.trim().upToFirstOccurrenceOf(" ", false, false)
+        .upToFirstOccurrenceOf("\t", false, false);
+}
+
+// The lines that are neither comments, nor empty
+static StringArray getScalaLines(const String &text, bool keepFirstEmptyLine)
+{
+    StringArray lines;
+    lines.addLines(text);
+
+    StringArray result;
+    for (const auto &line : lines)
+    {
+        if (line.startsWithChar('!'))
+        {
+            continue;
+        }
+
+        // The description line of a .scl file is allowed to be empty
+        if (line.trim().isEmpty() && ! (keepFirstEmptyLine && result.isEmpty()))
+        {
+            continue;
+        }
+
+        result.add(line);
+    }
+
+    return result;
+}
+
+// Cents have a period, ratios don't: "701.955", "3/2", "2"
+static bool parsePitch(const String &token, double &outCents)
+{
+    if (token.isEmpty() || ! token.containsOnly("0123456789-+./"))
+    {
+        return false;
+    }
+
+    if (token.containsChar('.'))
+    {
+        outCents = token.getDoubleValue();
+        return true;
+    }
+
+    const double numerator = double(token.upToFirstOccurrenceOf("/", false, false).getLargeIntValue());
+    const double denominator = token.containsChar('/') ?
+        double(token.fromFirstOccurrenceOf("/", false, false).getLargeIntValue()) : 1.0;
+
+    if (numerator <= 0.0 || denominator <= 0.0)
+    {
+        return false;
+    }
+
+    outCents = 1200.0 * log2(numerator / denominator);
+    return true;
+}
+
+Tuning::Tuning() :
+    name("12-TET"),
+    mapSize(0),
+    firstKey(0),
+    lastKey(TUNING_NUM_KEYS - 1),
+    middleKey(60),
+    referenceKey(69),
+    referenceFrequency(440.0),
+    periodDegree(TUNING_DEFAULT_SIZE)
+{
+    for (int i = 1; i <= TUNING_DEFAULT_SIZE; ++i)
+    {
+        this->cents.add(100.0 * i);
+    }
+
+    this->rebuildTables();
+}
+
+Tuning Tuning::withScala(const String &sclText) const
+{
+    Tuning t(*this);
+    t.cents.clearQuick();
+
+    const StringArray lines(getScalaLines(sclText, true));
+    const int numDegrees = (lines.size() > 1) ? getFirstToken(lines[1]).getIntValue() : 0;
+
+    for (int i = 2; i < lines.size() && t.cents.size() < numDegrees; ++i)
+    {
+        double pitchCents = 0.0;
+        if (! parsePitch(getFirstToken(lines[i]), pitchCents))
+        {
+            Logger::writeToLog("Invalid pitch in Scala file: " + lines[i]);
+            t.cents.clearQuick();
+            break;
+        }
+
+        t.cents.add(pitchCents);
+    }
+
+    if (numDegrees <= 0 || t.cents.size() != numDegrees || t.cents.getLast() <= 0.0)
+    {
+        Logger::writeToLog("Failed to parse Scala file");
+        t.cents.clearQuick();
+    }
+
+    t.name = lines[0].trim();
+
+    if (t.mapSize == 0)
+    {
+        t.periodDegree = t.cents.size();
+    }
+
+    t.rebuildTables();
+    return t;
+}
+
+Tuning Tuning::withKeyboardMapping(const String &kbmText) const
+{
+    Tuning t(*this);
+
+    const StringArray lines(getScalaLines(kbmText, false));
+    const int numHeaderLines = 7;
+
+    if (lines.size() < numHeaderLines)
+    {
+        Logger::writeToLog("Failed to parse keyboard mapping");
+        t.cents.clearQuick();
+        t.rebuildTables();
+        return t;
+    }
+
+    t.mapSize = jlimit(0, TUNING_NUM_KEYS, getFirstToken(lines[0]).getIntValue());
+    t.firstKey = jlimit(0, TUNING_NUM_KEYS - 1, getFirstToken(lines[1]).getIntValue());
+    t.lastKey = jlimit(0, TUNING_NUM_KEYS - 1, getFirstToken(lines[2]).getIntValue());
+    t.middleKey = jlimit(0, TUNING_NUM_KEYS - 1, getFirstToken(lines[3]).getIntValue());
+    t.referenceKey = jlimit(0, TUNING_NUM_KEYS - 1, getFirstToken(lines[4]).getIntValue());
+    t.referenceFrequency = getFirstToken(lines[5]).getDoubleValue();
+    t.periodDegree = getFirstToken(lines[6]).getIntValue();
+
+    if (t.referenceFrequency <= 0.0)
+    {
+        t.referenceFrequency = 440.0;
+    }
+
+    // Missing entries at the end of the mapping are unmapped
+    t.mapping.clearQuick();
+    for (int i = 0; i < t.mapSize; ++i)
+    {
+        const String token = getFirstToken(lines[numHeaderLines + i]).toLowerCase();
+        const bool isMapped = token.isNotEmpty() && token != "x";
+        t.mapping.add(isMapped ? jmax(0, token.getIntValue()) : -1);
+    }
+
+    if (t.mapSize == 0 || t.periodDegree <= 0)
+    {
+        t.periodDegree = t.cents.size();
+    }
+
+    t.rebuildTables();
+    return t;
+}
+
+Tuning Tuning::loadScalaFile(const File &file)
+{
+    Tuning tuning(Tuning().withScala(file.loadFileAsString()));
+
+    const File mappingFile(file.withFileExtension("kbm"));
+    if (tuning.isValid() && mappingFile.existsAsFile())
+    {
+        tuning = tuning.withKeyboardMapping(mappingFile.loadFileAsString());
+    }
+
+    if (tuning.isValid() && tuning.name.isEmpty())
+    {
+        tuning.name = file.getFileNameWithoutExtension();
+    }
+
+    return tuning;
+}
+
+String Tuning::getName() const noexcept
+{
+    return this->name;
+}
+
+int Tuning::getSize() const noexcept
+{
+    return this->cents.size();
+}
+
+bool Tuning::isValid() const noexcept
+{
+    return !this->cents.isEmpty();
+}
+
+bool Tuning::isEqualTemperament() const noexcept
+{
+    return this->equalTemperament;
+}
+
+//===----------------------------------------------------------------------===//
+// Tables
+//===----------------------------------------------------------------------===//
+
+double Tuning::getDegreeCents(int degree) const noexcept
+{
+    const int size = this->cents.size();
+    const int period = floorDivide(degree, size);
+    const int index = degree - period * size;
+    const double offset = (index == 0) ? 0.0 : this->cents.getUnchecked(index - 1);
+    return period * this->cents.getLast() + offset;
+}
+
+bool Tuning::getKeyCents(int key, double &outCents) const noexcept
+{
+    const int offset = key - this->middleKey;
+
+    if (this->mapSize == 0)
+    {
+        outCents = this->getDegreeCents(offset);
+        return true;
+    }
+
+    const int period = floorDivide(offset, this->mapSize);
+    const int degree = this->mapping[offset - period * this->mapSize];
+    if (degree < 0)
+    {
+        return false;
+    }
+
+    outCents = period * this->getDegreeCents(this->periodDegree) + this->getDegreeCents(degree);
+    return true;
+}
+
+void Tuning::rebuildTables()
+{
+    if (this->isValid())
+    {
+        // The reference frequency holds even if its key is not mapped
+        double referenceCents = 0.0;
+        if (! this->getKeyCents(this->referenceKey, referenceCents))
+        {
+            referenceCents = this->getDegreeCents(this->referenceKey - this->middleKey);
+        }
+
+        for (int key = 0; key < TUNING_NUM_KEYS; ++key)
+        {
+            double keyCents = 0.0;
+            const bool isMapped = (key >= this->firstKey && key <= this->lastKey &&
+                this->getKeyCents(key, keyCents));
+
+            this->frequencies[key] = isMapped ?
+                this->referenceFrequency * pow(2.0, (keyCents - referenceCents) / 1200.0) : 0.0;
+        }
+    }
+    else
+    {
+        Tuning::fillEqualTemperament(this->frequencies);
+    }
+
+    this->equalTemperament = true;
+
+    for (int key = 0; key < TUNING_NUM_KEYS; ++key)
+    {
+        const double frequency = this->frequencies[key];
+        if (frequency <= 0.0)
+        {
+            this->pitchBendKeys[key] = uint8(key);
+            this->pitchBendValues[key] = 8192;
+            this->tuningData[key][0] = TUNING_MTS_NO_CHANGE;
+            this->tuningData[key][1] = TUNING_MTS_NO_CHANGE;
+            this->tuningData[key][2] = TUNING_MTS_NO_CHANGE;
+            this->equalTemperament = false;
+            continue;
+        }
+
+        const double note = jlimit(0.0, double(TUNING_NUM_KEYS - 1), frequencyToNote(frequency));
+
+        if (fabs(note - key) * 100.0 > TUNING_EQUAL_TEMPERAMENT_TOLERANCE_CENTS)
+        {
+            this->equalTemperament = false;
+        }
+
+        const int nearestKey = roundToInt(note);
+        const int bend = 8192 + roundToInt((note - nearestKey) * 8192.0 / TUNING_PITCH_BEND_RANGE);
+        this->pitchBendKeys[key] = uint8(nearestKey);
+        this->pitchBendValues[key] = uint16(jlimit(0, 16383, bend));
+
+        // MTS frequency data is a semitone and a 14-bit fraction of it,
+        // where 7f 7f 7f is reserved for "no change"
+        int semitone = int(floor(note));
+        int fraction = roundToInt((note - semitone) * TUNING_MTS_FRACTION_STEPS);
+        if (fraction >= TUNING_MTS_FRACTION_STEPS)
+        {
+            semitone = semitone + 1;
+            fraction = 0;
+        }
+
+        if (semitone >= TUNING_NUM_KEYS - 1)
+        {
+            semitone = TUNING_NUM_KEYS - 1;
+            fraction = jmin(fraction, TUNING_MTS_FRACTION_STEPS - 2);
+        }
+
+        this->tuningData[key][0] = uint8(semitone);
+        this->tuningData[key][1] = uint8(fraction >> 7);
+        this->tuningData[key][2] = uint8(fraction & 0x7f);
+    }
+}
+
+void Tuning::fillEqualTemperament(double *keyFrequencies) noexcept
+{
+    for (int key = 0; key < TUNING_NUM_KEYS; ++key)
+    {
+        keyFrequencies[key] = noteToFrequency(key);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// MIDI Tuning Standard
+//===----------------------------------------------------------------------===//
+
+MidiMessage Tuning::createBulkDumpMessage(int program) const
+{
+    // 7e <device> 08 01 <program> <name> [xx yy zz] * 128 <checksum>
+    const int headerSize = 5;
+    const int dataSize = headerSize + TUNING_MTS_NAME_LENGTH + TUNING_NUM_KEYS * 3 + 1;
+
+    HeapBlock<uint8> data(dataSize, true);
+    data[0] = 0x7e;
+    data[1] = TUNING_MTS_DEVICE_ALL;
+    data[2] = 0x08;
+    data[3] = 0x01;
+    data[4] = uint8(program & 0x7f);
+
+    const String asciiName(this->name.retainCharacters(
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789 -_.,/()#+"));
+
+    for (int i = 0; i < TUNING_MTS_NAME_LENGTH; ++i)
+    {
+        data[headerSize + i] = uint8((i < asciiName.length()) ? asciiName[i] : ' ');
+    }
+
+    uint8 *keyData = data.getData() + headerSize + TUNING_MTS_NAME_LENGTH;
+    for (int key = 0; key < TUNING_NUM_KEYS; ++key)
+    {
+        keyData[key * 3 + 0] = this->tuningData[key][0];
+        keyData[key * 3 + 1] = this->tuningData[key][1];
+        keyData[key * 3 + 2] = this->tuningData[key][2];
+    }
+
+    uint8 checksum = 0;
+    for (int i = 0; i < dataSize - 1; ++i)
+    {
+        checksum ^= data[i];
+    }
+
+    data[dataSize - 1] = checksum & 0x7f;
+
+    return MidiMessage::createSysExMessage(data.getData(), dataSize);
+}
+
+static inline void applyKeyTuning(const uint8 *keyData, double &frequency) noexcept
+{
+    if (keyData[0] == TUNING_MTS_NO_CHANGE &&
+        keyData[1] == TUNING_MTS_NO_CHANGE &&
+        keyData[2] == TUNING_MTS_NO_CHANGE)
+    {
+        return;
+    }
+
+    const int fraction = ((keyData[1] & 0x7f) << 7) | (keyData[2] & 0x7f);
+    frequency = noteToFrequency((keyData[0] & 0x7f) + double(fraction) / TUNING_MTS_FRACTION_STEPS);
+}
+
+bool Tuning::applyTuningMessage(const uint8 *sysexData, int size, double *keyFrequencies) noexcept
+{
+    if (size < 6 || sysexData[2] != 0x08)
+    {
+        return false;
+    }
+
+    // Non-realtime bulk dump
+    if (sysexData[0] == 0x7e && sysexData[3] == 0x01)
+    {
+        const int headerSize = 5 + TUNING_MTS_NAME_LENGTH;
+        if (size < headerSize + TUNING_NUM_KEYS * 3)
+        {
+            return false;
+        }
+
+        for (int key = 0; key < TUNING_NUM_KEYS; ++key)
+        {
+            applyKeyTuning(sysexData + headerSize + key * 3, keyFrequencies[key]);
+        }
+
+        return true;
+    }
+
+    // Realtime single note tuning change: 7f <device> 08 02 <program> <count> [kk xx yy zz] * count
+    if (sysexData[0] == 0x7f && sysexData[3] == 0x02)
+    {
+        const int numChanges = jmin(int(sysexData[5]), (size - 6) / 4);
+        for (int i = 0; i < numChanges; ++i)
+        {
+            const uint8 *change = sysexData + 6 + i * 4;
+            applyKeyTuning(change + 1, keyFrequencies[change[0] & 0x7f]);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+//===----------------------------------------------------------------------===//
+// Serializable
+//===----------------------------------------------------------------------===//
+
+XmlElement *Tuning::serialize() const
+{
+    auto xml = new XmlElement(Serialization::Core::tuning);
+    xml->setAttribute(Serialization::Core::tuningName, this->name);
+
+    StringArray degrees;
+    for (const auto degreeCents : this->cents)
+    {
+        degrees.add(String(degreeCents, 6));
+    }
+
+    xml->setAttribute(Serialization::Core::tuningDegrees, degrees.joinIntoString(" "));
+
+    StringArray keys;
+    for (const auto degree : this->mapping)
+    {
+        keys.add((degree < 0) ? String("x") : String(degree));
+    }
+
+    xml->setAttribute(Serialization::Core::tuningMapping, keys.joinIntoString(" "));
+    xml->setAttribute(Serialization::Core::tuningFirstKey, this->firstKey);
+    xml->setAttribute(Serialization::Core::tuningLastKey, this->lastKey);
+    xml->setAttribute(Serialization::Core::tuningMiddleKey, this->middleKey);
+    xml->setAttribute(Serialization::Core::tuningReferenceKey, this->referenceKey);
+    xml->setAttribute(Serialization::Core::tuningReferenceFrequency, this->referenceFrequency);
+    xml->setAttribute(Serialization::Core::tuningPeriodDegree, this->periodDegree);
+
+    return xml;
+}
+
+void Tuning::deserialize(const XmlElement &xml)
+{
+    const XmlElement *root = (xml.getTagName() == Serialization::Core::tuning) ?
+        &xml : xml.getChildByName(Serialization::Core::tuning);
+
+    if (root == nullptr) { return; }
+
+    this->name = root->getStringAttribute(Serialization::Core::tuningName);
+
+    StringArray degrees;
+    degrees.addTokens(root->getStringAttribute(Serialization::Core::tuningDegrees), true);
+    this->cents.clearQuick();
+    for (const auto &degree : degrees)
+    {
+        this->cents.add(degree.getDoubleValue());
+    }
+
+    StringArray keys;
+    keys.addTokens(root->getStringAttribute(Serialization::Core::tuningMapping), true);
+    this->mapping.clearQuick();
+    for (const auto &key : keys)
+    {
+        this->mapping.add((key == "x") ? -1 : key.getIntValue());
+    }
+
+    this->mapSize = this->mapping.size();
+    this->firstKey = root->getIntAttribute(Serialization::Core::tuningFirstKey, 0);
+    this->lastKey = root->getIntAttribute(Serialization::Core::tuningLastKey, TUNING_NUM_KEYS - 1);
+    this->middleKey = root->getIntAttribute(Serialization::Core::tuningMiddleKey, 60);
+    this->referenceKey = root->getIntAttribute(Serialization::Core::tuningReferenceKey, 69);
+    this->referenceFrequency = root->getDoubleAttribute(Serialization::Core::tuningReferenceFrequency, 440.0);
+    this->periodDegree = root->getIntAttribute(Serialization::Core::tuningPeriodDegree, this->cents.size());
+
+    this->rebuildTables();
+}
+
+void Tuning::reset()
+{
+    *this = Tuning();
+}
+
+bool operator==(const Tuning &l, const Tuning &r)
+{
+    return &l == &r ||
+        (l.name == r.name &&
+         memcmp(l.frequencies, r.frequencies, sizeof(l.frequencies)) == 0);
+}
+
+bool operator!=(const Tuning &l, const Tuning &r)
+{
+    return !operator== (l, r);
+}
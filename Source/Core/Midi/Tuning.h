@@ -0,0 +1,132 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "Serializable.h"
+
+#define TUNING_NUM_KEYS 128
+
+// The pitch wheel range assumed when retuning with pitch bends
+// (the receiver is told to use it with RPN 0 before playback)
+#define TUNING_PITCH_BEND_RANGE 2
+
+// A microtonal tuning: a Scala scale with an optional keyboard mapping.
+//
+// Everything the playback path needs is computed once, when the tuning
+// is built: the frequency of every key, the MIDI Tuning Standard data,
+// and the nearest equal-tempered key with a pitch bend for every key,
+// so that retuning a note is a table lookup.
+
+class Tuning final : public Serializable
+{
+public:
+
+    // 12-tone equal temperament, A4 = 440 Hz
+    Tuning();
+
+    // Returns an invalid tuning, if the text cannot be parsed
+    Tuning withScala(const String &sclText) const;
+    Tuning withKeyboardMapping(const String &kbmText) const;
+
+    // Reads a .scl file and the .kbm file with the same name, if any
+    static Tuning loadScalaFile(const File &file);
+
+    String getName() const noexcept;
+    int getSize() const noexcept;
+    bool isValid() const noexcept;
+    bool isEqualTemperament() const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Lookups
+    //===------------------------------------------------------------------===//
+
+    // Zero for the keys left unmapped by the keyboard mapping
+    inline double getFrequency(int key) const noexcept
+    { return this->frequencies[key & 0x7f]; }
+
+    inline bool isKeyMapped(int key) const noexcept
+    { return this->frequencies[key & 0x7f] > 0.0; }
+
+    // The nearest equal-tempered key and the 14-bit pitch wheel value
+    // that retunes it, with a range of TUNING_PITCH_BEND_RANGE semitones
+    inline int getPitchBendKey(int key) const noexcept
+    { return this->pitchBendKeys[key & 0x7f]; }
+
+    inline int getPitchBendValue(int key) const noexcept
+    { return this->pitchBendValues[key & 0x7f]; }
+
+    //===------------------------------------------------------------------===//
+    // MIDI Tuning Standard
+    //===------------------------------------------------------------------===//
+
+    // Non-realtime bulk dump of all 128 keys
+    MidiMessage createBulkDumpMessage(int program = 0) const;
+
+    // Applies a bulk dump or a realtime single note tuning change
+    // to a table of key frequencies; the data goes without F0 and F7.
+    // Returns false, if the message is neither of those
+    static bool applyTuningMessage(const uint8 *sysexData, int size,
+        double *keyFrequencies) noexcept;
+
+    static void fillEqualTemperament(double *keyFrequencies) noexcept;
+
+    //===------------------------------------------------------------------===//
+    // Serializable
+    //===------------------------------------------------------------------===//
+
+    XmlElement *serialize() const override;
+    void deserialize(const XmlElement &xml) override;
+    void reset() override;
+
+    friend bool operator==(const Tuning &l, const Tuning &r);
+    friend bool operator!=(const Tuning &l, const Tuning &r);
+
+private:
+
+    void rebuildTables();
+
+    double getDegreeCents(int degree) const noexcept;
+    bool getKeyCents(int key, double &outCents) const noexcept;
+
+    String name;
+
+    // Pitches of degrees 1..size in cents (degree 0 is always 0),
+    // the last one is the period, usually an octave
+    Array<double> cents;
+
+    // Keyboard mapping, as in .kbm files;
+    // zero map size means every key gets the next degree
+    int mapSize;
+    int firstKey;
+    int lastKey;
+    int middleKey;
+    int referenceKey;
+    double referenceFrequency;
+    int periodDegree;
+    Array<int> mapping; // -1 for the unmapped keys
+
+    // Precomputed tables
+    double frequencies[TUNING_NUM_KEYS];
+    uint8 pitchBendKeys[TUNING_NUM_KEYS];
+    uint16 pitchBendValues[TUNING_NUM_KEYS];
+    uint8 tuningData[TUNING_NUM_KEYS][3];
+    bool equalTemperament;
+
+    JUCE_LEAK_DETECTOR(Tuning)
+};
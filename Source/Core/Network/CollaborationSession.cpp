@@ -0,0 +1,961 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "CollaborationSession.h"
+#include "ProjectTreeItem.h"
+#include "MidiTrack.h"
+#include "PianoSequence.h"
+#include "AutomationSequence.h"
+#include "AnnotationsSequence.h"
+#include "TimeSignaturesSequence.h"
+#include "KeySignaturesSequence.h"
+#include "Note.h"
+#include "AutomationEvent.h"
+#include "AnnotationEvent.h"
+#include "TimeSignatureEvent.h"
+#include "KeySignatureEvent.h"
+#include "NoteActions.h"
+#include "AutomationEventActions.h"
+#include "AnnotationEventActions.h"
+#include "TimeSignatureEventActions.h"
+#include "KeySignatureEventActions.h"
+#include "UndoStack.h"
+
+#if JUCE_WINDOWS
+#   ifndef NOMINMAX
+#       define NOMINMAX
+#   endif
+#   include <windows.h>
+#   include <bcrypt.h>
+#   if JUCE_MSVC
+#       pragma comment(lib, "bcrypt.lib")
+#   endif
+#elif JUCE_MAC || JUCE_IOS
+#   include <stdlib.h>
+#else
+#   include <cstdio>
+#endif
+
+#define COLLABORATION_PROTOCOL_VERSION 2
+#define COLLABORATION_MAGIC 0x4c4f4348
+#define COLLABORATION_DEFAULT_PORT 7231
+#define COLLABORATION_DEFAULT_BIND_ADDRESS "127.0.0.1"
+#define COLLABORATION_CONNECT_TIMEOUT_MS 2000
+
+// Connections that haven't proven they know the token by then are dropped
+#define COLLABORATION_HELLO_TIMEOUT_MS 5000
+
+#define COLLABORATION_TOKEN_SIZE 16
+
+// Well within the 100 ms it takes for an edit to feel laggy on a peer
+#define COLLABORATION_FLUSH_INTERVAL_MS 10
+
+#define COLLABORATION_MAX_BATCH_SIZE 2048
+
+// Bigger batches are applied as a bulk change, i.e. with a single reload
+#define COLLABORATION_BULK_APPLY_SIZE 128
+
+namespace
+{
+    enum MessageType
+    {
+        HelloMessage = 1,
+        OperationsMessage = 2,
+        SnapshotMessage = 3
+    };
+
+    // The token is all that keeps the uninvited out,
+    // so it comes from the system's secure random generator
+    bool fillSecureRandom(uint8 *data, size_t size)
+    {
+#if JUCE_WINDOWS
+        return BCRYPT_SUCCESS(BCryptGenRandom(nullptr, data, ULONG(size),
+            BCRYPT_USE_SYSTEM_PREFERRED_RNG));
+#elif JUCE_MAC || JUCE_IOS
+        arc4random_buf(data, size);
+        return true;
+#else
+        std::FILE *source = std::fopen("/dev/urandom", "rb");
+        if (source == nullptr)
+        {
+            return false;
+        }
+
+        const bool hasRead = (std::fread(data, 1, size, source) == size);
+        std::fclose(source);
+        return hasRead;
+#endif
+    }
+
+    String createToken()
+    {
+        uint8 bytes[COLLABORATION_TOKEN_SIZE];
+        if (! fillSecureRandom(bytes, sizeof(bytes)))
+        {
+            return String::empty;
+        }
+
+        const String token(String::toHexString(bytes, sizeof(bytes), 0));
+        zeromem(bytes, sizeof(bytes));
+        return token;
+    }
+
+    // Takes the same time wherever the first mismatch is
+    bool tokensMatch(const String &expected, const String &received) noexcept
+    {
+        const CharPointer_UTF8 a(expected.toUTF8());
+        const CharPointer_UTF8 b(received.toUTF8());
+        const size_t size = a.sizeInBytes();
+
+        if (expected.isEmpty() || size != b.sizeInBytes())
+        {
+            return false;
+        }
+
+        uint8 difference = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            difference |= uint8(a.getAddress()[i] ^ b.getAddress()[i]);
+        }
+
+        return (difference == 0);
+    }
+
+    template<typename TEvent> struct GroupActions;
+
+    template<> struct GroupActions<Note>
+    {
+        typedef NotesGroupInsertAction Insert;
+        typedef NotesGroupRemoveAction Remove;
+        typedef NotesGroupChangeAction Change;
+    };
+
+    template<> struct GroupActions<AutomationEvent>
+    {
+        typedef AutomationEventsGroupInsertAction Insert;
+        typedef AutomationEventsGroupRemoveAction Remove;
+        typedef AutomationEventsGroupChangeAction Change;
+    };
+
+    template<> struct GroupActions<AnnotationEvent>
+    {
+        typedef AnnotationEventsGroupInsertAction Insert;
+        typedef AnnotationEventsGroupRemoveAction Remove;
+        typedef AnnotationEventsGroupChangeAction Change;
+    };
+
+    template<> struct GroupActions<TimeSignatureEvent>
+    {
+        typedef TimeSignatureEventsGroupInsertAction Insert;
+        typedef TimeSignatureEventsGroupRemoveAction Remove;
+        typedef TimeSignatureEventsGroupChangeAction Change;
+    };
+
+    template<> struct GroupActions<KeySignatureEvent>
+    {
+        typedef KeySignatureEventsGroupInsertAction Insert;
+        typedef KeySignatureEventsGroupRemoveAction Remove;
+        typedef KeySignatureEventsGroupChangeAction Change;
+    };
+
+    void serializeEvent(const MidiEvent &event, MemoryBlock &target)
+    {
+        ScopedPointer<XmlElement> xml(event.serialize());
+        MemoryOutputStream out(target, false);
+        ValueTree::fromXml(*xml).writeToStream(out);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Peer
+//===----------------------------------------------------------------------===//
+
+// Socket reads happen on the connection's own thread, and the callbacks
+// are delivered on the message thread; writes happen on the sender thread,
+// so that a slow peer never blocks the UI, only makes its batches bigger.
+class CollaborationSession::Peer final :
+    public InterprocessConnection,
+    private Thread
+{
+public:
+
+    explicit Peer(CollaborationSession &owner) :
+        InterprocessConnection(true, COLLABORATION_MAGIC),
+        Thread("Live session peer"),
+        session(owner),
+        siteId(0),
+        isReady(false),
+        hasDisconnected(false),
+        connectionTime(Time::getMillisecondCounter())
+    {
+        this->startThread(5);
+    }
+
+    ~Peer() override
+    {
+        this->stopThread(COLLABORATION_CONNECT_TIMEOUT_MS);
+        this->disconnect();
+    }
+
+    // Called from the message thread only
+    void post(const MemoryBlock &message)
+    {
+        {
+            const ScopedLock lock(this->outgoingLock);
+            this->outgoingMessages.add(message);
+        }
+
+        ++this->numUnsentMessages;
+        this->notify();
+    }
+
+    bool isBusy() const noexcept
+    {
+        return this->numUnsentMessages.get() > 0;
+    }
+
+    void connectionMade() override
+    {
+        this->session.onPeerConnected(*this);
+    }
+
+    void connectionLost() override
+    {
+        this->hasDisconnected = true;
+    }
+
+    void messageReceived(const MemoryBlock &message) override
+    {
+        this->session.onMessageReceived(*this, message);
+    }
+
+    int siteId;
+    bool isReady;
+    bool hasDisconnected;
+
+    // Since when the peer has been waiting for its hello
+    const uint32 connectionTime;
+
+    // Not sent yet, at most one operation per key
+    Array<Operation> pendingOperations;
+    HashMap<String, int> pendingIndices;
+
+private:
+
+    void run() override
+    {
+        while (! this->threadShouldExit())
+        {
+            this->wait(-1);
+
+            while (! this->threadShouldExit())
+            {
+                MemoryBlock message;
+
+                {
+                    const ScopedLock lock(this->outgoingLock);
+                    if (this->outgoingMessages.isEmpty())
+                    {
+                        break;
+                    }
+
+                    message.swapWith(this->outgoingMessages.getReference(0));
+                    this->outgoingMessages.remove(0);
+                }
+
+                this->sendMessage(message);
+                --this->numUnsentMessages;
+            }
+        }
+    }
+
+    CollaborationSession &session;
+
+    CriticalSection outgoingLock;
+    Array<MemoryBlock> outgoingMessages;
+    Atomic<int> numUnsentMessages;
+
+    JUCE_DECLARE_NON_COPYABLE(Peer)
+};
+
+//===----------------------------------------------------------------------===//
+// Server
+//===----------------------------------------------------------------------===//
+
+class CollaborationSession::Server final : public InterprocessConnectionServer
+{
+public:
+
+    explicit Server(CollaborationSession &owner) :
+        session(owner) {}
+
+    ~Server() override
+    {
+        this->stop();
+    }
+
+private:
+
+    // Called from the server thread
+    InterprocessConnection *createConnectionObject() override
+    {
+        Peer *peer = new Peer(this->session);
+        const ScopedLock lock(this->session.newPeersLock);
+        this->session.newPeers.add(peer);
+        return peer;
+    }
+
+    CollaborationSession &session;
+
+    JUCE_DECLARE_NON_COPYABLE(Server)
+};
+
+//===----------------------------------------------------------------------===//
+// Session
+//===----------------------------------------------------------------------===//
+
+CollaborationSession::CollaborationSession(ProjectTreeItem &parentProject) :
+    project(parentProject),
+    siteId(Random::getSystemRandom().nextInt(Range<int>(0x1000, 0x10000))),
+    clock(0),
+    isApplyingRemoteOperations(false)
+{
+    this->project.addListener(this);
+}
+
+CollaborationSession::~CollaborationSession()
+{
+    this->stopTimer();
+    this->server = nullptr;
+
+    this->adoptNewPeers();
+    this->peers.clear();
+
+    this->project.removeListener(this);
+    this->project.setEventIdPrefix(String::empty);
+}
+
+int CollaborationSession::getDefaultPort() noexcept
+{
+    return COLLABORATION_DEFAULT_PORT;
+}
+
+String CollaborationSession::getDefaultBindAddress()
+{
+    return COLLABORATION_DEFAULT_BIND_ADDRESS;
+}
+
+bool CollaborationSession::host(const String &bindAddress, int port)
+{
+    jassert(this->server == nullptr && this->peers.isEmpty());
+
+    ScopedPointer<Server> newServer(new Server(*this));
+    if (! newServer->beginWaitingForSocket(port, bindAddress))
+    {
+        Logger::writeToLog("Live session: cannot listen on " + bindAddress + ":" + String(port));
+        return false;
+    }
+
+    const String newToken(createToken());
+    if (newToken.isEmpty())
+    {
+        Logger::writeToLog("Live session: cannot generate a session token");
+        return false;
+    }
+
+    Logger::writeToLog("Live session: hosting on " + bindAddress + ":" + String(port));
+    this->token = newToken;
+    this->server = newServer.release();
+    this->start();
+    return true;
+}
+
+bool CollaborationSession::join(const String &hostName, int port, const String &sessionToken)
+{
+    jassert(this->server == nullptr && this->peers.isEmpty());
+
+    // Set before connecting, as the hello goes out as soon as the connection is made
+    this->token = sessionToken;
+
+    ScopedPointer<Peer> peer(new Peer(*this));
+    if (! peer->connectToSocket(hostName, port, COLLABORATION_CONNECT_TIMEOUT_MS))
+    {
+        Logger::writeToLog("Live session: cannot connect to " + hostName + ":" + String(port));
+        return false;
+    }
+
+    Logger::writeToLog("Live session: joined " + hostName + ":" + String(port));
+    this->peers.add(peer.release());
+    this->start();
+    return true;
+}
+
+const String &CollaborationSession::getToken() const noexcept
+{
+    return this->token;
+}
+
+bool CollaborationSession::isHosting() const noexcept
+{
+    return (this->server != nullptr);
+}
+
+int CollaborationSession::getNumPeers() const noexcept
+{
+    int numPeers = 0;
+    for (const auto peer : this->peers)
+    {
+        numPeers += (peer->isReady && ! peer->hasDisconnected) ? 1 : 0;
+    }
+
+    return numPeers;
+}
+
+void CollaborationSession::start()
+{
+    this->project.setEventIdPrefix(String::toHexString(this->siteId) + "~");
+    this->startTimer(COLLABORATION_FLUSH_INTERVAL_MS);
+}
+
+//===----------------------------------------------------------------------===//
+// ProjectListener
+//===----------------------------------------------------------------------===//
+
+void CollaborationSession::onAddMidiEvent(const MidiEvent &event)
+{
+    this->recordLocalOperation(Operation::Upsert, event);
+}
+
+void CollaborationSession::onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &newEvent)
+{
+    this->recordLocalOperation(Operation::Upsert, newEvent);
+}
+
+void CollaborationSession::onRemoveMidiEvent(const MidiEvent &event)
+{
+    this->recordLocalOperation(Operation::Remove, event);
+}
+
+//===----------------------------------------------------------------------===//
+// Operations
+//===----------------------------------------------------------------------===//
+
+void CollaborationSession::recordLocalOperation(Operation::Kind kind, const MidiEvent &event)
+{
+    const MidiSequence *sequence = event.getSequence();
+    if (this->isApplyingRemoteOperations || sequence == nullptr)
+    {
+        return;
+    }
+
+    Operation operation;
+    operation.kind = kind;
+    operation.trackId = sequence->getTrackId();
+    operation.eventId = event.getId();
+    operation.stamp = { ++this->clock, this->siteId };
+
+    if (kind == Operation::Upsert)
+    {
+        serializeEvent(event, operation.payload);
+    }
+
+    this->stamps.set(operation.getKey(), operation.stamp);
+    this->enqueueOperation(operation, nullptr);
+}
+
+void CollaborationSession::enqueueOperation(const Operation &operation, const Peer *exceptPeer)
+{
+    const String key(operation.getKey());
+
+    for (auto peer : this->peers)
+    {
+        if (peer == exceptPeer || ! peer->isReady)
+        {
+            continue;
+        }
+
+        if (peer->pendingIndices.contains(key))
+        {
+            peer->pendingOperations.setUnchecked(peer->pendingIndices[key], operation);
+        }
+        else
+        {
+            peer->pendingIndices.set(key, peer->pendingOperations.size());
+            peer->pendingOperations.add(operation);
+        }
+    }
+}
+
+bool CollaborationSession::acceptOperation(const Operation &operation, bool force)
+{
+    this->clock = jmax(this->clock, operation.stamp.clock);
+
+    const String key(operation.getKey());
+    if (! force && this->stamps.contains(key) &&
+        ! operation.stamp.isNewerThan(this->stamps[key]))
+    {
+        return false;
+    }
+
+    this->stamps.set(key, operation.stamp);
+    return true;
+}
+
+void CollaborationSession::writeOperation(OutputStream &out, const Operation &operation)
+{
+    out.writeByte(char(operation.kind));
+    out.writeString(operation.trackId);
+    out.writeString(operation.eventId);
+    out.writeInt64(operation.stamp.clock);
+    out.writeInt(operation.stamp.siteId);
+
+    if (operation.kind == Operation::Upsert)
+    {
+        out.writeCompressedInt(int(operation.payload.getSize()));
+        out << operation.payload;
+    }
+}
+
+bool CollaborationSession::readOperation(InputStream &in, Operation &operation)
+{
+    const int kind = in.readByte();
+    if (kind != Operation::Upsert && kind != Operation::Remove)
+    {
+        return false;
+    }
+
+    operation.kind = Operation::Kind(kind);
+    operation.trackId = in.readString();
+    operation.eventId = in.readString();
+    operation.stamp.clock = in.readInt64();
+    operation.stamp.siteId = in.readInt();
+
+    if (operation.kind == Operation::Upsert)
+    {
+        const int payloadSize = in.readCompressedInt();
+        if (payloadSize <= 0 || payloadSize > in.getNumBytesRemaining())
+        {
+            return false;
+        }
+
+        operation.payload.setSize(size_t(payloadSize));
+        if (in.read(operation.payload.getData(), payloadSize) != payloadSize)
+        {
+            return false;
+        }
+    }
+
+    return operation.trackId.isNotEmpty() && operation.eventId.isNotEmpty();
+}
+
+//===----------------------------------------------------------------------===//
+// Peers
+//===----------------------------------------------------------------------===//
+
+void CollaborationSession::timerCallback()
+{
+    this->adoptNewPeers();
+    this->removeDisconnectedPeers();
+    this->flushPendingOperations();
+}
+
+void CollaborationSession::adoptNewPeers()
+{
+    const ScopedLock lock(this->newPeersLock);
+    while (this->newPeers.size() > 0)
+    {
+        this->peers.add(this->newPeers.removeAndReturn(0));
+    }
+}
+
+void CollaborationSession::removeDisconnectedPeers()
+{
+    const uint32 now = Time::getMillisecondCounter();
+
+    for (int i = this->peers.size(); --i >= 0; )
+    {
+        Peer *peer = this->peers.getUnchecked(i);
+
+        if (! peer->isReady && ! peer->hasDisconnected &&
+            (now - peer->connectionTime) > COLLABORATION_HELLO_TIMEOUT_MS)
+        {
+            Logger::writeToLog("Live session: dropped a peer that never said hello");
+            peer->disconnect();
+            peer->hasDisconnected = true;
+        }
+
+        if (peer->hasDisconnected)
+        {
+            Logger::writeToLog("Live session: peer disconnected");
+            this->peers.remove(i);
+        }
+    }
+}
+
+void CollaborationSession::flushPendingOperations()
+{
+    for (auto peer : this->peers)
+    {
+        // The previous batch is still being written: keep coalescing
+        if (! peer->isReady || peer->isBusy() || peer->pendingOperations.isEmpty())
+        {
+            continue;
+        }
+
+        const int numOperations = jmin(peer->pendingOperations.size(), COLLABORATION_MAX_BATCH_SIZE);
+
+        MemoryOutputStream out;
+        out.writeByte(char(OperationsMessage));
+        out.writeCompressedInt(numOperations);
+        for (int i = 0; i < numOperations; ++i)
+        {
+            writeOperation(out, peer->pendingOperations.getReference(i));
+        }
+
+        peer->post(out.getMemoryBlock());
+
+        peer->pendingOperations.removeRange(0, numOperations);
+        peer->pendingIndices.clear();
+        for (int i = 0; i < peer->pendingOperations.size(); ++i)
+        {
+            peer->pendingIndices.set(peer->pendingOperations.getReference(i).getKey(), i);
+        }
+    }
+}
+
+void CollaborationSession::onPeerConnected(Peer &peer)
+{
+    this->adoptNewPeers();
+
+    // The host says nothing until the peer proves it knows the token
+    if (! this->isHosting())
+    {
+        peer.post(this->createHelloMessage());
+    }
+}
+
+void CollaborationSession::onMessageReceived(Peer &peer, const MemoryBlock &message)
+{
+    MemoryInputStream in(message, false);
+    const int messageType = in.readByte();
+
+    if (messageType == HelloMessage)
+    {
+        const int protocolVersion = in.readInt();
+        const String projectId = in.readString();
+        const int remoteSiteId = in.readInt();
+        const String remoteToken = in.readString();
+
+        if (peer.isReady ||
+            protocolVersion != COLLABORATION_PROTOCOL_VERSION ||
+            projectId != this->project.getId() ||
+            remoteSiteId == this->siteId ||
+            ! tokensMatch(this->token, remoteToken))
+        {
+            Logger::writeToLog("Live session: rejected a peer with a wrong token, project or protocol version");
+            peer.disconnect();
+            peer.hasDisconnected = true;
+            return;
+        }
+
+        peer.siteId = remoteSiteId;
+        peer.isReady = true;
+        Logger::writeToLog("Live session: peer " + peer.getConnectedHostName() + " is ready");
+
+        if (this->isHosting())
+        {
+            peer.post(this->createHelloMessage());
+            peer.post(this->createSnapshotMessage());
+        }
+
+        return;
+    }
+
+    const bool isSnapshot = (messageType == SnapshotMessage);
+    if (! peer.isReady ||
+        (messageType != OperationsMessage && ! isSnapshot) ||
+        (isSnapshot && this->isHosting()))
+    {
+        return;
+    }
+
+    StringArray snapshotTrackIds;
+    if (isSnapshot)
+    {
+        const int numTracks = in.readCompressedInt();
+        for (int i = 0; i < numTracks && ! in.isExhausted(); ++i)
+        {
+            snapshotTrackIds.add(in.readString());
+        }
+    }
+
+    Array<Operation> acceptedOperations;
+    HashMap<String, int> acceptedIndices;
+
+    const int numOperations = in.readCompressedInt();
+    for (int i = 0; i < numOperations && ! in.isExhausted(); ++i)
+    {
+        Operation operation;
+        if (! readOperation(in, operation))
+        {
+            Logger::writeToLog("Live session: received a malformed operation");
+            break;
+        }
+
+        // The host's snapshot is authoritative
+        if (! this->acceptOperation(operation, isSnapshot))
+        {
+            continue;
+        }
+
+        const String key(operation.getKey());
+        if (acceptedIndices.contains(key))
+        {
+            acceptedOperations.setUnchecked(acceptedIndices[key], operation);
+        }
+        else
+        {
+            acceptedIndices.set(key, acceptedOperations.size());
+            acceptedOperations.add(operation);
+        }
+
+        // Relayed to everyone else (only the host has more than one peer)
+        if (! isSnapshot)
+        {
+            this->enqueueOperation(operation, &peer);
+        }
+    }
+
+    this->applyOperations(acceptedOperations, snapshotTrackIds);
+}
+
+MemoryBlock CollaborationSession::createHelloMessage() const
+{
+    MemoryOutputStream out;
+    out.writeByte(char(HelloMessage));
+    out.writeInt(COLLABORATION_PROTOCOL_VERSION);
+    out.writeString(this->project.getId());
+    out.writeInt(this->siteId);
+    out.writeString(this->token);
+    return out.getMemoryBlock();
+}
+
+MemoryBlock CollaborationSession::createSnapshotMessage()
+{
+    const Array<MidiTrack *> tracks(this->project.getTracks());
+
+    MemoryOutputStream out;
+    out.writeByte(char(SnapshotMessage));
+
+    int numOperations = 0;
+    out.writeCompressedInt(tracks.size());
+    for (const auto track : tracks)
+    {
+        out.writeString(track->getTrackId().toString());
+        numOperations += track->getSequence()->size();
+    }
+
+    out.writeCompressedInt(numOperations);
+    for (const auto track : tracks)
+    {
+        const String trackId(track->getTrackId().toString());
+        for (const MidiEvent *event : *track->getSequence())
+        {
+            Operation operation;
+            operation.kind = Operation::Upsert;
+            operation.trackId = trackId;
+            operation.eventId = event->getId();
+
+            // The events nobody has touched yet are older than any edit
+            const String key(operation.getKey());
+            operation.stamp = this->stamps.contains(key) ? this->stamps[key] : Stamp { 0, 0 };
+
+            serializeEvent(*event, operation.payload);
+            writeOperation(out, operation);
+        }
+    }
+
+    return out.getMemoryBlock();
+}
+
+//===----------------------------------------------------------------------===//
+// Applying remote operations
+//===----------------------------------------------------------------------===//
+
+void CollaborationSession::applyOperations(const Array<Operation> &operations,
+    const StringArray &snapshotTrackIds)
+{
+    if (operations.isEmpty() && snapshotTrackIds.isEmpty())
+    {
+        return;
+    }
+
+    const ScopedValueSetter<bool> applyingScope(this->isApplyingRemoteOperations, true);
+
+    const bool isBulkChange = snapshotTrackIds.size() > 0 ||
+        operations.size() > COLLABORATION_BULK_APPLY_SIZE;
+
+    if (isBulkChange)
+    {
+        this->project.beginBulkChange();
+    }
+
+    ReferenceCountedArray<UndoAction> journaledActions;
+
+    StringArray trackIds(snapshotTrackIds);
+    for (const auto &operation : operations)
+    {
+        trackIds.addIfNotAlreadyThere(operation.trackId);
+    }
+
+    for (const auto &trackId : trackIds)
+    {
+        Array<const Operation *> trackOperations;
+        for (const auto &operation : operations)
+        {
+            if (operation.trackId == trackId)
+            {
+                trackOperations.add(&operation);
+            }
+        }
+
+        const bool removeMissing = snapshotTrackIds.contains(trackId);
+
+        if (auto pianoSequence = this->project.findSequenceByTrackId<PianoSequence>(trackId))
+        {
+            this->applyToSequence<Note>(*pianoSequence, trackId, trackOperations, removeMissing, journaledActions);
+        }
+        else if (auto automationSequence = this->project.findSequenceByTrackId<AutomationSequence>(trackId))
+        {
+            this->applyToSequence<AutomationEvent>(*automationSequence, trackId, trackOperations, removeMissing, journaledActions);
+        }
+        else if (auto annotationsSequence = this->project.findSequenceByTrackId<AnnotationsSequence>(trackId))
+        {
+            this->applyToSequence<AnnotationEvent>(*annotationsSequence, trackId, trackOperations, removeMissing, journaledActions);
+        }
+        else if (auto timeSignaturesSequence = this->project.findSequenceByTrackId<TimeSignaturesSequence>(trackId))
+        {
+            this->applyToSequence<TimeSignatureEvent>(*timeSignaturesSequence, trackId, trackOperations, removeMissing, journaledActions);
+        }
+        else if (auto keySignaturesSequence = this->project.findSequenceByTrackId<KeySignaturesSequence>(trackId))
+        {
+            this->applyToSequence<KeySignatureEvent>(*keySignaturesSequence, trackId, trackOperations, removeMissing, journaledActions);
+        }
+        else
+        {
+            Logger::writeToLog("Live session: skipped the edits of unknown track " + trackId);
+        }
+    }
+
+    if (isBulkChange)
+    {
+        this->project.endBulkChange();
+    }
+
+    // The peers' edits bypass the undo stack, but still
+    // have to survive a crash along with the local ones
+    this->project.getUndoStack()->journalExternalChanges(journaledActions);
+}
+
+template<typename TEvent, typename TSequence>
+void CollaborationSession::applyToSequence(TSequence &sequence, const String &trackId,
+    const Array<const Operation *> &operations, bool removeMissing,
+    ReferenceCountedArray<UndoAction> &outActions)
+{
+    HashMap<String, const TEvent *> existingEvents;
+    for (const MidiEvent *event : sequence)
+    {
+        existingEvents.set(event->getId(), static_cast<const TEvent *>(event));
+    }
+
+    Array<TEvent> insertedEvents;
+    Array<TEvent> removedEvents;
+    Array<TEvent> eventsBefore;
+    Array<TEvent> eventsAfter;
+
+    for (const auto operation : operations)
+    {
+        const TEvent *existingEvent = existingEvents[operation->eventId];
+
+        if (operation->kind == Operation::Remove)
+        {
+            if (existingEvent != nullptr)
+            {
+                removedEvents.add(*existingEvent);
+            }
+
+            continue;
+        }
+
+        const ValueTree tree(ValueTree::readFromData(operation->payload.getData(), operation->payload.getSize()));
+        ScopedPointer<XmlElement> xml(tree.createXml());
+        if (xml == nullptr)
+        {
+            continue;
+        }
+
+        TEvent event;
+        event.deserialize(*xml);
+
+        if (existingEvent == nullptr)
+        {
+            insertedEvents.add(event);
+        }
+        else
+        {
+            eventsBefore.add(*existingEvent);
+            eventsAfter.add(event);
+        }
+    }
+
+    if (removeMissing)
+    {
+        HashMap<String, bool> snapshotIds;
+        for (const auto operation : operations)
+        {
+            snapshotIds.set(operation->eventId, true);
+        }
+
+        for (const MidiEvent *event : sequence)
+        {
+            if (! snapshotIds.contains(event->getId()))
+            {
+                removedEvents.add(static_cast<const TEvent &>(*event));
+            }
+        }
+    }
+
+    // The actions take the arrays over, so they are created last
+    if (removedEvents.size() > 0)
+    {
+        sequence.removeGroup(removedEvents, false);
+        outActions.add(new typename GroupActions<TEvent>::Remove(this->project, trackId, removedEvents));
+    }
+
+    if (eventsBefore.size() > 0)
+    {
+        sequence.changeGroup(eventsBefore, eventsAfter, false);
+        outActions.add(new typename GroupActions<TEvent>::Change(this->project, trackId, eventsBefore, eventsAfter));
+    }
+
+    if (insertedEvents.size() > 0)
+    {
+        sequence.insertGroup(insertedEvents, false);
+        outActions.add(new typename GroupActions<TEvent>::Insert(this->project, trackId, insertedEvents));
+    }
+}
@@ -0,0 +1,178 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Live editing session shared by several instances over TCP.
+//
+// Every change of a midi event, whether it comes from an undoable action,
+// an undo/redo or a bulk edit, ends up as a project notification, so the
+// session listens to those and turns them into operations on a map of
+// events keyed by track and event id. The map is a last-writer-wins CRDT:
+// each operation carries a Lamport timestamp and the site id of its author,
+// every site keeps the newest stamp it has seen for every key (including
+// removed ones), and an operation only applies when it is newer than that,
+// so all sites converge no matter in which order the operations arrive.
+// New event ids are prefixed with the site id, so they never collide.
+//
+// One instance hosts the session and relays accepted operations to the
+// others; on join, it sends a snapshot of all events of all tracks.
+// The host only listens on the interface it is told to (the loopback one
+// by default), and generates a random 128-bit token from the system's secure
+// generator, which every peer has to send in its hello message (within a few
+// seconds of connecting) before it gets anything; note that the traffic
+// itself is not encrypted, so the token only keeps out the uninvited.
+// Tracks and clips themselves are not shared: the peers are expected
+// to have the same revision checked out.
+//
+// The remote edits are applied bypassing the undo stack, so they are
+// never undone locally, but they are still journaled (as the group actions
+// that make the same changes), so that crash recovery keeps working.
+//
+// Operations for each peer are coalesced by key while the previous batch
+// is still being written, so dragging a thousand notes produces a handful
+// of batches with the latest state of each note rather than a flood.
+
+class ProjectTreeItem;
+
+#include "ProjectListener.h"
+#include "UndoAction.h"
+
+class CollaborationSession :
+    public ProjectListener,
+    private Timer
+{
+public:
+
+    explicit CollaborationSession(ProjectTreeItem &parentProject);
+    ~CollaborationSession() override;
+
+    static int getDefaultPort() noexcept;
+    static String getDefaultBindAddress();
+
+    bool host(const String &bindAddress, int port);
+    bool join(const String &hostName, int port, const String &sessionToken);
+
+    // Generated by the host, to be given to the peers
+    const String &getToken() const noexcept;
+
+    bool isHosting() const noexcept;
+    int getNumPeers() const noexcept;
+
+    //===------------------------------------------------------------------===//
+    // ProjectListener
+    //===------------------------------------------------------------------===//
+
+    void onAddMidiEvent(const MidiEvent &event) override;
+    void onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent &newEvent) override;
+    void onRemoveMidiEvent(const MidiEvent &event) override;
+
+    void onAddTrack(MidiTrack *const track) override {}
+    void onRemoveTrack(MidiTrack *const track) override {}
+    void onChangeTrackProperties(MidiTrack *const track) override {}
+
+    void onChangeProjectBeatRange(float firstBeat, float lastBeat) override {}
+    void onChangeViewBeatRange(float firstBeat, float lastBeat) override {}
+    void onReloadProjectContent(const Array<MidiTrack *> &tracks) override {}
+
+private:
+
+    class Peer;
+    class Server;
+
+    struct Stamp
+    {
+        int64 clock;
+        int siteId;
+
+        bool isNewerThan(const Stamp &other) const noexcept
+        {
+            return (this->clock != other.clock) ?
+                (this->clock > other.clock) : (this->siteId > other.siteId);
+        }
+    };
+
+    struct Operation
+    {
+        enum Kind
+        {
+            Upsert = 1,
+            Remove = 2
+        };
+
+        Kind kind;
+        String trackId;
+        String eventId;
+        Stamp stamp;
+        MemoryBlock payload; // the event in ValueTree binary form
+
+        String getKey() const
+        {
+            return this->trackId + "/" + this->eventId;
+        }
+    };
+
+    void timerCallback() override;
+
+    void start();
+    void adoptNewPeers();
+    void removeDisconnectedPeers();
+    void flushPendingOperations();
+
+    void recordLocalOperation(Operation::Kind kind, const MidiEvent &event);
+    void enqueueOperation(const Operation &operation, const Peer *exceptPeer);
+    bool acceptOperation(const Operation &operation, bool force);
+
+    static void writeOperation(OutputStream &out, const Operation &operation);
+    static bool readOperation(InputStream &in, Operation &operation);
+
+    void onPeerConnected(Peer &peer);
+    void onMessageReceived(Peer &peer, const MemoryBlock &message);
+
+    MemoryBlock createHelloMessage() const;
+    MemoryBlock createSnapshotMessage();
+
+    void applyOperations(const Array<Operation> &operations,
+        const StringArray &snapshotTrackIds);
+
+    // Also adds the group actions that would make the same changes,
+    // for the edit journal to replay them after a crash
+    template<typename TEvent, typename TSequence>
+    void applyToSequence(TSequence &sequence, const String &trackId,
+        const Array<const Operation *> &operations, bool removeMissing,
+        ReferenceCountedArray<UndoAction> &outActions);
+
+    ProjectTreeItem &project;
+
+    const int siteId;
+    int64 clock;
+    String token;
+
+    // The newest stamp seen for every track/event key
+    HashMap<String, Stamp> stamps;
+
+    ScopedPointer<Server> server;
+    OwnedArray<Peer> peers;
+
+    // Peers accepted by the server thread, not yet seen by the message thread
+    CriticalSection newPeersLock;
+    OwnedArray<Peer> newPeers;
+
+    bool isApplyingRemoteOperations;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CollaborationSession)
+};
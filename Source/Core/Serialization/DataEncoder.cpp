@@ -17,6 +17,7 @@
 
 #include "Common.h"
 #include "DataEncoder.h"
+#include "EncryptedStreams.h"
 
 static const std::string kBase64Chars =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -236,16 +237,21 @@ static inline MemoryBlock doXor(const MemoryBlock &input)
     return encoded;
 }
 
-static inline MemoryBlock compress(const String &str)
+static inline MemoryBlock compress(const void *data, size_t size)
 {
     MemoryOutputStream memOut;
     GZIPCompressorOutputStream compressMemOut(&memOut, 1, false);
-    compressMemOut.write(str.toRawUTF8(), str.getNumBytesAsUTF8());
+    compressMemOut.write(data, size);
     compressMemOut.flush();
     return MemoryBlock(memOut.getData(), memOut.getDataSize());
 }
 
-static inline String decompress(const MemoryBlock &str)
+static inline MemoryBlock compress(const String &str)
+{
+    return compress(str.toRawUTF8(), str.getNumBytesAsUTF8());
+}
+
+static inline MemoryBlock decompressBlock(const MemoryBlock &str)
 {
     MemoryInputStream input(str.getData(), str.getSize(), false);
     GZIPDecompressorInputStream gzInput(input);
@@ -258,7 +264,78 @@ static inline String decompress(const MemoryBlock &str)
         decompressedData.append(buf.getData(), data);
     }
 
-    return decompressedData.toString();
+    return decompressedData;
+}
+
+static inline String decompress(const MemoryBlock &str)
+{
+    return decompressBlock(str).toString();
+}
+
+// Files and config sections are not secret: this key is public,
+// so the authentication tags only detect corruption, not tampering
+static inline MemoryBlock getObfuscationKey()
+{
+    return MemoryBlock(kXorKey.data(), kXorKey.size());
+}
+
+static bool writeCompressedAndEncrypted(OutputStream &out, const MemoryBlock &key,
+    const void *data, size_t size)
+{
+    EncryptedOutputStream encryptedStream(&out, false, key);
+
+    {
+        GZIPCompressorOutputStream compressedStream(&encryptedStream, 1, false);
+        compressedStream.write(data, size);
+        compressedStream.flush();
+    }
+
+    return encryptedStream.finish();
+}
+
+static bool writeCompressedAndEncrypted(OutputStream &out, const MemoryBlock &key,
+    const XmlElement &xml)
+{
+    EncryptedOutputStream encryptedStream(&out, false, key);
+
+    {
+        GZIPCompressorOutputStream compressedStream(&encryptedStream, 1, false);
+        xml.writeToStream(compressedStream, "", false, true, "UTF-8", 512);
+        compressedStream.flush();
+    }
+
+    return encryptedStream.finish();
+}
+
+static bool readDecryptedAndDecompressed(InputStream &in, const MemoryBlock &key,
+    MemoryBlock &result)
+{
+    EncryptedInputStream encryptedStream(&in, false, key);
+
+    {
+        GZIPDecompressorInputStream decompressedStream(&encryptedStream, false);
+        MemoryOutputStream out(result, false);
+        out.writeFromInputStream(decompressedStream, -1);
+    }
+
+    // The compressed stream ends before the (possibly empty) last chunk
+    // has been read, but nothing can be trusted until it is verified
+    encryptedStream.skipNextBytes(std::numeric_limits<int64>::max());
+
+    if (!encryptedStream.isAuthentic())
+    {
+        Logger::writeToLog("DataEncoder: failed to authenticate the encrypted data");
+        result.reset();
+        return false;
+    }
+
+    return true;
+}
+
+static inline bool isLegacyFormat(const MemoryBlock &data)
+{
+    return (data.getSize() >= sizeof(int) &&
+        ByteOrder::littleEndianInt(data.getData()) == uint32(kMagicNumber));
 }
 
 String DataEncoder::obfuscateString(const String &buffer)
@@ -281,8 +358,6 @@ String DataEncoder::deobfuscateString(const String &buffer)
 
 bool DataEncoder::saveObfuscated(const File &file, XmlElement *xml)
 {
-    const String xmlString(xml->createDocument("", false, true, "UTF-8", 512));
-
 // Writes as plain text for debugging purposes:
 //#if defined _DEBUG
 //
@@ -292,11 +367,6 @@ bool DataEncoder::saveObfuscated(const File &file, XmlElement *xml)
 //
 //#else
     
-    const MemoryBlock &compressed = compress(xmlString);
-    const MemoryBlock &xorBlock = doXor(compressed);
-    
-    MemoryInputStream obfuscatedStream(xorBlock, false);
-    
     if (! file.existsAsFile())
     {
         Result creationResult = file.create();
@@ -310,11 +380,11 @@ bool DataEncoder::saveObfuscated(const File &file, XmlElement *xml)
     
     if (out != nullptr)
     {
-        out->writeInt(kMagicNumber);
-        out->writeFromInputStream(obfuscatedStream, -1);
-        out->flush();
-        
-        if (tempFile.overwriteTargetFileWithTemporary())
+        // Compressed and encrypted on the fly, without a full text copy of the document
+        const bool written = writeCompressedAndEncrypted(*out, getObfuscationKey(), *xml);
+        out = nullptr;
+
+        if (written && tempFile.overwriteTargetFileWithTemporary())
         {
             return true;
         }
@@ -351,6 +421,7 @@ XmlElement *DataEncoder::loadObfuscated(const File &file)
         
         if (magicNumber == kMagicNumber)
         {
+            // Legacy format, still readable
             SubregionStream subStream(&fileStream, 4, -1, false);
             MemoryBlock subBlock;
             subStream.readIntoMemoryBlock(subBlock);
@@ -359,6 +430,13 @@ XmlElement *DataEncoder::loadObfuscated(const File &file)
             XmlElement *xml = XmlDocument::parse(uncompressed);
             return xml;
         }
+
+        MemoryBlock decrypted;
+        if (fileStream.setPosition(0) &&
+            readDecryptedAndDecompressed(fileStream, getObfuscationKey(), decrypted))
+        {
+            return XmlDocument::parse(decrypted.toString());
+        }
     }
     
     return nullptr;
@@ -366,10 +444,73 @@ XmlElement *DataEncoder::loadObfuscated(const File &file)
 //#endif
 }
 
-#define KEY_BLOCK_SIZE 64
+MemoryBlock DataEncoder::obfuscateBlock(const MemoryBlock &data)
+{
+    MemoryBlock result;
+    MemoryOutputStream out(result, false);
+    writeCompressedAndEncrypted(out, getObfuscationKey(), data.getData(), data.getSize());
+    out.flush();
+    return result;
+}
+
+MemoryBlock DataEncoder::deobfuscateBlock(const MemoryBlock &data)
+{
+    // Legacy blocks always start with a xor'ed gzip header, which never matches the magic
+    if (!EncryptedOutputStream::isEncrypted(data.getData(), data.getSize()))
+    {
+        return decompressBlock(doXor(data));
+    }
+
+    MemoryBlock result;
+    MemoryInputStream in(data, false);
+    readDecryptedAndDecompressed(in, getObfuscationKey(), result);
+    return result;
+}
 
 MemoryBlock DataEncoder::encryptXml(const XmlElement &xmlTarget,
+        const MemoryBlock &key, SyncFormat format)
+{
+    MemoryBlock result;
+    MemoryOutputStream out(result, false);
+    writeEncryptedXml(xmlTarget, key, out, format);
+    out.flush();
+    return result;
+}
+
+bool DataEncoder::writeEncryptedXml(const XmlElement &xmlTarget,
+        const MemoryBlock &key, OutputStream &out, SyncFormat format)
+{
+    if (format == LegacySyncFormat)
+    {
+        return writeLegacyEncryptedXml(xmlTarget, key, out);
+    }
+
+    return writeCompressedAndEncrypted(out, key, xmlTarget);
+}
+
+XmlElement *DataEncoder::createDecryptedXml(const MemoryBlock &buffer,
         const MemoryBlock &key)
+{
+    if (isLegacyFormat(buffer))
+    {
+        return createDecryptedLegacyXml(buffer, key);
+    }
+
+    MemoryBlock decrypted;
+    MemoryInputStream in(buffer, false);
+    if (readDecryptedAndDecompressed(in, key, decrypted))
+    {
+        return XmlDocument::parse(decrypted.toString());
+    }
+
+    return nullptr;
+}
+
+#define KEY_BLOCK_SIZE 64
+
+// The format that all clients can read, see SyncFormat
+bool DataEncoder::writeLegacyEncryptedXml(const XmlElement &xmlTarget,
+        const MemoryBlock &key, OutputStream &out)
 {
     const String xmlString = xmlTarget.createDocument("", false, true, "UTF-8", 512);
     MemoryBlock compressed = compress(xmlString);
@@ -381,9 +522,6 @@ MemoryBlock DataEncoder::encryptXml(const XmlElement &xmlTarget,
     MemoryInputStream xmlStream(compressed, false);
     MemoryInputStream keyStream(key, false);
 
-    MemoryBlock cipher;
-    MemoryOutputStream cipherStream(cipher, false);
-
     int currentCrypter = 0;
     OwnedArray<BlowFish> crypters;
 
@@ -398,7 +536,10 @@ MemoryBlock DataEncoder::encryptXml(const XmlElement &xmlTarget,
 
     jassert(crypters.size() > 0);
 
-    cipherStream.writeInt(kMagicNumber);
+    if (crypters.size() == 0 || !out.writeInt(kMagicNumber))
+    {
+        return false;
+    }
 
     while (!xmlStream.isExhausted())
     {
@@ -411,17 +552,18 @@ MemoryBlock DataEncoder::encryptXml(const XmlElement &xmlTarget,
         if (currentCrypter >= crypters.size())
         { currentCrypter = 0; }
 
-        cipherStream.writeInt(int1);
-        cipherStream.writeInt(int2);
+        if (!out.writeInt(int1) || !out.writeInt(int2))
+        {
+            return false;
+        }
     }
 
-    // если этого не сделать, размер блока будет больше необходимого
-    cipherStream.flush();
-
-    return cipher;
+    out.flush();
+    return true;
 }
 
-XmlElement *DataEncoder::createDecryptedXml(const MemoryBlock &buffer,
+// Sync payloads used to be encrypted with a rotation of BlowFish keys
+XmlElement *DataEncoder::createDecryptedLegacyXml(const MemoryBlock &buffer,
         const MemoryBlock &key)
 {
     MemoryInputStream bufferStream(buffer, false);
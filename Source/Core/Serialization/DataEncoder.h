@@ -24,13 +24,47 @@ public:
     static String obfuscateString(const String &buffer);
     static String deobfuscateString(const String &buffer);
 
+    // Files and blocks are compressed and sealed with EncryptedOutputStream;
+    // the legacy xor'ed files and blocks can still be read.
+    // Note that the key here is derived from a constant built into the app,
+    // so this only detects accidental corruption: the files are neither
+    // confidential nor protected against deliberate tampering.
     static bool saveObfuscated(const File &file, XmlElement *xml);
     static XmlElement *loadObfuscated(const File &file);
 
-    // Blowfish stuff
+    // Raw blocks, used for sectioned files (see Config)
+    static MemoryBlock obfuscateBlock(const MemoryBlock &data);
+    static MemoryBlock deobfuscateBlock(const MemoryBlock &data);
+
+    // Sync payloads are encrypted with the project key.
+    // The sealed format (authenticated encryption) cannot be read by older
+    // clients, so it is only pushed when the remote accepts it, see PushThread;
+    // createDecryptedXml reads both formats, and returns nullptr
+    // if the key is wrong or the sealed data was tampered with
+    enum SyncFormat
+    {
+        LegacySyncFormat = 1, // BlowFish, readable by every client
+        SealedSyncFormat = 2
+    };
+
     static MemoryBlock encryptXml(const XmlElement &xmlTarget,
-                                  const MemoryBlock &key);
+                                  const MemoryBlock &key,
+                                  SyncFormat format);
+
+    static bool writeEncryptedXml(const XmlElement &xmlTarget,
+                                  const MemoryBlock &key,
+                                  OutputStream &out,
+                                  SyncFormat format);
 
     static XmlElement *createDecryptedXml(const MemoryBlock &buffer,
                                           const MemoryBlock &key);
+
+private:
+
+    static bool writeLegacyEncryptedXml(const XmlElement &xmlTarget,
+                                        const MemoryBlock &key,
+                                        OutputStream &out);
+
+    static XmlElement *createDecryptedLegacyXml(const MemoryBlock &buffer,
+                                                const MemoryBlock &key);
 };
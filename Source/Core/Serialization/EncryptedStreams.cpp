@@ -0,0 +1,656 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "EncryptedStreams.h"
+
+#define ENCRYPTED_STREAM_CHUNK_SIZE (64 * 1024)
+#define ENCRYPTED_STREAM_MAX_CHUNK_SIZE (16 * 1024 * 1024)
+#define ENCRYPTED_STREAM_HEADER_SIZE 15
+#define ENCRYPTED_STREAM_TAG_SIZE 16
+#define CHACHA_LANES 4
+
+static const uint32 kEncryptedMagicNumber = ByteOrder::littleEndianInt("HAE1");
+
+namespace
+{
+    inline uint32 loadLittleEndian(const uint8 *p) noexcept
+    {
+        return uint32(p[0]) | (uint32(p[1]) << 8) | (uint32(p[2]) << 16) | (uint32(p[3]) << 24);
+    }
+
+    inline void storeLittleEndian(uint8 *p, uint32 v) noexcept
+    {
+        p[0] = uint8(v);
+        p[1] = uint8(v >> 8);
+        p[2] = uint8(v >> 16);
+        p[3] = uint8(v >> 24);
+    }
+
+    inline uint32 rotateLeft(uint32 v, int n) noexcept
+    {
+        return (v << n) | (v >> (32 - n));
+    }
+
+    //===------------------------------------------------------------------===//
+    // ChaCha20 (RFC 8439)
+    //===------------------------------------------------------------------===//
+
+    struct ChaCha20
+    {
+        uint32 input[16];
+
+        ChaCha20(const uint8 *key, const uint8 *nonce, uint32 counter) noexcept
+        {
+            this->input[0] = 0x61707865;
+            this->input[1] = 0x3320646e;
+            this->input[2] = 0x79622d32;
+            this->input[3] = 0x6b206574;
+
+            for (int i = 0; i < 8; ++i)
+            {
+                this->input[4 + i] = loadLittleEndian(key + i * 4);
+            }
+
+            this->input[12] = counter;
+            this->input[13] = loadLittleEndian(nonce);
+            this->input[14] = loadLittleEndian(nonce + 4);
+            this->input[15] = loadLittleEndian(nonce + 8);
+        }
+
+        // Generates several consecutive blocks at once; the state is laid out
+        // word-major, so that the inner loops over the lanes are plain
+        // element-wise operations the compiler turns into SSE2/NEON code
+        void generateBlocks(uint8 *keyStream) noexcept
+        {
+            uint32 x[16][CHACHA_LANES];
+
+            for (int w = 0; w < 16; ++w)
+            {
+                for (int lane = 0; lane < CHACHA_LANES; ++lane)
+                {
+                    x[w][lane] = this->input[w];
+                }
+            }
+
+            for (int lane = 0; lane < CHACHA_LANES; ++lane)
+            {
+                x[12][lane] += uint32(lane);
+            }
+
+#define CHACHA_QUARTER_ROUND(a, b, c, d) \
+            for (int lane = 0; lane < CHACHA_LANES; ++lane) \
+            { \
+                x[a][lane] += x[b][lane]; x[d][lane] = rotateLeft(x[d][lane] ^ x[a][lane], 16); \
+                x[c][lane] += x[d][lane]; x[b][lane] = rotateLeft(x[b][lane] ^ x[c][lane], 12); \
+                x[a][lane] += x[b][lane]; x[d][lane] = rotateLeft(x[d][lane] ^ x[a][lane], 8); \
+                x[c][lane] += x[d][lane]; x[b][lane] = rotateLeft(x[b][lane] ^ x[c][lane], 7); \
+            }
+
+            for (int round = 0; round < 10; ++round)
+            {
+                CHACHA_QUARTER_ROUND(0, 4, 8, 12)
+                CHACHA_QUARTER_ROUND(1, 5, 9, 13)
+                CHACHA_QUARTER_ROUND(2, 6, 10, 14)
+                CHACHA_QUARTER_ROUND(3, 7, 11, 15)
+                CHACHA_QUARTER_ROUND(0, 5, 10, 15)
+                CHACHA_QUARTER_ROUND(1, 6, 11, 12)
+                CHACHA_QUARTER_ROUND(2, 7, 8, 13)
+                CHACHA_QUARTER_ROUND(3, 4, 9, 14)
+            }
+
+#undef CHACHA_QUARTER_ROUND
+
+            for (int lane = 0; lane < CHACHA_LANES; ++lane)
+            {
+                for (int w = 0; w < 16; ++w)
+                {
+                    const uint32 initial = this->input[w] + ((w == 12) ? uint32(lane) : 0);
+                    storeLittleEndian(keyStream + lane * 64 + w * 4, x[w][lane] + initial);
+                }
+            }
+
+            this->input[12] += CHACHA_LANES;
+        }
+
+        void process(uint8 *data, size_t size) noexcept
+        {
+            uint8 keyStream[64 * CHACHA_LANES];
+
+            while (size > 0)
+            {
+                this->generateBlocks(keyStream);
+                const size_t numBytes = jmin(size, sizeof(keyStream));
+
+                for (size_t i = 0; i < numBytes; ++i)
+                {
+                    data[i] ^= keyStream[i];
+                }
+
+                data += numBytes;
+                size -= numBytes;
+            }
+        }
+    };
+
+    //===------------------------------------------------------------------===//
+    // Poly1305 (RFC 8439), 26-bit limbs
+    //===------------------------------------------------------------------===//
+
+    class Poly1305
+    {
+    public:
+
+        explicit Poly1305(const uint8 *key) noexcept
+        {
+            this->r[0] = (loadLittleEndian(key + 0)) & 0x3ffffff;
+            this->r[1] = (loadLittleEndian(key + 3) >> 2) & 0x3ffff03;
+            this->r[2] = (loadLittleEndian(key + 6) >> 4) & 0x3ffc0ff;
+            this->r[3] = (loadLittleEndian(key + 9) >> 6) & 0x3f03fff;
+            this->r[4] = (loadLittleEndian(key + 12) >> 8) & 0x00fffff;
+
+            for (int i = 0; i < 4; ++i)
+            {
+                this->pad[i] = loadLittleEndian(key + 16 + i * 4);
+            }
+        }
+
+        void update(const uint8 *data, size_t size) noexcept
+        {
+            if (this->numLeftover > 0)
+            {
+                const size_t numBytes = jmin(size, size_t(16 - this->numLeftover));
+                memcpy(this->leftover + this->numLeftover, data, numBytes);
+                this->numLeftover += numBytes;
+                data += numBytes;
+                size -= numBytes;
+
+                if (this->numLeftover < 16)
+                {
+                    return;
+                }
+
+                this->processBlocks(this->leftover, 16, 1 << 24);
+                this->numLeftover = 0;
+            }
+
+            const size_t numFullBytes = size & ~size_t(15);
+            this->processBlocks(data, numFullBytes, 1 << 24);
+            data += numFullBytes;
+            size -= numFullBytes;
+
+            memcpy(this->leftover, data, size);
+            this->numLeftover = size;
+        }
+
+        // Aligns the input to 16 bytes with zeros, as the AEAD construction requires
+        void padToBlock() noexcept
+        {
+            if (this->numLeftover > 0)
+            {
+                const uint8 zeros[16] = { 0 };
+                this->update(zeros, 16 - this->numLeftover);
+            }
+        }
+
+        void finish(uint8 *tag) noexcept
+        {
+            if (this->numLeftover > 0)
+            {
+                this->leftover[this->numLeftover] = 1;
+                memset(this->leftover + this->numLeftover + 1, 0, 15 - this->numLeftover);
+                this->processBlocks(this->leftover, 16, 0);
+            }
+
+            uint32 h0 = this->h[0], h1 = this->h[1], h2 = this->h[2], h3 = this->h[3], h4 = this->h[4];
+
+            uint32 c = h1 >> 26; h1 &= 0x3ffffff;
+            h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+            h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+            h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+            h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+            h1 += c;
+
+            // Computes h - p and selects it in constant time if it is not negative
+            uint32 g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+            uint32 g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+            uint32 g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+            uint32 g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+            uint32 g4 = h4 + c - (1u << 26);
+
+            uint32 mask = (g4 >> 31) - 1;
+            h0 = (h0 & ~mask) | (g0 & mask);
+            h1 = (h1 & ~mask) | (g1 & mask);
+            h2 = (h2 & ~mask) | (g2 & mask);
+            h3 = (h3 & ~mask) | (g3 & mask);
+            h4 = (h4 & ~mask) | (g4 & mask);
+
+            h0 = (h0 | (h1 << 26));
+            h1 = ((h1 >> 6) | (h2 << 20));
+            h2 = ((h2 >> 12) | (h3 << 14));
+            h3 = ((h3 >> 18) | (h4 << 8));
+
+            uint64 f = uint64(h0) + this->pad[0];
+            storeLittleEndian(tag, uint32(f));
+            f = uint64(h1) + this->pad[1] + (f >> 32);
+            storeLittleEndian(tag + 4, uint32(f));
+            f = uint64(h2) + this->pad[2] + (f >> 32);
+            storeLittleEndian(tag + 8, uint32(f));
+            f = uint64(h3) + this->pad[3] + (f >> 32);
+            storeLittleEndian(tag + 12, uint32(f));
+        }
+
+    private:
+
+        void processBlocks(const uint8 *data, size_t size, uint32 hibit) noexcept
+        {
+            const uint32 r0 = this->r[0], r1 = this->r[1], r2 = this->r[2], r3 = this->r[3], r4 = this->r[4];
+            const uint32 s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+            uint32 h0 = this->h[0], h1 = this->h[1], h2 = this->h[2], h3 = this->h[3], h4 = this->h[4];
+
+            for (; size >= 16; size -= 16, data += 16)
+            {
+                h0 += (loadLittleEndian(data + 0)) & 0x3ffffff;
+                h1 += (loadLittleEndian(data + 3) >> 2) & 0x3ffffff;
+                h2 += (loadLittleEndian(data + 6) >> 4) & 0x3ffffff;
+                h3 += (loadLittleEndian(data + 9) >> 6) & 0x3ffffff;
+                h4 += (loadLittleEndian(data + 12) >> 8) | hibit;
+
+                const uint64 d0 = uint64(h0) * r0 + uint64(h1) * s4 + uint64(h2) * s3 + uint64(h3) * s2 + uint64(h4) * s1;
+                uint64 d1 = uint64(h0) * r1 + uint64(h1) * r0 + uint64(h2) * s4 + uint64(h3) * s3 + uint64(h4) * s2;
+                uint64 d2 = uint64(h0) * r2 + uint64(h1) * r1 + uint64(h2) * r0 + uint64(h3) * s4 + uint64(h4) * s3;
+                uint64 d3 = uint64(h0) * r3 + uint64(h1) * r2 + uint64(h2) * r1 + uint64(h3) * r0 + uint64(h4) * s4;
+                uint64 d4 = uint64(h0) * r4 + uint64(h1) * r3 + uint64(h2) * r2 + uint64(h3) * r1 + uint64(h4) * r0;
+
+                uint32 c = uint32(d0 >> 26); h0 = uint32(d0) & 0x3ffffff;
+                d1 += c; c = uint32(d1 >> 26); h1 = uint32(d1) & 0x3ffffff;
+                d2 += c; c = uint32(d2 >> 26); h2 = uint32(d2) & 0x3ffffff;
+                d3 += c; c = uint32(d3 >> 26); h3 = uint32(d3) & 0x3ffffff;
+                d4 += c; c = uint32(d4 >> 26); h4 = uint32(d4) & 0x3ffffff;
+                h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+                h1 += c;
+            }
+
+            this->h[0] = h0; this->h[1] = h1; this->h[2] = h2; this->h[3] = h3; this->h[4] = h4;
+        }
+
+        uint32 r[5];
+        uint32 h[5] = { 0, 0, 0, 0, 0 };
+        uint32 pad[4];
+
+        uint8 leftover[16];
+        size_t numLeftover = 0;
+
+    };
+
+    //===------------------------------------------------------------------===//
+    // AEAD construction (RFC 8439)
+    //===------------------------------------------------------------------===//
+
+    void computeTag(const uint8 *key, const uint8 *nonce,
+        const uint8 *aad, size_t aadSize,
+        const uint8 *cipherText, size_t size, uint8 *tag) noexcept
+    {
+        uint8 polyKey[64] = { 0 };
+        ChaCha20(key, nonce, 0).process(polyKey, sizeof(polyKey));
+
+        uint8 lengths[16];
+        storeLittleEndian(lengths, uint32(aadSize));
+        storeLittleEndian(lengths + 4, 0);
+        storeLittleEndian(lengths + 8, uint32(uint64(size)));
+        storeLittleEndian(lengths + 12, uint32(uint64(size) >> 32));
+
+        Poly1305 poly(polyKey);
+        poly.update(aad, aadSize);
+        poly.padToBlock();
+        poly.update(cipherText, size);
+        poly.padToBlock();
+        poly.update(lengths, sizeof(lengths));
+        poly.finish(tag);
+
+        zeromem(polyKey, sizeof(polyKey));
+    }
+
+    void seal(const uint8 *key, const uint8 *nonce,
+        const uint8 *aad, size_t aadSize,
+        uint8 *data, size_t size, uint8 *tag) noexcept
+    {
+        ChaCha20(key, nonce, 1).process(data, size);
+        computeTag(key, nonce, aad, aadSize, data, size, tag);
+    }
+
+    bool open(const uint8 *key, const uint8 *nonce,
+        const uint8 *aad, size_t aadSize,
+        uint8 *data, size_t size, const uint8 *tag) noexcept
+    {
+        uint8 expectedTag[ENCRYPTED_STREAM_TAG_SIZE];
+        computeTag(key, nonce, aad, aadSize, data, size, expectedTag);
+
+        // Constant time comparison
+        uint8 difference = 0;
+        for (int i = 0; i < ENCRYPTED_STREAM_TAG_SIZE; ++i)
+        {
+            difference |= (expectedTag[i] ^ tag[i]);
+        }
+
+        if (difference != 0)
+        {
+            return false;
+        }
+
+        ChaCha20(key, nonce, 1).process(data, size);
+        return true;
+    }
+
+    void makeNonce(uint8 *nonce, const uint8 *header, uint32 chunkIndex, bool isLastChunk) noexcept
+    {
+        memcpy(nonce, header + 8, 7);
+        nonce[7] = uint8(chunkIndex >> 24);
+        nonce[8] = uint8(chunkIndex >> 16);
+        nonce[9] = uint8(chunkIndex >> 8);
+        nonce[10] = uint8(chunkIndex);
+        nonce[11] = isLastChunk ? 1 : 0;
+    }
+
+    // Network streams may return less than asked for
+    size_t readFully(InputStream *stream, uint8 *dest, size_t numBytes)
+    {
+        size_t numRead = 0;
+        while (numRead < numBytes)
+        {
+            const int numBytesRead = stream->read(dest + numRead, int(numBytes - numRead));
+            if (numBytesRead <= 0)
+            {
+                break;
+            }
+
+            numRead += size_t(numBytesRead);
+        }
+
+        return numRead;
+    }
+
+    void deriveKey(uint8 *result, const MemoryBlock &key)
+    {
+        const MemoryBlock hash(SHA256(key).getRawData());
+        jassert(hash.getSize() == 32);
+        memcpy(result, hash.getData(), 32);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// EncryptedOutputStream
+//===----------------------------------------------------------------------===//
+
+EncryptedOutputStream::EncryptedOutputStream(OutputStream *destStream,
+    bool deleteDestStreamWhenDestroyed, const MemoryBlock &key) :
+    destination(destStream, deleteDestStreamWhenDestroyed),
+    buffer(ENCRYPTED_STREAM_CHUNK_SIZE + ENCRYPTED_STREAM_TAG_SIZE),
+    numBuffered(0),
+    chunkIndex(0),
+    position(0),
+    finished(false),
+    failed(false)
+{
+    deriveKey(this->key, key);
+
+    // Nonces only need to be unique, not unpredictable
+    Random random;
+    random.setSeedRandomly();
+    random.combineSeed(Time::getHighResolutionTicks());
+
+    storeLittleEndian(this->header, kEncryptedMagicNumber);
+    storeLittleEndian(this->header + 4, ENCRYPTED_STREAM_CHUNK_SIZE);
+    for (int i = 8; i < ENCRYPTED_STREAM_HEADER_SIZE; ++i)
+    {
+        this->header[i] = uint8(random.nextInt(256));
+    }
+
+    this->failed = !this->destination->write(this->header, ENCRYPTED_STREAM_HEADER_SIZE);
+}
+
+EncryptedOutputStream::~EncryptedOutputStream()
+{
+    this->finish();
+    zeromem(this->key, sizeof(this->key));
+}
+
+bool EncryptedOutputStream::finish()
+{
+    if (!this->finished)
+    {
+        this->writeChunk(true);
+        this->destination->flush();
+        this->finished = true;
+    }
+
+    return !this->failed;
+}
+
+void EncryptedOutputStream::flush()
+{
+    // Doesn't seal the pending chunk, since a flush is not an end of stream
+    this->destination->flush();
+}
+
+int64 EncryptedOutputStream::getPosition()
+{
+    return this->position;
+}
+
+bool EncryptedOutputStream::setPosition(int64 newPosition)
+{
+    return (newPosition == this->position);
+}
+
+bool EncryptedOutputStream::write(const void *data, size_t numBytes)
+{
+    jassert(!this->finished);
+    if (this->finished || this->failed)
+    {
+        return false;
+    }
+
+    const uint8 *source = static_cast<const uint8 *>(data);
+    while (numBytes > 0)
+    {
+        // A full chunk is only sealed when more data arrives,
+        // so that the last chunk is never an empty one following it
+        if (this->numBuffered == ENCRYPTED_STREAM_CHUNK_SIZE &&
+            !this->writeChunk(false))
+        {
+            return false;
+        }
+
+        const size_t numToCopy = jmin(numBytes, size_t(ENCRYPTED_STREAM_CHUNK_SIZE) - this->numBuffered);
+        memcpy(this->buffer + this->numBuffered, source, numToCopy);
+        this->numBuffered += numToCopy;
+        this->position += numToCopy;
+        source += numToCopy;
+        numBytes -= numToCopy;
+    }
+
+    return true;
+}
+
+bool EncryptedOutputStream::writeChunk(bool isLastChunk)
+{
+    if (this->failed)
+    {
+        return false;
+    }
+
+    uint8 nonce[12];
+    makeNonce(nonce, this->header, this->chunkIndex, isLastChunk);
+
+    uint8 *tag = this->buffer + this->numBuffered;
+    seal(this->key, nonce, this->header, ENCRYPTED_STREAM_HEADER_SIZE,
+        this->buffer, this->numBuffered, tag);
+
+    this->failed = !this->destination->write(this->buffer,
+        this->numBuffered + ENCRYPTED_STREAM_TAG_SIZE);
+
+    this->numBuffered = 0;
+    this->chunkIndex++;
+    jassert(this->chunkIndex != 0);
+
+    return !this->failed;
+}
+
+bool EncryptedOutputStream::isEncrypted(const void *data, size_t numBytes) noexcept
+{
+    return (numBytes >= ENCRYPTED_STREAM_HEADER_SIZE &&
+        loadLittleEndian(static_cast<const uint8 *>(data)) == kEncryptedMagicNumber);
+}
+
+//===----------------------------------------------------------------------===//
+// EncryptedInputStream
+//===----------------------------------------------------------------------===//
+
+EncryptedInputStream::EncryptedInputStream(InputStream *sourceStream,
+    bool deleteSourceStreamWhenDestroyed, const MemoryBlock &key) :
+    source(sourceStream, deleteSourceStreamWhenDestroyed),
+    chunkSize(0),
+    numAvailable(0),
+    readPosition(0),
+    chunkIndex(0),
+    position(0),
+    lastChunkRead(false),
+    failed(true)
+{
+    deriveKey(this->key, key);
+
+    if (readFully(this->source, this->header, ENCRYPTED_STREAM_HEADER_SIZE) != ENCRYPTED_STREAM_HEADER_SIZE ||
+        !EncryptedOutputStream::isEncrypted(this->header, ENCRYPTED_STREAM_HEADER_SIZE))
+    {
+        return;
+    }
+
+    this->chunkSize = loadLittleEndian(this->header + 4);
+    if (this->chunkSize == 0 || this->chunkSize > ENCRYPTED_STREAM_MAX_CHUNK_SIZE)
+    {
+        return;
+    }
+
+    this->buffer.malloc(this->chunkSize + ENCRYPTED_STREAM_TAG_SIZE);
+    this->failed = false;
+}
+
+bool EncryptedInputStream::isAuthentic() const noexcept
+{
+    return this->lastChunkRead && !this->failed;
+}
+
+bool EncryptedInputStream::hasFailed() const noexcept
+{
+    return this->failed;
+}
+
+int64 EncryptedInputStream::getTotalLength()
+{
+    return -1;
+}
+
+bool EncryptedInputStream::isExhausted()
+{
+    return this->failed ||
+        (this->lastChunkRead && this->readPosition == this->numAvailable);
+}
+
+int EncryptedInputStream::read(void *destBuffer, int maxBytesToRead)
+{
+    uint8 *dest = static_cast<uint8 *>(destBuffer);
+    int numRead = 0;
+
+    while (numRead < maxBytesToRead)
+    {
+        if (this->readPosition == this->numAvailable && !this->readChunk())
+        {
+            break;
+        }
+
+        const size_t numToCopy = jmin(size_t(maxBytesToRead - numRead),
+            this->numAvailable - this->readPosition);
+
+        memcpy(dest + numRead, this->buffer + this->readPosition, numToCopy);
+        this->readPosition += numToCopy;
+        numRead += int(numToCopy);
+    }
+
+    this->position += numRead;
+    return numRead;
+}
+
+int64 EncryptedInputStream::getPosition()
+{
+    return this->position;
+}
+
+bool EncryptedInputStream::setPosition(int64 newPosition)
+{
+    if (newPosition < this->position)
+    {
+        return false;
+    }
+
+    this->skipNextBytes(newPosition - this->position);
+    return (newPosition == this->position);
+}
+
+bool EncryptedInputStream::readChunk()
+{
+    if (this->failed || this->lastChunkRead)
+    {
+        return false;
+    }
+
+    const size_t numWanted = this->chunkSize + ENCRYPTED_STREAM_TAG_SIZE;
+    const size_t numRead = readFully(this->source, this->buffer, numWanted);
+
+    if (numRead < ENCRYPTED_STREAM_TAG_SIZE)
+    {
+        // Truncated: the last chunk is missing
+        this->failed = true;
+        return false;
+    }
+
+    const bool isLastChunk = (numRead < numWanted) || this->source->isExhausted();
+    const size_t size = numRead - ENCRYPTED_STREAM_TAG_SIZE;
+
+    if (size == 0 && !isLastChunk)
+    {
+        // Never written, and would stall the readers
+        this->failed = true;
+        return false;
+    }
+
+    uint8 nonce[12];
+    makeNonce(nonce, this->header, this->chunkIndex, isLastChunk);
+
+    if (!open(this->key, nonce, this->header, ENCRYPTED_STREAM_HEADER_SIZE,
+        this->buffer, size, this->buffer + size))
+    {
+        this->failed = true;
+        return false;
+    }
+
+    this->chunkIndex++;
+    this->numAvailable = size;
+    this->readPosition = 0;
+    this->lastChunkRead = isLastChunk;
+    return (size > 0);
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Authenticated encryption for files and sync payloads.
+//
+// The data is split into chunks, and every chunk is sealed separately
+// with ChaCha20-Poly1305 (RFC 8439), so neither side ever has to hold
+// the whole payload in memory. Each chunk's nonce is made of a random
+// per-stream prefix, the chunk index and a flag marking the last chunk,
+// which means reordered, duplicated or truncated chunks fail to verify.
+//
+// Stream layout:
+//   magic (4) | chunk size (4) | nonce prefix (7) | chunks...
+//   chunk: ciphertext (up to chunk size) | tag (16)
+// The header is authenticated as associated data of every chunk.
+//
+// The streams are only as secret as their key: with a key that ships
+// with the app (as for project files and config, see DataEncoder)
+// the tags just detect corruption, anyone can still read and re-seal the data.
+
+class EncryptedOutputStream final : public OutputStream
+{
+public:
+
+    // The key can be of any length, it is hashed into a 256-bit one
+    EncryptedOutputStream(OutputStream *destStream,
+        bool deleteDestStreamWhenDestroyed,
+        const MemoryBlock &key);
+
+    // Calls finish(), if that hasn't been done yet
+    ~EncryptedOutputStream() override;
+
+    // Seals the last chunk; nothing can be written afterwards.
+    // Returns false if any of the writes has failed.
+    bool finish();
+
+    void flush() override;
+    int64 getPosition() override;
+    bool setPosition(int64 newPosition) override;
+    bool write(const void *data, size_t numBytes) override;
+
+    static bool isEncrypted(const void *data, size_t numBytes) noexcept;
+
+private:
+
+    bool writeChunk(bool isLastChunk);
+
+    OptionalScopedPointer<OutputStream> destination;
+
+    HeapBlock<uint8> buffer;
+    size_t numBuffered;
+
+    uint8 key[32];
+    uint8 header[15];
+    uint32 chunkIndex;
+
+    int64 position;
+    bool finished;
+    bool failed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EncryptedOutputStream)
+};
+
+class EncryptedInputStream final : public InputStream
+{
+public:
+
+    EncryptedInputStream(InputStream *sourceStream,
+        bool deleteSourceStreamWhenDestroyed,
+        const MemoryBlock &key);
+
+    // True if everything up to the last chunk has been read and verified;
+    // the data read so far is only trustworthy when this returns true
+    bool isAuthentic() const noexcept;
+
+    bool hasFailed() const noexcept;
+
+    int64 getTotalLength() override;
+    bool isExhausted() override;
+    int read(void *destBuffer, int maxBytesToRead) override;
+    int64 getPosition() override;
+
+    // Only skipping forward is supported
+    bool setPosition(int64 newPosition) override;
+
+private:
+
+    bool readChunk();
+
+    OptionalScopedPointer<InputStream> source;
+
+    HeapBlock<uint8> buffer;
+    size_t chunkSize;
+    size_t numAvailable;
+    size_t readPosition;
+
+    uint8 key[32];
+    uint8 header[15];
+    uint32 chunkIndex;
+
+    int64 position;
+    bool lastChunkRead;
+    bool failed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EncryptedInputStream)
+};
@@ -0,0 +1,553 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "MusicXmlExporter.h"
+#include "XmlStreamWriter.h"
+#include "ProjectTreeItem.h"
+#include "ProjectTimeline.h"
+#include "PianoSequence.h"
+#include "AnnotationEvent.h"
+#include "TimeSignatureEvent.h"
+#include "KeySignatureEvent.h"
+#include "Note.h"
+
+// Positions are in divisions of a quarter note (that is, of a beat):
+// 96 is enough for 128th notes and triplets of 64th notes
+#define MUSICXML_DIVISIONS 96
+
+// MusicXML's default dynamics (forte) is 90 out of 127
+#define MUSICXML_DEFAULT_VELOCITY (90.f / 128.f)
+
+#define MUSICXML_DOCTYPE "<!DOCTYPE score-partwise PUBLIC \"-//Recordare//DTD MusicXML 3.1 Partwise//EN\" \"http://www.musicxml.org/dtds/partwise.dtd\">"
+
+static inline int beatToPosition(float beat) noexcept
+{
+    return roundToInt(double(beat) * MUSICXML_DIVISIONS);
+}
+
+MusicXmlExporter::MusicXmlExporter(const ProjectTreeItem &project) :
+    project(project),
+    lastPosition(0) {}
+
+bool MusicXmlExporter::exportFile(const File &file)
+{
+    file.deleteFile();
+    FileOutputStream out(file);
+
+    if (out.failedToOpen())
+    {
+        Logger::writeToLog("Cannot write " + file.getFullPathName());
+        return false;
+    }
+
+    return this->exportTo(out);
+}
+
+bool MusicXmlExporter::exportTo(OutputStream &output)
+{
+    this->lastPosition = 0;
+    this->collectParts();
+    this->collectDirections();
+    this->collectMeasures();
+
+    XmlStreamWriter writer(output);
+    writer.writeHeader(MUSICXML_DOCTYPE);
+
+    writer.startElement("score-partwise").withAttribute("version", "3.1");
+
+    writer.startElement("work");
+    writer.writeElement("work-title", this->project.getName());
+    writer.endElement();
+
+    writer.startElement("identification");
+    writer.startElement("encoding");
+    writer.writeElement("software", "Helio Workstation");
+    writer.writeElement("encoding-date", Time::getCurrentTime().formatted("%Y-%m-%d"));
+    writer.endElement();
+    writer.endElement();
+
+    writer.startElement("part-list");
+    for (int i = 0; i < this->parts.size(); ++i)
+    {
+        writer.startElement("score-part").withAttribute("id", "P" + String(i + 1));
+        writer.writeElement("part-name", this->parts[i]->name);
+        writer.endElement();
+    }
+    writer.endElement();
+
+    for (int i = 0; i < this->parts.size(); ++i)
+    {
+        this->writePart(writer, i);
+    }
+
+    writer.endElement();
+
+    const bool writtenOk = writer.isOk();
+    this->parts.clear();
+    this->measures.clearQuick();
+    this->directions.clearQuick();
+    return writtenOk;
+}
+
+//===----------------------------------------------------------------------===//
+// Layout
+//===----------------------------------------------------------------------===//
+
+void MusicXmlExporter::collectParts()
+{
+    this->parts.clear();
+
+    for (const auto track : this->project.getTracks())
+    {
+        const PianoSequence *sequence = dynamic_cast<const PianoSequence *>(track->getSequence());
+        if (sequence == nullptr)
+        {
+            continue;
+        }
+
+        Part *part = new Part();
+        part->name = track->getTrackName();
+        this->parts.add(part);
+
+        // The notes are sorted by beat, so the chords (the notes with the same
+        // start and end) are built from the runs of the notes with the same start
+        Array<Chord> chords;
+        int runStart = 0;
+
+        for (int i = 0; i < sequence->size(); ++i)
+        {
+            const Note *note = static_cast<const Note *>(sequence->getUnchecked(i));
+            const int start = beatToPosition(note->getBeat());
+            const int end = jmax(start + 1, beatToPosition(note->getBeat() + note->getLength()));
+            this->lastPosition = jmax(this->lastPosition, end);
+
+            if (chords.size() == 0 || chords.getLast().start != start)
+            {
+                runStart = chords.size();
+            }
+
+            bool isAdded = false;
+            for (int j = runStart; j < chords.size(); ++j)
+            {
+                if (chords.getReference(j).end == end)
+                {
+                    chords.getReference(j).notes.add(note);
+                    isAdded = true;
+                    break;
+                }
+            }
+
+            if (! isAdded)
+            {
+                Chord chord;
+                chord.start = start;
+                chord.end = end;
+                chord.notes.add(note);
+                chords.add(chord);
+            }
+        }
+
+        // Each chord goes to the first voice which is silent by then
+        for (const auto &chord : chords)
+        {
+            Voice *freeVoice = nullptr;
+            for (const auto voice : part->voices)
+            {
+                if (voice->getLast().end <= chord.start)
+                {
+                    freeVoice = voice;
+                    break;
+                }
+            }
+
+            if (freeVoice == nullptr)
+            {
+                freeVoice = part->voices.add(new Voice());
+            }
+
+            freeVoice->add(chord);
+        }
+    }
+}
+
+void MusicXmlExporter::collectDirections()
+{
+    this->directions.clearQuick();
+
+    const MidiSequence *annotations = this->project.getTimeline()->getAnnotations()->getSequence();
+    for (const auto event : *annotations)
+    {
+        const AnnotationEvent *annotation = static_cast<const AnnotationEvent *>(event);
+        const Direction direction = { jmax(0, beatToPosition(annotation->getBeat())), annotation->getDescription() };
+        this->directions.add(direction);
+        this->lastPosition = jmax(this->lastPosition, direction.position + 1);
+    }
+}
+
+void MusicXmlExporter::collectMeasures()
+{
+    this->measures.clearQuick();
+
+    const MidiSequence *timeSignatures = this->project.getTimeline()->getTimeSignatures()->getSequence();
+    const MidiSequence *keySignatures = this->project.getTimeline()->getKeySignatures()->getSequence();
+
+    // Number of flats (negative) or sharps for every root key, starting from C
+    static const int majorCircle[] = {  0, 7,  2, -3, 4, -1, 6,  1, -4, 3, -2, 5 };
+    static const int minorCircle[] = { -3, 4, -1, -6, 1, -4, 3, -2, -7, 0, -5, 2 };
+
+    Measure measure = { 0, 0, 4, 4, 0, false, true, true };
+    int timeIndex = 0;
+    int keyIndex = 0;
+
+    do
+    {
+        while (timeIndex < timeSignatures->size() &&
+            beatToPosition(timeSignatures->getUnchecked(timeIndex)->getBeat()) <= measure.start)
+        {
+            const auto *signature = static_cast<const TimeSignatureEvent *>(timeSignatures->getUnchecked(timeIndex));
+            measure.numerator = jmax(1, signature->getNumerator());
+            measure.denominator = jmax(1, signature->getDenominator());
+            measure.hasNewTime = true;
+            timeIndex++;
+        }
+
+        measure.length = jmax(1, measure.numerator * MUSICXML_DIVISIONS * 4 / measure.denominator);
+
+        // A time signature in the middle of a measure makes it shorter
+        if (timeIndex < timeSignatures->size())
+        {
+            const int nextSignature = beatToPosition(timeSignatures->getUnchecked(timeIndex)->getBeat());
+            measure.length = jmin(measure.length, nextSignature - measure.start);
+        }
+
+        // A key signature in the middle of a measure is moved to its start
+        while (keyIndex < keySignatures->size() &&
+            beatToPosition(keySignatures->getUnchecked(keyIndex)->getBeat()) < measure.start + measure.length)
+        {
+            const auto *signature = static_cast<const KeySignatureEvent *>(keySignatures->getUnchecked(keyIndex));
+            const int root = signature->getRootKey() % CHROMATIC_SCALE_SIZE;
+            measure.isMinor = signature->getScale().seemsMinor();
+            measure.fifths = measure.isMinor ? minorCircle[root] : majorCircle[root];
+            measure.hasNewKey = true;
+            keyIndex++;
+        }
+
+        this->measures.add(measure);
+
+        measure.start += measure.length;
+        measure.hasNewTime = false;
+        measure.hasNewKey = false;
+    }
+    while (measure.start < this->lastPosition);
+}
+
+//===----------------------------------------------------------------------===//
+// Writing
+//===----------------------------------------------------------------------===//
+
+void MusicXmlExporter::writePart(XmlStreamWriter &writer, int partIndex)
+{
+    const Part *part = this->parts[partIndex];
+    writer.startElement("part").withAttribute("id", "P" + String(partIndex + 1));
+
+    // Next chord to write, for every voice
+    Array<int> chordIndices;
+    chordIndices.insertMultiple(0, 0, jmax(1, part->voices.size()));
+
+    int directionIndex = 0;
+
+    for (int m = 0; m < this->measures.size(); ++m)
+    {
+        const Measure &measure = this->measures.getReference(m);
+        const int measureEnd = measure.start + measure.length;
+
+        writer.startElement("measure").withAttribute("number", String(m + 1));
+        this->writeAttributes(writer, measure, m == 0);
+
+        // Annotations are global, they are written once, in the first part
+        if (partIndex == 0)
+        {
+            this->writeDirections(writer, measure, directionIndex);
+        }
+
+        int backupDuration = 0;
+
+        for (int v = 0; v < jmax(1, part->voices.size()); ++v)
+        {
+            const Voice *voice = part->voices[v];
+            int &chordIndex = chordIndices.getReference(v);
+            const bool hasChords = voice != nullptr &&
+                chordIndex < voice->size() &&
+                voice->getReference(chordIndex).start < measureEnd;
+
+            // The first voice always fills the measure, the others only have what they have
+            if (v > 0 && ! hasChords)
+            {
+                continue;
+            }
+
+            if (backupDuration > 0)
+            {
+                writer.startElement("backup");
+                writer.writeElement("duration", backupDuration);
+                writer.endElement();
+            }
+
+            int position = measure.start;
+
+            while (voice != nullptr && chordIndex < voice->size() &&
+                voice->getReference(chordIndex).start < measureEnd)
+            {
+                const Chord &chord = voice->getReference(chordIndex);
+                const int chordStart = jmax(chord.start, measure.start);
+                const int chordEnd = jmin(chord.end, measureEnd);
+
+                if (chordStart > position)
+                {
+                    this->writeRest(writer, chordStart - position, v + 1, false);
+                }
+
+                for (int n = 0; n < chord.notes.size(); ++n)
+                {
+                    this->writeNote(writer, chord.notes.getUnchecked(n), chordEnd - chordStart, v + 1,
+                        n > 0, chord.start < measure.start, chord.end > measureEnd, measure.fifths < 0);
+                }
+
+                position = chordEnd;
+
+                if (chord.end > measureEnd)
+                {
+                    break; // to be continued in the next measure
+                }
+
+                chordIndex++;
+            }
+
+            if (v == 0 && position < measureEnd)
+            {
+                const bool isEmptyMeasure = (position == measure.start);
+                this->writeRest(writer, measureEnd - position, v + 1, isEmptyMeasure);
+                position = measureEnd;
+            }
+
+            backupDuration = position - measure.start;
+        }
+
+        writer.endElement();
+    }
+
+    writer.endElement();
+}
+
+void MusicXmlExporter::writeAttributes(XmlStreamWriter &writer,
+    const Measure &measure, bool isFirstMeasure)
+{
+    if (! isFirstMeasure && ! measure.hasNewKey && ! measure.hasNewTime)
+    {
+        return;
+    }
+
+    writer.startElement("attributes");
+
+    if (isFirstMeasure)
+    {
+        writer.writeElement("divisions", MUSICXML_DIVISIONS);
+    }
+
+    if (measure.hasNewKey)
+    {
+        writer.startElement("key");
+        writer.writeElement("fifths", measure.fifths);
+        writer.writeElement("mode", measure.isMinor ? "minor" : "major");
+        writer.endElement();
+    }
+
+    if (measure.hasNewTime)
+    {
+        writer.startElement("time");
+        writer.writeElement("beats", measure.numerator);
+        writer.writeElement("beat-type", measure.denominator);
+        writer.endElement();
+    }
+
+    if (isFirstMeasure)
+    {
+        writer.startElement("clef");
+        writer.writeElement("sign", "G");
+        writer.writeElement("line", 2);
+        writer.endElement();
+    }
+
+    writer.endElement();
+}
+
+void MusicXmlExporter::writeDirections(XmlStreamWriter &writer,
+    const Measure &measure, int &directionIndex)
+{
+    const int measureEnd = measure.start + measure.length;
+
+    while (directionIndex < this->directions.size() &&
+        this->directions.getReference(directionIndex).position < measureEnd)
+    {
+        const Direction &direction = this->directions.getReference(directionIndex);
+
+        writer.startElement("direction").withAttribute("placement", "above");
+        writer.startElement("direction-type");
+        writer.writeElement("words", direction.text);
+        writer.endElement();
+
+        const int offset = direction.position - measure.start;
+        if (offset > 0)
+        {
+            writer.writeElement("offset", offset);
+        }
+
+        writer.endElement();
+        directionIndex++;
+    }
+}
+
+void MusicXmlExporter::writeNote(XmlStreamWriter &writer, const Note *note, int duration, int voice,
+    bool isChord, bool isTieStop, bool isTieStart, bool useFlats)
+{
+    static const char *steps[2][CHROMATIC_SCALE_SIZE] =
+    {
+        { "C", "C", "D", "D", "E", "F", "F", "G", "G", "A", "A", "B" },
+        { "C", "D", "D", "E", "E", "F", "G", "G", "A", "A", "B", "B" }
+    };
+
+    static const int alters[2][CHROMATIC_SCALE_SIZE] =
+    {
+        { 0, 1, 0, 1, 0, 0, 1, 0, 1, 0, 1, 0 },
+        { 0, -1, 0, -1, 0, 0, -1, 0, -1, 0, -1, 0 }
+    };
+
+    const int spelling = useFlats ? 1 : 0;
+    const int key = jlimit(0, 127, note->getKey());
+    const int pitchClass = key % CHROMATIC_SCALE_SIZE;
+
+    writer.startElement("note").withAttribute("dynamics",
+        String(note->getVelocity() / MUSICXML_DEFAULT_VELOCITY * 100.f, 2));
+
+    if (isChord)
+    {
+        writer.writeEmptyElement("chord");
+    }
+
+    writer.startElement("pitch");
+    writer.writeElement("step", steps[spelling][pitchClass]);
+    if (alters[spelling][pitchClass] != 0)
+    {
+        writer.writeElement("alter", alters[spelling][pitchClass]);
+    }
+    writer.writeElement("octave", key / CHROMATIC_SCALE_SIZE - 1);
+    writer.endElement();
+
+    writer.writeElement("duration", duration);
+
+    if (isTieStop)
+    {
+        writer.startElement("tie").withAttribute("type", "stop").endElement();
+    }
+
+    if (isTieStart)
+    {
+        writer.startElement("tie").withAttribute("type", "start").endElement();
+    }
+
+    writer.writeElement("voice", voice);
+    this->writeType(writer, duration);
+
+    if (isTieStop || isTieStart)
+    {
+        writer.startElement("notations");
+
+        if (isTieStop)
+        {
+            writer.startElement("tied").withAttribute("type", "stop").endElement();
+        }
+
+        if (isTieStart)
+        {
+            writer.startElement("tied").withAttribute("type", "start").endElement();
+        }
+
+        writer.endElement();
+    }
+
+    writer.endElement();
+}
+
+void MusicXmlExporter::writeRest(XmlStreamWriter &writer, int duration, int voice, bool isWholeMeasure)
+{
+    writer.startElement("note");
+
+    if (isWholeMeasure)
+    {
+        writer.startElement("rest").withAttribute("measure", "yes").endElement();
+    }
+    else
+    {
+        writer.writeEmptyElement("rest");
+    }
+
+    writer.writeElement("duration", duration);
+    writer.writeElement("voice", voice);
+
+    if (! isWholeMeasure)
+    {
+        this->writeType(writer, duration);
+    }
+
+    writer.endElement();
+}
+
+void MusicXmlExporter::writeType(XmlStreamWriter &writer, int duration)
+{
+    // The note type is only written when the duration is an exact (maybe dotted) value;
+    // for anything else the readers are left to figure out the notation themselves
+    static const char *types[] = { "breve", "whole", "half", "quarter", "eighth", "16th", "32nd", "64th", "128th" };
+    static const int typeDurations[] =
+    {
+        MUSICXML_DIVISIONS * 8, MUSICXML_DIVISIONS * 4, MUSICXML_DIVISIONS * 2,
+        MUSICXML_DIVISIONS, MUSICXML_DIVISIONS / 2, MUSICXML_DIVISIONS / 4,
+        MUSICXML_DIVISIONS / 8, MUSICXML_DIVISIONS / 16, MUSICXML_DIVISIONS / 32
+    };
+
+    for (int i = 0; i < numElementsInArray(types); ++i)
+    {
+        const int base = typeDurations[i];
+        for (int dots = 0; dots <= 2; ++dots)
+        {
+            // A dot adds a half of the previous value: 1, 1.5, 1.75
+            const int dotted = base * 2 - (base >> dots);
+            const bool isExact = ((base >> dots) << dots) == base;
+
+            if (isExact && dotted == duration)
+            {
+                writer.writeElement("type", types[i]);
+                for (int d = 0; d < dots; ++d)
+                {
+                    writer.writeEmptyElement("dot");
+                }
+
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+class ProjectTreeItem;
+class XmlStreamWriter;
+class Note;
+
+// Exports the piano tracks of a project as a partwise MusicXML score,
+// with the measures laid out by the project's time signatures.
+//
+// Overlapping notes of a track are spread over as few voices as possible,
+// and the notes crossing a barline are split and tied.
+// The score is written straight into the stream with XmlStreamWriter.
+
+class MusicXmlExporter final
+{
+public:
+
+    explicit MusicXmlExporter(const ProjectTreeItem &project);
+
+    bool exportFile(const File &file);
+    bool exportTo(OutputStream &output);
+
+private:
+
+    struct Chord
+    {
+        int start;
+        int end;
+        Array<const Note *> notes;
+    };
+
+    typedef Array<Chord> Voice;
+
+    struct Part
+    {
+        String name;
+        OwnedArray<Voice> voices;
+    };
+
+    struct Measure
+    {
+        int start;
+        int length;
+        int numerator;
+        int denominator;
+        int fifths;
+        bool isMinor;
+        bool hasNewTime;
+        bool hasNewKey;
+    };
+
+    struct Direction
+    {
+        int position;
+        String text;
+    };
+
+    void collectParts();
+    void collectMeasures();
+    void collectDirections();
+
+    void writePart(XmlStreamWriter &writer, int partIndex);
+    void writeAttributes(XmlStreamWriter &writer, const Measure &measure, bool isFirstMeasure);
+    void writeDirections(XmlStreamWriter &writer, const Measure &measure, int &directionIndex);
+    void writeNote(XmlStreamWriter &writer, const Note *note, int duration, int voice,
+        bool isChord, bool isTieStop, bool isTieStart, bool useFlats);
+    void writeRest(XmlStreamWriter &writer, int duration, int voice, bool isWholeMeasure);
+    void writeType(XmlStreamWriter &writer, int duration);
+
+    const ProjectTreeItem &project;
+
+    OwnedArray<Part> parts;
+    Array<Measure> measures;
+    Array<Direction> directions;
+    int lastPosition;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MusicXmlExporter)
+};
@@ -0,0 +1,549 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "MusicXmlImporter.h"
+#include "ProjectTreeItem.h"
+#include "ProjectTimeline.h"
+#include "PianoTrackTreeItem.h"
+#include "PianoSequence.h"
+#include "AnnotationEvent.h"
+#include "TimeSignatureEvent.h"
+#include "KeySignatureEvent.h"
+
+// MusicXML's default dynamics (forte) is 90 out of 127
+#define MUSICXML_DEFAULT_VELOCITY (90.f / 128.f)
+
+static float dynamicsToVelocity(const String &dynamics)
+{
+    // Percents of the default dynamics
+    return jlimit(0.f, 1.f, dynamics.getFloatValue() / 100.f * MUSICXML_DEFAULT_VELOCITY);
+}
+
+MusicXmlImporter::MusicXmlImporter(ProjectTreeItem &project) :
+    project(project),
+    isTimewise(false),
+    sequence(nullptr),
+    numParts(0),
+    divisions(1.0),
+    cursor(0.0),
+    measureStart(0.0),
+    measureEnd(0.0),
+    lastNoteStart(0.0),
+    velocity(MUSICXML_DEFAULT_VELOCITY),
+    transposition(0),
+    note(),
+    duration(0.0),
+    fifths(0),
+    isMinor(false),
+    beats(0),
+    beatType(0),
+    directionOffset(0.0) {}
+
+String MusicXmlImporter::getLastError() const noexcept
+{
+    return this->lastError;
+}
+
+bool MusicXmlImporter::importFile(const File &file)
+{
+    if (file.hasFileExtension("mxl"))
+    {
+        ZipFile archive(file);
+        ScopedPointer<InputStream> score(createScoreStream(archive));
+
+        if (score == nullptr)
+        {
+            this->lastError = "No score found in " + file.getFileName();
+            Logger::writeToLog(this->lastError);
+            return false;
+        }
+
+        return this->importFrom(*score);
+    }
+
+    FileInputStream in(file);
+
+    if (in.failedToOpen())
+    {
+        this->lastError = "Cannot open " + file.getFullPathName();
+        Logger::writeToLog(this->lastError);
+        return false;
+    }
+
+    return this->importFrom(in);
+}
+
+bool MusicXmlImporter::importFrom(InputStream &input)
+{
+    this->lastError = String::empty;
+    this->numParts = 0;
+    this->isTimewise = false;
+    this->partNames.clear();
+    this->importedAnnotations.clear();
+
+    XmlStreamReader reader(input);
+    const bool parsedOk = reader.parse(*this);
+
+    // Keeps whatever was read before an error
+    this->finishPart();
+
+    if (! parsedOk)
+    {
+        this->lastError = reader.getLastError();
+    }
+    else if (this->isTimewise)
+    {
+        this->lastError = "Timewise MusicXML scores are not supported";
+    }
+    else if (this->numParts == 0)
+    {
+        this->lastError = "No parts found";
+    }
+
+    if (this->lastError.isNotEmpty())
+    {
+        Logger::writeToLog("MusicXML import failed: " + this->lastError);
+        return false;
+    }
+
+    return true;
+}
+
+InputStream *MusicXmlImporter::createScoreStream(ZipFile &archive)
+{
+    String scorePath;
+
+    const int containerIndex = archive.getIndexOfFileName("META-INF/container.xml");
+    if (containerIndex >= 0)
+    {
+        // The container is tiny, so it's fine to read it as a whole
+        ScopedPointer<InputStream> containerStream(archive.createStreamForEntry(containerIndex));
+        if (containerStream != nullptr)
+        {
+            ScopedPointer<XmlElement> container(XmlDocument::parse(containerStream->readEntireStreamAsString()));
+            if (container != nullptr)
+            {
+                if (XmlElement *rootfiles = container->getChildByName("rootfiles"))
+                {
+                    if (XmlElement *rootfile = rootfiles->getChildByName("rootfile"))
+                    {
+                        scorePath = rootfile->getStringAttribute("full-path");
+                    }
+                }
+            }
+        }
+    }
+
+    if (scorePath.isEmpty())
+    {
+        for (int i = 0; i < archive.getNumEntries(); ++i)
+        {
+            const String entryName(archive.getEntry(i)->filename);
+            if (! entryName.startsWith("META-INF") &&
+                (entryName.endsWithIgnoreCase(".xml") || entryName.endsWithIgnoreCase(".musicxml")))
+            {
+                scorePath = entryName;
+                break;
+            }
+        }
+    }
+
+    const int scoreIndex = archive.getIndexOfFileName(scorePath);
+    return (scoreIndex >= 0) ? archive.createStreamForEntry(scoreIndex) : nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// XmlStreamReader::Listener
+//===----------------------------------------------------------------------===//
+
+void MusicXmlImporter::onStartElement(const String &name, const StringPairArray &attributes)
+{
+    this->path.add(name);
+    this->text = String::empty;
+
+    if (this->isTimewise)
+    {
+        return;
+    }
+
+    if (name == "note")
+    {
+        zerostruct(this->note);
+        this->note.velocity = attributes.containsKey("dynamics") ?
+            dynamicsToVelocity(attributes["dynamics"]) : this->velocity;
+    }
+    else if (name == "pitch")
+    {
+        this->note.hasPitch = true;
+    }
+    else if (name == "chord")
+    {
+        this->note.isChord = true;
+    }
+    else if (name == "grace")
+    {
+        this->note.isGrace = true;
+    }
+    else if (name == "tie")
+    {
+        this->note.isTieStart = this->note.isTieStart || attributes["type"] == "start";
+        this->note.isTieStop = this->note.isTieStop || attributes["type"] == "stop";
+    }
+    else if (name == "backup" || name == "forward")
+    {
+        this->duration = 0.0;
+    }
+    else if (name == "measure")
+    {
+        this->measureStart = this->measureEnd;
+        this->cursor = this->measureStart;
+        this->lastNoteStart = this->cursor;
+    }
+    else if (name == "key")
+    {
+        this->fifths = 0;
+        this->isMinor = false;
+    }
+    else if (name == "time")
+    {
+        this->beats = 0;
+        this->beatType = 0;
+    }
+    else if (name == "transpose")
+    {
+        this->transposition = 0;
+    }
+    else if (name == "direction")
+    {
+        this->directionOffset = 0.0;
+        this->directionWords.clearQuick();
+    }
+    else if (name == "sound")
+    {
+        if (attributes.containsKey("dynamics"))
+        {
+            this->velocity = dynamicsToVelocity(attributes["dynamics"]);
+        }
+    }
+    else if (name == "score-part")
+    {
+        this->currentScorePartId = attributes["id"];
+    }
+    else if (name == "part")
+    {
+        this->startPart(attributes["id"]);
+    }
+    else if (name == "score-timewise")
+    {
+        this->isTimewise = true;
+    }
+}
+
+void MusicXmlImporter::onEndElement(const String &name)
+{
+    const String parent(this->path[this->path.size() - 2]);
+    const String value(this->text.trim());
+    this->path.removeLast();
+    this->text = String::empty;
+
+    if (this->isTimewise)
+    {
+        return;
+    }
+
+    if (name == "duration")
+    {
+        if (parent == "note")
+        {
+            this->note.duration = value.getDoubleValue();
+        }
+        else
+        {
+            this->duration = value.getDoubleValue();
+        }
+    }
+    else if (name == "step" && parent == "pitch")
+    {
+        static const int semitones[] = { 0, 2, 4, 5, 7, 9, 11 };
+        const int index = String("CDEFGAB").indexOfChar(value.toUpperCase()[0]);
+        this->note.step = (index >= 0) ? semitones[index] : 0;
+    }
+    else if (name == "alter" && parent == "pitch")
+    {
+        this->note.alter = value.getDoubleValue();
+    }
+    else if (name == "octave" && parent == "pitch")
+    {
+        this->note.octave = value.getIntValue();
+    }
+    else if (name == "note")
+    {
+        this->finishNote();
+    }
+    else if (name == "backup")
+    {
+        this->cursor = jmax(0.0, this->cursor - this->duration / this->divisions);
+    }
+    else if (name == "forward")
+    {
+        this->cursor += this->duration / this->divisions;
+        this->measureEnd = jmax(this->measureEnd, this->cursor);
+    }
+    else if (name == "divisions")
+    {
+        const double newDivisions = value.getDoubleValue();
+        this->divisions = (newDivisions > 0.0) ? newDivisions : this->divisions;
+    }
+    else if (name == "fifths")
+    {
+        this->fifths = jlimit(-7, 7, value.getIntValue());
+    }
+    else if (name == "mode")
+    {
+        this->isMinor = (value == "minor" || value == "aeolian");
+    }
+    else if (name == "beats")
+    {
+        // Composite signatures, like 3+2, are summed up
+        StringArray tokens;
+        tokens.addTokens(value, "+", "");
+        this->beats = 0;
+        for (const auto &token : tokens)
+        {
+            this->beats += token.getIntValue();
+        }
+    }
+    else if (name == "beat-type")
+    {
+        this->beatType = value.getIntValue();
+    }
+    else if (name == "key" && parent == "attributes")
+    {
+        this->addKeySignature();
+    }
+    else if (name == "time" && parent == "attributes")
+    {
+        this->addTimeSignature();
+    }
+    else if (name == "chromatic" && parent == "transpose")
+    {
+        this->transposition += value.getIntValue();
+    }
+    else if (name == "octave-change" && parent == "transpose")
+    {
+        this->transposition += value.getIntValue() * 12;
+    }
+    else if (name == "words" && parent == "direction-type")
+    {
+        this->directionWords.add(value);
+    }
+    else if (name == "offset" && parent == "direction")
+    {
+        this->directionOffset = value.getDoubleValue();
+    }
+    else if (name == "direction")
+    {
+        this->finishDirection();
+    }
+    else if (name == "part-name" && parent == "score-part")
+    {
+        this->partNames.set(this->currentScorePartId, value);
+    }
+    else if (name == "part")
+    {
+        this->finishPart();
+    }
+}
+
+void MusicXmlImporter::onText(const String &newText)
+{
+    this->text += newText;
+}
+
+//===----------------------------------------------------------------------===//
+// Parts
+//===----------------------------------------------------------------------===//
+
+void MusicXmlImporter::startPart(const String &partId)
+{
+    this->finishPart();
+
+    String trackName(this->partNames[partId]);
+    if (trackName.isEmpty())
+    {
+        trackName = "Track " + String(this->numParts);
+    }
+
+    PianoTrackTreeItem *track = new PianoTrackTreeItem(trackName);
+    this->project.addChildTreeItem(track);
+    this->sequence = static_cast<PianoSequence *>(track->getSequence());
+
+    this->numParts++;
+    this->divisions = 1.0;
+    this->cursor = 0.0;
+    this->measureStart = 0.0;
+    this->measureEnd = 0.0;
+    this->lastNoteStart = 0.0;
+    this->velocity = MUSICXML_DEFAULT_VELOCITY;
+    this->transposition = 0;
+}
+
+void MusicXmlImporter::finishPart()
+{
+    if (this->sequence == nullptr)
+    {
+        return;
+    }
+
+    // Ties left open till the end of the part
+    for (HashMap<int, Note>::Iterator i(this->tiedNotes); i.next();)
+    {
+        this->sequence->silentImport(i.getValue());
+    }
+
+    this->tiedNotes.clear();
+    this->sequence = nullptr;
+}
+
+void MusicXmlImporter::finishNote()
+{
+    if (this->note.isGrace)
+    {
+        return; // they take no time
+    }
+
+    const double length = this->note.duration / this->divisions;
+    double start = this->lastNoteStart;
+
+    if (! this->note.isChord)
+    {
+        start = this->cursor;
+        this->lastNoteStart = this->cursor;
+        this->cursor += length;
+        this->measureEnd = jmax(this->measureEnd, this->cursor);
+    }
+
+    if (this->sequence == nullptr || ! this->note.hasPitch || length <= 0.0)
+    {
+        return; // rests and unpitched notes only move the cursor
+    }
+
+    const int key = jlimit(0, 127, (this->note.octave + 1) * 12 +
+        this->note.step + roundToInt(this->note.alter) + this->transposition);
+
+    if (this->note.isTieStop && this->tiedNotes.contains(key))
+    {
+        const Note &tiedNote = this->tiedNotes.getReference(key);
+        const Note continuedNote(tiedNote.withLength(float(start + length) - tiedNote.getBeat()));
+
+        if (this->note.isTieStart)
+        {
+            this->tiedNotes.set(key, continuedNote);
+        }
+        else
+        {
+            this->tiedNotes.remove(key);
+            this->sequence->silentImport(continuedNote);
+        }
+
+        return;
+    }
+
+    const Note newNote(this->sequence, key, float(start), float(length), this->note.velocity);
+
+    if (this->note.isTieStart)
+    {
+        if (this->tiedNotes.contains(key))
+        {
+            this->sequence->silentImport(this->tiedNotes[key]);
+        }
+
+        this->tiedNotes.set(key, newNote);
+    }
+    else
+    {
+        this->sequence->silentImport(newNote);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Timeline
+//===----------------------------------------------------------------------===//
+
+// Time and key signatures are global, so they are only taken from the first part,
+// while the directions come from all parts, as long as they don't repeat
+
+void MusicXmlImporter::addTimeSignature()
+{
+    MidiSequence *signatures = this->project.getTimeline()->getTimeSignatures()->getSequence();
+    const float beat = float(this->cursor);
+
+    if (this->numParts != 1 || this->beats <= 0 || this->beatType <= 0 ||
+        this->hasEventAt(signatures, beat))
+    {
+        return;
+    }
+
+    signatures->silentImport(TimeSignatureEvent(signatures, beat, this->beats, this->beatType));
+}
+
+void MusicXmlImporter::addKeySignature()
+{
+    MidiSequence *signatures = this->project.getTimeline()->getKeySignatures()->getSequence();
+    const float beat = float(this->cursor);
+
+    if (this->numParts != 1 || this->hasEventAt(signatures, beat))
+    {
+        return;
+    }
+
+    // Every fifth up is 7 semitones, relative minor is 9 semitones above major
+    const int rootKey = ((this->fifths * 7) % 12 + 12 + (this->isMinor ? 9 : 0)) % 12;
+    signatures->silentImport(KeySignatureEvent(signatures, beat, KEY_C5 + rootKey,
+        this->isMinor ? Scale::getNaturalMiniorScale() : Scale::getNaturalMajorScale()));
+}
+
+void MusicXmlImporter::finishDirection()
+{
+    MidiSequence *annotations = this->project.getTimeline()->getAnnotations()->getSequence();
+    const float beat = float(this->cursor + this->directionOffset / this->divisions);
+
+    for (const auto &words : this->directionWords)
+    {
+        const String annotationKey(String(beat) + ":" + words);
+
+        if (words.isNotEmpty() && ! this->importedAnnotations.contains(annotationKey))
+        {
+            this->importedAnnotations.add(annotationKey);
+            annotations->silentImport(AnnotationEvent(annotations, beat, words));
+        }
+    }
+}
+
+bool MusicXmlImporter::hasEventAt(const MidiSequence *sequence, float beat) const
+{
+    for (const auto event : *sequence)
+    {
+        if (fabsf(event->getBeat() - beat) < 0.001f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,117 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+class ProjectTreeItem;
+class PianoSequence;
+class MidiSequence;
+
+#include "XmlStreamReader.h"
+#include "Note.h"
+
+// Imports partwise MusicXML (plain or compressed .mxl) into a project:
+// every part becomes a piano track, the time signatures, key signatures
+// and text directions go to the project timeline.
+//
+// The score is streamed through XmlStreamReader, and the notes go
+// to their tracks as soon as they are read, so the only things kept
+// in memory are the notes themselves, not the document.
+
+class MusicXmlImporter final : private XmlStreamReader::Listener
+{
+public:
+
+    explicit MusicXmlImporter(ProjectTreeItem &project);
+
+    bool importFile(const File &file);
+    bool importFrom(InputStream &input);
+
+    String getLastError() const noexcept;
+
+private:
+
+    void onStartElement(const String &name, const StringPairArray &attributes) override;
+    void onEndElement(const String &name) override;
+    void onText(const String &text) override;
+
+    void startPart(const String &partId);
+    void finishPart();
+    void finishNote();
+    void finishDirection();
+    void addTimeSignature();
+    void addKeySignature();
+
+    bool hasEventAt(const MidiSequence *sequence, float beat) const;
+
+    // Compressed files are zip archives with the score path in META-INF/container.xml
+    static InputStream *createScoreStream(ZipFile &archive);
+
+    ProjectTreeItem &project;
+    String lastError;
+
+    StringArray path;
+    String text;
+    bool isTimewise;
+
+    // score-part id -> part name
+    StringPairArray partNames;
+    String currentScorePartId;
+
+    // Current part
+    PianoSequence *sequence;
+    int numParts;
+    double divisions;
+    double cursor;
+    double measureStart;
+    double measureEnd;
+    double lastNoteStart;
+    float velocity;
+    int transposition;
+
+    // Tied notes waiting for their continuation, by key
+    HashMap<int, Note> tiedNotes;
+
+    // Current note
+    struct NoteState
+    {
+        int step;
+        double alter;
+        int octave;
+        double duration;
+        bool hasPitch;
+        bool isChord;
+        bool isGrace;
+        bool isTieStart;
+        bool isTieStop;
+        float velocity;
+    };
+
+    NoteState note;
+    double duration;
+
+    // Current attributes and direction
+    int fifths;
+    bool isMinor;
+    int beats;
+    int beatType;
+    double directionOffset;
+    StringArray directionWords;
+    SortedSet<String> importedAnnotations;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MusicXmlImporter)
+};
@@ -42,6 +42,9 @@ namespace Serialization
         static const String instrumentName = "Name";
         static const String instrumentNode = "Node";
         static const String instrumentConnection = "Connection";
+        static const String instrumentMidiOutput = "MidiOutput";
+        static const String instrumentMidiOutputLatency = "MidiOutputLatency";
+        static const String instrumentMidiOutputTuning = "MidiOutputTuning";
         static const String audioPlugin = "PluginSettings";
 
         static const String plugin = "Plugin";
@@ -82,6 +85,7 @@ namespace Serialization
         static const String annotation = "Annotation";
         static const String timeSignature = "TimeSignature";
         static const String keySignature = "KeySignature";
+        static const String noteExpression = "Expression";
 
         // Patterns
         static const String clip = "Clip";
@@ -94,6 +98,18 @@ namespace Serialization
         static const String scaleIntervals = "Intervals";
         static const String lastUsedScale = "LastUsedScale";
 
+        // Tunings
+        static const String tuning = "Tuning";
+        static const String tuningName = "Name";
+        static const String tuningDegrees = "Degrees";
+        static const String tuningMapping = "Mapping";
+        static const String tuningFirstKey = "FirstKey";
+        static const String tuningLastKey = "LastKey";
+        static const String tuningMiddleKey = "MiddleKey";
+        static const String tuningReferenceKey = "ReferenceKey";
+        static const String tuningReferenceFrequency = "ReferenceFrequency";
+        static const String tuningPeriodDegree = "PeriodDegree";
+
         static const String valueTag = "Key";
         static const String nameAttribute = "Name";
         static const String valueAttribute = "Value";
@@ -107,6 +123,14 @@ namespace Serialization
         static const String pluginManager = "PluginManager";
         static const String audioSettings = "AudioSettings";
         static const String audioCore = "AudioCore";
+        static const String midiOutputLookahead = "MidiOutputLookahead";
+        static const String midiSyncMode = "MidiSyncMode";
+        static const String midiSyncInput = "MidiSyncInput";
+        static const String midiSyncOutput = "MidiSyncOutput";
+        static const String metronomeEnabled = "MetronomeEnabled";
+        static const String metronomeCountInBars = "MetronomeCountInBars";
+        static const String metronomePreRollBars = "MetronomePreRollBars";
+        static const String metronomeInRenders = "MetronomeInRenders";
         static const String orchestra = "Orchestra";
 
         static const String recentFiles = "RecentFiles";
@@ -218,6 +242,8 @@ namespace Serialization
         static const String vcsApplyStash = "vcsApplyStash";
         static const String vcsCheckoutItems = "vcsCheckoutItems";
         static const String vcsCheckoutRevision = "vcsCheckoutRevision";
+        static const String vcsMergeBranch = "vcsMergeBranch";
+        static const String vcsCompactHistory = "vcsCompactHistory";
         static const String vcsLogin = "vcsLogin";
         static const String vcsLogout = "vcsLogout";
 
@@ -252,6 +278,7 @@ namespace Serialization
         static const String vcsHistoryKey = "HistoryKey";
         static const String vcsHistoryId = "HistoryId";
         static const String vcsHistoryVersion = "HistoryVersion";
+        static const String publishedRevisions = "PublishedRevisions";
         
         static const String stashesRepository = "StashesRepository";
         static const String userStashes = "UserStashes";
@@ -272,6 +299,7 @@ namespace Serialization
         static const String commitTimeStamp = "Date";
         static const String commitVersion = "Version";
         static const String commitId = "Uuid";
+        static const String commitHash = "Hash";
 
         static const String vcsItemId = "VCSUuid";
 
@@ -279,6 +307,7 @@ namespace Serialization
         static const String revisionItemType = "Type";
         static const String revisionItemName = "Name";
         static const String revisionItemDiffLogic = "DiffLogic";
+        static const String revisionItemHash = "Hash";
 
         static const String delta = "Delta";
         static const String deltaId = "Uuid";
@@ -286,6 +315,7 @@ namespace Serialization
         static const String deltaIntParam = "IntParam";
         static const String deltaStringParam = "StringParam";
         static const String deltaType = "Type";
+        static const String deltaHash = "Hash";
 
         static const String headStateDelta = "HeadState";
     }  // namespace VCS
@@ -317,6 +347,11 @@ namespace Serialization
         static const String key = "vcsIdHash";
         static const String realKey = "vcsId";
         static const String title = "title";
+
+        // the client sends the newest sync format it supports,
+        // the remote answers with the one it accepts for pushes
+        static const String syncFormat = "syncFormat";
+        static const String acceptedSyncFormat = "X-Helio-Sync-Format";
     }  // namespace Network
     
     namespace Locales
@@ -361,6 +396,7 @@ namespace Serialization
     {
         static const String undoStack = "UndoStack";
         static const String transaction = "Transaction";
+        static const String journalSequence = "JournalSequence";
 
         static const String name = "Name";
         static const String xPath = "Path";
@@ -0,0 +1,516 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "XmlStreamReader.h"
+
+#define XML_STREAM_BUFFER_SIZE (64 * 1024)
+#define XML_STREAM_MAX_NAME_LENGTH 256
+#define XML_STREAM_MAX_ENTITY_LENGTH 12
+
+static inline bool isXmlWhitespace(int c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static inline bool isNameTerminator(int c) noexcept
+{
+    return c < 0 || isXmlWhitespace(c) || c == '>' || c == '/' || c == '=';
+}
+
+XmlStreamReader::XmlStreamReader(InputStream &input) :
+    input(input),
+    buffer(XML_STREAM_BUFFER_SIZE),
+    bufferSize(0),
+    position(0),
+    lineNumber(1) {}
+
+String XmlStreamReader::getLastError() const noexcept
+{
+    return this->lastError;
+}
+
+bool XmlStreamReader::parse(Listener &listener)
+{
+    this->lastError = String::empty;
+
+    MemoryOutputStream text;
+    Array<String> openElements;
+    String name;
+
+    for (;;)
+    {
+        int c = this->nextChar();
+
+        if (c < 0)
+        {
+            break;
+        }
+
+        if (c == '&')
+        {
+            this->readEntity(text);
+            continue;
+        }
+
+        if (c != '<')
+        {
+            text.writeByte(char(c));
+            continue;
+        }
+
+        c = this->nextChar();
+
+        if (c == '!' && this->peekChar() == '[')
+        {
+            // CDATA is a part of the text, so the text is not flushed yet
+            if (! this->readCData(text))
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        if (openElements.size() > 0)
+        {
+            this->flushText(listener, text);
+        }
+        else
+        {
+            text.reset(); // a byte order mark or some garbage before the root
+        }
+
+        if (c == '?')
+        {
+            if (! this->skipUntil("?>"))
+            {
+                return false;
+            }
+        }
+        else if (c == '!')
+        {
+            if (this->peekChar() == '-')
+            {
+                if (! this->skipUntil("-->"))
+                {
+                    return false;
+                }
+            }
+            else if (! this->skipDeclaration())
+            {
+                return false;
+            }
+        }
+        else if (c == '/')
+        {
+            if (! this->readName(this->nextChar(), name))
+            {
+                return false;
+            }
+
+            this->skipWhitespace();
+
+            if (this->nextChar() != '>')
+            {
+                return this->fail("Expected '>' after </" + name);
+            }
+
+            if (openElements.size() == 0 || openElements.getLast() != name)
+            {
+                return this->fail("Unexpected closing tag </" + name + ">");
+            }
+
+            openElements.removeLast();
+            listener.onEndElement(name);
+        }
+        else
+        {
+            if (! this->readName(c, name))
+            {
+                return false;
+            }
+
+            bool isEmptyElement = false;
+            if (! this->readAttributes(isEmptyElement))
+            {
+                return false;
+            }
+
+            listener.onStartElement(name, this->attributes);
+
+            if (isEmptyElement)
+            {
+                listener.onEndElement(name);
+            }
+            else
+            {
+                openElements.add(name);
+            }
+        }
+    }
+
+    if (openElements.size() > 0)
+    {
+        return this->fail("Unexpected end of file, <" + openElements.getLast() + "> is not closed");
+    }
+
+    return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Tokens
+//===----------------------------------------------------------------------===//
+
+bool XmlStreamReader::skipUntil(const char *terminator)
+{
+    const int length = int(strlen(terminator));
+    int matched = 0;
+
+    while (matched < length)
+    {
+        const int c = this->nextChar();
+
+        if (c < 0)
+        {
+            return this->fail("Unexpected end of file, expected " + String(terminator));
+        }
+
+        if (c == terminator[matched])
+        {
+            ++matched;
+        }
+        else
+        {
+            matched = (c == terminator[0]) ? 1 : 0;
+        }
+    }
+
+    return true;
+}
+
+bool XmlStreamReader::skipDeclaration()
+{
+    // <!DOCTYPE ...> with a possible [internal subset], which may contain '>'
+    int depth = 0;
+    char quote = 0;
+
+    for (;;)
+    {
+        const int c = this->nextChar();
+
+        if (c < 0)
+        {
+            return this->fail("Unexpected end of file in a declaration");
+        }
+
+        if (quote != 0)
+        {
+            quote = (c == quote) ? 0 : quote;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            quote = char(c);
+        }
+        else if (c == '[')
+        {
+            ++depth;
+        }
+        else if (c == ']')
+        {
+            --depth;
+        }
+        else if (c == '>' && depth <= 0)
+        {
+            return true;
+        }
+    }
+}
+
+bool XmlStreamReader::readCData(MemoryOutputStream &text)
+{
+    static const char *prefix = "[CDATA[";
+
+    for (const char *p = prefix; *p != 0; ++p)
+    {
+        if (this->nextChar() != *p)
+        {
+            return this->fail("Malformed CDATA section");
+        }
+    }
+
+    // Copies everything up to the "]]>"
+    int numBrackets = 0;
+
+    for (;;)
+    {
+        const int c = this->nextChar();
+
+        if (c < 0)
+        {
+            return this->fail("Unexpected end of file in a CDATA section");
+        }
+
+        if (c == ']')
+        {
+            ++numBrackets;
+            continue;
+        }
+
+        if (c == '>' && numBrackets >= 2)
+        {
+            for (int i = 2; i < numBrackets; ++i)
+            {
+                text.writeByte(']');
+            }
+
+            return true;
+        }
+
+        for (int i = 0; i < numBrackets; ++i)
+        {
+            text.writeByte(']');
+        }
+
+        numBrackets = 0;
+        text.writeByte(char(c));
+    }
+}
+
+bool XmlStreamReader::readName(int firstChar, String &name)
+{
+    char chars[XML_STREAM_MAX_NAME_LENGTH];
+    int length = 0;
+
+    if (isNameTerminator(firstChar))
+    {
+        return this->fail("Expected a name");
+    }
+
+    chars[length++] = char(firstChar);
+
+    while (! isNameTerminator(this->peekChar()))
+    {
+        if (length == XML_STREAM_MAX_NAME_LENGTH)
+        {
+            return this->fail("The name is too long");
+        }
+
+        chars[length++] = char(this->nextChar());
+    }
+
+    name = String::fromUTF8(chars, length);
+    return true;
+}
+
+bool XmlStreamReader::readAttributes(bool &isEmptyElement)
+{
+    this->attributes.clear();
+
+    String name;
+    MemoryOutputStream value;
+
+    for (;;)
+    {
+        this->skipWhitespace();
+
+        const int c = this->nextChar();
+
+        if (c == '>')
+        {
+            isEmptyElement = false;
+            return true;
+        }
+
+        if (c == '/')
+        {
+            if (this->nextChar() != '>')
+            {
+                return this->fail("Expected '>' after '/'");
+            }
+
+            isEmptyElement = true;
+            return true;
+        }
+
+        if (! this->readName(c, name))
+        {
+            return false;
+        }
+
+        this->skipWhitespace();
+
+        if (this->nextChar() != '=')
+        {
+            return this->fail("Expected '=' after the attribute " + name);
+        }
+
+        this->skipWhitespace();
+
+        const int quote = this->nextChar();
+        if (quote != '"' && quote != '\'')
+        {
+            return this->fail("Expected a quoted value of the attribute " + name);
+        }
+
+        value.reset();
+
+        for (;;)
+        {
+            const int v = this->nextChar();
+
+            if (v < 0)
+            {
+                return this->fail("Unexpected end of file in the attribute " + name);
+            }
+
+            if (v == quote)
+            {
+                break;
+            }
+
+            if (v == '&')
+            {
+                this->readEntity(value);
+            }
+            else
+            {
+                value.writeByte(char(v));
+            }
+        }
+
+        this->attributes.set(name, value.toUTF8());
+    }
+}
+
+void XmlStreamReader::readEntity(MemoryOutputStream &out)
+{
+    char entity[XML_STREAM_MAX_ENTITY_LENGTH + 1];
+    int length = 0;
+
+    while (length < XML_STREAM_MAX_ENTITY_LENGTH)
+    {
+        const int c = this->peekChar();
+
+        if (c < 0 || c == ';' || c == '<' || c == '&' || isXmlWhitespace(c))
+        {
+            break;
+        }
+
+        entity[length++] = char(this->nextChar());
+    }
+
+    entity[length] = 0;
+
+    if (this->peekChar() != ';')
+    {
+        // Not an entity at all, keep it as is
+        out.writeByte('&');
+        out.write(entity, size_t(length));
+        return;
+    }
+
+    this->nextChar();
+
+    if (strcmp(entity, "lt") == 0) { out.writeByte('<'); }
+    else if (strcmp(entity, "gt") == 0) { out.writeByte('>'); }
+    else if (strcmp(entity, "amp") == 0) { out.writeByte('&'); }
+    else if (strcmp(entity, "quot") == 0) { out.writeByte('"'); }
+    else if (strcmp(entity, "apos") == 0) { out.writeByte('\''); }
+    else if (entity[0] == '#')
+    {
+        const juce_wchar code = (entity[1] == 'x' || entity[1] == 'X') ?
+            juce_wchar(String(entity + 2).getHexValue32()) :
+            juce_wchar(String(entity + 1).getIntValue());
+
+        char utf8[8];
+        CharPointer_UTF8 utf8Writer(utf8);
+        utf8Writer.write(code);
+        out.write(utf8, CharPointer_UTF8::getBytesRequiredFor(code));
+    }
+    else
+    {
+        // An entity from the doctype, which we don't read
+        out.writeByte('&');
+        out.write(entity, size_t(length));
+        out.writeByte(';');
+    }
+}
+
+void XmlStreamReader::flushText(Listener &listener, MemoryOutputStream &text)
+{
+    const char *data = static_cast<const char *>(text.getData());
+    const size_t size = text.getDataSize();
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (! isXmlWhitespace(data[i]))
+        {
+            listener.onText(text.toUTF8());
+            break;
+        }
+    }
+
+    text.reset();
+}
+
+//===----------------------------------------------------------------------===//
+// Buffering
+//===----------------------------------------------------------------------===//
+
+int XmlStreamReader::nextChar() noexcept
+{
+    const int c = this->peekChar();
+
+    if (c >= 0)
+    {
+        ++this->position;
+        this->lineNumber += (c == '\n') ? 1 : 0;
+    }
+
+    return c;
+}
+
+int XmlStreamReader::peekChar() noexcept
+{
+    if (this->position >= this->bufferSize)
+    {
+        this->position = 0;
+        this->bufferSize = jmax(0, this->input.read(this->buffer.getData(), XML_STREAM_BUFFER_SIZE));
+
+        if (this->bufferSize == 0)
+        {
+            return -1;
+        }
+    }
+
+    return int(uint8(this->buffer[this->position]));
+}
+
+void XmlStreamReader::skipWhitespace() noexcept
+{
+    while (isXmlWhitespace(this->peekChar()))
+    {
+        this->nextChar();
+    }
+}
+
+bool XmlStreamReader::fail(const String &message)
+{
+    this->lastError = message + " (line " + String(this->lineNumber) + ")";
+    return false;
+}
@@ -0,0 +1,80 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// A forward-only, SAX-style xml parser.
+//
+// Unlike XmlDocument, it never builds a tree: it reads the stream
+// in fixed-size chunks and reports the elements and the text as they come,
+// so the memory used does not depend on the size of the document.
+// Only UTF-8 input is supported; comments, processing instructions
+// and doctype declarations are skipped, CDATA sections are reported as text.
+
+class XmlStreamReader final
+{
+public:
+
+    class Listener
+    {
+    public:
+
+        virtual ~Listener() {}
+
+        virtual void onStartElement(const String &name, const StringPairArray &attributes) = 0;
+        virtual void onEndElement(const String &name) = 0;
+
+        // The text of the innermost open element, whitespace-only text is skipped
+        virtual void onText(const String &text) = 0;
+
+    };
+
+    explicit XmlStreamReader(InputStream &input);
+
+    // Returns false if the document is malformed, see getLastError()
+    bool parse(Listener &listener);
+
+    String getLastError() const noexcept;
+
+private:
+
+    int nextChar() noexcept;
+    int peekChar() noexcept;
+
+    bool skipUntil(const char *terminator);
+    bool skipDeclaration();
+    bool readCData(MemoryOutputStream &text);
+    bool readName(int firstChar, String &name);
+    bool readAttributes(bool &isEmptyElement);
+    void readEntity(MemoryOutputStream &out);
+    void flushText(Listener &listener, MemoryOutputStream &text);
+    void skipWhitespace() noexcept;
+
+    bool fail(const String &message);
+
+    InputStream &input;
+
+    HeapBlock<char> buffer;
+    int bufferSize;
+    int position;
+    int lineNumber;
+
+    StringPairArray attributes;
+    String lastError;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(XmlStreamReader)
+};
@@ -0,0 +1,137 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "XmlStreamWriter.h"
+
+XmlStreamWriter::XmlStreamWriter(OutputStream &output) :
+    output(output),
+    hasPendingStartTag(false),
+    hasFailed(false) {}
+
+XmlStreamWriter::~XmlStreamWriter()
+{
+    jassert(this->openElements.size() == 0);
+    this->output.flush();
+}
+
+void XmlStreamWriter::writeHeader(const String &doctype)
+{
+    this->output << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << newLine;
+
+    if (doctype.isNotEmpty())
+    {
+        this->output << doctype << newLine;
+    }
+}
+
+XmlStreamWriter &XmlStreamWriter::startElement(const String &name)
+{
+    this->closeStartTag();
+    this->writeIndent();
+    this->output << "<" << name;
+    this->openElements.add(name);
+    this->hasPendingStartTag = true;
+    return *this;
+}
+
+XmlStreamWriter &XmlStreamWriter::withAttribute(const String &name, const String &value)
+{
+    jassert(this->hasPendingStartTag);
+    this->output << " " << name << "=\"";
+    this->writeEscaped(value);
+    this->output << "\"";
+    return *this;
+}
+
+void XmlStreamWriter::endElement()
+{
+    jassert(this->openElements.size() > 0);
+    const String name(this->openElements[this->openElements.size() - 1]);
+    this->openElements.remove(this->openElements.size() - 1);
+
+    if (this->hasPendingStartTag)
+    {
+        this->output << "/>" << newLine;
+        this->hasPendingStartTag = false;
+    }
+    else
+    {
+        this->writeIndent();
+        this->output << "</" << name << ">" << newLine;
+    }
+
+    this->hasFailed = this->hasFailed || this->output.getStatus().failed();
+}
+
+void XmlStreamWriter::writeElement(const String &name, const String &text)
+{
+    this->closeStartTag();
+    this->writeIndent();
+    this->output << "<" << name << ">";
+    this->writeEscaped(text);
+    this->output << "</" << name << ">" << newLine;
+}
+
+void XmlStreamWriter::writeElement(const String &name, int value)
+{
+    this->writeElement(name, String(value));
+}
+
+void XmlStreamWriter::writeEmptyElement(const String &name)
+{
+    this->startElement(name);
+    this->endElement();
+}
+
+bool XmlStreamWriter::isOk() const noexcept
+{
+    return ! this->hasFailed && ! this->output.getStatus().failed();
+}
+
+void XmlStreamWriter::closeStartTag()
+{
+    if (this->hasPendingStartTag)
+    {
+        this->output << ">" << newLine;
+        this->hasPendingStartTag = false;
+    }
+}
+
+void XmlStreamWriter::writeIndent()
+{
+    for (int i = 0; i < this->openElements.size(); ++i)
+    {
+        this->output << "  ";
+    }
+}
+
+void XmlStreamWriter::writeEscaped(const String &text)
+{
+    // Most of the values are numbers and names, written as they are
+    if (! text.containsAnyOf("&<>\"'"))
+    {
+        this->output << text;
+        return;
+    }
+
+    this->output << text.replace("&", "&amp;")
+        .replace("<", "&lt;")
+        .replace(">", "&gt;")
+        .replace("\"", "&quot;")
+        .replace("'", "&apos;");
+}
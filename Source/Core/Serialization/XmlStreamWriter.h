@@ -0,0 +1,59 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Writes an indented UTF-8 xml document element by element,
+// straight into the stream, without building an XmlElement tree first.
+
+class XmlStreamWriter final
+{
+public:
+
+    explicit XmlStreamWriter(OutputStream &output);
+    ~XmlStreamWriter();
+
+    void writeHeader(const String &doctype = String::empty);
+
+    // Attributes are collected until the element's contents or the end
+    XmlStreamWriter &startElement(const String &name);
+    XmlStreamWriter &withAttribute(const String &name, const String &value);
+    void endElement();
+
+    // Writes a text-only element, <name>text</name>
+    void writeElement(const String &name, const String &text);
+    void writeElement(const String &name, int value);
+
+    // Writes an element with no contents, <name/>
+    void writeEmptyElement(const String &name);
+
+    bool isOk() const noexcept;
+
+private:
+
+    void closeStartTag();
+    void writeIndent();
+    void writeEscaped(const String &text);
+
+    OutputStream &output;
+
+    StringArray openElements;
+    bool hasPendingStartTag;
+    bool hasFailed;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(XmlStreamWriter)
+};
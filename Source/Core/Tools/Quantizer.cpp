@@ -0,0 +1,295 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "Quantizer.h"
+#include "SerializationKeys.h"
+
+#define QUANTIZER_MIN_GRID (1.f / 16.f)
+#define QUANTIZER_MAX_GROOVE_STEPS 64
+
+Quantizer::Quantizer() :
+    gridBeats(0.25f),
+    strength(1.f),
+    swing(0.f),
+    window(1.f),
+    shouldQuantizeLengths(false)
+{
+}
+
+//===----------------------------------------------------------------------===//
+// Accessors
+//===----------------------------------------------------------------------===//
+
+float Quantizer::getGrid() const noexcept
+{
+    return this->gridBeats;
+}
+
+float Quantizer::getStrength() const noexcept
+{
+    return this->strength;
+}
+
+float Quantizer::getSwing() const noexcept
+{
+    return this->swing;
+}
+
+float Quantizer::getWindow() const noexcept
+{
+    return this->window;
+}
+
+bool Quantizer::quantizesLengths() const noexcept
+{
+    return this->shouldQuantizeLengths;
+}
+
+bool Quantizer::hasGroove() const noexcept
+{
+    return (this->grooveOffsets.size() > 0);
+}
+
+int Quantizer::getNumGrooveSteps() const noexcept
+{
+    return jlimit(1, QUANTIZER_MAX_GROOVE_STEPS,
+        roundToInt(float(NUM_BEATS_IN_BAR) / this->gridBeats));
+}
+
+static inline int positiveModulo(int value, int divisor) noexcept
+{
+    const int result = value % divisor;
+    return (result < 0) ? (result + divisor) : result;
+}
+
+//===----------------------------------------------------------------------===//
+// Chains
+//===----------------------------------------------------------------------===//
+
+Quantizer Quantizer::withGrid(float newGridBeats) const
+{
+    Quantizer q(*this);
+    q.gridBeats = jmax(QUANTIZER_MIN_GRID, newGridBeats);
+    // The groove was measured against the old grid
+    q.grooveOffsets.clearQuick();
+    q.grooveVelocities.clearQuick();
+    return q;
+}
+
+Quantizer Quantizer::withStrength(float newStrength) const
+{
+    Quantizer q(*this);
+    q.strength = jlimit(0.f, 1.f, newStrength);
+    return q;
+}
+
+Quantizer Quantizer::withSwing(float newSwing) const
+{
+    Quantizer q(*this);
+    q.swing = jlimit(0.f, 1.f, newSwing);
+    return q;
+}
+
+Quantizer Quantizer::withWindow(float newWindow) const
+{
+    Quantizer q(*this);
+    q.window = jlimit(0.f, 1.f, newWindow);
+    return q;
+}
+
+Quantizer Quantizer::withLengths(bool shouldQuantizeLengths) const
+{
+    Quantizer q(*this);
+    q.shouldQuantizeLengths = shouldQuantizeLengths;
+    return q;
+}
+
+Quantizer Quantizer::withGroove(const Array<Note> &grooveSource) const
+{
+    Quantizer q(*this);
+    q.grooveOffsets.clearQuick();
+    q.grooveVelocities.clearQuick();
+
+    if (grooveSource.size() == 0)
+    {
+        return q;
+    }
+
+    const int numSteps = q.getNumGrooveSteps();
+    Array<float> offsetSums, velocitySums;
+    Array<int> counts;
+    offsetSums.insertMultiple(0, 0.f, numSteps);
+    velocitySums.insertMultiple(0, 0.f, numSteps);
+    counts.insertMultiple(0, 0, numSteps);
+
+    for (const auto &note : grooveSource)
+    {
+        const int step = roundToInt(note.getBeat() / q.gridBeats);
+        const int index = positiveModulo(step, numSteps);
+        offsetSums.getReference(index) += note.getBeat() - float(step) * q.gridBeats;
+        velocitySums.getReference(index) += note.getVelocity();
+        counts.getReference(index)++;
+    }
+
+    for (int i = 0; i < numSteps; ++i)
+    {
+        const int count = counts.getUnchecked(i);
+        q.grooveOffsets.add((count > 0) ? (offsetSums.getUnchecked(i) / count) : 0.f);
+        q.grooveVelocities.add((count > 0) ? (velocitySums.getUnchecked(i) / count) : -1.f);
+    }
+
+    return q;
+}
+
+Quantizer Quantizer::withGrooveFromXml(const XmlElement &xml) const
+{
+    const XmlElement *root = (xml.getTagName() == Serialization::Core::track) ?
+        &xml : xml.getChildByName(Serialization::Core::track);
+
+    if (root == nullptr) { return *this; }
+
+    Array<Note> grooveSource;
+
+    forEachXmlChildElementWithTagName(*root, e, Serialization::Core::note)
+    {
+        grooveSource.add(Note().withParameters(*e));
+    }
+
+    return this->withGroove(grooveSource);
+}
+
+Quantizer Quantizer::withoutGroove() const
+{
+    Quantizer q(*this);
+    q.grooveOffsets.clearQuick();
+    q.grooveVelocities.clearQuick();
+    return q;
+}
+
+//===----------------------------------------------------------------------===//
+// Processing
+//===----------------------------------------------------------------------===//
+
+void Quantizer::process(const float *beats, const float *lengths, const float *velocities,
+    float *outBeats, float *outLengths, float *outVelocities, int numNotes) const noexcept
+{
+    const float grid = this->gridBeats;
+    const float swingOffset = this->swing * grid * 0.5f;
+    const float windowLimit = this->window * grid * 0.5f + 0.0001f;
+    const int numGrooveSteps = this->hasGroove() ? this->grooveOffsets.size() : 0;
+    const float *grooveOffsets = this->grooveOffsets.getRawDataPointer();
+    const float *grooveVelocities = this->grooveVelocities.getRawDataPointer();
+
+    auto getLine = [=](int step) noexcept -> float
+    {
+        const float offset = (numGrooveSteps > 0) ?
+            grooveOffsets[positiveModulo(step, numGrooveSteps)] :
+            ((step & 1) ? swingOffset : 0.f);
+
+        return float(step) * grid + offset;
+    };
+
+    // Both the swing and the groove move the lines by less than
+    // a half of the step, so one of the three closest ones is the nearest
+    auto findNearestStep = [&getLine, grid](float beat) noexcept -> int
+    {
+        const int step = int(floorf(beat / grid));
+        int nearestStep = step - 1;
+        float nearestDistance = fabsf(getLine(step - 1) - beat);
+
+        for (int candidate = step; candidate <= step + 1; ++candidate)
+        {
+            const float distance = fabsf(getLine(candidate) - beat);
+            if (distance < nearestDistance)
+            {
+                nearestDistance = distance;
+                nearestStep = candidate;
+            }
+        }
+
+        return nearestStep;
+    };
+
+    for (int i = 0; i < numNotes; ++i)
+    {
+        const float beat = beats[i];
+        const int step = findNearestStep(beat);
+        const float distance = getLine(step) - beat;
+        const float amount = (fabsf(distance) <= windowLimit) ? this->strength : 0.f;
+        const float newBeat = beat + distance * amount;
+
+        outBeats[i] = newBeat;
+        outLengths[i] = lengths[i];
+        outVelocities[i] = velocities[i];
+
+        if (this->shouldQuantizeLengths)
+        {
+            const float end = beat + lengths[i];
+            const int endStep = jmax(step + 1, findNearestStep(end));
+            const float newEnd = end + (getLine(endStep) - end) * amount;
+            outLengths[i] = jmax(newEnd - newBeat, lengths[i] * (1.f - amount));
+        }
+
+        if (numGrooveSteps > 0)
+        {
+            const float grooveVelocity = grooveVelocities[positiveModulo(step, numGrooveSteps)];
+            if (grooveVelocity >= 0.f)
+            {
+                outVelocities[i] = velocities[i] + (grooveVelocity - velocities[i]) * amount;
+            }
+        }
+    }
+}
+
+Array<Note> Quantizer::process(const Array<Note> &notes) const
+{
+    const int numNotes = notes.size();
+
+    // Structure of arrays: inputs and outputs in one allocation
+    HeapBlock<float> buffer(size_t(numNotes) * 6);
+    float *beats = buffer;
+    float *lengths = beats + numNotes;
+    float *velocities = lengths + numNotes;
+    float *outBeats = velocities + numNotes;
+    float *outLengths = outBeats + numNotes;
+    float *outVelocities = outLengths + numNotes;
+
+    for (int i = 0; i < numNotes; ++i)
+    {
+        const Note &note = notes.getReference(i);
+        beats[i] = note.getBeat();
+        lengths[i] = note.getLength();
+        velocities[i] = note.getVelocity();
+    }
+
+    this->process(beats, lengths, velocities, outBeats, outLengths, outVelocities, numNotes);
+
+    Array<Note> result;
+    result.ensureStorageAllocated(numNotes);
+
+    for (int i = 0; i < numNotes; ++i)
+    {
+        result.add(notes.getReference(i)
+            .withBeat(outBeats[i])
+            .withLength(outLengths[i])
+            .withVelocity(outVelocities[i]));
+    }
+
+    return result;
+}
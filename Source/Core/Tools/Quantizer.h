@@ -0,0 +1,78 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "Note.h"
+
+// Moves the notes towards the grid, or towards a groove template.
+//
+// The grid lines are placed every gridBeats, with every other line
+// delayed by the swing amount (up to a half of the grid step).
+// A groove template, when set, replaces the swing: it holds the average
+// offset and velocity per grid step over one bar of some existing material.
+// Only the notes closer than the window to their grid line are affected,
+// and they are only moved by the strength part of the distance.
+
+class Quantizer
+{
+public:
+
+    Quantizer();
+
+    float getGrid() const noexcept;
+    float getStrength() const noexcept;
+    float getSwing() const noexcept;
+    float getWindow() const noexcept;
+    bool quantizesLengths() const noexcept;
+    bool hasGroove() const noexcept;
+
+    Quantizer withGrid(float newGridBeats) const;
+    Quantizer withStrength(float newStrength) const;
+    Quantizer withSwing(float newSwing) const;
+    Quantizer withWindow(float newWindow) const;
+    Quantizer withLengths(bool shouldQuantizeLengths) const;
+    Quantizer withGroove(const Array<Note> &grooveSource) const;
+    Quantizer withGrooveFromXml(const XmlElement &xml) const;
+    Quantizer withoutGroove() const;
+
+    // The whole selection is processed in a single pass over flat arrays,
+    // so that even the huge performances are quantized in no time
+    void process(const float *beats, const float *lengths, const float *velocities,
+        float *outBeats, float *outLengths, float *outVelocities, int numNotes) const noexcept;
+
+    Array<Note> process(const Array<Note> &notes) const;
+
+private:
+
+    float gridBeats;
+    float strength;
+    float swing;
+    float window;
+    bool shouldQuantizeLengths;
+
+    int getNumGrooveSteps() const noexcept;
+
+    // Per grid step within a bar; velocity is negative for the steps
+    // that had no notes in the groove source
+    Array<float> grooveOffsets;
+    Array<float> grooveVelocities;
+
+    JUCE_LEAK_DETECTOR(Quantizer)
+
+};
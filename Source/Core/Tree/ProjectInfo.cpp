@@ -35,6 +35,7 @@ ProjectInfo::ProjectInfo(ProjectTreeItem &parent) : project(parent)
     this->deltas.add(new VCS::Delta(VCS::DeltaDescription(""), ProjectInfoDeltas::projectFullName));
     this->deltas.add(new VCS::Delta(VCS::DeltaDescription(""), ProjectInfoDeltas::projectAuthor));
     this->deltas.add(new VCS::Delta(VCS::DeltaDescription("initialized"), ProjectInfoDeltas::projectDescription));
+    this->deltas.add(new VCS::Delta(VCS::DeltaDescription(""), ProjectInfoDeltas::projectTuning));
 }
 
 
@@ -57,6 +58,18 @@ void ProjectInfo::setAuthor(String val)         { this->author = val; this->proj
 String ProjectInfo::getDescription() const      { return this->description; }
 void ProjectInfo::setDescription(String val)    { this->description = val; this->project.broadcastChangeProjectInfo(this); }
 
+Tuning ProjectInfo::getTuning() const
+{
+    return this->tuning;
+}
+
+void ProjectInfo::setTuning(const Tuning &val)
+{
+    this->tuning = val;
+    this->project.getTransport().setTuning(val);
+    this->project.broadcastChangeProjectInfo(this);
+}
+
 
 //===----------------------------------------------------------------------===//
 // VCS::TrackedItem
@@ -95,6 +108,10 @@ XmlElement *ProjectInfo::createDeltaDataFor(int index) const
     {
         return this->serializeDescriptionDelta();
     }
+    else if (this->deltas[index]->getType() == ProjectInfoDeltas::projectTuning)
+    {
+        return this->serializeTuningDelta();
+    }
 
     jassertfalse;
     return nullptr;
@@ -128,6 +145,10 @@ void ProjectInfo::resetStateTo(const TrackedItem &newState)
         {
             this->resetDescriptionDelta(newDeltaData);
         }
+        else if (newDelta->getType() == ProjectInfoDeltas::projectTuning)
+        {
+            this->resetTuningDelta(newDeltaData);
+        }
     }
 }
 
@@ -148,6 +169,11 @@ XmlElement *ProjectInfo::serialize() const
     xml->setAttribute(ProjectInfoDeltas::projectAuthor, this->getAuthor());
     xml->setAttribute(ProjectInfoDeltas::projectDescription, this->getDescription());
 
+    if (! this->tuning.isEqualTemperament())
+    {
+        xml->addChildElement(this->tuning.serialize());
+    }
+
     return xml;
 }
 
@@ -168,6 +194,12 @@ void ProjectInfo::deserialize(const XmlElement &xml)
     this->author = root->getStringAttribute(ProjectInfoDeltas::projectAuthor);
     this->description = root->getStringAttribute(ProjectInfoDeltas::projectDescription);
 
+    if (const XmlElement *tuningNode = root->getChildByName(Serialization::Core::tuning))
+    {
+        this->tuning.deserialize(*tuningNode);
+    }
+
+    this->project.getTransport().setTuning(this->tuning);
     this->project.broadcastChangeProjectInfo(this);
 }
 
@@ -176,6 +208,7 @@ void ProjectInfo::reset()
 //    this->fullName = "";
     this->author = "";
     this->description = "";
+    this->tuning.reset();
 }
 
 
@@ -211,6 +244,13 @@ XmlElement *ProjectInfo::serializeDescriptionDelta() const
     return xml;
 }
 
+XmlElement *ProjectInfo::serializeTuningDelta() const
+{
+    auto xml = new XmlElement(ProjectInfoDeltas::projectTuning);
+    xml->addChildElement(this->tuning.serialize());
+    return xml;
+}
+
 void ProjectInfo::resetLicenseDelta(const XmlElement *state)
 {
     jassert(state->getTagName() == ProjectInfoDeltas::projectLicense);
@@ -254,3 +294,19 @@ void ProjectInfo::resetDescriptionDelta(const XmlElement *state)
         this->setDescription(delta);
     }
 }
+
+void ProjectInfo::resetTuningDelta(const XmlElement *state)
+{
+    jassert(state->getTagName() == ProjectInfoDeltas::projectTuning);
+
+    Tuning delta;
+    if (const XmlElement *tuningNode = state->getChildByName(Serialization::Core::tuning))
+    {
+        delta.deserialize(*tuningNode);
+    }
+
+    if (delta != this->tuning)
+    {
+        this->setTuning(delta);
+    }
+}
@@ -23,6 +23,7 @@ class Delta;
 #include "Serializable.h"
 #include "ProjectInfoDiffLogic.h"
 #include "TrackedItem.h"
+#include "Tuning.h"
 
 class ProjectInfo :
     public Serializable,
@@ -49,6 +50,9 @@ public:
     String getDescription() const;
     void setDescription(String val);
 
+    Tuning getTuning() const;
+    void setTuning(const Tuning &val);
+
 
     //===------------------------------------------------------------------===//
     // VCS::TrackedItem
@@ -90,6 +94,8 @@ public:
 
     XmlElement *serializeDescriptionDelta() const;
 
+    XmlElement *serializeTuningDelta() const;
+
     void resetLicenseDelta(const XmlElement *state);
 
     void resetFullNameDelta(const XmlElement *state);
@@ -98,6 +104,8 @@ public:
 
     void resetDescriptionDelta(const XmlElement *state);
 
+    void resetTuningDelta(const XmlElement *state);
+
 private:
 
     ScopedPointer<VCS::ProjectInfoDiffLogic> vcsDiffLogic;
@@ -114,6 +122,8 @@ private:
 
     String license;
 
+    Tuning tuning;
+
     int64 initTimestamp;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectInfo);
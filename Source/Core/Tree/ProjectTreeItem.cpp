@@ -53,12 +53,16 @@
 #include "HelioTheme.h"
 #include "ProjectCommandPanel.h"
 #include "UndoStack.h"
+#include "EditJournal.h"
+#include "CollaborationSession.h"
 
 #include "Workspace.h"
 #include "App.h"
 
 #include "Config.h"
 #include "SerializationKeys.h"
+#include "MusicXmlImporter.h"
+#include "MusicXmlExporter.h"
 
 
 ProjectTreeItem::ProjectTreeItem(const String &name) :
@@ -78,8 +82,15 @@ ProjectTreeItem::ProjectTreeItem(const File &existingFile) :
 void ProjectTreeItem::initialize()
 {
     this->isLayersHashOutdated = true;
+    this->isRegistryOutdated = true;
+    this->bulkChangeDepth = 0;
+    this->hasBulkChanges = false;
     
+    this->journal = new EditJournal();
+    this->lastSavedJournalSequence = 0;
+
     this->undoStack = new UndoStack(*this);
+    this->undoStack->setJournal(this->journal);
     
     this->autosaver = new Autosaver(*this);
 
@@ -119,6 +130,7 @@ ProjectTreeItem::~ProjectTreeItem()
     }
 
     this->projectSettings = nullptr;
+    this->liveSession = nullptr;
 
     this->removeAllListeners();
     this->sequencerLayout = nullptr;
@@ -441,6 +453,58 @@ void ProjectTreeItem::clearUndoHistory()
     this->getUndoStack()->clearUndoHistory();
 }
 
+//===----------------------------------------------------------------------===//
+// Live session
+//===----------------------------------------------------------------------===//
+
+CollaborationSession *ProjectTreeItem::getLiveSession() const noexcept
+{
+    return this->liveSession;
+}
+
+void ProjectTreeItem::setEventIdPrefix(const String &prefix)
+{
+    this->eventIdPrefix = prefix;
+}
+
+const String &ProjectTreeItem::getEventIdPrefix() const noexcept
+{
+    return this->eventIdPrefix;
+}
+
+bool ProjectTreeItem::hostLiveSession(const String &bindAddress, int port)
+{
+    this->liveSession = nullptr;
+
+    ScopedPointer<CollaborationSession> session(new CollaborationSession(*this));
+    if (session->host(bindAddress, port))
+    {
+        this->liveSession = session.release();
+        return true;
+    }
+
+    return false;
+}
+
+bool ProjectTreeItem::joinLiveSession(const String &hostName, int port, const String &token)
+{
+    this->liveSession = nullptr;
+
+    ScopedPointer<CollaborationSession> session(new CollaborationSession(*this));
+    if (session->join(hostName, port, token))
+    {
+        this->liveSession = session.release();
+        return true;
+    }
+
+    return false;
+}
+
+void ProjectTreeItem::leaveLiveSession()
+{
+    this->liveSession = nullptr;
+}
+
 //===----------------------------------------------------------------------===//
 // Project
 //===----------------------------------------------------------------------===//
@@ -587,6 +651,7 @@ XmlElement *ProjectTreeItem::save() const
     //xml->addChildElement(this->sequencerLayout->serialize());
 
     xml->addChildElement(this->undoStack->serialize());
+    xml->setAttribute(Serialization::Undo::journalSequence, this->journal->getLastSequence());
     
     TreeItemChildrenSerializer::serializeChildren(*this, *xml);
 
@@ -636,6 +701,7 @@ void ProjectTreeItem::load(const XmlElement &xml)
     //this->sequencerLayout->deserialize(*root);
     
     this->undoStack->deserialize(*root);
+    this->lastSavedJournalSequence = root->getIntAttribute(Serialization::Undo::journalSequence, 0);
     
     const float seek = float(root->getDoubleAttribute("seek", 0.f));
     this->transport->seekToPosition(seek);
@@ -673,6 +739,18 @@ void ProjectTreeItem::importMidi(File &file)
     this->getDocument()->save();
 }
 
+void ProjectTreeItem::importMusicXml(File &file)
+{
+    // Even if the score turns out to be broken,
+    // the parts read before the error are kept
+    MusicXmlImporter importer(*this);
+    importer.importFile(file);
+
+    this->broadcastReloadProjectContent();
+    this->broadcastChangeProjectBeatRange();
+    this->getDocument()->save();
+}
+
 //===----------------------------------------------------------------------===//
 // ProjectListeners management
 //===----------------------------------------------------------------------===//
@@ -704,6 +782,20 @@ void ProjectTreeItem::broadcastChangeEvent(const MidiEvent &oldEvent, const Midi
 {
     //jassert(oldEvent.isValid()); // old event is allowed to be un-owned
     jassert(newEvent.isValid());
+
+    if (this->bulkChangeDepth > 0)
+    {
+        this->hasBulkChanges = true;
+
+        // Unlike the views, the live session needs every single change
+        if (this->liveSession != nullptr)
+        {
+            this->liveSession->onChangeMidiEvent(oldEvent, newEvent);
+        }
+
+        return;
+    }
+
     this->changeListeners.call(&ProjectListener::onChangeMidiEvent, oldEvent, newEvent);
     this->sendChangeMessage();
 }
@@ -711,6 +803,20 @@ void ProjectTreeItem::broadcastChangeEvent(const MidiEvent &oldEvent, const Midi
 void ProjectTreeItem::broadcastAddEvent(const MidiEvent &event)
 {
     jassert(event.isValid());
+
+    if (this->bulkChangeDepth > 0)
+    {
+        this->hasBulkChanges = true;
+
+        // Unlike the views, the live session needs every single change
+        if (this->liveSession != nullptr)
+        {
+            this->liveSession->onAddMidiEvent(event);
+        }
+
+        return;
+    }
+
     this->changeListeners.call(&ProjectListener::onAddMidiEvent, event);
     this->sendChangeMessage();
 }
@@ -718,12 +824,32 @@ void ProjectTreeItem::broadcastAddEvent(const MidiEvent &event)
 void ProjectTreeItem::broadcastRemoveEvent(const MidiEvent &event)
 {
     jassert(event.isValid());
+
+    if (this->bulkChangeDepth > 0)
+    {
+        this->hasBulkChanges = true;
+
+        // Unlike the views, the live session needs every single change
+        if (this->liveSession != nullptr)
+        {
+            this->liveSession->onRemoveMidiEvent(event);
+        }
+
+        return;
+    }
+
     this->changeListeners.call(&ProjectListener::onRemoveMidiEvent, event);
     this->sendChangeMessage();
 }
 
 void ProjectTreeItem::broadcastPostRemoveEvent(MidiSequence *const layer)
 {
+    if (this->bulkChangeDepth > 0)
+    {
+        this->hasBulkChanges = true;
+        return;
+    }
+
     this->changeListeners.call(&ProjectListener::onPostRemoveMidiEvent, layer);
     this->sendChangeMessage();
 }
@@ -820,6 +946,24 @@ void ProjectTreeItem::broadcastReloadProjectContent()
     this->sendChangeMessage();
 }
 
+void ProjectTreeItem::beginBulkChange() noexcept
+{
+    this->bulkChangeDepth++;
+}
+
+void ProjectTreeItem::endBulkChange()
+{
+    jassert(this->bulkChangeDepth > 0);
+    this->bulkChangeDepth--;
+
+    if (this->bulkChangeDepth == 0 && this->hasBulkChanges)
+    {
+        this->hasBulkChanges = false;
+        this->broadcastReloadProjectContent();
+        this->broadcastChangeProjectBeatRange();
+    }
+}
+
 void ProjectTreeItem::broadcastChangeViewBeatRange(float firstBeat, float lastBeat)
 {
     this->changeListeners.call(&ProjectListener::onChangeViewBeatRange, firstBeat, lastBeat);
@@ -857,20 +1001,72 @@ void ProjectTreeItem::onDocumentDidLoad(File &file)
                               this->getId(),
                               true);
     }
+
+    this->restoreFromJournal();
 }
 
 bool ProjectTreeItem::onDocumentSave(File &file)
 {
     ScopedPointer<XmlElement> xml(this->save());
+    this->lastSavedJournalSequence = this->journal->getLastSequence();
     return DataEncoder::saveObfuscated(file, xml);
 }
 
+void ProjectTreeItem::onDocumentDidSave(File &file)
+{
+    if (this->journal->isOpen())
+    {
+        this->journal->truncate(this->lastSavedJournalSequence);
+    }
+    else
+    {
+        // A new project is journaled from its first save on
+        this->journal->open(EditJournal::getFileForProject(this->getId()),
+            0, this->lastSavedJournalSequence);
+    }
+}
+
+void ProjectTreeItem::restoreFromJournal()
+{
+    const File journalFile(EditJournal::getFileForProject(this->getId()));
+
+    OwnedArray<EditJournal::Record> records;
+    int64 validLength = 0;
+    EditJournal::readRecords(journalFile, this->lastSavedJournalSequence, records, validLength);
+
+    const int numReplayed = this->undoStack->replayJournal(records);
+    int lastSequence = this->lastSavedJournalSequence;
+
+    if (numReplayed > 0)
+    {
+        lastSequence = records[numReplayed - 1]->sequence;
+    }
+
+    if (numReplayed < records.size())
+    {
+        // Whatever could not be applied is dropped with the rest
+        validLength = records[numReplayed]->offset;
+    }
+
+    this->journal->open(journalFile, validLength, lastSequence);
+
+    if (numReplayed > 0)
+    {
+        Logger::writeToLog("Restored " + String(numReplayed) + " unsaved edits from the journal");
+        this->getDocument()->forceSave();
+    }
+}
+
 void ProjectTreeItem::onDocumentImport(File &file)
 {
     if (file.hasFileExtension("mid") || file.hasFileExtension("midi"))
     {
         this->importMidi(file);
     }
+    else if (file.hasFileExtension("musicxml;mxl;xml"))
+    {
+        this->importMusicXml(file);
+    }
 }
 
 bool ProjectTreeItem::onDocumentExport(File &file)
@@ -880,6 +1076,11 @@ bool ProjectTreeItem::onDocumentExport(File &file)
         this->exportMidi(file);
         return true;
     }
+    else if (file.hasFileExtension("musicxml;xml"))
+    {
+        this->exportMusicXml(file);
+        return true;
+    }
 
     return false;
 }
@@ -901,20 +1102,36 @@ void ProjectTreeItem::exportMidi(File &file) const
     tempFile.writeTo(*out);
 }
 
+void ProjectTreeItem::exportMusicXml(File &file) const
+{
+    MusicXmlExporter exporter(*this);
+    exporter.exportFile(file);
+}
+
 //===----------------------------------------------------------------------===//
 // MidiTrackSource
 //===----------------------------------------------------------------------===//
 
 MidiTrack *ProjectTreeItem::getTrackById(const String &trackId)
 {
-    Array<MidiTrackTreeItem *> allChildren = this->findChildrenOfType<MidiTrackTreeItem>();
+    const ScopedLock lock(this->registryLock);
+    this->rebuildRegistryIfNeeded();
 
-    for (int i = 0; i < allChildren.size(); ++i)
+    const auto found = this->registeredTracksById.find(trackId);
+    if (found != this->registeredTracksById.end() &&
+        found->second->getTrackId().toString() == trackId)
     {
-        if (allChildren.getUnchecked(i)->getTrackId().toString() == trackId)
-        {
-            return allChildren.getUnchecked(i);
-        }
+        return found->second;
+    }
+
+    // Track ids are assigned on deserialization, which happens
+    // after the item is attached to the tree, so the index might be stale:
+    this->rebuildTracksByIdIndex();
+
+    const auto retry = this->registeredTracksById.find(trackId);
+    if (retry != this->registeredTracksById.end())
+    {
+        return retry->second;
     }
 
     return nullptr;
@@ -996,6 +1213,8 @@ bool ProjectTreeItem::deleteTrackedItem(VCS::TrackedItem *item)
 
 void ProjectTreeItem::onResetState()
 {
+    // Checkouts are not journaled, the next save makes the journal usable again
+    this->journal->push(EditJournal::Invalidate, nullptr);
     this->broadcastReloadProjectContent();
     this->broadcastChangeProjectBeatRange();
 }
@@ -1046,3 +1265,78 @@ void ProjectTreeItem::rebuildSequencesHashIfNeeded()
         this->isLayersHashOutdated = false;
     }
 }
+
+//===----------------------------------------------------------------------===//
+// Tree items registry
+//===----------------------------------------------------------------------===//
+
+void ProjectTreeItem::onSubtreeChanged()
+{
+    const ScopedLock lock(this->registryLock);
+    this->isRegistryOutdated = true;
+    this->isLayersHashOutdated = true;
+}
+
+static void collectSubtree(const TreeViewItem *rootNode, Array<TreeItem *> &resultArray)
+{
+    for (int i = 0; i < rootNode->getNumSubItems(); ++i)
+    {
+        TreeItem *child = static_cast<TreeItem *>(rootNode->getSubItem(i));
+        resultArray.add(child);
+
+        if (child->getNumSubItems() > 0)
+        {
+            collectSubtree(child, resultArray);
+        }
+    }
+}
+
+void ProjectTreeItem::rebuildRegistryIfNeeded() const
+{
+    if (this->isRegistryOutdated)
+    {
+        this->registeredItems.clearQuick();
+        this->registeredItemsByType.clear();
+        collectSubtree(this, this->registeredItems);
+        this->isRegistryOutdated = false;
+        this->rebuildTracksByIdIndex();
+    }
+}
+
+void ProjectTreeItem::rebuildTracksByIdIndex() const
+{
+    this->registeredTracksById.clear();
+
+    const auto &tracks = this->getRegisteredItemsOfType(typeid(MidiTrackTreeItem),
+        [](TreeItem *item) { return dynamic_cast<MidiTrackTreeItem *>(item) != nullptr; });
+
+    for (auto item : tracks)
+    {
+        MidiTrackTreeItem *track = static_cast<MidiTrackTreeItem *>(item);
+        this->registeredTracksById[track->getTrackId().toString()] = track;
+    }
+}
+
+const Array<TreeItem *> &ProjectTreeItem::getRegisteredItemsOfType(const std::type_index &type,
+    const TypeFilter &filter) const
+{
+    this->rebuildRegistryIfNeeded();
+
+    auto found = this->registeredItemsByType.find(type);
+    if (found != this->registeredItemsByType.end())
+    {
+        return found->second;
+    }
+
+    Array<TreeItem *> &itemsOfType = this->registeredItemsByType[type];
+
+    for (auto item : this->registeredItems)
+    {
+        if (filter(item))
+        {
+            itemsOfType.add(item);
+        }
+    }
+
+    return itemsOfType;
+}
@@ -21,6 +21,8 @@
 #define PROJECT_HAS_MAP_RENDERER 0
 
 class Autosaver;
+class EditJournal;
+class CollaborationSession;
 class Document;
 class Project;
 class ProjectListener;
@@ -38,6 +40,7 @@ class ToolsSidebar;
 class UndoStack;
 class RecentFilesList;
 class Pattern;
+class MidiTrackTreeItem;
 
 #include "TreeItem.h"
 #include "DocumentOwner.h"
@@ -48,6 +51,8 @@ class Pattern;
 #include "MidiSequence.h"
 #include "MidiTrackSource.h"
 
+#include <typeindex>
+
 class ProjectTreeItem :
     public TreeItem,
     public DocumentOwner,
@@ -75,6 +80,9 @@ public:
     void importMidi(File &file);
     void exportMidi(File &file) const;
 
+    void importMusicXml(File &file);
+    void exportMusicXml(File &file) const;
+
     Colour getColour() const override;
     Image getIcon() const override;
 
@@ -116,12 +124,53 @@ public:
     void redo();
     void clearUndoHistory();
 
+    //===------------------------------------------------------------------===//
+    // Live session
+    //===------------------------------------------------------------------===//
+
+    CollaborationSession *getLiveSession() const noexcept;
+    bool hostLiveSession(const String &bindAddress, int port);
+    bool joinLiveSession(const String &hostName, int port, const String &token);
+    void leaveLiveSession();
+
+    // All new event ids in this project start with it (none by default);
+    // set while in a live session, so that the ids created by different
+    // peers never collide
+    void setEventIdPrefix(const String &prefix);
+    const String &getEventIdPrefix() const noexcept;
+
     //===------------------------------------------------------------------===//
     // Accessors
     //===------------------------------------------------------------------===//
 
     Array<MidiTrack *> getTracks() const;
     Array<MidiTrack *> getSelectedTracks() const;
+
+    // Same as TreeItem::findChildrenOfType, but instead of walking
+    // the whole tree on every call, picks items from the registry,
+    // which is only rebuilt when the project subtree changes:
+    template<typename T>
+    Array<T *> findChildrenOfType(bool pickOnlySelectedOnes = false) const
+    {
+        const ScopedLock lock(this->registryLock);
+        const Array<TreeItem *> &items =
+            this->getRegisteredItemsOfType(typeid(T),
+                [](TreeItem *item) { return dynamic_cast<T *>(item) != nullptr; });
+
+        Array<T *> result;
+        result.ensureStorageAllocated(items.size());
+
+        for (auto item : items)
+        {
+            if (!pickOnlySelectedOnes || item->isSelected())
+            {
+                result.add(dynamic_cast<T *>(item));
+            }
+        }
+
+        return result;
+    }
+
     Point<float> getProjectRangeInBeats() const;
 
     //===------------------------------------------------------------------===//
@@ -163,6 +212,11 @@ public:
     void broadcastReloadProjectContent();
     Point<float> broadcastChangeProjectBeatRange();
 
+    // Bulk edits hold back the per-event notifications
+    // until the outermost bulk change ends, and then reload the content once
+    void beginBulkChange() noexcept;
+    void endBulkChange();
+
     //===------------------------------------------------------------------===//
     // VCS::TrackedItemsSource
     //===------------------------------------------------------------------===//
@@ -180,6 +234,12 @@ public:
 
     void changeListenerCallback(ChangeBroadcaster *source) override;
 
+    //===------------------------------------------------------------------===//
+    // TreeItem
+    //===------------------------------------------------------------------===//
+
+    void onSubtreeChanged() override;
+
 protected:
 
     //===------------------------------------------------------------------===//
@@ -189,6 +249,7 @@ protected:
     bool onDocumentLoad(File &file) override;
     void onDocumentDidLoad(File &file) override;
     bool onDocumentSave(File &file) override;
+    void onDocumentDidSave(File &file) override;
     void onDocumentImport(File &file) override;
     bool onDocumentExport(File &file) override;
 
@@ -230,16 +291,52 @@ private:
     XmlElement *save() const;
     void load(const XmlElement &xml);
 
+    void restoreFromJournal();
+
 private:
 
     ReadWriteLock vcsInfoLock;
     Array<const VCS::TrackedItem *> vcsItems;
 
+    // Outlives the undo stack that pushes to it
+    ScopedPointer<EditJournal> journal;
+    int lastSavedJournalSequence;
+
     ScopedPointer<UndoStack> undoStack;
 
+    ScopedPointer<CollaborationSession> liveSession;
+    String eventIdPrefix;
+
+    int bulkChangeDepth;
+    bool hasBulkChanges;
+
     bool isLayersHashOutdated;
     SparseHashMap<String, WeakReference<MidiSequence>, StringHash> sequencesHash;
 
     void rebuildSequencesHashIfNeeded();
 
+private:
+
+    //===------------------------------------------------------------------===//
+    // Tree items registry
+    //===------------------------------------------------------------------===//
+
+    typedef std::function<bool(TreeItem *)> TypeFilter;
+    typedef SparseHashMap<std::type_index, Array<TreeItem *>, std::hash<std::type_index>> ItemsByTypeMap;
+    typedef SparseHashMap<String, MidiTrackTreeItem *, StringHash> TracksByIdMap;
+
+    CriticalSection registryLock;
+
+    // All the subtree items in the depth-first order, same as the tree walk gives;
+    // per-type lists are filtered from it on demand and kept until the next change:
+    mutable bool isRegistryOutdated;
+    mutable Array<TreeItem *> registeredItems;
+    mutable ItemsByTypeMap registeredItemsByType;
+    mutable TracksByIdMap registeredTracksById;
+
+    void rebuildRegistryIfNeeded() const;
+    void rebuildTracksByIdIndex() const;
+    const Array<TreeItem *> &getRegisteredItemsOfType(const std::type_index &type,
+        const TypeFilter &filter) const;
+
 };
@@ -217,6 +217,19 @@ void TreeItem::deleteAllSubItems()
     }
 }
 
+static void notifyAncestorsSubtreeChanged(TreeViewItem *node)
+{
+    while (node != nullptr)
+    {
+        if (TreeItem *treeItem = dynamic_cast<TreeItem *>(node))
+        {
+            treeItem->onSubtreeChanged();
+        }
+
+        node = node->getParentItem();
+    }
+}
+
 void TreeItem::removeItemFromParent()
 {
     if (TreeItem *parent = dynamic_cast<TreeItem *>(this->getParentItem()))
@@ -231,6 +244,8 @@ void TreeItem::removeItemFromParent()
                 }
             }
         }
+
+        notifyAncestorsSubtreeChanged(parent);
     }
 }
 
@@ -248,6 +263,7 @@ static void notifySubtreeParentChanged(TreeItem *node)
 void TreeItem::addChildTreeItem(TreeItem *child, int insertIndex /*= -1*/)
 {
     this->addSubItem(child, insertIndex);
+    notifyAncestorsSubtreeChanged(this);
     notifySubtreeParentChanged(child);
 }
 
@@ -484,6 +500,7 @@ void TreeItem::itemDropped(const DragAndDropTarget::SourceDetails &dragSourceDet
             }
         }
 
+        notifyAncestorsSubtreeChanged(parent);
         this->addChildTreeItem(selected, insertIndex + insertIndexCorrection);
     }
 }
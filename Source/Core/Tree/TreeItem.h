@@ -56,6 +56,10 @@ public:
 
     virtual void onItemParentChanged() {}
 
+    // Called for every ancestor, whenever any item is added, removed
+    // or moved somewhere in its subtree, so that it can drop its caches:
+    virtual void onSubtreeChanged() {}
+
     virtual void safeRename(const String &newName);
     void addChildTreeItem(TreeItem *child, int insertIndex = -1);
     void dispatchChangeTreeItemView();
@@ -245,6 +245,21 @@ bool VersionControlTreeItem::deletePermanentlyFromRemoteRepo()
     return false;
 }
 
+VCS::BlameIndex *VersionControlTreeItem::getBlameIndex() const
+{
+    if (this->vcs)
+    {
+        return &this->vcs->getBlameIndex();
+    }
+
+    return nullptr;
+}
+
+VersionControl *VersionControlTreeItem::getVersionControl() const
+{
+    return this->vcs;
+}
+
 void VersionControlTreeItem::toggleQuickStash()
 {
     if (! this->vcs)
@@ -21,6 +21,11 @@
 
 class VersionControl;
 class VersionControlEditor;
+
+namespace VCS
+{
+    class BlameIndex;
+}
 class ProjectTreeItem;
 
 class VersionControlTreeItem :
@@ -47,6 +52,10 @@ public:
 
     bool deletePermanentlyFromRemoteRepo();
     void toggleQuickStash();
+
+    // Both return nullptr if the vcs is not initialized yet
+    VCS::BlameIndex *getBlameIndex() const;
+    VersionControl *getVersionControl() const;
     
     
     //===------------------------------------------------------------------===//
@@ -21,10 +21,15 @@ class MidiTrackSource;
 
 #include "Serializable.h"
 
-class UndoAction : public Serializable
+// Reference-counted, so that the actions the undo stack keeps
+// can also be collected elsewhere, e.g. to journal the live session edits
+
+class UndoAction : public Serializable, public ReferenceCountedObject
 {
 public:
 
+    typedef ReferenceCountedObjectPtr<UndoAction> Ptr;
+
     explicit UndoAction(MidiTrackSource &trackSource) noexcept : source(trackSource) {}
     ~UndoAction() override {}
 
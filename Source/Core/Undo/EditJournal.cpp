@@ -0,0 +1,354 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "EditJournal.h"
+#include "FileUtils.h"
+
+#define EDIT_JOURNAL_FIFO_SIZE 4096
+#define EDIT_JOURNAL_WRITE_INTERVAL_MS 100
+#define EDIT_JOURNAL_SYNC_INTERVAL_MS 1000
+#define EDIT_JOURNAL_STOP_TIMEOUT_MS 5000
+
+// Not a record type: the queued request to drop everything saved so far
+#define EDIT_JOURNAL_TRUNCATE 0
+
+static const int kJournalMagicNumber =
+    static_cast<int>(ByteOrder::littleEndianInt("HEJ1"));
+
+// Only used to detect the records torn by a crash (FNV-1a)
+static uint32 computeChecksum(const void *data, size_t size) noexcept
+{
+    const uint8 *bytes = static_cast<const uint8 *>(data);
+    uint32 hash = 2166136261u;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+EditJournal::EditJournal() :
+    Thread("EditJournal"),
+    initialValidLength(0),
+    lastSequence(0),
+    hasOverflowed(false),
+    fifo(EDIT_JOURNAL_FIFO_SIZE),
+    numRecordsWritten(0)
+{
+    this->fifoBuffer.resize(EDIT_JOURNAL_FIFO_SIZE);
+}
+
+EditJournal::~EditJournal()
+{
+    this->signalThreadShouldExit();
+    this->notify();
+    this->stopThread(EDIT_JOURNAL_STOP_TIMEOUT_MS);
+
+    // Whatever the writer has not taken
+    int start1, size1, start2, size2;
+    this->fifo.prepareToRead(this->fifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int i = 0; i < size1; ++i)
+    {
+        delete this->fifoBuffer.getReference(start1 + i).payload;
+    }
+
+    for (int i = 0; i < size2; ++i)
+    {
+        delete this->fifoBuffer.getReference(start2 + i).payload;
+    }
+
+    this->fifo.finishedRead(size1 + size2);
+}
+
+File EditJournal::getFileForProject(const String &projectId)
+{
+    return FileUtils::getConfigSlot("journal_" + projectId + ".bin");
+}
+
+//===----------------------------------------------------------------------===//
+// Message thread
+//===----------------------------------------------------------------------===//
+
+void EditJournal::open(const File &journalFile, int64 validLength, int sequence)
+{
+    jassert(!this->isOpen());
+
+    this->file = journalFile;
+    this->initialValidLength = validLength;
+    this->lastSequence = sequence;
+    this->startThread(3);
+}
+
+bool EditJournal::isOpen() const noexcept
+{
+    return (this->file != File());
+}
+
+int EditJournal::getLastSequence() const noexcept
+{
+    return this->lastSequence;
+}
+
+void EditJournal::push(RecordType type, XmlElement *payload) noexcept
+{
+    ScopedPointer<XmlElement> record(payload);
+
+    if (!this->isOpen())
+    {
+        return;
+    }
+
+    // After an overflow, the replay has to stop where the lost records were
+    if (this->hasOverflowed)
+    {
+        if (!this->enqueue(Invalidate, nullptr))
+        {
+            return;
+        }
+
+        this->hasOverflowed = false;
+    }
+
+    if (this->enqueue(type, record))
+    {
+        record.release();
+    }
+    else
+    {
+        this->hasOverflowed = true;
+        Logger::writeToLog("EditJournal: the writer is behind, the journal is incomplete until the next save");
+    }
+}
+
+void EditJournal::truncate(int lastSavedSequence) noexcept
+{
+    if (!this->isOpen())
+    {
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    this->fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        // Nothing bad happens, the saved records will just be skipped on restore
+        return;
+    }
+
+    QueuedRecord &slot = this->fifoBuffer.getReference(size1 > 0 ? start1 : start2);
+    slot.type = EDIT_JOURNAL_TRUNCATE;
+    slot.sequence = lastSavedSequence;
+    slot.payload = nullptr;
+    this->fifo.finishedWrite(1);
+
+    // Whatever was lost before the save is in the file now
+    this->hasOverflowed = false;
+}
+
+bool EditJournal::enqueue(int type, XmlElement *payload) noexcept
+{
+    int start1, size1, start2, size2;
+    this->fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+    if (size1 + size2 == 0)
+    {
+        return false;
+    }
+
+    QueuedRecord &slot = this->fifoBuffer.getReference(size1 > 0 ? start1 : start2);
+    slot.type = type;
+    slot.sequence = ++this->lastSequence;
+    slot.payload = payload;
+    this->fifo.finishedWrite(1);
+    return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Writer thread
+//===----------------------------------------------------------------------===//
+
+void EditJournal::run()
+{
+    {
+        FileOutputStream out(this->file);
+
+        if (out.failedToOpen())
+        {
+            Logger::writeToLog("EditJournal: cannot open " + this->file.getFullPathName());
+            return;
+        }
+
+        if (out.getPosition() > this->initialValidLength)
+        {
+            out.setPosition(this->initialValidLength);
+            out.truncate();
+        }
+
+        if (out.getPosition() == 0)
+        {
+            this->writeHeader(out);
+        }
+
+        this->numRecordsWritten = (out.getPosition() > int64(sizeof(int))) ? 1 : 0;
+
+        uint32 lastSyncTime = Time::getMillisecondCounter();
+        bool needsSync = false;
+
+        while (!this->threadShouldExit())
+        {
+            this->wait(EDIT_JOURNAL_WRITE_INTERVAL_MS);
+
+            if (this->fifo.getNumReady() > 0)
+            {
+                this->writePendingRecords(out);
+                needsSync = true;
+            }
+
+            const uint32 now = Time::getMillisecondCounter();
+            if (needsSync && (now - lastSyncTime) >= EDIT_JOURNAL_SYNC_INTERVAL_MS)
+            {
+                out.flush(); // also syncs the file to disk
+                lastSyncTime = now;
+                needsSync = false;
+            }
+        }
+
+        this->writePendingRecords(out);
+        out.flush();
+    }
+
+    // A clean shutdown right after a save leaves nothing to restore
+    if (this->numRecordsWritten == 0)
+    {
+        this->file.deleteFile();
+    }
+}
+
+void EditJournal::writeHeader(FileOutputStream &out)
+{
+    out.writeInt(kJournalMagicNumber);
+}
+
+void EditJournal::writePendingRecords(FileOutputStream &out)
+{
+    int start1, size1, start2, size2;
+    this->fifo.prepareToRead(this->fifo.getNumReady(), start1, size1, start2, size2);
+
+    MemoryOutputStream body;
+
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        QueuedRecord &record = this->fifoBuffer.getReference((i < size1) ? (start1 + i) : (start2 + i - size1));
+        ScopedPointer<XmlElement> payload(record.payload);
+        record.payload = nullptr;
+
+        if (record.type == EDIT_JOURNAL_TRUNCATE)
+        {
+            out.setPosition(0);
+            out.truncate();
+            this->writeHeader(out);
+            this->numRecordsWritten = 0;
+            continue;
+        }
+
+        body.reset();
+        body.writeByte(static_cast<char>(record.type));
+        body.writeInt(record.sequence);
+
+        if (payload != nullptr)
+        {
+            ValueTree::fromXml(*payload).writeToStream(body);
+        }
+
+        out.writeInt(static_cast<int>(body.getDataSize()));
+        out.writeInt(static_cast<int>(computeChecksum(body.getData(), body.getDataSize())));
+        out.write(body.getData(), body.getDataSize());
+        this->numRecordsWritten++;
+    }
+
+    this->fifo.finishedRead(size1 + size2);
+}
+
+//===----------------------------------------------------------------------===//
+// Restore
+//===----------------------------------------------------------------------===//
+
+void EditJournal::readRecords(const File &file, int lastSavedSequence,
+    OwnedArray<Record> &result, int64 &validLength)
+{
+    validLength = 0;
+
+    FileInputStream in(file);
+    if (!in.openedOk() || in.readInt() != kJournalMagicNumber)
+    {
+        return;
+    }
+
+    validLength = in.getPosition();
+
+    while (!in.isExhausted())
+    {
+        const int64 offset = in.getPosition();
+        const int size = in.readInt();
+        const uint32 checksum = static_cast<uint32>(in.readInt());
+
+        if (size < 5 || size > (in.getTotalLength() - in.getPosition()))
+        {
+            break; // torn by a crash
+        }
+
+        MemoryBlock body;
+        if (in.readIntoMemoryBlock(body, size) != size_t(size) ||
+            computeChecksum(body.getData(), body.getSize()) != checksum)
+        {
+            break;
+        }
+
+        MemoryInputStream bodyStream(body, false);
+        const int type = bodyStream.readByte();
+        const int sequence = bodyStream.readInt();
+
+        if (sequence > lastSavedSequence && type == Invalidate)
+        {
+            break;
+        }
+
+        validLength = in.getPosition();
+
+        if (sequence <= lastSavedSequence)
+        {
+            continue; // these ones made it into the project file
+        }
+
+        ScopedPointer<Record> record(new Record());
+        record->type = RecordType(type);
+        record->sequence = sequence;
+        record->offset = offset;
+
+        if (!bodyStream.isExhausted())
+        {
+            record->payload = ValueTree::readFromStream(bodyStream).createXml();
+        }
+
+        result.add(record.release());
+    }
+}
@@ -0,0 +1,109 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Write-ahead journal of the edits made since the last save.
+//
+// UndoStack pushes every performed, undone and redone action here, so that
+// after a crash the project can be restored from its last saved state plus
+// the journal. Pushing serializes the action right away, so the queued xml
+// is a snapshot the writer never shares with the editing code, and puts it
+// into a lock-free queue; encoding the records in binary form and writing
+// them is left to a background thread, which syncs the file to disk every second.
+//
+// Every record has a sequence number, and the project file stores the last
+// one it includes, so the records that were saved (but not yet truncated
+// away when the app went down) are never replayed twice.
+
+class EditJournal : private Thread
+{
+public:
+
+    EditJournal();
+    ~EditJournal() override;
+
+    enum RecordType
+    {
+        Perform = 1,
+        Undo = 2,
+        Redo = 3,
+        NewTransaction = 4,
+        // Something has changed outside of the undo stack,
+        // the records that follow cannot be replayed
+        Invalidate = 5,
+        // Changes made outside of the undo stack, but known in detail
+        // (e.g. the edits of the live session peers); replayed as they are
+        External = 6
+    };
+
+    struct Record
+    {
+        RecordType type;
+        int sequence;
+        int64 offset;
+        ScopedPointer<XmlElement> payload;
+    };
+
+    static File getFileForProject(const String &projectId);
+
+    // Reads the records newer than lastSavedSequence, up to the first
+    // invalidated or torn one; validLength is where the valid data ends
+    static void readRecords(const File &file, int lastSavedSequence,
+        OwnedArray<Record> &result, int64 &validLength);
+
+    // Starts appending to the file, cutting off everything after validLength
+    void open(const File &file, int64 validLength, int lastSequence);
+    bool isOpen() const noexcept;
+
+    // Called from the message thread only (single producer).
+    // Takes ownership of the payload; does nothing if the journal isn't open.
+    void push(RecordType type, XmlElement *payload) noexcept;
+
+    int getLastSequence() const noexcept;
+
+    // Called after the project has been saved with everything up to lastSavedSequence
+    void truncate(int lastSavedSequence) noexcept;
+
+private:
+
+    void run() override;
+
+    bool enqueue(int type, XmlElement *payload) noexcept;
+    void writePendingRecords(FileOutputStream &out);
+    void writeHeader(FileOutputStream &out);
+
+    struct QueuedRecord
+    {
+        int type;
+        int sequence;
+        XmlElement *payload;
+    };
+
+    File file;
+    int64 initialValidLength;
+    int lastSequence;
+    bool hasOverflowed;
+
+    AbstractFifo fifo;
+    Array<QueuedRecord> fifoBuffer;
+
+    // Owned by the writer thread
+    int numRecordsWritten;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EditJournal)
+};
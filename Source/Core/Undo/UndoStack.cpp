@@ -34,6 +34,24 @@
 
 #define MAX_TRANSACTIONS_TO_STORE 10
 
+static XmlElement *createTransactionXml(const String &name,
+    const ReferenceCountedArray<UndoAction> &actions)
+{
+    auto xml = new XmlElement(Serialization::Undo::transaction);
+    xml->setAttribute(Serialization::Undo::name, name);
+
+    for (int i = 0; i < actions.size(); ++i)
+    {
+        xml->addChildElement(actions.getUnchecked(i)->serialize());
+    }
+
+    return xml;
+}
+
+//===----------------------------------------------------------------------===//
+// ActionSet
+//===----------------------------------------------------------------------===//
+
 UndoStack::ActionSet::ActionSet(ProjectTreeItem &parentProject, String transactionName) :
 project(parentProject),
 name(std::move(transactionName)) {}
@@ -77,16 +95,7 @@ int UndoStack::ActionSet::getTotalSize() const
     
 XmlElement *UndoStack::ActionSet::serialize() const
 {
-    auto xml = new XmlElement(Serialization::Undo::transaction);
-        
-    xml->setAttribute(Serialization::Undo::name, this->name);
-        
-    for (int i = 0; i < this->actions.size(); ++i)
-    {
-        xml->addChildElement(this->actions.getUnchecked(i)->serialize());
-    }
-        
-    return xml;
+    return createTransactionXml(this->name, this->actions);
 }
     
 void UndoStack::ActionSet::deserialize(const XmlElement &xml)
@@ -162,6 +171,7 @@ UndoStack::UndoStack (ProjectTreeItem &parentProject,
     const int maxNumberOfUnitsToKeep,
     const int minimumTransactions) :
     project(parentProject),
+    journal(nullptr),
     totalUnitsStored(0),
     nextIndex(0),
     newTransaction(true),
@@ -171,6 +181,11 @@ UndoStack::UndoStack (ProjectTreeItem &parentProject,
 
 void UndoStack::clearUndoHistory()
 {
+    if (this->journal != nullptr)
+    {
+        this->journal->push(EditJournal::Invalidate, nullptr);
+    }
+
     transactions.clear();
     totalUnitsStored = 0;
     nextIndex = 0;
@@ -196,7 +211,7 @@ bool UndoStack::perform (UndoAction *const newAction)
 {
     if (newAction != nullptr)
     {
-        ScopedPointer<UndoAction> action (newAction);
+        UndoAction::Ptr action (newAction);
         
         if (reentrancyCheck)
         {
@@ -207,6 +222,11 @@ bool UndoStack::perform (UndoAction *const newAction)
         
         if (action->perform())
         {
+            if (this->journal != nullptr)
+            {
+                this->journal->push(EditJournal::Perform, action->serialize());
+            }
+
             ActionSet *actionSet = getCurrentSet();
             
             if (actionSet != nullptr && ! newTransaction)
@@ -215,7 +235,7 @@ bool UndoStack::perform (UndoAction *const newAction)
                 {
                     if (UndoAction *const lastAction = actionSet->actions[i])
                     {
-                        if (UndoAction *const coalescedAction = lastAction->createCoalescedAction(action))
+                        if (UndoAction *const coalescedAction = lastAction->createCoalescedAction(action.get()))
                         {
                             action = coalescedAction;
                             totalUnitsStored -= lastAction->getSizeInUnits();
@@ -233,7 +253,7 @@ bool UndoStack::perform (UndoAction *const newAction)
             }
             
             totalUnitsStored += action->getSizeInUnits();
-            actionSet->actions.add (action.release());
+            actionSet->actions.add (action);
             newTransaction = false;
             //Logger::writeToLog("size " + String(actionSet->actions.size()));
             
@@ -275,6 +295,11 @@ void UndoStack::beginNewTransaction() noexcept
 
 void UndoStack::beginNewTransaction (const String& actionName) noexcept
 {
+    if (this->journal != nullptr && ! newTransaction)
+    {
+        this->journal->push(EditJournal::NewTransaction, nullptr);
+    }
+
     newTransaction = true;
     newTransactionName = actionName;
 }
@@ -301,6 +326,9 @@ bool UndoStack::undo()
         const ScopedValueSetter<bool> setter (reentrancyCheck, true);
         
         if (s->undo()) {
+            if (this->journal != nullptr) {
+                this->journal->push(EditJournal::Undo, s->serialize());
+            }
             --nextIndex;
         } else {
             clearUndoHistory();
@@ -321,6 +349,9 @@ bool UndoStack::redo()
         const ScopedValueSetter<bool> setter (reentrancyCheck, true);
         
         if (s->perform()) {
+            if (this->journal != nullptr) {
+                this->journal->push(EditJournal::Redo, s->serialize());
+            }
             ++nextIndex;
         } else {
             clearUndoHistory();
@@ -379,6 +410,110 @@ int UndoStack::getNumActionsInCurrentTransaction() const
     return 0;
 }
 
+//===----------------------------------------------------------------------===//
+// Journal
+//===----------------------------------------------------------------------===//
+
+void UndoStack::setJournal(EditJournal *editJournal) noexcept
+{
+    this->journal = editJournal;
+}
+
+int UndoStack::replayJournal(const OwnedArray<EditJournal::Record> &records)
+{
+    // The journal isn't open yet, so nothing replayed here is journaled again
+    jassert(this->journal == nullptr || ! this->journal->isOpen());
+
+    ActionSet replayedSet(this->project, String::empty);
+
+    for (int i = 0; i < records.size(); ++i)
+    {
+        const EditJournal::Record *record = records.getUnchecked(i);
+        const bool needsPayload = (record->type != EditJournal::NewTransaction);
+        if (needsPayload && record->payload == nullptr)
+        {
+            return i;
+        }
+
+        switch (record->type)
+        {
+            case EditJournal::Perform:
+            {
+                UndoAction *action = replayedSet.createUndoActionsByTagName(record->payload->getTagName());
+                if (action == nullptr)
+                {
+                    return i;
+                }
+
+                action->deserialize(*record->payload);
+                if (! this->perform(action))
+                {
+                    return i;
+                }
+
+                break;
+            }
+
+            // The saved stack holds only the latest transactions, so the ones
+            // undone or redone beyond them are re-applied from the journal copy
+            case EditJournal::Undo:
+                if (this->canUndo())
+                {
+                    this->undo();
+                }
+                else
+                {
+                    replayedSet.deserialize(*record->payload);
+                    if (! replayedSet.undo())
+                    {
+                        return i;
+                    }
+                }
+                break;
+
+            case EditJournal::Redo:
+                if (this->canRedo())
+                {
+                    this->redo();
+                }
+                else
+                {
+                    replayedSet.deserialize(*record->payload);
+                    if (! replayedSet.perform())
+                    {
+                        return i;
+                    }
+                }
+                break;
+
+            case EditJournal::NewTransaction:
+                this->beginNewTransaction();
+                break;
+
+            case EditJournal::External:
+                replayedSet.deserialize(*record->payload);
+                if (! replayedSet.perform())
+                {
+                    return i;
+                }
+                break;
+
+            default:
+                return i;
+        }
+    }
+
+    return records.size();
+}
+
+void UndoStack::journalExternalChanges(const ReferenceCountedArray<UndoAction> &actions)
+{
+    if (this->journal != nullptr && actions.size() > 0)
+    {
+        this->journal->push(EditJournal::External, createTransactionXml(String::empty, actions));
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Serializable
 //===----------------------------------------------------------------------===//
@@ -21,6 +21,7 @@ class ProjectTreeItem;
 
 #include "UndoAction.h"
 #include "Serializable.h"
+#include "EditJournal.h"
 
 class UndoStack : public ChangeBroadcaster, public Serializable
 {
@@ -48,6 +49,17 @@ public:
     bool canRedo() const noexcept;
     String getRedoDescription() const;
     bool redo();
+
+    // Every change made from now on is pushed to the journal
+    void setJournal(EditJournal *editJournal) noexcept;
+
+    // Re-applies the journal records on top of the saved state;
+    // returns the number of records replayed before the first one that failed
+    int replayJournal(const OwnedArray<EditJournal::Record> &records);
+
+    // Journals the changes that bypassed the stack, as the actions
+    // that would make them again; these are never undoable
+    void journalExternalChanges(const ReferenceCountedArray<UndoAction> &actions);
     
     XmlElement *serialize() const override;
     void deserialize(const XmlElement &xml) override;
@@ -59,6 +71,7 @@ private:
     int getNumActionsInCurrentTransaction() const;
 
     ProjectTreeItem &project;
+    EditJournal *journal;
     
     struct ActionSet
     {
@@ -74,7 +87,7 @@ private:
 
         UndoAction *createUndoActionsByTagName(const String &tagName);
 
-        OwnedArray<UndoAction> actions;
+        ReferenceCountedArray<UndoAction> actions;
         String name;
 
         ProjectTreeItem &project;
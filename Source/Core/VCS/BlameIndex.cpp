@@ -0,0 +1,520 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "BlameIndex.h"
+#include "Revision.h"
+#include "Delta.h"
+#include "FileUtils.h"
+
+#include "PianoSequenceDeltas.h"
+#include "AutoSequenceDeltas.h"
+#include "PatternDeltas.h"
+#include "ProjectTimelineDeltas.h"
+
+using namespace VCS;
+
+#define BLAME_INDEX_MAGIC_NUMBER 0x4d414c42
+#define BLAME_INDEX_THREAD_STOP_TIMEOUT 5000
+
+// More new revisions than that are indexed in the background
+#define BLAME_INDEX_MAX_INCREMENTAL_REVISIONS 8
+
+static bool checkIfDeltaAddsEvents(const String &deltaType)
+{
+    return (deltaType == PianoSequenceDeltas::notesAdded ||
+            deltaType == AutoSequenceDeltas::eventsAdded ||
+            deltaType == PatternDeltas::clipsAdded ||
+            deltaType == ProjectTimelineDeltas::annotationsAdded ||
+            deltaType == ProjectTimelineDeltas::timeSignaturesAdded ||
+            deltaType == ProjectTimelineDeltas::keySignaturesAdded);
+}
+
+static bool checkIfDeltaChangesEvents(const String &deltaType)
+{
+    return (deltaType == PianoSequenceDeltas::notesChanged ||
+            deltaType == AutoSequenceDeltas::eventsChanged ||
+            deltaType == PatternDeltas::clipsChanged ||
+            deltaType == ProjectTimelineDeltas::annotationsChanged ||
+            deltaType == ProjectTimelineDeltas::timeSignaturesChanged ||
+            deltaType == ProjectTimelineDeltas::keySignaturesChanged);
+}
+
+static bool checkIfDeltaRemovesEvents(const String &deltaType)
+{
+    return (deltaType == PianoSequenceDeltas::notesRemoved ||
+            deltaType == AutoSequenceDeltas::eventsRemoved ||
+            deltaType == PatternDeltas::clipsRemoved ||
+            deltaType == ProjectTimelineDeltas::annotationsRemoved ||
+            deltaType == ProjectTimelineDeltas::timeSignaturesRemoved ||
+            deltaType == ProjectTimelineDeltas::keySignaturesRemoved);
+}
+
+// Keyed by the tracked item first, so that all events
+// of an item can be dropped at once when it is removed
+static String getEventKey(const String &itemId, const String &eventTag, const String &eventId)
+{
+    return itemId + "/" + eventTag + "/" + eventId;
+}
+
+static void removeItemEvents(const String &itemId, HashMap<String, BlameIndex::Entry> &events)
+{
+    const String prefix(itemId + "/");
+    StringArray keysToRemove;
+
+    for (HashMap<String, BlameIndex::Entry>::Iterator i(events); i.next();)
+    {
+        if (i.getKey().startsWith(prefix))
+        {
+            keysToRemove.add(i.getKey());
+        }
+    }
+
+    for (const auto &key : keysToRemove)
+    {
+        events.remove(key);
+    }
+}
+
+BlameIndex::BlameIndex() :
+    Thread("Blame index"),
+    numChanges(0),
+    numSavedChanges(0) {}
+
+BlameIndex::~BlameIndex()
+{
+    this->masterReference.clear();
+    this->stopThread(BLAME_INDEX_THREAD_STOP_TIMEOUT);
+    this->cancelPendingUpdate();
+    this->saveIfNeeded();
+}
+
+//===----------------------------------------------------------------------===//
+// Lookup
+//===----------------------------------------------------------------------===//
+
+bool BlameIndex::isRebuilding() const
+{
+    return this->isThreadRunning();
+}
+
+bool BlameIndex::findEntry(const Uuid &itemId, const String &eventTag,
+    const String &eventId, Entry &outEntry) const
+{
+    const String key(getEventKey(itemId.toString(), eventTag, eventId));
+    const ScopedReadLock lock(this->indexLock);
+
+    if (this->events.contains(key))
+    {
+        outEntry = this->events[key];
+        return true;
+    }
+
+    return false;
+}
+
+int BlameIndex::getNumRevisions() const
+{
+    const ScopedReadLock lock(this->indexLock);
+    return this->revisionIds.size();
+}
+
+String BlameIndex::getRevisionId(int revisionNumber) const
+{
+    const ScopedReadLock lock(this->indexLock);
+    return this->revisionIds[revisionNumber];
+}
+
+//===----------------------------------------------------------------------===//
+// Indexing
+//===----------------------------------------------------------------------===//
+
+BlameIndex::Snapshot BlameIndex::takeSnapshot(const ValueTree revision)
+{
+    Snapshot snapshot;
+    snapshot.revisionId = Revision::getUuid(revision);
+    snapshot.revisionHash = Revision::getContentHash(revision);
+
+    for (int i = 0; i < revision.getNumProperties(); ++i)
+    {
+        const var property(revision.getProperty(revision.getPropertyName(i)));
+
+        if (RevisionItem *item = dynamic_cast<RevisionItem *>(property.getObject()))
+        {
+            snapshot.items.add(item);
+        }
+    }
+
+    return snapshot;
+}
+
+void BlameIndex::applyRevision(const Snapshot &revision, int revisionNumber,
+    EventsMap &outEvents, ItemsSet &outItems)
+{
+    for (const auto &item : revision.items)
+    {
+        const String itemId(item->getUuid().toString());
+
+        // an item that is added again starts from scratch
+        if (item->getType() != RevisionItem::Changed && outItems.contains(itemId))
+        {
+            removeItemEvents(itemId, outEvents);
+            outItems.remove(itemId);
+        }
+
+        if (item->getType() == RevisionItem::Removed)
+        {
+            continue;
+        }
+
+        outItems.set(itemId, revisionNumber);
+
+        for (int i = 0; i < item->getNumDeltas(); ++i)
+        {
+            const String deltaType(item->getDelta(i)->getType());
+            const bool addsEvents = checkIfDeltaAddsEvents(deltaType);
+            const bool removesEvents = checkIfDeltaRemovesEvents(deltaType);
+
+            if (! addsEvents && ! removesEvents && ! checkIfDeltaChangesEvents(deltaType))
+            {
+                continue;
+            }
+
+            ScopedPointer<XmlElement> deltaData(item->createDeltaDataFor(i));
+
+            if (deltaData == nullptr)
+            {
+                continue;
+            }
+
+            forEachXmlChildElement(*deltaData, e)
+            {
+                const String key(getEventKey(itemId, e->getTagName(), e->getStringAttribute("id")));
+
+                if (removesEvents)
+                {
+                    outEvents.remove(key);
+                    continue;
+                }
+
+                Entry entry;
+
+                if (! addsEvents && outEvents.contains(key))
+                {
+                    entry = outEvents[key];
+                }
+                else
+                {
+                    entry.introducedIn = revisionNumber;
+                }
+
+                entry.lastChangedIn = revisionNumber;
+                outEvents.set(key, entry);
+            }
+        }
+    }
+}
+
+void BlameIndex::update(const String &newHistoryId, const ValueTree headRevision)
+{
+    if (newHistoryId != this->historyId)
+    {
+        this->load(newHistoryId);
+    }
+
+    if (! headRevision.isValid())
+    {
+        return;
+    }
+
+    if (this->isThreadRunning())
+    {
+        const Snapshot &pendingHead = this->pendingLineage.getReference(this->pendingLineage.size() - 1);
+
+        if (pendingHead.revisionId == Revision::getUuid(headRevision) &&
+            pendingHead.revisionHash == Revision::getContentHash(headRevision))
+        {
+            return; // already being rebuilt for this lineage
+        }
+    }
+    else if (this->updateIncrementally(headRevision))
+    {
+        return;
+    }
+
+    this->stopThread(BLAME_INDEX_THREAD_STOP_TIMEOUT);
+
+    // the snapshots hold the revision items, so that the thread
+    // does not have to touch the tree, which can change meanwhile
+    Array<ValueTree> lineage;
+    for (ValueTree rev(headRevision); rev.isValid(); rev = rev.getParent())
+    {
+        lineage.add(rev);
+    }
+
+    this->pendingLineage.clearQuick();
+    for (int i = lineage.size(); --i >= 0; )
+    {
+        this->pendingLineage.add(BlameIndex::takeSnapshot(lineage.getReference(i)));
+    }
+
+    this->startThread(3);
+}
+
+bool BlameIndex::updateIncrementally(const ValueTree headRevision)
+{
+    String lastIndexedId;
+    String lastIndexedHash;
+    int numIndexed = 0;
+
+    {
+        const ScopedReadLock lock(this->indexLock);
+        numIndexed = this->revisionIds.size();
+        lastIndexedId = this->revisionIds[numIndexed - 1];
+        lastIndexedHash = this->revisionHashes[numIndexed - 1];
+    }
+
+    if (numIndexed == 0)
+    {
+        return false;
+    }
+
+    // Only walks up to the last indexed revision: the parents of a revision
+    // never change, and the hash includes its id, so finding it means that
+    // the indexed lineage is the beginning of the new one; an amended head
+    // has another hash, so it is never mistaken for the indexed one
+    Array<ValueTree> newRevisions;
+    ValueTree rev(headRevision);
+
+    while (rev.isValid() &&
+        (Revision::getUuid(rev) != lastIndexedId ||
+         Revision::getContentHash(rev) != lastIndexedHash))
+    {
+        if (newRevisions.size() == BLAME_INDEX_MAX_INCREMENTAL_REVISIONS)
+        {
+            return false;
+        }
+
+        newRevisions.add(rev);
+        rev = rev.getParent();
+    }
+
+    if (! rev.isValid())
+    {
+        return false;
+    }
+
+    if (newRevisions.isEmpty())
+    {
+        return true;
+    }
+
+    Array<Snapshot> snapshots;
+    for (int i = newRevisions.size(); --i >= 0; )
+    {
+        snapshots.add(BlameIndex::takeSnapshot(newRevisions.getReference(i)));
+    }
+
+    {
+        const ScopedWriteLock lock(this->indexLock);
+
+        for (const auto &revision : snapshots)
+        {
+            BlameIndex::applyRevision(revision, this->revisionIds.size(), this->events, this->items);
+            this->revisionIds.add(revision.revisionId);
+            this->revisionHashes.add(revision.revisionHash);
+        }
+
+        ++this->numChanges;
+    }
+
+    this->sendChangeMessage();
+    return true;
+}
+
+void BlameIndex::run()
+{
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    EventsMap newEvents;
+    ItemsSet newItems;
+    StringArray newRevisionIds;
+    StringArray newRevisionHashes;
+
+    for (int i = 0; i < this->pendingLineage.size(); ++i)
+    {
+        if (this->threadShouldExit())
+        {
+            return;
+        }
+
+        const Snapshot &revision = this->pendingLineage.getReference(i);
+        BlameIndex::applyRevision(revision, i, newEvents, newItems);
+        newRevisionIds.add(revision.revisionId);
+        newRevisionHashes.add(revision.revisionHash);
+    }
+
+    {
+        const ScopedWriteLock lock(this->indexLock);
+        this->events.swapWith(newEvents);
+        this->items.swapWith(newItems);
+        this->revisionIds.swapWith(newRevisionIds);
+        this->revisionHashes.swapWith(newRevisionHashes);
+        ++this->numChanges;
+    }
+
+    this->saveIfNeeded();
+
+    const double endTime = Time::getMillisecondCounterHiRes();
+    Logger::writeToLog("BlameIndex: indexed " + String(this->pendingLineage.size()) +
+        " revisions in " + String(endTime - startTime) + "ms");
+
+    this->triggerAsyncUpdate();
+}
+
+void BlameIndex::handleAsyncUpdate()
+{
+    this->sendChangeMessage();
+}
+
+//===----------------------------------------------------------------------===//
+// Cache
+//===----------------------------------------------------------------------===//
+
+void BlameIndex::load(const String &newHistoryId)
+{
+    this->stopThread(BLAME_INDEX_THREAD_STOP_TIMEOUT);
+    this->saveIfNeeded();
+
+    const ScopedWriteLock lock(this->indexLock);
+
+    this->historyId = newHistoryId;
+    this->cacheFile = FileUtils::getConfigSlot("blame_" + newHistoryId + ".cache");
+    this->revisionIds.clearQuick();
+    this->revisionHashes.clearQuick();
+    this->events.clear();
+    this->items.clear();
+    this->numChanges = 0;
+    this->numSavedChanges = 0;
+
+    FileInputStream in(this->cacheFile);
+
+    if (! in.openedOk() || in.readInt() != BLAME_INDEX_MAGIC_NUMBER)
+    {
+        return;
+    }
+
+    const int numRevisions = in.readInt();
+    for (int i = 0; i < numRevisions && ! in.isExhausted(); ++i)
+    {
+        this->revisionIds.add(in.readString());
+        this->revisionHashes.add(in.readString());
+    }
+
+    const int numItems = in.readInt();
+    for (int i = 0; i < numItems && ! in.isExhausted(); ++i)
+    {
+        const String key(in.readString());
+        this->items.set(key, in.readInt());
+    }
+
+    const int numEvents = in.readInt();
+    for (int i = 0; i < numEvents && ! in.isExhausted(); ++i)
+    {
+        const String key(in.readString());
+        Entry entry;
+        entry.introducedIn = in.readInt();
+        entry.lastChangedIn = in.readInt();
+        this->events.set(key, entry);
+    }
+
+    if (this->revisionIds.size() != numRevisions ||
+        this->items.size() != numItems ||
+        this->events.size() != numEvents)
+    {
+        // truncated, will be rebuilt
+        Logger::writeToLog("BlameIndex: discarding a damaged cache");
+        this->revisionIds.clearQuick();
+        this->revisionHashes.clearQuick();
+        this->events.clear();
+        this->items.clear();
+    }
+}
+
+void BlameIndex::saveIfNeeded()
+{
+    // Serialized into memory under the lock, so that
+    // the lookups never wait for the disk
+    MemoryOutputStream data;
+    File targetFile;
+    int numChangesSaved = 0;
+
+    {
+        const ScopedReadLock lock(this->indexLock);
+
+        if (this->numChanges == this->numSavedChanges ||
+            this->cacheFile.getFullPathName().isEmpty())
+        {
+            return;
+        }
+
+        targetFile = this->cacheFile;
+        numChangesSaved = this->numChanges;
+
+        data.writeInt(BLAME_INDEX_MAGIC_NUMBER);
+
+        data.writeInt(this->revisionIds.size());
+        for (int i = 0; i < this->revisionIds.size(); ++i)
+        {
+            data.writeString(this->revisionIds[i]);
+            data.writeString(this->revisionHashes[i]);
+        }
+
+        data.writeInt(this->items.size());
+        for (ItemsSet::Iterator i(this->items); i.next();)
+        {
+            data.writeString(i.getKey());
+            data.writeInt(i.getValue());
+        }
+
+        data.writeInt(this->events.size());
+        for (EventsMap::Iterator i(this->events); i.next();)
+        {
+            data.writeString(i.getKey());
+            data.writeInt(i.getValue().introducedIn);
+            data.writeInt(i.getValue().lastChangedIn);
+        }
+    }
+
+    TemporaryFile tempFile(targetFile);
+    ScopedPointer<FileOutputStream> out(tempFile.getFile().createOutputStream());
+
+    if (out == nullptr)
+    {
+        return;
+    }
+
+    out->write(data.getData(), data.getDataSize());
+    out->flush();
+    out = nullptr;
+
+    if (tempFile.overwriteTargetFileWithTemporary())
+    {
+        const ScopedWriteLock lock(this->indexLock);
+        this->numSavedChanges = numChangesSaved;
+    }
+}
@@ -0,0 +1,111 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "RevisionItem.h"
+
+namespace VCS
+{
+    // Tells which revision has introduced an event (a note, an automation
+    // event, an annotation, a clip) and which one has changed it last.
+    //
+    // The index follows the lineage of the head revision: the revisions
+    // from the root to the head are numbered in order, and every event of
+    // every tracked item is mapped to the numbers of the two revisions.
+    // A new commit on top of the indexed lineage is applied right away,
+    // as it only costs walking up to the last indexed revision and reading
+    // the new deltas; any other change (another branch checked out,
+    // a squashed or amended history) means rebuilding the index in
+    // a background thread. The index is cached in a file, so that
+    // a project's history is walked only once; the file is written
+    // from an in-memory copy, without holding the lock.
+
+    class BlameIndex final :
+        public ChangeBroadcaster, // sent when the index is rebuilt or updated
+        private Thread,
+        private AsyncUpdater
+    {
+    public:
+
+        struct Entry
+        {
+            int introducedIn = -1; // revision numbers, root is 0
+            int lastChangedIn = -1;
+        };
+
+        BlameIndex();
+        ~BlameIndex() override;
+
+        // Brings the index up to date with the lineage of the given revision;
+        // the history id names the cache file to pick up the index from
+        void update(const String &historyId, const ValueTree headRevision);
+
+        bool isRebuilding() const;
+
+        bool findEntry(const Uuid &itemId, const String &eventTag,
+            const String &eventId, Entry &outEntry) const;
+
+        int getNumRevisions() const;
+        String getRevisionId(int revisionNumber) const;
+
+    private:
+
+        struct Snapshot
+        {
+            String revisionId;
+            String revisionHash;
+            Array<RevisionItem::Ptr> items;
+        };
+
+        typedef HashMap<String, Entry> EventsMap;
+        typedef HashMap<String, int> ItemsSet;
+
+        static Snapshot takeSnapshot(const ValueTree revision);
+        static void applyRevision(const Snapshot &revision, int revisionNumber,
+            EventsMap &events, ItemsSet &items);
+
+        bool updateIncrementally(const ValueTree headRevision);
+
+        void load(const String &newHistoryId);
+        void saveIfNeeded();
+
+        void run() override;
+        void handleAsyncUpdate() override;
+
+        // guards everything below
+        ReadWriteLock indexLock;
+
+        StringArray revisionIds;
+        StringArray revisionHashes;
+        EventsMap events;
+        ItemsSet items;
+        int numChanges;
+        int numSavedChanges;
+
+        String historyId;
+        File cacheFile;
+
+        // the lineage to rebuild the index for, owned by the thread
+        Array<Snapshot> pendingLineage;
+
+        WeakReference<BlameIndex>::Master masterReference;
+        friend class WeakReference<BlameIndex>;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BlameIndex)
+    };
+} // namespace VCS
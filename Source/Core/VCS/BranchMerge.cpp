@@ -0,0 +1,363 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "BranchMerge.h"
+#include "HeadState.h"
+#include "Revision.h"
+#include "TrackedItem.h"
+#include "Diff.h"
+#include "DiffLogic.h"
+
+#include "PianoSequenceDeltas.h"
+#include "AutoSequenceDeltas.h"
+#include "PatternDeltas.h"
+#include "ProjectTimelineDeltas.h"
+
+using namespace VCS;
+
+static bool checkIfDeltaIsEventsType(const String &deltaType)
+{
+    return (deltaType == PianoSequenceDeltas::notesAdded ||
+            deltaType == PianoSequenceDeltas::notesRemoved ||
+            deltaType == PianoSequenceDeltas::notesChanged ||
+            deltaType == AutoSequenceDeltas::eventsAdded ||
+            deltaType == AutoSequenceDeltas::eventsRemoved ||
+            deltaType == AutoSequenceDeltas::eventsChanged ||
+            deltaType == PatternDeltas::clipsAdded ||
+            deltaType == PatternDeltas::clipsRemoved ||
+            deltaType == PatternDeltas::clipsChanged ||
+            deltaType == ProjectTimelineDeltas::annotationsAdded ||
+            deltaType == ProjectTimelineDeltas::annotationsRemoved ||
+            deltaType == ProjectTimelineDeltas::annotationsChanged ||
+            deltaType == ProjectTimelineDeltas::timeSignaturesAdded ||
+            deltaType == ProjectTimelineDeltas::timeSignaturesRemoved ||
+            deltaType == ProjectTimelineDeltas::timeSignaturesChanged ||
+            deltaType == ProjectTimelineDeltas::keySignaturesAdded ||
+            deltaType == ProjectTimelineDeltas::keySignaturesRemoved ||
+            deltaType == ProjectTimelineDeltas::keySignaturesChanged);
+}
+
+static bool checkIfDeltaIsRemovalType(const String &deltaType)
+{
+    return (deltaType == PianoSequenceDeltas::notesRemoved ||
+            deltaType == AutoSequenceDeltas::eventsRemoved ||
+            deltaType == PatternDeltas::clipsRemoved ||
+            deltaType == ProjectTimelineDeltas::annotationsRemoved ||
+            deltaType == ProjectTimelineDeltas::timeSignaturesRemoved ||
+            deltaType == ProjectTimelineDeltas::keySignaturesRemoved);
+}
+
+// Event ids are only unique within a sequence, and a track has
+// both events and clips, so the keys also include the event tag
+static String getEventKey(const XmlElement &event)
+{
+    return event.getTagName() + "/" + event.getStringAttribute("id");
+}
+
+static bool hasChanges(const TrackedItem &item, const TrackedItem &initialState)
+{
+    ScopedPointer<Diff> diff(item.getDiffLogic()->createDiff(initialState));
+    return diff->hasAnyChanges();
+}
+
+//===----------------------------------------------------------------------===//
+// History
+//===----------------------------------------------------------------------===//
+
+ValueTree BranchMerge::findCommonAncestor(const ValueTree revision1,
+    const ValueTree revision2)
+{
+    HashMap<String, int> firstPath;
+
+    for (ValueTree rev(revision1); rev.isValid(); rev = rev.getParent())
+    {
+        firstPath.set(Revision::getUuid(rev), 0);
+    }
+
+    for (ValueTree rev(revision2); rev.isValid(); rev = rev.getParent())
+    {
+        if (firstPath.contains(Revision::getUuid(rev)))
+        {
+            return rev;
+        }
+    }
+
+    return {};
+}
+
+HeadState *BranchMerge::createStateAt(const ValueTree revision)
+{
+    return BranchMerge::createState(BranchMerge::getLineageItems(revision));
+}
+
+Array<RevisionItem::Ptr> BranchMerge::getLineageItems(const ValueTree revision)
+{
+    Array<ValueTree> treePath;
+
+    for (ValueTree rev(revision); rev.isValid(); rev = rev.getParent())
+    {
+        treePath.insert(0, rev);
+    }
+
+    Array<RevisionItem::Ptr> lineageItems;
+
+    for (const auto &rev : treePath)
+    {
+        for (int i = 0; i < rev.getNumProperties(); ++i)
+        {
+            const var &property = rev.getProperty(rev.getPropertyName(i));
+
+            if (RevisionItem *item = dynamic_cast<RevisionItem *>(property.getObject()))
+            {
+                lineageItems.add(item);
+            }
+        }
+    }
+
+    return lineageItems;
+}
+
+HeadState *BranchMerge::createState(const Array<RevisionItem::Ptr> &lineageItems)
+{
+    ScopedPointer<HeadState> state(new HeadState());
+
+    for (const auto &item : lineageItems)
+    {
+        if (item->getType() == RevisionItem::Added)
+        {
+            state->addItem(item);
+        }
+        else if (item->getType() == RevisionItem::Removed)
+        {
+            state->removeItem(item);
+        }
+        else if (item->getType() == RevisionItem::Changed)
+        {
+            state->mergeItem(item);
+        }
+    }
+
+    return state.release();
+}
+
+//===----------------------------------------------------------------------===//
+// Merge
+//===----------------------------------------------------------------------===//
+
+bool BranchMerge::mergeInto(TrackedItemsSource &target,
+    const ValueTree ours, const ValueTree theirs,
+    Array<Conflict> &outConflicts)
+{
+    const ValueTree base(BranchMerge::findCommonAncestor(ours, theirs));
+
+    if (! base.isValid())
+    {
+        Logger::writeToLog("BranchMerge: revisions have no common ancestor");
+        return false;
+    }
+
+    if (base == theirs)
+    {
+        return true; // already merged, nothing to do
+    }
+
+    Logger::writeToLog("BranchMerge::mergeInto " + Revision::getUuid(theirs) +
+        ", common ancestor " + Revision::getUuid(base));
+
+    const ScopedPointer<HeadState> baseState(BranchMerge::createStateAt(base));
+    const ScopedPointer<HeadState> theirState(BranchMerge::createStateAt(theirs));
+
+    HashMap<String, TrackedItem *> ourItems;
+
+    for (int i = 0; i < target.getNumTrackedItems(); ++i)
+    {
+        TrackedItem *item = target.getTrackedItem(i);
+        ourItems.set(item->getUuid().toString(), item);
+    }
+
+    Array<TrackedItem *> itemsToDelete;
+
+    for (int i = 0; i < theirState->getNumTrackedItems(); ++i)
+    {
+        RevisionItem::Ptr theirItem(static_cast<RevisionItem *>(theirState->getTrackedItem(i)));
+        RevisionItem::Ptr baseItem(baseState->getItemWithUuid(theirItem->getUuid()));
+
+        const String uuid(theirItem->getUuid().toString());
+        TrackedItem *ourItem = ourItems.contains(uuid) ? ourItems[uuid] : nullptr;
+
+        const bool existsInBase = (baseItem != nullptr && baseItem->getType() != RevisionItem::Removed);
+        const bool existsInTheirs = (theirItem->getType() != RevisionItem::Removed);
+
+        const Conflict itemConflict = { theirItem->getUuid(), theirItem->getVCSName(), {}, {} };
+
+        if (existsInTheirs && ourItem != nullptr)
+        {
+            if (existsInBase)
+            {
+                BranchMerge::mergeItem(*ourItem, *baseItem, *theirItem, outConflicts);
+            }
+            else if (hasChanges(*theirItem, *ourItem))
+            {
+                outConflicts.add(itemConflict); // added on both sides, but differently
+            }
+        }
+        else if (existsInTheirs && ourItem == nullptr)
+        {
+            if (! existsInBase)
+            {
+                TrackedItem *newItem =
+                    target.initTrackedItem(theirItem->getDiffLogic()->getType(), theirItem->getUuid());
+
+                if (newItem != nullptr)
+                {
+                    newItem->getDiffLogic()->resetStateTo(*theirItem);
+                }
+            }
+            else if (hasChanges(*theirItem, *baseItem))
+            {
+                outConflicts.add(itemConflict); // removed here, changed there
+            }
+        }
+        else if (! existsInTheirs && ourItem != nullptr && existsInBase)
+        {
+            if (hasChanges(*ourItem, *baseItem))
+            {
+                outConflicts.add(itemConflict); // changed here, removed there
+            }
+            else
+            {
+                itemsToDelete.add(ourItem);
+            }
+        }
+    }
+
+    for (auto item : itemsToDelete)
+    {
+        target.deleteTrackedItem(item);
+    }
+
+    target.onResetState();
+    return true;
+}
+
+void BranchMerge::mergeItem(TrackedItem &ourItem,
+    const TrackedItem &baseItem, TrackedItem &theirItem,
+    Array<Conflict> &outConflicts)
+{
+    ScopedPointer<Diff> theirChanges(theirItem.getDiffLogic()->createDiff(baseItem));
+
+    if (! theirChanges->hasAnyChanges())
+    {
+        return;
+    }
+
+    ScopedPointer<Diff> ourChanges(ourItem.getDiffLogic()->createDiff(baseItem));
+
+    // index everything we've changed: properties by delta type,
+    // events by their ids, removed events separately
+    OwnedArray<XmlElement> ourChangesData;
+    HashMap<String, const XmlElement *> ourProperties;
+    HashMap<String, const XmlElement *> ourEvents;
+    HashMap<String, const XmlElement *> ourRemovedEvents;
+
+    for (int i = 0; i < ourChanges->getNumDeltas(); ++i)
+    {
+        const String deltaType(ourChanges->getDelta(i)->getType());
+        const XmlElement *deltaData = ourChangesData.add(ourChanges->createDeltaDataFor(i));
+
+        if (checkIfDeltaIsEventsType(deltaType))
+        {
+            auto &events = checkIfDeltaIsRemovalType(deltaType) ? ourRemovedEvents : ourEvents;
+
+            forEachXmlChildElement(*deltaData, e)
+            {
+                events.set(getEventKey(*e), e);
+            }
+        }
+        else
+        {
+            ourProperties.set(deltaType, deltaData);
+        }
+    }
+
+    // now pick their changes that do not clash with ours
+    Diff resolvedChanges(theirItem);
+
+    for (int i = 0; i < theirChanges->getNumDeltas(); ++i)
+    {
+        const Delta *delta = theirChanges->getDelta(i);
+        const String deltaType(delta->getType());
+        ScopedPointer<XmlElement> deltaData(theirChanges->createDeltaDataFor(i));
+
+        if (checkIfDeltaIsEventsType(deltaType))
+        {
+            const bool theyRemove = checkIfDeltaIsRemovalType(deltaType);
+            ScopedPointer<XmlElement> resolvedData(new XmlElement(deltaData->getTagName()));
+
+            forEachXmlChildElement(*deltaData, e)
+            {
+                const String key(getEventKey(*e));
+                bool isConflict = false;
+
+                if (ourRemovedEvents.contains(key))
+                {
+                    isConflict = ! theyRemove;
+                }
+                else if (ourEvents.contains(key))
+                {
+                    isConflict = theyRemove || ! ourEvents[key]->isEquivalentTo(e, true);
+                }
+
+                if (isConflict)
+                {
+                    const Conflict conflict = { theirItem.getUuid(),
+                        theirItem.getVCSName(), deltaType, e->getStringAttribute("id") };
+                    outConflicts.add(conflict);
+                }
+                else
+                {
+                    resolvedData->addChildElement(new XmlElement(*e));
+                }
+            }
+
+            if (resolvedData->getNumChildElements() > 0)
+            {
+                resolvedChanges.addOwnedDelta(new Delta(*delta), resolvedData.release());
+            }
+        }
+        else
+        {
+            if (ourProperties.contains(deltaType) &&
+                ! ourProperties[deltaType]->isEquivalentTo(deltaData, true))
+            {
+                const Conflict conflict = { theirItem.getUuid(), theirItem.getVCSName(), deltaType, {} };
+                outConflicts.add(conflict);
+            }
+            else
+            {
+                resolvedChanges.addOwnedDelta(new Delta(*delta), deltaData.release());
+            }
+        }
+    }
+
+    if (resolvedChanges.hasAnyChanges())
+    {
+        ScopedPointer<Diff> mergedState(resolvedChanges.getDiffLogic()->createMergedItem(ourItem));
+        ourItem.getDiffLogic()->resetStateTo(*mergedState);
+    }
+}
@@ -0,0 +1,78 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "TrackedItemsSource.h"
+#include "RevisionItem.h"
+
+namespace VCS
+{
+    class HeadState;
+    class TrackedItem;
+
+    // Merges another branch of the history tree into the working copy.
+    //
+    // Both sides are diffed against their common ancestor with the usual
+    // DiffLogic machinery, so that changes are compared at the level
+    // of single notes, events, clips and track properties (matched by ids
+    // through hash tables, not pairwise). Whatever only one side has touched
+    // is merged automatically; whatever both sides have changed differently
+    // is a conflict, which is resolved in favour of the working copy
+    // and reported back to the caller.
+
+    class BranchMerge
+    {
+    public:
+
+        struct Conflict
+        {
+            Uuid itemId;
+            String itemName;
+            String deltaType; // empty if the whole item was removed on one side
+            String eventId; // empty for the item properties
+        };
+
+        // The latest revision both of the given revisions descend from,
+        // or an invalid tree, if they are not from the same history
+        static ValueTree findCommonAncestor(const ValueTree revision1,
+            const ValueTree revision2);
+
+        // Replays the history from the root up to the given revision,
+        // the same way the head does
+        static HeadState *createStateAt(const ValueTree revision);
+
+        // The same, split in two: collecting the items of the revisions
+        // only reads the history tree, so it has to be done on the message
+        // thread, while replaying them can be done anywhere
+        static Array<RevisionItem::Ptr> getLineageItems(const ValueTree revision);
+        static HeadState *createState(const Array<RevisionItem::Ptr> &lineageItems);
+
+        // Applies the changes made in theirs revision since the common ancestor
+        // to the target's current state, which is supposed to descend from ours
+        static bool mergeInto(TrackedItemsSource &target,
+            const ValueTree ours, const ValueTree theirs,
+            Array<Conflict> &outConflicts);
+
+    private:
+
+        static void mergeItem(TrackedItem &ourItem,
+            const TrackedItem &baseItem, TrackedItem &theirItem,
+            Array<Conflict> &outConflicts);
+
+    };
+} // namespace VCS
@@ -58,6 +58,7 @@ bool Client::push()
     if (this->isRemoving()) { return false; }
 
     ScopedPointer<XmlElement> vcsXml(this->vcs.serialize());
+    this->revisionsBeingPushed = this->vcs.getAllRevisionIds();
 
     this->pushThread =
         new PushThread(URL(HELIO_VCS_REMOTE_URL),
@@ -228,6 +229,7 @@ void Client::changeListenerCallback(ChangeBroadcaster *source)
         else if (this->lastPushState == SyncThread::allDone)
         {
             this->vcs.incrementVersion(); // sic!
+            this->vcs.markAsPublished(this->revisionsBeingPushed);
             this->deletePushThread();
 
             const String tooltip(TRANS("vcs::push::done"));
@@ -73,6 +73,9 @@ namespace VCS
         ScopedPointer<PullThread> pullThread;
         ScopedPointer<RemovalThread> removalThread;
 
+        // the revisions that are on the remote once the push is done
+        StringArray revisionsBeingPushed;
+
         void deletePushThread();
         void deletePullThread();
         void deleteRemovalThread();
@@ -27,7 +27,8 @@ int64 DeltaDescription::defaultNumChanges = -1;
 Delta::Delta(const Delta &other) :
     type(other.type),
     description(other.description),
-    vcsUuid(other.vcsUuid)
+    vcsUuid(other.vcsUuid),
+    contentHash(other.contentHash)
 {
 }
 
@@ -56,6 +57,16 @@ String Delta::getType() const
     return this->type;
 }
 
+String Delta::getContentHash() const
+{
+    return this->contentHash;
+}
+
+void Delta::setContentHash(const String &hash)
+{
+    this->contentHash = hash;
+}
+
 XmlElement *Delta::serialize() const
 {
     auto const xml = new XmlElement(Serialization::VCS::delta);
@@ -66,6 +77,11 @@ XmlElement *Delta::serialize() const
     xml->setAttribute(Serialization::VCS::deltaIntParam, String(this->description.intParameter));
     xml->setAttribute(Serialization::VCS::deltaId, this->vcsUuid.toString());
 
+    if (this->contentHash.isNotEmpty())
+    {
+        xml->setAttribute(Serialization::VCS::deltaHash, this->contentHash);
+    }
+
     return xml;
 }
 
@@ -80,6 +96,7 @@ void Delta::deserialize(const XmlElement &xml)
 
     this->vcsUuid = root->getStringAttribute(Serialization::VCS::deltaId, this->vcsUuid.toString());
     this->type = root->getStringAttribute(Serialization::VCS::deltaType, undefinedDelta);
+    this->contentHash = root->getStringAttribute(Serialization::VCS::deltaHash);
 
     const String descriptionName = root->getStringAttribute(Serialization::VCS::deltaName, String::empty);
     const String descriptionStringParam = root->getStringAttribute(Serialization::VCS::deltaStringParam, String::empty);
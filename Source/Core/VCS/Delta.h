@@ -94,6 +94,11 @@ namespace VCS
 
         String getType() const;
 
+        // SHA-256 of the delta data as stored in the pack,
+        // empty for the deltas that were never flushed
+        String getContentHash() const;
+        void setContentHash(const String &hash);
+
 
         //===------------------------------------------------------------------===//
         // Serializable
@@ -113,6 +118,8 @@ namespace VCS
 
         String type;
 
+        String contentHash;
+
         JUCE_LEAK_DETECTOR(Delta)
 
     };
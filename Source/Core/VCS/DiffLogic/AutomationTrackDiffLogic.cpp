@@ -389,23 +389,18 @@ XmlElement *mergeEventsAdded(const XmlElement *state, const XmlElement *changes)
     result.addArray(stateNotes);
 
     // на всякий пожарный, ищем, нет ли в состоянии нот с теми же id, где нет - добавляем
-    for (int i = 0; i < changesNotes.size(); ++i)
-    {
-        bool foundNoteInState = false;
-        const AutomationEvent *changesNote = static_cast<AutomationEvent *>(changesNotes.getUnchecked(i));
+    HashMap<MidiEvent::Id, int> stateIDs;
 
-        for (int j = 0; j < stateNotes.size(); ++j)
-        {
-            const AutomationEvent *stateNote = static_cast<AutomationEvent *>(stateNotes.getUnchecked(j));
+    for (int j = 0; j < stateNotes.size(); ++j)
+    {
+        stateIDs.set(stateNotes.getUnchecked(j)->getId(), j);
+    }
 
-            if (stateNote->getId() == changesNote->getId())
-            {
-                foundNoteInState = true;
-                break;
-            }
-        }
+    for (int i = 0; i < changesNotes.size(); ++i)
+    {
+        const MidiEvent *changesNote = changesNotes.getUnchecked(i);
 
-        if (! foundNoteInState)
+        if (! stateIDs.contains(changesNote->getId()))
         {
             result.add(changesNote);
         }
@@ -423,23 +418,18 @@ XmlElement *mergeEventsRemoved(const XmlElement *state, const XmlElement *change
     Array<const MidiEvent *> result;
 
     // добавляем все ноты из состояния, которых нет в изменениях
-    for (int i = 0; i < stateNotes.size(); ++i)
-    {
-        bool foundNoteInChanges = false;
-        const AutomationEvent *stateNote = static_cast<AutomationEvent *>(stateNotes.getUnchecked(i));
+    HashMap<MidiEvent::Id, int> changesIDs;
 
-        for (int j = 0; j < changesNotes.size(); ++j)
-        {
-            const AutomationEvent *changesNote = static_cast<AutomationEvent *>(changesNotes.getUnchecked(j));
+    for (int j = 0; j < changesNotes.size(); ++j)
+    {
+        changesIDs.set(changesNotes.getUnchecked(j)->getId(), j);
+    }
 
-            if (stateNote->getId() == changesNote->getId())
-            {
-                foundNoteInChanges = true;
-                break;
-            }
-        }
+    for (int i = 0; i < stateNotes.size(); ++i)
+    {
+        const MidiEvent *stateNote = stateNotes.getUnchecked(i);
 
-        if (! foundNoteInChanges)
+        if (! changesIDs.contains(stateNote->getId()))
         {
             result.add(stateNote);
         }
@@ -455,29 +445,29 @@ XmlElement *mergeEventsChanged(const XmlElement *state, const XmlElement *change
     deserializeChanges(state, changes, stateNotes, changesNotes);
 
     Array<const MidiEvent *> result;
-    result.addArray(stateNotes);
+    result.ensureStorageAllocated(stateNotes.size());
 
     // снова ищем по id и заменяем
+    HashMap<MidiEvent::Id, const MidiEvent *> changesIDs;
+
+    for (int j = 0; j < changesNotes.size(); ++j)
+    {
+        const MidiEvent *changesNote = changesNotes.getUnchecked(j);
+        changesIDs.set(changesNote->getId(), changesNote);
+    }
+
     for (int i = 0; i < stateNotes.size(); ++i)
     {
-        bool foundNoteInChanges = false;
-        const AutomationEvent *stateNote = static_cast<AutomationEvent *>(stateNotes.getUnchecked(i));
+        const MidiEvent *stateNote = stateNotes.getUnchecked(i);
 
-        for (int j = 0; j < changesNotes.size(); ++j)
+        if (changesIDs.contains(stateNote->getId()))
         {
-            const AutomationEvent *changesNote = static_cast<AutomationEvent *>(changesNotes.getUnchecked(j));
-
-            if (stateNote->getId() == changesNote->getId())
-            {
-                foundNoteInChanges = true;
-                result.removeAllInstancesOf(stateNote);
-                result.addIfNotAlreadyThere(changesNote);
-
-                break;
-            }
+            result.add(changesIDs[stateNote->getId()]);
+        }
+        else
+        {
+            result.add(stateNote);
         }
-
-        //jassert(foundNoteInChanges);
     }
 
     return serializeLayer(result, AutoSequenceDeltas::eventsAdded);
@@ -545,36 +535,42 @@ Array<NewSerializedDelta> createEventsDiffs(const XmlElement *state, const XmlEl
     Array<const MidiEvent *> removedEvents;
     Array<const MidiEvent *> changedEvents;
 
-    // собственно, само сравнение
+    // события сопоставляются по id через хэш-таблицы,
+    // иначе на длинных автоматизациях дифф становится квадратичным
+    HashMap<MidiEvent::Id, const MidiEvent *> stateIDs;
+    HashMap<MidiEvent::Id, const MidiEvent *> changesIDs;
+
+    for (const auto stateEvent : stateEvents)
+    {
+        stateIDs.set(stateEvent->getId(), stateEvent);
+    }
+
+    for (const auto changesEvent : changesEvents)
+    {
+        changesIDs.set(changesEvent->getId(), changesEvent);
+    }
+
     for (int i = 0; i < stateEvents.size(); ++i)
     {
-        bool foundNoteInChanges = false;
         const AutomationEvent *stateEvent = static_cast<AutomationEvent *>(stateEvents.getUnchecked(i));
 
-        for (int j = 0; j < changesEvents.size(); ++j)
+        // нота из состояния - существует в изменениях. добавляем запись changed, если нужно.
+        if (changesIDs.contains(stateEvent->getId()))
         {
-            const AutomationEvent *changesEvent = static_cast<AutomationEvent *>(changesEvents.getUnchecked(j));
+            const AutomationEvent *changesEvent =
+                static_cast<const AutomationEvent *>(changesIDs[stateEvent->getId()]);
 
-            // нота из состояния - существует в изменениях. добавляем запись changed, если нужно.
-            if (stateEvent->getId() == changesEvent->getId())
-            {
-                foundNoteInChanges = true;
+            const bool eventHasChanged = (stateEvent->getBeat() != changesEvent->getBeat() ||
+                                          stateEvent->getCurvature() != changesEvent->getCurvature() ||
+                                          stateEvent->getControllerValue() != changesEvent->getControllerValue());
 
-                const bool eventHasChanged = (stateEvent->getBeat() != changesEvent->getBeat() ||
-                                              stateEvent->getCurvature() != changesEvent->getCurvature() ||
-                                              stateEvent->getControllerValue() != changesEvent->getControllerValue());
-
-                if (eventHasChanged)
-                {
-                    changedEvents.add(changesEvent);
-                }
-
-                break;
+            if (eventHasChanged)
+            {
+                changedEvents.add(changesEvent);
             }
         }
-
         // нота из состояния - в изменениях не найдена. добавляем запись removed.
-        if (! foundNoteInChanges)
+        else
         {
             removedEvents.add(stateEvent);
         }
@@ -583,24 +579,12 @@ Array<NewSerializedDelta> createEventsDiffs(const XmlElement *state, const XmlEl
     // теперь ищем в изменениях ноты, которые отсутствуют в состоянии
     for (int i = 0; i < changesEvents.size(); ++i)
     {
-        bool foundNoteInState = false;
-        const AutomationEvent *changesNote = static_cast<AutomationEvent *>(changesEvents.getUnchecked(i));
-
-        for (int j = 0; j < stateEvents.size(); ++j)
-        {
-            const AutomationEvent *stateNote = static_cast<AutomationEvent *>(stateEvents.getUnchecked(j));
-
-            if (stateNote->getId() == changesNote->getId())
-            {
-                foundNoteInState = true;
-                break;
-            }
-        }
+        const MidiEvent *changesEvent = changesEvents.getUnchecked(i);
 
         // и пишем ее в список добавленных
-        if (! foundNoteInState)
+        if (! stateIDs.contains(changesEvent->getId()))
         {
-            addedEvents.add(changesNote);
+            addedEvents.add(changesEvent);
         }
     }
 
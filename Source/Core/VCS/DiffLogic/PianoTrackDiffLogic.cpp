@@ -437,10 +437,9 @@ XmlElement *mergeNotesChanged(const XmlElement *state, const XmlElement *changes
     deserializeLayerChanges(state, changes, stateNotes, changesNotes);
 
     Array<const MidiEvent *> result;
+    result.ensureStorageAllocated(stateNotes.size());
 
-    result.addArray(stateNotes);
-
-    // снова ищем по id и заменяем
+    // снова ищем по id и заменяем, не перестраивая массив на каждую ноту
     HashMap<MidiEvent::Id, const Note *> changesIDs;
     
     for (int j = 0; j < changesNotes.size(); ++j)
@@ -454,9 +453,11 @@ XmlElement *mergeNotesChanged(const XmlElement *state, const XmlElement *changes
         const Note *stateNote(stateNotes.getUnchecked(i));
         if (changesIDs.contains(stateNote->getId()))
         {
-            const Note *changesNote = changesIDs[stateNote->getId()];
-            result.removeAllInstancesOf(stateNote);
-            result.addIfNotAlreadyThere(changesNote);
+            result.add(changesIDs[stateNote->getId()]);
+        }
+        else
+        {
+            result.add(stateNote);
         }
     }
 
@@ -523,38 +524,44 @@ Array<NewSerializedDelta> createEventsDiffs(const XmlElement *state, const XmlEl
     Array<const MidiEvent *> removedNotes;
     Array<const MidiEvent *> changedNotes;
 
-    // собственно, само сравнение
+    // события сопоставляются по id через хэш-таблицы,
+    // иначе на слоях в десятки тысяч нот дифф становится квадратичным
+    HashMap<MidiEvent::Id, const Note *> stateIDs;
+    HashMap<MidiEvent::Id, const Note *> changesIDs;
+
+    for (const auto stateNote : stateNotes)
+    {
+        stateIDs.set(stateNote->getId(), stateNote);
+    }
+
+    for (const auto changesNote : changesNotes)
+    {
+        changesIDs.set(changesNote->getId(), changesNote);
+    }
+
     for (int i = 0; i < stateNotes.size(); ++i)
     {
-        bool foundNoteInChanges = false;
         const Note *stateNote(stateNotes.getUnchecked(i));
 
-        for (int j = 0; j < changesNotes.size(); ++j)
+        // нота из состояния - существует в изменениях. добавляем запись changed, если нужно.
+        if (changesIDs.contains(stateNote->getId()))
         {
-            const Note *changesNote(changesNotes.getUnchecked(j));
-
-            // нота из состояния - существует в изменениях. добавляем запись changed, если нужно.
-            if (stateNote->getId() == changesNote->getId())
-            {
-                foundNoteInChanges = true;
-
-                const bool noteHasChanged =
-                    (stateNote->getKey() != changesNote->getKey() ||
-                    stateNote->getBeat() != changesNote->getBeat() ||
-                    stateNote->getLength() != changesNote->getLength() ||
-                    stateNote->getVelocity() != changesNote->getVelocity());
+            const Note *changesNote = changesIDs[stateNote->getId()];
 
-                if (noteHasChanged)
-                {
-                    changedNotes.add(changesNote);
-                }
+            const bool noteHasChanged =
+                (stateNote->getKey() != changesNote->getKey() ||
+                stateNote->getBeat() != changesNote->getBeat() ||
+                stateNote->getLength() != changesNote->getLength() ||
+                stateNote->getVelocity() != changesNote->getVelocity() ||
+                ! stateNote->hasSameExpression(*changesNote));
 
-                break;
+            if (noteHasChanged)
+            {
+                changedNotes.add(changesNote);
             }
         }
-
         // нота из состояния - в изменениях не найдена. добавляем запись removed.
-        if (! foundNoteInChanges)
+        else
         {
             removedNotes.add(stateNote);
         }
@@ -563,22 +570,10 @@ Array<NewSerializedDelta> createEventsDiffs(const XmlElement *state, const XmlEl
     // теперь ищем в изменениях ноты, которые отсутствуют в состоянии
     for (int i = 0; i < changesNotes.size(); ++i)
     {
-        bool foundNoteInState = false;
         const Note *changesNote(changesNotes.getUnchecked(i));
 
-        for (int j = 0; j < stateNotes.size(); ++j)
-        {
-            const Note *stateNote(stateNotes.getUnchecked(j));
-
-            if (stateNote->getId() == changesNote->getId())
-            {
-                foundNoteInState = true;
-                break;
-            }
-        }
-
         // и пишем ее в список добавленных
-        if (! foundNoteInState)
+        if (! stateIDs.contains(changesNote->getId()))
         {
             addedNotes.add(changesNote);
         }
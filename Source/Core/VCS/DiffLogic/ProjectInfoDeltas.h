@@ -23,4 +23,5 @@ namespace ProjectInfoDeltas
     static const String projectFullName = "ProjectFullName";
     static const String projectAuthor = "ProjectAuthor";
     static const String projectDescription = "ProjectDescription";
+    static const String projectTuning = "ProjectTuning";
 } // namespace ProjectInfoDeltas
@@ -22,9 +22,23 @@
 
 #include "ProjectInfo.h"
 #include "ProjectInfoDeltas.h"
+#include "Tuning.h"
 
 using namespace VCS;
 
+// The revisions made before tunings were introduced have no tuning delta,
+// which is the same as the default tuning
+static bool isDefaultTuningDelta(const XmlElement *deltaData)
+{
+    Tuning tuning;
+    if (const XmlElement *tuningNode = deltaData->getChildByName(Serialization::Core::tuning))
+    {
+        tuning.deserialize(*tuningNode);
+    }
+
+    return tuning.isEqualTemperament();
+}
+
 ProjectInfoDiffLogic::ProjectInfoDiffLogic(TrackedItem &targetItem) :
     DiffLogic(targetItem) {}
 
@@ -69,6 +83,13 @@ Diff *ProjectInfoDiffLogic::createDiff(const TrackedItem &initialState) const
             }
         }
 
+        if (! deltaFoundInState &&
+            myDelta->getType() == ProjectInfoDeltas::projectTuning &&
+            isDefaultTuningDelta(myDeltaData))
+        {
+            continue;
+        }
+
         if (!deltaFoundInState || (deltaFoundInState && dataHasChanged))
         {
             if (myDelta->getType() == ProjectInfoDeltas::projectLicense)
@@ -91,6 +112,11 @@ Diff *ProjectInfoDiffLogic::createDiff(const TrackedItem &initialState) const
                 NewSerializedDelta fullDelta = this->createDescriptionDiff(stateDeltaData, myDeltaData);
                 diff->addOwnedDelta(fullDelta.delta, fullDelta.deltaData);
             }
+            else if (myDelta->getType() == ProjectInfoDeltas::projectTuning)
+            {
+                NewSerializedDelta fullDelta = this->createTuningDiff(stateDeltaData, myDeltaData);
+                diff->addOwnedDelta(fullDelta.delta, fullDelta.deltaData);
+            }
         }
     }
 
@@ -148,6 +174,12 @@ Diff *ProjectInfoDiffLogic::createMergedItem(const TrackedItem &initialState) co
                     XmlElement *diffDeltaData = this->mergeDescription(stateDeltaData, targetDeltaData);
                     diff->addOwnedDelta(diffDelta, diffDeltaData);
                 }
+                else if (targetDelta->getType() == ProjectInfoDeltas::projectTuning)
+                {
+                    Delta *diffDelta = new Delta(targetDelta->getDescription(), targetDelta->getType());
+                    XmlElement *diffDeltaData = this->mergeTuning(stateDeltaData, targetDeltaData);
+                    diff->addOwnedDelta(diffDelta, diffDeltaData);
+                }
             }
         }
 
@@ -187,6 +219,11 @@ XmlElement *ProjectInfoDiffLogic::mergeDescription(const XmlElement *state, cons
     return new XmlElement(*changes);
 }
 
+XmlElement *ProjectInfoDiffLogic::mergeTuning(const XmlElement *state, const XmlElement *changes) const
+{
+    return new XmlElement(*changes);
+}
+
 NewSerializedDelta ProjectInfoDiffLogic::createPathDiff(const XmlElement *state, const XmlElement *changes) const
 {
     NewSerializedDelta res;
@@ -218,3 +255,11 @@ NewSerializedDelta ProjectInfoDiffLogic::createDescriptionDiff(const XmlElement
     res.deltaData = new XmlElement(*changes);
     return res;
 }
+
+NewSerializedDelta ProjectInfoDiffLogic::createTuningDiff(const XmlElement *state, const XmlElement *changes) const
+{
+    NewSerializedDelta res;
+    res.delta = new Delta(DeltaDescription("tuning changed"), ProjectInfoDeltas::projectTuning);
+    res.deltaData = new XmlElement(*changes);
+    return res;
+}
@@ -43,11 +43,13 @@ namespace VCS
         XmlElement *mergeFullName(const XmlElement *state, const XmlElement *changes) const;
         XmlElement *mergeAuthor(const XmlElement *state, const XmlElement *changes) const;
         XmlElement *mergeDescription(const XmlElement *state, const XmlElement *changes) const;
+        XmlElement *mergeTuning(const XmlElement *state, const XmlElement *changes) const;
 
         NewSerializedDelta createPathDiff(const XmlElement *state, const XmlElement *changes) const;
         NewSerializedDelta createFullNameDiff(const XmlElement *state, const XmlElement *changes) const;
         NewSerializedDelta createAuthorDiff(const XmlElement *state, const XmlElement *changes) const;
         NewSerializedDelta createDescriptionDiff(const XmlElement *state, const XmlElement *changes) const;
+        NewSerializedDelta createTuningDiff(const XmlElement *state, const XmlElement *changes) const;
 
     };
 } // namespace VCS
@@ -325,7 +325,50 @@ bool Head::resetChangedItemToState(const VCS::RevisionItem::Ptr diffItem)
     return false;
 }
 
+void Head::getUnchangedItemHashes(HashMap<String, String> &outHashes) const
+{
+    if (this->state == nullptr || this->isDiffOutdated() || this->isRebuildingDiff())
+    { return; }
+
+    const ValueTree currentDiff(this->getDiff());
+    const ScopedReadLock lock(this->stateLock);
+
+    for (int i = 0; i < this->state->getNumTrackedItems(); ++i)
+    {
+        const RevisionItem::Ptr stateItem = static_cast<RevisionItem *>(this->state->getTrackedItem(i));
+        const String uuid(stateItem->getUuid().toString());
+
+        if (stateItem->getType() != RevisionItem::Removed && ! currentDiff.hasProperty(uuid))
+        {
+            outHashes.set(uuid, stateItem->getContentHash());
+        }
+    }
+}
+
+Array<RevisionItem::Ptr> Head::getStateItems() const
+{
+    Array<RevisionItem::Ptr> result;
+
+    if (this->state == nullptr)
+    { return result; }
+
+    const ScopedReadLock lock(this->stateLock);
+
+    for (int i = 0; i < this->state->getNumTrackedItems(); ++i)
+    {
+        result.add(static_cast<RevisionItem *>(this->state->getTrackedItem(i)));
+    }
+
+    return result;
+}
+
 void Head::checkout()
+{
+    const HashMap<String, String> noUnchangedItems;
+    this->checkout(noUnchangedItems);
+}
+
+void Head::checkout(const HashMap<String, String> &unchangedItemHashes)
 {
     if (this->targetVcsItemsSource == nullptr)
     { return; }
@@ -333,6 +376,22 @@ void Head::checkout()
     if (this->state == nullptr)
     { return; }
 
+    // items that are already in the target state are left alone
+    Array<Uuid> itemsToKeep;
+
+    for (int i = 0; i < this->state->getNumTrackedItems(); ++i)
+    {
+        const RevisionItem::Ptr stateItem = static_cast<RevisionItem *>(this->state->getTrackedItem(i));
+        const String uuid(stateItem->getUuid().toString());
+
+        if (stateItem->getType() != RevisionItem::Removed &&
+            unchangedItemHashes.contains(uuid) &&
+            unchangedItemHashes[uuid] == stateItem->getContentHash())
+        {
+            itemsToKeep.add(stateItem->getUuid());
+        }
+    }
+
     // clear all tracked items
     {
         Array<TrackedItem *> itemsToClear;
@@ -341,7 +400,8 @@ void Head::checkout()
         {
             TrackedItem *ti = this->targetVcsItemsSource->getTrackedItem(i);
 
-            if (this->state->getItemWithUuid(ti->getUuid()) != nullptr)
+            if (this->state->getItemWithUuid(ti->getUuid()) != nullptr &&
+                ! itemsToKeep.contains(ti->getUuid()))
             {
                 itemsToClear.add(ti);
             }
@@ -356,7 +416,10 @@ void Head::checkout()
     for (int i = 0; i < this->state->getNumTrackedItems(); ++i)
     {
         RevisionItem::Ptr stateItem = static_cast<RevisionItem *>(this->state->getTrackedItem(i));
-        this->checkoutItem(stateItem);
+        if (! itemsToKeep.contains(stateItem->getUuid()))
+        {
+            this->checkoutItem(stateItem);
+        }
     }
 
     this->targetVcsItemsSource->onResetState();
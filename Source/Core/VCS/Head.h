@@ -58,7 +58,16 @@ namespace VCS
         bool moveTo(const ValueTree revision); // rebuilds state index
         void pointTo(const ValueTree revision); // does not rebuild index
 
+        // Content hashes of the state items that have no uncommitted changes,
+        // by item id; nothing, if the diff is not up to date
+        void getUnchangedItemHashes(HashMap<String, String> &outHashes) const;
+
+        // The items the state is made of, which may still point
+        // to the pack data of revisions that are no longer in the tree
+        Array<RevisionItem::Ptr> getStateItems() const;
+
         void checkout();
+        void checkout(const HashMap<String, String> &unchangedItemHashes); // skips the items that are the same
         void cherryPick(const Array<Uuid> uuids);
         void cherryPickAll();
         bool resetChanges(const Array<RevisionItem::Ptr> &changes);
@@ -0,0 +1,387 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "HistoryCompactor.h"
+#include "BranchMerge.h"
+#include "HeadState.h"
+#include "Revision.h"
+#include "Diff.h"
+#include "SerializationKeys.h"
+
+using namespace VCS;
+
+#define HISTORY_COMPACTOR_MESSAGE_SEPARATOR ", "
+
+static void addBlockKeys(const RevisionItem *item, HashMap<String, int> &keys)
+{
+    for (int i = 0; i < item->getNumDeltas(); ++i)
+    {
+        keys.set(Pack::getBlockKey(item->getUuid(), item->getDelta(i)->getUuid()), 0);
+    }
+}
+
+static void collectBlockKeys(const ValueTree revision, HashMap<String, int> &keys)
+{
+    for (int i = 0; i < revision.getNumProperties(); ++i)
+    {
+        const var property(revision.getProperty(revision.getPropertyName(i)));
+
+        if (const RevisionItem *item = dynamic_cast<RevisionItem *>(property.getObject()))
+        {
+            addBlockKeys(item, keys);
+        }
+    }
+
+    for (int i = 0; i < revision.getNumChildren(); ++i)
+    {
+        collectBlockKeys(revision.getChild(i), keys);
+    }
+}
+
+static int countRevisions(const ValueTree revision)
+{
+    int result = 1;
+
+    for (int i = 0; i < revision.getNumChildren(); ++i)
+    {
+        result += countRevisions(revision.getChild(i));
+    }
+
+    return result;
+}
+
+// A published revision's ancestors are always published too,
+// since the sync pushes and pulls the whole trees
+static bool isPublished(const ValueTree revision, const HashMap<String, int> &published)
+{
+    return published.contains(Revision::getUuid(revision));
+}
+
+static int64 getLatestTimeStamp(const ValueTree revision)
+{
+    int64 result = Revision::getTimeStamp(revision);
+
+    for (int i = 0; i < revision.getNumChildren(); ++i)
+    {
+        result = jmax(result, getLatestTimeStamp(revision.getChild(i)));
+    }
+
+    return result;
+}
+
+HistoryCompactor::HistoryCompactor(Pack::Ptr pack) :
+    Thread("History compaction"),
+    pack(pack),
+    sizeBeforeCompaction(0) {}
+
+HistoryCompactor::~HistoryCompactor()
+{
+    // the pack rewrite cannot be interrupted halfway
+    this->stopThread(-1);
+    this->cancelPendingUpdate();
+}
+
+//===----------------------------------------------------------------------===//
+// Squash and prune
+//===----------------------------------------------------------------------===//
+
+bool HistoryCompactor::squash(Pack::Ptr pack, ValueTree first, ValueTree last)
+{
+    ValueTree parent(first.getParent());
+
+    if (! parent.isValid() || first == last)
+    {
+        return false;
+    }
+
+    Array<ValueTree> range;
+
+    for (ValueTree rev(last); rev != first; rev = rev.getParent())
+    {
+        if (! rev.isValid())
+        {
+            return false; // last is not a descendant of first
+        }
+
+        range.insert(0, rev);
+    }
+
+    range.insert(0, first);
+
+    for (int i = 0; i < range.size() - 1; ++i)
+    {
+        if (range.getReference(i).getNumChildren() != 1)
+        {
+            return false;
+        }
+    }
+
+    // the net changes of the range are the difference
+    // between the states before and after it
+    const ScopedPointer<HeadState> stateBefore(BranchMerge::createStateAt(parent));
+    const ScopedPointer<HeadState> stateAfter(BranchMerge::createStateAt(last));
+
+    StringArray itemIds;
+    StringArray messages;
+
+    for (const auto &rev : range)
+    {
+        for (int i = 0; i < rev.getNumProperties(); ++i)
+        {
+            const var property(rev.getProperty(rev.getPropertyName(i)));
+
+            if (RevisionItem *item = dynamic_cast<RevisionItem *>(property.getObject()))
+            {
+                itemIds.addIfNotAlreadyThere(item->getUuid().toString());
+            }
+        }
+
+        messages.addIfNotAlreadyThere(Revision::getMessage(rev));
+    }
+
+    Array<RevisionItem::Ptr> squashedItems;
+
+    for (const auto &itemId : itemIds)
+    {
+        const RevisionItem::Ptr itemBefore(stateBefore->getItemWithUuid(Uuid(itemId)));
+        const RevisionItem::Ptr itemAfter(stateAfter->getItemWithUuid(Uuid(itemId)));
+
+        const bool existedBefore = (itemBefore != nullptr && itemBefore->getType() != RevisionItem::Removed);
+        const bool existsAfter = (itemAfter != nullptr && itemAfter->getType() != RevisionItem::Removed);
+
+        if (existsAfter && ! existedBefore)
+        {
+            squashedItems.add(new RevisionItem(pack, RevisionItem::Added, itemAfter));
+        }
+        else if (existedBefore && ! existsAfter)
+        {
+            ScopedPointer<Diff> emptyDiff(new Diff(*itemBefore));
+            squashedItems.add(new RevisionItem(pack, RevisionItem::Removed, emptyDiff));
+        }
+        else if (existedBefore && existsAfter)
+        {
+            ScopedPointer<Diff> itemDiff(itemAfter->getDiffLogic()->createDiff(*itemBefore));
+
+            if (itemDiff->hasAnyChanges())
+            {
+                squashedItems.add(new RevisionItem(pack, RevisionItem::Changed, itemDiff));
+            }
+        }
+    }
+
+    // the last revision keeps its id, so that the head and its children stay where they are
+    for (int i = last.getNumProperties(); --i >= 0;)
+    {
+        const Identifier id(last.getPropertyName(i));
+
+        if (dynamic_cast<RevisionItem *>(last.getProperty(id).getObject()) != nullptr)
+        {
+            last.removeProperty(id, nullptr);
+        }
+    }
+
+    for (const auto &item : squashedItems)
+    {
+        last.setProperty(item->getUuid().toString(), var(item), nullptr);
+    }
+
+    last.setProperty(Serialization::VCS::commitMessage,
+        messages.joinIntoString(HISTORY_COMPACTOR_MESSAGE_SEPARATOR), nullptr);
+
+    const int index = parent.indexOf(first);
+    parent.removeChild(first, nullptr);
+    last.getParent().removeChild(last, nullptr);
+    parent.addChild(last, index, nullptr);
+
+    Revision::incrementVersion(last);
+    Revision::flush(last);
+    return true;
+}
+
+bool HistoryCompactor::prune(ValueTree revision, const ValueTree head)
+{
+    ValueTree parent(revision.getParent());
+
+    if (! parent.isValid())
+    {
+        return false;
+    }
+
+    for (ValueTree rev(head); rev.isValid(); rev = rev.getParent())
+    {
+        if (rev == revision)
+        {
+            return false;
+        }
+    }
+
+    parent.removeChild(revision, nullptr);
+    return true;
+}
+
+static void pruneOldBranches(const ValueTree head, const HashMap<String, int> &published,
+    int64 cutoffTime, int &numPruned)
+{
+    // the branches that lead away from the path to the head;
+    // the ones that grow from the head itself are left alone,
+    // as the head may have been moved back in time
+    for (ValueTree child(head), rev(head.getParent());
+         rev.isValid(); child = rev, rev = rev.getParent())
+    {
+        for (int i = rev.getNumChildren(); --i >= 0;)
+        {
+            const ValueTree branch(rev.getChild(i));
+
+            if (branch != child && ! isPublished(branch, published) &&
+                getLatestTimeStamp(branch) < cutoffTime)
+            {
+                const int numRevisions = countRevisions(branch);
+
+                if (HistoryCompactor::prune(branch, head))
+                {
+                    numPruned += numRevisions;
+                }
+            }
+        }
+    }
+}
+
+static void squashOldRuns(Pack::Ptr pack, ValueTree revision, const ValueTree head,
+    const HashMap<String, int> &published, int64 cutoffTime, int &numSquashed)
+{
+    for (int i = 0; i < revision.getNumChildren(); ++i)
+    {
+        const ValueTree first(revision.getChild(i));
+
+        if (! isPublished(first, published) && Revision::getTimeStamp(first) < cutoffTime)
+        {
+            ValueTree last(first);
+            int numRevisions = 1;
+
+            while (last != head && last.getNumChildren() == 1 &&
+                   Revision::getTimeStamp(last.getChild(0)) < cutoffTime)
+            {
+                last = last.getChild(0);
+                numRevisions++;
+            }
+
+            if (numRevisions > 1 && HistoryCompactor::squash(pack, first, last))
+            {
+                numSquashed += numRevisions - 1;
+            }
+        }
+
+        // either the first or the squashed revision
+        squashOldRuns(pack, revision.getChild(i), head, published, cutoffTime, numSquashed);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Compaction
+//===----------------------------------------------------------------------===//
+
+bool HistoryCompactor::compact(ValueTree root, const ValueTree head,
+    const Array<ValueTree> &stashes,
+    const Array<RevisionItem::Ptr> &liveItems,
+    const HashMap<String, int> &publishedRevisions,
+    RelativeTime minAge, Callback callback)
+{
+    if (this->isCompacting())
+    {
+        return false;
+    }
+
+    this->report = Report();
+    this->callback = callback;
+    this->sizeBeforeCompaction = this->pack->getSizeInBytes();
+
+    const int64 cutoffTime = (Time::getCurrentTime() - minAge).toMilliseconds();
+
+    if (head.isValid())
+    {
+        pruneOldBranches(head, publishedRevisions, cutoffTime, this->report.numRevisionsPruned);
+    }
+
+    squashOldRuns(this->pack, root, head, publishedRevisions,
+        cutoffTime, this->report.numRevisionsSquashed);
+
+    // whatever is still in memory goes to disk,
+    // so that the blocks list below is complete
+    this->pack->flush();
+
+    HashMap<String, int> referencedBlocks;
+    collectBlockKeys(root, referencedBlocks);
+
+    for (const auto &stash : stashes)
+    {
+        collectBlockKeys(stash, referencedBlocks);
+    }
+
+    for (const auto &item : liveItems)
+    {
+        addBlockKeys(item, referencedBlocks);
+    }
+
+    // the blocks stored from now on are not in this list,
+    // so the pack can keep growing while it is being rewritten
+    this->blocksToRemove.clear();
+
+    for (const auto &block : this->pack->getStoredBlocks())
+    {
+        const String key(Pack::getBlockKey(block.itemId, block.deltaId));
+
+        if (! referencedBlocks.contains(key) && ! this->blocksToRemove.contains(key))
+        {
+            this->blocksToRemove.set(key, 0);
+            this->report.numBlocksRemoved++;
+        }
+    }
+
+    this->startThread(3);
+    return true;
+}
+
+bool HistoryCompactor::isCompacting() const
+{
+    return this->isThreadRunning() || this->isUpdatePending();
+}
+
+void HistoryCompactor::run()
+{
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    this->pack->compact(this->blocksToRemove);
+    this->report.bytesSaved = this->sizeBeforeCompaction - this->pack->getSizeInBytes();
+
+    const double endTime = Time::getMillisecondCounterHiRes();
+
+    Logger::writeToLog("HistoryCompactor: rewrote the pack in " + String(endTime - startTime) + "ms");
+    this->triggerAsyncUpdate();
+}
+
+void HistoryCompactor::handleAsyncUpdate()
+{
+    Logger::writeToLog("HistoryCompactor: " + String(this->report.numRevisionsSquashed) + " revisions squashed, " +
+        String(this->report.numRevisionsPruned) + " pruned, " + String(this->report.numBlocksRemoved) +
+        " blocks removed, " + String(this->report.bytesSaved) + " bytes saved");
+
+    if (this->callback != nullptr)
+    {
+        this->callback(this->report);
+    }
+}
@@ -0,0 +1,89 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Pack.h"
+#include "RevisionItem.h"
+
+namespace VCS
+{
+    // Makes the history smaller.
+    //
+    // Old linear runs of revisions are squashed into their last revision,
+    // which gets the net changes of the whole run (computed by diffing
+    // the states before and after it); old branches that lead away
+    // from the head are pruned; then the pack blocks nothing refers to
+    // any more (left by squashes, prunes, removed stashes, resets and amends)
+    // are dropped by rewriting the pack file in a background thread.
+    //
+    // The tree operations are done on the message thread, as they
+    // are quick enough and the tree is not thread-safe. Only the revisions
+    // that have never been pushed or pulled are squashed or pruned: the sync
+    // merges the trees by revision ids, so the published ones would come back
+    // with the next pull, and the squashed ones would get duplicated.
+
+    class HistoryCompactor final : private Thread, private AsyncUpdater
+    {
+    public:
+
+        struct Report
+        {
+            int numRevisionsSquashed = 0;
+            int numRevisionsPruned = 0;
+            int numBlocksRemoved = 0;
+            int64 bytesSaved = 0;
+        };
+
+        typedef std::function<void (const Report &)> Callback;
+
+        explicit HistoryCompactor(Pack::Ptr pack);
+        ~HistoryCompactor() override;
+
+        // Squashes a linear range of revisions, the first one of which
+        // is not the root, into the last one; returns false if it is not linear
+        static bool squash(Pack::Ptr pack, ValueTree first, ValueTree last);
+
+        // Removes the revision with all its descendants, unless the head is there
+        static bool prune(ValueTree revision, const ValueTree head);
+
+        // Squashes and prunes the unpublished revisions older than minAge,
+        // then starts the pack cleanup; the callback is called
+        // on the message thread when it is done
+        bool compact(ValueTree root, const ValueTree head,
+            const Array<ValueTree> &stashes,
+            const Array<RevisionItem::Ptr> &liveItems,
+            const HashMap<String, int> &publishedRevisions,
+            RelativeTime minAge, Callback callback);
+
+        bool isCompacting() const;
+
+    private:
+
+        void run() override;
+        void handleAsyncUpdate() override;
+
+        Pack::Ptr pack;
+
+        Report report;
+        Callback callback;
+        HashMap<String, int> blocksToRemove;
+        int64 sizeBeforeCompaction;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HistoryCompactor)
+    };
+} // namespace VCS
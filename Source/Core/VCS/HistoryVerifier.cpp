@@ -0,0 +1,240 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "HistoryVerifier.h"
+#include "RevisionItem.h"
+
+using namespace VCS;
+
+#define HISTORY_VERIFIER_CHUNK_SIZE 64
+#define HISTORY_VERIFIER_MIN_PARALLEL_SIZE 256
+
+struct DeltaReference
+{
+    RevisionItem::Ptr item;
+    Delta *delta;
+};
+
+static void collectReferences(const ValueTree revision,
+    HashMap<String, int> &keys, Array<DeltaReference> &references)
+{
+    for (int i = 0; i < revision.getNumProperties(); ++i)
+    {
+        const var property(revision.getProperty(revision.getPropertyName(i)));
+
+        if (RevisionItem *item = dynamic_cast<RevisionItem *>(property.getObject()))
+        {
+            for (int j = 0; j < item->getNumDeltas(); ++j)
+            {
+                Delta *delta = item->getDelta(j);
+                const String key(Pack::getBlockKey(item->getUuid(), delta->getUuid()));
+
+                if (! keys.contains(key))
+                {
+                    keys.set(key, references.size());
+                    references.add({ item, delta });
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < revision.getNumChildren(); ++i)
+    {
+        collectReferences(revision.getChild(i), keys, references);
+    }
+}
+
+class BlockHashJob final : public ThreadPoolJob
+{
+public:
+
+    BlockHashJob(const Pack &pack, const Array<PackDataHeader> &blocks,
+        Array<String> &hashes, int startIndex, int endIndex) :
+        ThreadPoolJob("Pack verification"),
+        pack(pack),
+        blocks(blocks),
+        hashes(hashes),
+        startIndex(startIndex),
+        endIndex(endIndex) {}
+
+    JobStatus runJob() override
+    {
+        this->calculateHashes();
+        return jobHasFinished;
+    }
+
+    // every job writes to its own range of the preallocated array
+    void calculateHashes()
+    {
+        for (int i = this->startIndex; i < this->endIndex; ++i)
+        {
+            this->hashes.getReference(i) =
+                this->pack.calculateStoredBlockHash(this->blocks.getReference(i));
+        }
+    }
+
+private:
+
+    const Pack &pack;
+    const Array<PackDataHeader> &blocks;
+    Array<String> &hashes;
+
+    const int startIndex;
+    const int endIndex;
+
+    JUCE_DECLARE_NON_COPYABLE(BlockHashJob)
+};
+
+HistoryVerifier::Report HistoryVerifier::verify(Pack &pack,
+    const Array<ValueTree> &histories, bool shouldRepair)
+{
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    Report report;
+
+    // all blocks have to be on disk
+    pack.flush();
+
+    HashMap<String, int> referenceIndices;
+    Array<DeltaReference> references;
+
+    for (const auto &history : histories)
+    {
+        collectReferences(history, referenceIndices, references);
+    }
+
+    const Array<PackDataHeader> blocks(pack.getStoredBlocks());
+
+    Array<String> blockHashes;
+    blockHashes.insertMultiple(0, String(), blocks.size());
+
+    OwnedArray<BlockHashJob> jobs;
+    for (int i = 0; i < blocks.size(); i += HISTORY_VERIFIER_CHUNK_SIZE)
+    {
+        jobs.add(new BlockHashJob(pack, blocks, blockHashes,
+            i, jmin(blocks.size(), i + HISTORY_VERIFIER_CHUNK_SIZE)));
+    }
+
+    if (blocks.size() >= HISTORY_VERIFIER_MIN_PARALLEL_SIZE)
+    {
+        ThreadPool pool(jmin(jobs.size(), SystemStats::getNumCpus()));
+
+        for (auto job : jobs)
+        {
+            pool.addJob(job, false);
+        }
+
+        for (auto job : jobs)
+        {
+            pool.waitForJobToFinish(job, -1);
+        }
+    }
+    else
+    {
+        for (auto job : jobs)
+        {
+            job->calculateHashes();
+        }
+    }
+
+    report.numBlocksChecked = blocks.size();
+
+    // the pack reads the first block stored for a delta,
+    // but any intact block with the same content will do for repairs
+    HashMap<String, int> firstBlocks;
+    HashMap<String, int> blocksByHash;
+
+    for (int i = 0; i < blocks.size(); ++i)
+    {
+        const PackDataHeader &block = blocks.getReference(i);
+        const String key(Pack::getBlockKey(block.itemId, block.deltaId));
+        const String &hash = blockHashes.getReference(i);
+
+        if (! firstBlocks.contains(key))
+        {
+            firstBlocks.set(key, i);
+
+            if (! referenceIndices.contains(key))
+            {
+                report.numUnreferenced++;
+            }
+        }
+
+        if (hash.isNotEmpty() && ! blocksByHash.contains(hash))
+        {
+            blocksByHash.set(hash, i);
+        }
+    }
+
+    for (const auto &reference : references)
+    {
+        report.numDeltasChecked++;
+
+        const String key(Pack::getBlockKey(reference.item->getUuid(), reference.delta->getUuid()));
+        const String expectedHash(reference.delta->getContentHash());
+        const int blockIndex = firstBlocks.contains(key) ? firstBlocks[key] : -1;
+        const String actualHash = (blockIndex >= 0) ? blockHashes[blockIndex] : String();
+
+        if (actualHash.isNotEmpty() && expectedHash.isEmpty())
+        {
+            if (shouldRepair)
+            {
+                reference.delta->setContentHash(actualHash);
+            }
+
+            continue;
+        }
+
+        if (actualHash.isNotEmpty() && actualHash == expectedHash)
+        {
+            continue;
+        }
+
+        report.numDamaged++;
+
+        if (expectedHash.isNotEmpty() && blocksByHash.contains(expectedHash))
+        {
+            if (shouldRepair)
+            {
+                pack.replaceDeltaData(reference.item->getUuid(), reference.delta->getUuid(),
+                    blocks.getReference(blocksByHash[expectedHash]));
+            }
+
+            report.numRepairable++;
+        }
+        else
+        {
+            report.damagedItems.addIfNotAlreadyThere(reference.item->getVCSName());
+        }
+    }
+
+    const double endTime = Time::getMillisecondCounterHiRes();
+
+    Logger::writeToLog("HistoryVerifier: checked " + String(report.numBlocksChecked) +
+        " blocks for " + String(report.numDeltasChecked) + " deltas in " + String(endTime - startTime) + "ms, " +
+        String(report.numDamaged) + " damaged, " + String(report.numRepairable) +
+        (shouldRepair ? " repaired, " : " repairable, ") +
+        String(report.numUnreferenced) + " unreferenced");
+
+    if (! report.isOk())
+    {
+        Logger::writeToLog("HistoryVerifier: damaged items: " + report.damagedItems.joinIntoString(", "));
+    }
+
+    return report;
+}
@@ -0,0 +1,55 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Pack.h"
+
+namespace VCS
+{
+    // Checks the pack against the content hashes stored in the history.
+    //
+    // Every block is read back, decoded and hashed in parallel; the deltas
+    // whose data is missing or does not match its hash can be repaired,
+    // where possible, by pointing them to another block with the same content
+    // (the same data often gets stored several times, e.g. by amends and stashes).
+    // Nothing is changed unless shouldRepair is set, so the user can see
+    // the report first. The deltas saved by older versions have no hashes yet,
+    // so the repair just gives them the hashes of their current data.
+
+    class HistoryVerifier final
+    {
+    public:
+
+        struct Report
+        {
+            int numBlocksChecked = 0;
+            int numDeltasChecked = 0;
+            int numDamaged = 0;
+            int numRepairable = 0; // the damaged deltas with an intact copy in the pack
+            int numUnreferenced = 0; // the blocks nothing in the history points to
+            StringArray damagedItems; // the names of the items that cannot be repaired
+
+            bool isOk() const noexcept
+            { return this->numDamaged == this->numRepairable; }
+        };
+
+        static Report verify(Pack &pack,
+            const Array<ValueTree> &histories, bool shouldRepair);
+
+    };
+} // namespace VCS
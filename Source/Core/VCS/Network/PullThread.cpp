@@ -57,6 +57,7 @@ void PullThread::run()
     URL fetchUrl(this->url);
     fetchUrl = fetchUrl.withParameter(Serialization::Network::fetch, this->localId);
     fetchUrl = fetchUrl.withParameter(Serialization::Network::clientCheck, saltedIdHash);
+    fetchUrl = fetchUrl.withParameter(Serialization::Network::syncFormat, String(DataEncoder::SealedSyncFormat));
 
     {
         int statusCode = 0;
@@ -53,9 +53,15 @@ void PushThread::run()
 
     ScopedPointer<XmlElement> remoteXml;
 
+    // Older clients can't read the sealed format, so it is only pushed
+    // when the remote says it accepts it; a remote that doesn't know
+    // about the negotiation gets the legacy format
+    DataEncoder::SyncFormat pushFormat = DataEncoder::LegacySyncFormat;
+
     URL fetchUrl(this->url);
     fetchUrl = fetchUrl.withParameter(Serialization::Network::fetch, this->localId);
     fetchUrl = fetchUrl.withParameter(Serialization::Network::clientCheck, saltedIdHash);
+    fetchUrl = fetchUrl.withParameter(Serialization::Network::syncFormat, String(DataEncoder::SealedSyncFormat));
 
     {
         int statusCode = 0;
@@ -82,6 +88,16 @@ void PushThread::run()
         downloadStream->readIntoMemoryBlock(fetchData);
         //Logger::writeToLog(fetchData.toString());
 
+        const int acceptedFormat =
+            responseHeaders[Serialization::Network::acceptedSyncFormat].getIntValue();
+
+        if (acceptedFormat >= DataEncoder::SealedSyncFormat)
+        {
+            pushFormat = DataEncoder::SealedSyncFormat;
+        }
+
+        Logger::writeToLog("Push format: " + String(pushFormat));
+
         remoteXml = DataEncoder::createDecryptedXml(fetchData, this->localKey);
 
         const bool fileExists = (fetchData.getSize() != 0) && (statusCode != 404);
@@ -153,9 +169,14 @@ void PushThread::run()
     TemporaryFile tempFile("vcs");
 
     {
+        // Encrypted straight into the file, chunk by chunk
         ScopedPointer<XmlElement> xmlToPush(remoteVCS.serialize());
-        MemoryBlock encryptedRemoteXml(DataEncoder::encryptXml(*xmlToPush, this->localKey));
-        tempFile.getFile().replaceWithData(encryptedRemoteXml.getData(), encryptedRemoteXml.getSize());
+        ScopedPointer<FileOutputStream> out(tempFile.getFile().createOutputStream());
+        if (out == nullptr || !DataEncoder::writeEncryptedXml(*xmlToPush, this->localKey, *out, pushFormat))
+        {
+            this->setState(SyncThread::syncError);
+            return;
+        }
     }
 
     // debug
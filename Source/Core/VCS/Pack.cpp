@@ -41,7 +41,8 @@ using namespace VCS;
 // в памяти держим только хэдер, где записано: пара id и смещения в файле.
 //
 
-Pack::Pack()
+Pack::Pack() :
+    numResets(0)
 {
     // todo иногда пишет в корень диска c: ? wtf
 
@@ -118,9 +119,9 @@ XmlElement *Pack::createDeltaDataFor(const Uuid &itemId,
     return nullptr;
 }
 
-void Pack::setDeltaDataFor(const Uuid &itemId,
-                           const Uuid &deltaId,
-                           const XmlElement &data)
+String Pack::setDeltaDataFor(const Uuid &itemId,
+                             const Uuid &deltaId,
+                             const XmlElement &data)
 {
     const ScopedLock lock(this->packLocker);
 
@@ -134,6 +135,255 @@ void Pack::setDeltaDataFor(const Uuid &itemId,
     ms.flush();
 
     this->unsavedData.add(block);
+    return SHA256(block->data).toHexString();
+}
+
+
+//===----------------------------------------------------------------------===//
+// Verification
+//===----------------------------------------------------------------------===//
+
+String Pack::calculateHash(const XmlElement &data)
+{
+    MemoryBlock block;
+    MemoryOutputStream ms(block, false);
+    data.writeToStream(ms, "", true, false);
+    ms.flush();
+    return SHA256(block).toHexString();
+}
+
+String Pack::getBlockKey(const Uuid &itemId, const Uuid &deltaId)
+{
+    return itemId.toString() + deltaId.toString();
+}
+
+Array<PackDataHeader> Pack::getStoredBlocks() const
+{
+    const ScopedLock lock(this->packLocker);
+
+    Array<PackDataHeader> result;
+    result.ensureStorageAllocated(this->headers.size());
+
+    for (auto header : this->headers)
+    {
+        result.add(*header);
+    }
+
+    return result;
+}
+
+String Pack::calculateStoredBlockHash(const PackDataHeader &header) const
+{
+    MemoryBlock mb;
+
+    {
+        const ScopedLock lock(this->packStreamLock);
+
+        if (this->packStream == nullptr ||
+            ! this->packStream->setPosition(header.startPosition) ||
+            this->packStream->readIntoMemoryBlock(mb, header.numBytes) != size_t(header.numBytes))
+        {
+            return {};
+        }
+    }
+
+    // the decoding is what takes time, so it goes outside the lock
+
+#if VCS_PACK_DEBUGGING
+    const String &xmlData = mb.toString();
+#else
+    const String &xmlData = DataEncoder::deobfuscateString(mb.toString());
+#endif
+
+    return SHA256(xmlData.toUTF8()).toHexString();
+}
+
+void Pack::replaceDeltaData(const Uuid &itemId,
+                            const Uuid &deltaId,
+                            const PackDataHeader &intactBlock)
+{
+    const ScopedLock lock(this->packLocker);
+
+    for (int i = this->headers.size(); --i >= 0;)
+    {
+        const PackDataHeader *header = this->headers.getUnchecked(i);
+        if (header->itemId == itemId && header->deltaId == deltaId)
+        {
+            this->headers.remove(i);
+        }
+    }
+
+    // the pack file is append-only, so the two headers may
+    // safely share the same bytes on disk
+    auto newHeader = new PackDataHeader(intactBlock);
+    newHeader->itemId = itemId;
+    newHeader->deltaId = deltaId;
+    this->headers.insert(0, newHeader);
+}
+
+
+//===----------------------------------------------------------------------===//
+// Compaction
+//===----------------------------------------------------------------------===//
+
+int64 Pack::getSizeInBytes() const
+{
+    const ScopedLock lock(this->packLocker);
+
+    int64 result = 0;
+
+    for (auto block : this->unsavedData)
+    {
+        result += block->data.getSize();
+    }
+
+    const ScopedLock streamLock(this->packStreamLock);
+
+    if (this->packStream != nullptr)
+    {
+        result += this->packStream->getTotalLength();
+    }
+
+    return result;
+}
+
+int64 Pack::compact(const HashMap<String, int> &blocksToRemove)
+{
+    // The bulk of the data is copied without blocking the message thread:
+    // the pack file is only ever appended to, so the blocks of a snapshot
+    // stay where they are, whatever is committed in the meantime
+
+    OwnedArray<PackDataHeader> snapshot;
+    int resetsAtSnapshot = 0;
+
+    {
+        const ScopedLock lock(this->packLocker);
+        const ScopedLock streamLock(this->packStreamLock);
+
+        if (this->packStream == nullptr)
+        {
+            return 0;
+        }
+
+        for (auto header : this->headers)
+        {
+            snapshot.add(new PackDataHeader(*header));
+        }
+
+        resetsAtSnapshot = this->numResets;
+    }
+
+    TemporaryFile tempFile(*this->packFile);
+    ScopedPointer<FileOutputStream> tempOutputStream(tempFile.getFile().createOutputStream());
+
+    if (tempOutputStream == nullptr || ! tempOutputStream->openedOk())
+    {
+        jassertfalse;
+        return 0;
+    }
+
+    HashMap<int64, int64> newPositions; // the repaired deltas share their bytes
+
+    auto copyBlock = [this, &tempOutputStream, &newPositions](const PackDataHeader &header)
+    {
+        if (! newPositions.contains(header.startPosition))
+        {
+            MemoryBlock mb;
+            if (this->readStoredBlock(header, mb))
+            {
+                newPositions.set(header.startPosition, tempOutputStream->getPosition());
+                tempOutputStream->write(mb.getData(), mb.getSize());
+            }
+        }
+    };
+
+    {
+        HashMap<String, int> keptBlocks;
+
+        for (auto header : snapshot)
+        {
+            const String key(Pack::getBlockKey(header->itemId, header->deltaId));
+
+            // only the first block stored for a delta is ever read
+            if (! blocksToRemove.contains(key) && ! keptBlocks.contains(key))
+            {
+                keptBlocks.set(key, 0);
+                copyBlock(*header);
+            }
+        }
+    }
+
+    // Now the headers are rebuilt from the current ones, so that
+    // whatever has been flushed or repaired meanwhile is not lost;
+    // only the few blocks written since the snapshot are copied under the lock
+
+    const ScopedLock lock(this->packLocker);
+    const ScopedLock streamLock(this->packStreamLock);
+
+    if (this->packStream == nullptr || this->numResets != resetsAtSnapshot)
+    {
+        return 0; // the whole pack has been replaced
+    }
+
+    const int64 oldSize = this->packStream->getTotalLength();
+
+    OwnedArray<PackDataHeader> newHeaders;
+    HashMap<String, int> keptBlocks;
+
+    for (auto header : this->headers)
+    {
+        const String key(Pack::getBlockKey(header->itemId, header->deltaId));
+
+        if (blocksToRemove.contains(key) || keptBlocks.contains(key))
+        {
+            continue;
+        }
+
+        copyBlock(*header);
+
+        if (! newPositions.contains(header->startPosition))
+        {
+            jassertfalse; // could not be read, keep the whole pack as it is
+            return 0;
+        }
+
+        auto newHeader = new PackDataHeader(*header);
+        newHeader->startPosition = newPositions[header->startPosition];
+        newHeaders.add(newHeader);
+
+        keptBlocks.set(key, newHeaders.size());
+    }
+
+    const int64 newSize = tempOutputStream->getPosition();
+    tempOutputStream = nullptr;
+
+    this->packStream = nullptr;
+    this->packWriteLocker = nullptr;
+
+    const bool replaced = tempFile.overwriteTargetFileWithTemporary();
+    jassert(replaced);
+
+    if (replaced)
+    {
+        this->headers.swapWith(newHeaders);
+    }
+
+    this->packStream = this->packFile->createInputStream();
+    jassert(this->packStream->openedOk());
+
+    this->packWriteLocker = this->packFile->createOutputStream();
+    jassert(this->packWriteLocker->openedOk());
+
+    return replaced ? (oldSize - newSize) : 0;
+}
+
+bool Pack::readStoredBlock(const PackDataHeader &header, MemoryBlock &result) const
+{
+    const ScopedLock lock(this->packStreamLock);
+
+    return (this->packStream != nullptr &&
+        this->packStream->setPosition(header.startPosition) &&
+        this->packStream->readIntoMemoryBlock(result, header.numBytes) == size_t(header.numBytes));
 }
 
 
@@ -217,6 +467,7 @@ void Pack::reset()
 {
     const ScopedLock lock(this->packStreamLock);
 
+    this->numResets++;
     this->headers.clear();
     this->unsavedData.clear();
     this->packStream = nullptr;
@@ -60,9 +60,46 @@ namespace VCS
                                        const Uuid &deltaId) const;
 
 
-        void setDeltaDataFor(const Uuid &itemId,
-                                     const Uuid &deltaId,
-                                     const XmlElement &data);
+        // returns the content hash of the data stored
+        String setDeltaDataFor(const Uuid &itemId,
+                               const Uuid &deltaId,
+                               const XmlElement &data);
+
+
+        //===------------------------------------------------------------------===//
+        // Verification
+        //
+
+        static String calculateHash(const XmlElement &data);
+
+        static String getBlockKey(const Uuid &itemId, const Uuid &deltaId);
+
+        // all blocks on disk (call flush() first to include the unsaved ones)
+        Array<PackDataHeader> getStoredBlocks() const;
+
+        // reads the block back from disk and hashes it the same way
+        // setDeltaDataFor does, returns an empty string if it can't be read;
+        // safe to call from several threads at once
+        String calculateStoredBlockHash(const PackDataHeader &header) const;
+
+        // points the item's delta to another block with the same content
+        void replaceDeltaData(const Uuid &itemId,
+                              const Uuid &deltaId,
+                              const PackDataHeader &intactBlock);
+
+
+        //===------------------------------------------------------------------===//
+        // Compaction
+        //
+
+        // the size of the pack file plus the data not flushed yet
+        int64 getSizeInBytes() const;
+
+        // rewrites the pack file without the given blocks (by block key)
+        // and without the stale duplicates of the remaining ones;
+        // returns the number of bytes saved. Meant to be called from
+        // a background thread: the locks are only held for short moments
+        int64 compact(const HashMap<String, int> &blocksToRemove);
 
 
         //===------------------------------------------------------------------===//
@@ -82,6 +119,8 @@ namespace VCS
 
         XmlElement *createXmlData(const PackDataHeader *header) const;
 
+        bool readStoredBlock(const PackDataHeader &header, MemoryBlock &result) const;
+
     private:
 
         // todo locks?
@@ -100,6 +139,9 @@ namespace VCS
         
         CriticalSection packLocker;
 
+        // lets the compaction know the pack has been replaced while it was copying
+        int numResets;
+
         Uuid uuid;
 
 
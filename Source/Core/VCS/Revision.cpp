@@ -149,6 +149,51 @@ MD5 Revision::calculateHash(ValueTree revision)
     return MD5(sum.joinIntoString("").toUTF8());
 }
 
+String Revision::getContentHash(ValueTree revision)
+{
+    const String storedHash(revision.getProperty(Serialization::VCS::commitHash).toString());
+    return storedHash.isNotEmpty() ? storedHash : Revision::calculateContentHash(revision);
+}
+
+String Revision::calculateContentHash(ValueTree revision)
+{
+    StringArray items;
+    for (int i = 0; i < revision.getNumProperties(); ++i)
+    {
+        const var property(revision.getProperty(revision.getPropertyName(i)));
+
+        if (RevisionItem *revItem = dynamic_cast<RevisionItem *>(property.getObject()))
+        {
+            items.add(revItem->getUuid().toString() + "=" + revItem->getContentHash());
+        }
+    }
+
+    items.sort(true);
+
+    const String sum(Revision::getUuid(revision) + ":" +
+        Revision::getMessage(revision) + ":" + items.joinIntoString(":"));
+
+    return SHA256(sum.toUTF8()).toHexString();
+}
+
+String Revision::calculateSubtreeHashes(ValueTree revision,
+    HashMap<String, String> &outHashesById)
+{
+    StringArray children;
+    for (int i = 0; i < revision.getNumChildren(); ++i)
+    {
+        children.add(Revision::calculateSubtreeHashes(revision.getChild(i), outHashesById));
+    }
+
+    // the order of children does not matter
+    children.sort(true);
+
+    const String sum(Revision::getContentHash(revision) + ":" + children.joinIntoString(":"));
+    const String subtreeHash(SHA256(sum.toUTF8()).toHexString());
+    outHashesById.set(Revision::getUuid(revision), subtreeHash);
+    return subtreeHash;
+}
+
 bool Revision::isEmpty(ValueTree revision)
 {
     return Revision::getMessage(revision).isEmpty();
@@ -185,6 +230,9 @@ void Revision::flush(ValueTree revision)
             }
         }
     }
+
+    revision.setProperty(Serialization::VCS::commitHash,
+        Revision::calculateContentHash(revision), nullptr);
 }
 
 void Revision::incrementVersion(ValueTree revision)
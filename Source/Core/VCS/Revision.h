@@ -36,6 +36,15 @@ namespace VCS
         static void copyDeltas(ValueTree one, ValueTree another);
 
         static MD5 calculateHash(ValueTree revision);
+
+        // Merkle-style content hashes: a revision's hash covers its items'
+        // content hashes, and a subtree hash covers the revision's hash
+        // and the subtree hashes of its children (mapped by revision id)
+        static String getContentHash(ValueTree revision);
+        static String calculateContentHash(ValueTree revision);
+        static String calculateSubtreeHashes(ValueTree revision,
+            HashMap<String, String> &outHashesById);
+
         static void incrementVersion(ValueTree revision);
         static void flush(ValueTree revision);
 
@@ -0,0 +1,219 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "RevisionDiff.h"
+#include "BranchMerge.h"
+#include "HeadState.h"
+#include "Diff.h"
+#include "DiffLogic.h"
+#include "SerializationKeys.h"
+
+#include "PianoSequenceDeltas.h"
+#include "PatternDeltas.h"
+
+using namespace VCS;
+
+#define REVISION_DIFF_THREAD_STOP_TIMEOUT 5000
+
+RevisionDiff::RevisionDiff() :
+    Thread("Revision diff"),
+    comparesWorkingCopy(false) {}
+
+RevisionDiff::~RevisionDiff()
+{
+    this->cancel();
+}
+
+void RevisionDiff::compare(const ValueTree baseRevision, const ValueTree targetRevision,
+    WeakReference<TrackedItemsSource> targetProject, Callback resultCallback)
+{
+    this->cancel();
+
+    // the thread only works with the items, since the tree
+    // of revisions can be changed on the message thread meanwhile
+    this->baseItems = BranchMerge::getLineageItems(baseRevision);
+    this->comparesWorkingCopy = ! targetRevision.isValid();
+    this->targetItems = this->comparesWorkingCopy ?
+        Array<RevisionItem::Ptr>() : BranchMerge::getLineageItems(targetRevision);
+
+    this->project = targetProject;
+    this->callback = resultCallback;
+    this->startThread(4);
+}
+
+void RevisionDiff::cancel()
+{
+    this->stopThread(REVISION_DIFF_THREAD_STOP_TIMEOUT);
+    this->cancelPendingUpdate();
+
+    const ScopedLock lock(this->resultLock);
+    this->result = nullptr;
+}
+
+bool RevisionDiff::isComparing() const
+{
+    return this->isThreadRunning() || this->isUpdatePending();
+}
+
+//===----------------------------------------------------------------------===//
+// Thread
+//===----------------------------------------------------------------------===//
+
+void RevisionDiff::addChanges(const TrackedItem &item, const Uuid &itemId,
+    bool isWholeItem, ChangeType wholeItemChangeType, Array<Change> &outChanges)
+{
+    for (int i = 0; i < item.getNumDeltas(); ++i)
+    {
+        const String deltaType(item.getDelta(i)->getType());
+        ChangeType changeType = wholeItemChangeType;
+
+        // a whole item keeps all its events in the "added" deltas
+        if (deltaType == PianoSequenceDeltas::notesAdded || deltaType == PatternDeltas::clipsAdded)
+        {
+            changeType = isWholeItem ? wholeItemChangeType : EventAdded;
+        }
+        else if (isWholeItem)
+        {
+            continue;
+        }
+        else if (deltaType == PianoSequenceDeltas::notesRemoved || deltaType == PatternDeltas::clipsRemoved)
+        {
+            changeType = EventRemoved;
+        }
+        else if (deltaType == PianoSequenceDeltas::notesChanged || deltaType == PatternDeltas::clipsChanged)
+        {
+            changeType = EventChanged;
+        }
+        else
+        {
+            continue;
+        }
+
+        ScopedPointer<XmlElement> deltaData(item.createDeltaDataFor(i));
+
+        if (deltaData == nullptr)
+        {
+            continue;
+        }
+
+        forEachXmlChildElement(*deltaData, e)
+        {
+            Change change;
+            change.type = changeType;
+            change.itemId = itemId;
+            change.isClip = e->hasTagName(Serialization::Core::clip);
+            change.key = e->getIntAttribute("key");
+            change.beat = float(e->getDoubleAttribute(change.isClip ? "start" : "beat"));
+            change.length = float(e->getDoubleAttribute("len"));
+            outChanges.add(change);
+        }
+    }
+}
+
+void RevisionDiff::run()
+{
+    const double startTime = Time::getMillisecondCounterHiRes();
+
+    Result::Ptr newResult(new Result());
+
+    const ScopedPointer<HeadState> baseState(BranchMerge::createState(this->baseItems));
+    const ScopedPointer<HeadState> targetState(this->comparesWorkingCopy ?
+        nullptr : BranchMerge::createState(this->targetItems));
+
+    TrackedItemsSource *target = this->comparesWorkingCopy ?
+        this->project.get() : static_cast<TrackedItemsSource *>(targetState.get());
+
+    if (target == nullptr)
+    {
+        return;
+    }
+
+    HashMap<String, int> comparedItems;
+
+    for (int i = 0; i < target->getNumTrackedItems(); ++i)
+    {
+        if (this->threadShouldExit())
+        {
+            return;
+        }
+
+        const TrackedItem *targetItem = target->getTrackedItem(i);
+        const auto *targetRevisionItem = dynamic_cast<const RevisionItem *>(targetItem);
+
+        if (targetRevisionItem != nullptr && targetRevisionItem->getType() == RevisionItem::Removed)
+        {
+            continue;
+        }
+
+        const Uuid &itemId = targetItem->getUuid();
+        const RevisionItem::Ptr baseItem(baseState->getItemWithUuid(itemId));
+        comparedItems.set(itemId.toString(), i);
+
+        if (baseItem != nullptr && baseItem->getType() != RevisionItem::Removed)
+        {
+            const ScopedPointer<Diff> itemDiff(targetItem->getDiffLogic()->createDiff(*baseItem));
+            RevisionDiff::addChanges(*itemDiff, itemId, false, EventChanged, newResult->changes);
+        }
+        else
+        {
+            RevisionDiff::addChanges(*targetItem, itemId, true, EventAdded, newResult->changes);
+        }
+    }
+
+    for (int i = 0; i < baseState->getNumTrackedItems(); ++i)
+    {
+        if (this->threadShouldExit())
+        {
+            return;
+        }
+
+        const auto *baseItem = static_cast<const RevisionItem *>(baseState->getTrackedItem(i));
+        if (baseItem->getType() != RevisionItem::Removed &&
+            ! comparedItems.contains(baseItem->getUuid().toString()))
+        {
+            RevisionDiff::addChanges(*baseItem, baseItem->getUuid(), true, EventRemoved, newResult->changes);
+        }
+    }
+
+    const double endTime = Time::getMillisecondCounterHiRes();
+    Logger::writeToLog("RevisionDiff: found " + String(newResult->changes.size()) +
+        " changes in " + String(endTime - startTime) + "ms");
+
+    {
+        const ScopedLock lock(this->resultLock);
+        this->result = newResult;
+    }
+
+    this->triggerAsyncUpdate();
+}
+
+void RevisionDiff::handleAsyncUpdate()
+{
+    Result::Ptr newResult;
+
+    {
+        const ScopedLock lock(this->resultLock);
+        newResult = this->result;
+        this->result = nullptr;
+    }
+
+    if (newResult != nullptr && this->callback)
+    {
+        this->callback(newResult);
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "RevisionItem.h"
+#include "TrackedItemsSource.h"
+
+namespace VCS
+{
+    // Finds out which notes and clips differ between two states of a project:
+    // the working copy and a revision, or two revisions of the same history.
+    //
+    // Both states are replayed from the history and compared with the items'
+    // own diff logic in a background thread, the same way the head builds
+    // its diff. The result keeps only the positions of the changed events,
+    // grouped by item, so that an editor can draw them without any lookups.
+
+    class RevisionDiff final : private Thread, private AsyncUpdater
+    {
+    public:
+
+        enum ChangeType
+        {
+            EventAdded = 0,
+            EventRemoved = 1,
+            EventChanged = 2
+        };
+
+        struct Change
+        {
+            ChangeType type;
+            Uuid itemId;
+            bool isClip;
+            int key; // notes only
+            float beat;
+            float length; // notes only
+        };
+
+        class Result final : public ReferenceCountedObject
+        {
+        public:
+
+            Array<Change> changes;
+
+            typedef ReferenceCountedObjectPtr<Result> Ptr;
+        };
+
+        typedef std::function<void (Result::Ptr result)> Callback;
+
+        RevisionDiff();
+        ~RevisionDiff() override;
+
+        // Restarts the comparison, if any is running; an invalid target
+        // revision stands for the working copy of the given project.
+        // The callback is called on the message thread
+        void compare(const ValueTree baseRevision, const ValueTree targetRevision,
+            WeakReference<TrackedItemsSource> project, Callback callback);
+
+        void cancel();
+        bool isComparing() const;
+
+    private:
+
+        static void addChanges(const TrackedItem &item, const Uuid &itemId,
+            bool isWholeItem, ChangeType wholeItemChangeType, Array<Change> &outChanges);
+
+        void run() override;
+        void handleAsyncUpdate() override;
+
+        Array<RevisionItem::Ptr> baseItems;
+        Array<RevisionItem::Ptr> targetItems;
+        bool comparesWorkingCopy;
+        WeakReference<TrackedItemsSource> project;
+
+        Callback callback;
+
+        CriticalSection resultLock;
+        Result::Ptr result;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RevisionDiff)
+    };
+} // namespace VCS
@@ -56,12 +56,47 @@ void RevisionItem::flushData()
 {
     for (int i = 0; i < this->deltasData.size(); ++i)
     {
-        this->pack->setDeltaDataFor(this->getUuid(), this->deltas[i]->getUuid(), *this->deltasData[i]);
+        const String hash =
+            this->pack->setDeltaDataFor(this->getUuid(), this->deltas[i]->getUuid(), *this->deltasData[i]);
+
+        this->deltas[i]->setContentHash(hash);
     }
 
+    // rehash with the fresh delta hashes
+    this->contentHash.clear();
+    this->getContentHash();
     this->deltasData.clear();
 }
 
+String RevisionItem::getContentHash() const
+{
+    if (this->contentHash.isNotEmpty())
+    {
+        return this->contentHash;
+    }
+
+    String sum(this->getUuid().toString() + ":" + String(this->vcsItemType));
+
+    for (int i = 0; i < this->deltas.size(); ++i)
+    {
+        Delta *delta = this->deltas.getUnchecked(i);
+
+        if (delta->getContentHash().isEmpty())
+        {
+            ScopedPointer<XmlElement> deltaData(this->createDeltaDataFor(i));
+            if (deltaData != nullptr)
+            {
+                delta->setContentHash(Pack::calculateHash(*deltaData));
+            }
+        }
+
+        sum << ":" << delta->getType() << "=" << delta->getContentHash();
+    }
+
+    this->contentHash = SHA256(sum.toUTF8()).toHexString();
+    return this->contentHash;
+}
+
 Pack::Ptr RevisionItem::getPackPtr() const
 {
     return this->pack;
@@ -166,6 +201,11 @@ XmlElement *RevisionItem::serialize() const
     xml->setAttribute(Serialization::VCS::revisionItemName, this->getVCSName());
     xml->setAttribute(Serialization::VCS::revisionItemDiffLogic, this->getDiffLogic()->getType());
 
+    if (this->contentHash.isNotEmpty())
+    {
+        xml->setAttribute(Serialization::VCS::revisionItemHash, this->contentHash);
+    }
+
     for (auto delta : this->deltas)
     {
         xml->prependChildElement(delta->serialize());
@@ -190,6 +230,8 @@ void RevisionItem::deserialize(const XmlElement &xml)
     const int type = root->getIntAttribute(Serialization::VCS::revisionItemType, Undefined);
     this->vcsItemType = static_cast<Type>(type);
 
+    this->contentHash = root->getStringAttribute(Serialization::VCS::revisionItemHash);
+
     const String logicType =
         root->getStringAttribute(Serialization::VCS::revisionItemDiffLogic,
                                  "");
@@ -210,5 +252,6 @@ void RevisionItem::reset()
 {
     this->deltas.clear();
     this->description = "";
+    this->contentHash = "";
     this->vcsItemType = Undefined;
 }
@@ -53,6 +53,11 @@ namespace VCS
         
         void importDataForDelta(const XmlElement *deltaDataToCopy, const String &deltaUuid);
 
+        // A hash of the item's identity and its deltas' content hashes,
+        // computed when flushed; the deltas of older projects that have
+        // no stored hashes are hashed from their data on first request
+        String getContentHash() const;
+
 
         //===------------------------------------------------------------------===//
         // TrackedItem
@@ -101,6 +106,8 @@ namespace VCS
 
         String diffLogicType;
 
+        mutable String contentHash;
+
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RevisionItem);
 
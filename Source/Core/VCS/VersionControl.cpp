@@ -36,7 +36,9 @@ VersionControl::VersionControl(WeakReference<VCS::TrackedItemsSource> parent,
     pack(new Pack()),
     stashes(new StashesRepository(pack)),
     head(pack, parent),
+    compactor(new HistoryCompactor(pack)),
     root(Revision::create(pack, "root")),
+    diffOverlayShown(false),
     parentItem(parent),
     historyMergeVersion(1)
 {
@@ -119,7 +121,13 @@ juce::StringArray VersionControl::recursiveGetHashes(const ValueTree revision) c
 
 void VersionControl::mergeWith(VersionControl &remoteHistory)
 {
-    this->recursiveTreeMerge(this->getRoot(), remoteHistory.getRoot());
+    HashMap<String, String> localHashes;
+    HashMap<String, String> remoteHashes;
+    Revision::calculateSubtreeHashes(this->getRoot(), localHashes);
+    Revision::calculateSubtreeHashes(remoteHistory.getRoot(), remoteHashes);
+
+    this->recursiveTreeMerge(this->getRoot(), remoteHistory.getRoot(), localHashes, remoteHashes);
+    this->markAsPublished(remoteHistory.getAllRevisionIds());
 
     this->publicId = remoteHistory.getPublicId();
     this->historyMergeVersion = remoteHistory.getVersion();
@@ -133,17 +141,140 @@ void VersionControl::mergeWith(VersionControl &remoteHistory)
     }
 
     this->pack->flush();
+    this->updateBlameIndex();
     this->sendChangeMessage();
 }
 
-void VersionControl::recursiveTreeMerge(ValueTree localRevision,
-    ValueTree remoteRevision)
+HistoryVerifier::Report VersionControl::verifyHistory(bool shouldRepair)
+{
+    Array<ValueTree> histories;
+    histories.add(this->root);
+    histories.add(this->stashes->getQuickStash());
+
+    for (int i = 0; i < this->stashes->getNumUserStashes(); ++i)
+    {
+        histories.add(this->stashes->getUserStash(i));
+    }
+
+    const HistoryVerifier::Report report =
+        HistoryVerifier::verify(*this->pack, histories, shouldRepair);
+
+    if (shouldRepair)
+    {
+        // the repaired pack headers and the new hashes need to be saved
+        this->sendChangeMessage();
+    }
+
+    return report;
+}
+
+void VersionControl::markAsPublished(const StringArray &revisionIds)
 {
+    for (const auto &id : revisionIds)
+    {
+        this->publishedRevisions.set(id, 0);
+    }
+}
+
+bool VersionControl::isPublished(const ValueTree revision) const
+{
+    return this->publishedRevisions.contains(Revision::getUuid(revision));
+}
+
+static void collectRevisionIds(const ValueTree revision, StringArray &ids)
+{
+    ids.add(Revision::getUuid(revision));
+
+    for (int i = 0; i < revision.getNumChildren(); ++i)
+    {
+        collectRevisionIds(revision.getChild(i), ids);
+    }
+}
+
+StringArray VersionControl::getAllRevisionIds() const
+{
+    StringArray ids;
+    collectRevisionIds(this->root, ids);
+    return ids;
+}
+
+bool VersionControl::compactHistory(RelativeTime minAge, HistoryCompactor::Callback callback)
+{
+    // the sync threads work with the copies of the tree made before they started
+    if (this->remote->isPushing() || this->remote->isPulling())
+    {
+        return false;
+    }
+
+    Array<ValueTree> stashTrees;
+    stashTrees.add(this->stashes->getQuickStash());
+
+    for (int i = 0; i < this->stashes->getNumUserStashes(); ++i)
+    {
+        stashTrees.add(this->stashes->getUserStash(i));
+    }
+
+    if (! this->compactor->compact(this->root, this->head.getHeadingRevision(),
+        stashTrees, this->head.getStateItems(), this->publishedRevisions, minAge, callback))
+    {
+        return false;
+    }
+
+    Supervisor::track(Serialization::Activities::vcsCompactHistory);
+    this->updateBlameIndex();
+    this->sendChangeMessage();
+    return true;
+}
+
+void VersionControl::showDiffOverlay(const ValueTree baseRevision, const ValueTree targetRevision)
+{
+    this->diffOverlayShown = true;
+    this->diffOverlayBase = baseRevision;
+    this->diffOverlayTarget = targetRevision;
+    this->sendChangeMessage();
+}
+
+void VersionControl::hideDiffOverlay()
+{
+    this->diffOverlayShown = false;
+    this->diffOverlayBase = ValueTree();
+    this->diffOverlayTarget = ValueTree();
+    this->sendChangeMessage();
+}
+
+bool VersionControl::isDiffOverlayShown() const noexcept
+{
+    return this->diffOverlayShown;
+}
+
+ValueTree VersionControl::getDiffOverlayBase()
+{
+    return this->diffOverlayBase.isValid() ?
+        this->diffOverlayBase : this->head.getHeadingRevision();
+}
+
+ValueTree VersionControl::getDiffOverlayTarget() const
+{
+    return this->diffOverlayTarget;
+}
+
+void VersionControl::recursiveTreeMerge(ValueTree localRevision, ValueTree remoteRevision,
+    const HashMap<String, String> &localHashes, const HashMap<String, String> &remoteHashes)
+{
+    // nothing has changed in the whole subtree, skip it
+    const String localId(Revision::getUuid(localRevision));
+    const String remoteId(Revision::getUuid(remoteRevision));
+    if (localHashes.contains(localId) && remoteHashes.contains(remoteId) &&
+        localHashes[localId] == remoteHashes[remoteId])
+    {
+        return;
+    }
+
     // сначала мерж двух ревизий.
     // проход по чайлдам идет потом, чтоб head.moveTo у чайлда имел дело
     // с уже смерженным родителем.
 
-    if (Revision::calculateHash(localRevision) != Revision::calculateHash(remoteRevision))
+    if (Revision::getContentHash(localRevision) != Revision::getContentHash(remoteRevision))
     {
         Revision::copyProperties(localRevision, remoteRevision);
         Revision::flush(localRevision);
@@ -178,7 +309,7 @@ void VersionControl::recursiveTreeMerge(ValueTree localRevision,
             ValueTree localChild(localRevision.getChild(j));
             if (Revision::getUuid(localChild) == Revision::getUuid(remoteChild))
             {
-                this->recursiveTreeMerge(localChild, remoteChild);
+                this->recursiveTreeMerge(localChild, remoteChild, localHashes, remoteHashes);
                 remoteChildExistsInLocal = true;
                 break;
             }
@@ -192,7 +323,7 @@ void VersionControl::recursiveTreeMerge(ValueTree localRevision,
             Revision::copyProperties(newLocalChild, remoteChild);
             Revision::flush(newLocalChild);
             localRevision.addChild(newLocalChild, -1, nullptr);
-            this->recursiveTreeMerge(newLocalChild, remoteChild);
+            this->recursiveTreeMerge(newLocalChild, remoteChild, localHashes, remoteHashes);
         }
     }
 
@@ -244,6 +375,7 @@ void VersionControl::moveHead(const ValueTree revision)
     if (! Revision::isEmpty(revision))
     {
         this->head.moveTo(revision);
+        this->updateBlameIndex();
         this->sendChangeMessage();
     }
 }
@@ -252,9 +384,13 @@ void VersionControl::checkout(const ValueTree revision)
 {
     if (! Revision::isEmpty(revision))
     {
+        HashMap<String, String> unchangedItemHashes;
+        this->head.getUnchangedItemHashes(unchangedItemHashes);
+
         this->head.moveTo(revision);
-        this->head.checkout();
+        this->head.checkout(unchangedItemHashes);
         Supervisor::track(Serialization::Activities::vcsCheckoutRevision);
+        this->updateBlameIndex();
         this->sendChangeMessage();
     }
 }
@@ -272,6 +408,33 @@ void VersionControl::cherryPick(const ValueTree revision, const Array<Uuid> uuid
     }
 }
 
+bool VersionControl::mergeBranch(const ValueTree revision,
+    Array<BranchMerge::Conflict> &outConflicts)
+{
+    if (Revision::isEmpty(revision) || this->parentItem == nullptr)
+    {
+        return false;
+    }
+
+    if (! BranchMerge::mergeInto(*this->parentItem.get(),
+        this->head.getHeadingRevision(), revision, outConflicts))
+    {
+        Supervisor::track(Serialization::Activities::vcsMergeError);
+        return false;
+    }
+
+    for (const auto &conflict : outConflicts)
+    {
+        Logger::writeToLog("Merge conflict in " + conflict.itemName + ": " +
+            (conflict.deltaType.isEmpty() ? "item removed" : conflict.deltaType) +
+            (conflict.eventId.isEmpty() ? "" : " " + conflict.eventId));
+    }
+
+    Supervisor::track(Serialization::Activities::vcsMergeBranch);
+    this->sendChangeMessage();
+    return true;
+}
+
 void VersionControl::quickAmendItem(TrackedItem *targetItem)
 {
     RevisionItem::Ptr revisionRecord(new RevisionItem(this->pack, RevisionItem::Added, targetItem));
@@ -279,6 +442,7 @@ void VersionControl::quickAmendItem(TrackedItem *targetItem)
     this->head.moveTo(this->head.getHeadingRevision());
     Revision::flush(this->head.getHeadingRevision());
     this->pack->flush();
+    this->updateBlameIndex();
     this->sendChangeMessage();
 }
 
@@ -361,6 +525,7 @@ bool VersionControl::commit(SparseSet<int> selectedItems, const String &message)
     this->pack->flush();
 
     Supervisor::track(Serialization::Activities::vcsCommit);
+    this->updateBlameIndex();
     this->sendChangeMessage();
 
     return true;
@@ -478,6 +643,16 @@ XmlElement *VersionControl::serialize() const
     xml->setAttribute(Serialization::VCS::vcsHistoryVersion, String(this->historyMergeVersion));
     xml->setAttribute(Serialization::VCS::vcsHistoryId, this->publicId);
     xml->setAttribute(Serialization::VCS::headRevisionId, Revision::getUuid(this->head.getHeadingRevision()));
+
+    StringArray publishedIds;
+    for (HashMap<String, int>::Iterator i(this->publishedRevisions); i.next();)
+    {
+        publishedIds.add(i.getKey());
+    }
+
+    auto publishedXml = new XmlElement(Serialization::VCS::publishedRevisions);
+    publishedXml->addTextElement(publishedIds.joinIntoString(" "));
+    xml->addChildElement(publishedXml);
     
     xml->addChildElement(this->key.serialize());
     xml->addChildElement(Revision::serialize(this->root));
@@ -505,8 +680,20 @@ void VersionControl::deserialize(const XmlElement &xml)
     const String headId = mainSlot->getStringAttribute(Serialization::VCS::headRevisionId);
     Logger::writeToLog("Head ID is " + headId);
 
+
     this->key.deserialize(*mainSlot);
     Revision::deserialize(this->root, *mainSlot);
+
+    // the histories saved before the published revisions were tracked
+    // are assumed to be all published, if they have ever been synced
+    if (const XmlElement *publishedXml = mainSlot->getChildByName(Serialization::VCS::publishedRevisions))
+    {
+        this->markAsPublished(StringArray::fromTokens(publishedXml->getAllSubText(), false));
+    }
+    else if (this->historyMergeVersion > 1) // a new history starts at 1
+    {
+        this->markAsPublished(this->getAllRevisionIds());
+    }
     this->stashes->deserialize(*mainSlot);
     this->pack->deserialize(*mainSlot);
 
@@ -516,7 +703,7 @@ void VersionControl::deserialize(const XmlElement &xml)
         const double h2 = Time::getMillisecondCounterHiRes();
         Logger::writeToLog("Loading index done in " + String(h2 - h1) + "ms");
     }
-    
+
     ValueTree headRevision(this->getRevisionById(this->root, headId));
 
     // здесь мы раньше полностью десериализовали состояние хэда.
@@ -533,6 +720,9 @@ void VersionControl::deserialize(const XmlElement &xml)
 
         const double t2 = Time::getMillisecondCounterHiRes();
         //Logger::writeToLog("Building index done in " + String(t2 - t1) + "ms");
+
+        // picks up the cached blame index, or rebuilds it in the background
+        this->updateBlameIndex();
     }
 //#endif
 }
@@ -540,6 +730,9 @@ void VersionControl::deserialize(const XmlElement &xml)
 void VersionControl::reset()
 {
     Revision::reset(this->root);
+    this->diffOverlayBase = ValueTree();
+    this->diffOverlayTarget = ValueTree();
+    this->publishedRevisions.clear();
     this->head.reset();
     this->stashes->reset();
     this->pack->reset();
@@ -561,6 +754,11 @@ void VersionControl::changeListenerCallback(ChangeBroadcaster* source)
 // Private
 //===----------------------------------------------------------------------===//
 
+void VersionControl::updateBlameIndex()
+{
+    this->blame.update(this->publicId, this->head.getHeadingRevision());
+}
+
 ValueTree VersionControl::getRevisionById(const ValueTree startFrom, const String &id) const
 {
     //Logger::writeToLog("getRevisionById, iterating " + startFrom.getUuid());
@@ -33,6 +33,10 @@ class VersionControlEditor;
 #include "Pack.h"
 #include "Client.h"
 #include "StashesRepository.h"
+#include "BranchMerge.h"
+#include "HistoryVerifier.h"
+#include "HistoryCompactor.h"
+#include "BlameIndex.h"
 
 #include "Key.h"
 
@@ -75,6 +79,35 @@ public:
     MD5 calculateHash() const;
     void mergeWith(VersionControl &remoteHistory);
 
+    // The revisions known to be on the remote, i.e. pushed or pulled;
+    // these are never squashed or pruned, as the next pull would bring them back
+    void markAsPublished(const StringArray &revisionIds);
+    bool isPublished(const ValueTree revision) const;
+    StringArray getAllRevisionIds() const;
+
+    // Checks the pack data of the whole history and stashes
+    // against their content hashes, see HistoryVerifier;
+    // reads and hashes the whole pack, so it is only run on user's request
+    VCS::HistoryVerifier::Report verifyHistory(bool shouldRepair);
+
+    // Squashes and prunes the unpublished revisions older than minAge,
+    // and cleans up the pack in the background, see HistoryCompactor;
+    // returns false if the compaction or the sync is already running
+    bool compactHistory(RelativeTime minAge, VCS::HistoryCompactor::Callback callback);
+
+    // Tells which revisions have introduced and changed the events
+    // of the head's lineage, see BlameIndex
+    VCS::BlameIndex &getBlameIndex() { return this->blame; }
+
+    // What the sequencer's diff overlays compare: the base revision
+    // (or the head, if not valid) against the target revision
+    // (or the working copy, if not valid), see RevisionDiff
+    void showDiffOverlay(const ValueTree baseRevision, const ValueTree targetRevision);
+    void hideDiffOverlay();
+    bool isDiffOverlayShown() const noexcept;
+    ValueTree getDiffOverlayBase();
+    ValueTree getDiffOverlayTarget() const;
+
     //===------------------------------------------------------------------===//
     // VCS
     //===------------------------------------------------------------------===//
@@ -87,6 +120,10 @@ public:
     void checkout(const ValueTree revision);
     void cherryPick(const ValueTree revision, const Array<Uuid> uuids);
 
+    // Three-way merges another branch into the working copy, leaving
+    // the result on the stage; conflicting changes are kept as they are here
+    bool mergeBranch(const ValueTree revision, Array<VCS::BranchMerge::Conflict> &outConflicts);
+
     bool resetChanges(SparseSet<int> selectedItems);
     bool resetAllChanges();
     bool commit(SparseSet<int> selectedItems, const String &message);
@@ -117,15 +154,23 @@ public:
 protected:
 
     StringArray recursiveGetHashes(const ValueTree revision) const;
-    void recursiveTreeMerge(ValueTree localRevision, ValueTree remoteRevision);
+    void recursiveTreeMerge(ValueTree localRevision, ValueTree remoteRevision,
+        const HashMap<String, String> &localHashes, const HashMap<String, String> &remoteHashes);
     ValueTree getRevisionById(const ValueTree startFrom, const String &id) const;
+    void updateBlameIndex();
 
     VCS::Pack::Ptr pack;
     VCS::StashesRepository::Ptr stashes;
     VCS::Head head;
+    ScopedPointer<VCS::HistoryCompactor> compactor;
+    VCS::BlameIndex blame;
 
     // the history tree itself
     ValueTree root;
+
+    bool diffOverlayShown;
+    ValueTree diffOverlayBase;
+    ValueTree diffOverlayTarget;
     ScopedPointer<VCS::Client> remote;
     WeakReference<VCS::TrackedItemsSource> parentItem;
 
@@ -134,6 +179,7 @@ protected:
     String publicId;
     VCS::Key key;
     int64 historyMergeVersion;
+    HashMap<String, int> publishedRevisions;
 
 private:
 
@@ -213,6 +213,10 @@ int CommandIDs::getIdForName(const String &command)
         return ImportMidi;
     case Hash("ExportMidi"):
         return ExportMidi;
+    case Hash("ImportMusicXml"):
+        return ImportMusicXml;
+    case Hash("ExportMusicXml"):
+        return ExportMusicXml;
     case Hash("UnloadProject"):
         return UnloadProject;
     case Hash("DeleteProject"):
@@ -251,6 +255,24 @@ int CommandIDs::getIdForName(const String &command)
         return BatchChangeInstrument;
     case Hash("BatchSetInstrument"):
         return BatchSetInstrument;
+    case Hash("ProjectTuningMenu"):
+        return ProjectTuningMenu;
+    case Hash("LoadTuning"):
+        return LoadTuning;
+    case Hash("ResetTuning"):
+        return ResetTuning;
+    case Hash("ProjectSessionMenu"):
+        return ProjectSessionMenu;
+    case Hash("HostSession"):
+        return HostSession;
+    case Hash("JoinSession"):
+        return JoinSession;
+    case Hash("JoinSessionConfirmed"):
+        return JoinSessionConfirmed;
+    case Hash("LeaveSession"):
+        return LeaveSession;
+    case Hash("HostSessionConfirmed"):
+        return HostSessionConfirmed;
     case Hash("DismissModalDialogAsync"):
         return DismissModalDialogAsync;
     case Hash("SelectFunction"):
@@ -325,6 +347,16 @@ int CommandIDs::getIdForName(const String &command)
         return TweakVolumeRandom;
     case Hash("TweakVolumeFadeOut"):
         return TweakVolumeFadeOut;
+    case Hash("QuantizeSelection"):
+        return QuantizeSelection;
+    case Hash("ShowQuantizePanel"):
+        return ShowQuantizePanel;
+    case Hash("ToggleMetronome"):
+        return ToggleMetronome;
+    case Hash("ToggleBlameOverlay"):
+        return ToggleBlameOverlay;
+    case Hash("ToggleDiffOverlay"):
+        return ToggleDiffOverlay;
     default:
         return 0;
     };
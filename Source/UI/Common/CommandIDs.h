@@ -54,6 +54,9 @@ namespace CommandIDs
         ResetArpeggiatorChanges         = 0x0200,
         ApplyArpeggiator                = 0x0201, // more ids reserved for arps
 
+        // QuantizePanel
+        ApplyQuantization               = 0x0400,
+
         InitWorkspace                   = 0x0500,
 
         RenameInstrument                = 0x0501,
@@ -128,6 +131,7 @@ namespace CommandIDs
         VersionControlReset             = 0x201c,
         VersionControlAmend             = 0x201d,
         VersionControlCommit            = 0x201e,
+        VersionControlCompact           = 0x201f,
 
         // WorkspaceMenu
         LoginLogout                     = 0x2020,
@@ -148,6 +152,8 @@ namespace CommandIDs
 
         ImportMidi                      = 0x2050,
         ExportMidi                      = 0x2051,
+        ImportMusicXml                  = 0x2052,
+        ExportMusicXml                  = 0x2053,
 
         UnloadProject                   = 0x2060,
         DeleteProject                   = 0x2061,
@@ -174,6 +180,20 @@ namespace CommandIDs
         BatchChangeInstrument           = 0x2600,
         BatchSetInstrument              = 0x2601, // more ids reserved for instruments
 
+        ProjectTuningMenu               = 0x2700,
+        LoadTuning                      = 0x2701,
+        ResetTuning                     = 0x2702,
+
+        ProjectSessionMenu              = 0x2710,
+        HostSession                     = 0x2711,
+        JoinSession                     = 0x2712,
+        JoinSessionConfirmed            = 0x2713,
+        LeaveSession                    = 0x2714,
+        HostSessionConfirmed            = 0x2715,
+
+        // Version control, continued
+        VersionControlRepair            = 0x2720,
+
         DismissModalDialogAsync         = 0x3000,
 
         SelectFunction                  = 0x3010,
@@ -194,6 +214,12 @@ namespace CommandIDs
         SelectSampleRate                = 0x3600,
         SelectBufferSize                = 0x3700, // more ids reserved for sub-items
 
+        SelectMidiOutput                = 0x3800,
+        SetMidiOutput                   = 0x3801, // more ids reserved for sub-items
+
+        SelectMidiOutputTuning          = 0x3900,
+        SetMidiOutputTuning             = 0x3901, // more ids reserved for sub-items
+
         EditModeDefault                 = 0x4000,
         EditModeDraw                    = 0x4001,
         EditModePan                     = 0x4002,
@@ -218,8 +244,13 @@ namespace CommandIDs
         ShowVolumePanel                 = 0x405d,
         TweakVolumeRandom               = 0x405e,
         TweakVolumeFadeOut              = 0x405f,
+        QuantizeSelection               = 0x4060,
+        ShowQuantizePanel               = 0x4061,
+        ToggleMetronome                 = 0x4062,
+        ToggleBlameOverlay              = 0x4063,
+        ToggleDiffOverlay               = 0x4064,
 
-        YourNextCommandId               = 0x4060
+        YourNextCommandId               = 0x4065
     };
 
     int getIdForName(const String &command);
@@ -22,15 +22,12 @@
 #include "CommandIDs.h"
 #include "App.h"
 #include "MainLayout.h"
+#include "Instrument.h"
 
 InstrumentCommandPanel::InstrumentCommandPanel(InstrumentTreeItem &parentInstrument) :
     instrument(parentInstrument)
 {
-    CommandPanel::Items cmds;
-    //cmds.add(CommandItem::withParams(Icons::reset, CommandIDs::UpdateInstrument, TRANS("menu::instrument::update")));
-    //cmds.add(CommandItem::withParams(Icons::ellipsis, CommandIDs::RenameInstrument, TRANS("menu::instrument::rename")));
-    cmds.add(CommandItem::withParams(Icons::trash, CommandIDs::DeleteInstrument, TRANS("menu::instrument::delete")));
-    this->updateContent(cmds);
+    this->initDefaultCommands();
 }
 
 InstrumentCommandPanel::~InstrumentCommandPanel()
@@ -41,6 +38,18 @@ void InstrumentCommandPanel::handleCommandMessage(int commandId)
 {
     switch (commandId)
     {
+        case CommandIDs::Back:
+            this->initDefaultCommands();
+            return;
+
+        case CommandIDs::SelectMidiOutput:
+            this->initMidiOutputSelection();
+            return;
+
+        case CommandIDs::SelectMidiOutputTuning:
+            this->initMidiOutputTuningSelection();
+            return;
+
         case CommandIDs::UpdateInstrument:
             this->instrument.updateChildrenEditors();
             break;
@@ -54,5 +63,89 @@ void InstrumentCommandPanel::handleCommandMessage(int commandId)
             break;
     }
 
+    const StringArray devices(MidiOutput::getDevices());
+    if (commandId >= CommandIDs::SetMidiOutput &&
+        commandId <= (CommandIDs::SetMidiOutput + devices.size()))
+    {
+        // The first item is "no output"
+        const int deviceIndex = commandId - CommandIDs::SetMidiOutput - 1;
+        if (Instrument *instrument = this->instrument.getInstrument())
+        {
+            instrument->setMidiOutput(devices[deviceIndex]);
+        }
+    }
+
+    if (commandId >= CommandIDs::SetMidiOutputTuning &&
+        commandId <= (CommandIDs::SetMidiOutputTuning + MidiOutputSender::PitchBendTuning))
+    {
+        const Instrument *instrument = this->instrument.getInstrument();
+        if (const MidiOutputSender::Ptr sender = (instrument != nullptr) ? instrument->getMidiOutputSender() : nullptr)
+        {
+            sender->setTuningMode(MidiOutputSender::TuningMode(commandId - CommandIDs::SetMidiOutputTuning));
+        }
+    }
+
     this->getParentComponent()->exitModalState(0);
 }
+
+void InstrumentCommandPanel::initDefaultCommands()
+{
+    CommandPanel::Items cmds;
+    //cmds.add(CommandItem::withParams(Icons::reset, CommandIDs::UpdateInstrument, TRANS("menu::instrument::update")));
+    //cmds.add(CommandItem::withParams(Icons::ellipsis, CommandIDs::RenameInstrument, TRANS("menu::instrument::rename")));
+#if HELIO_DESKTOP
+    cmds.add(CommandItem::withParams(Icons::saxophone, CommandIDs::SelectMidiOutput, TRANS("menu::instrument::midioutput"))->withSubmenu());
+
+    const Instrument *instrument = this->instrument.getInstrument();
+    if (instrument != nullptr && instrument->getMidiOutputSender() != nullptr)
+    {
+        cmds.add(CommandItem::withParams(Icons::switcher, CommandIDs::SelectMidiOutputTuning, TRANS("menu::instrument::midioutput::tuning"))->withSubmenu());
+    }
+#endif
+    cmds.add(CommandItem::withParams(Icons::trash, CommandIDs::DeleteInstrument, TRANS("menu::instrument::delete")));
+    this->updateContent(cmds, CommandPanel::SlideRight);
+}
+
+void InstrumentCommandPanel::initMidiOutputSelection()
+{
+    CommandPanel::Items cmds;
+    cmds.add(CommandItem::withParams(Icons::left, CommandIDs::Back, TRANS("menu::back"))->withTimer());
+
+    const Instrument *instrument = this->instrument.getInstrument();
+    const String currentDevice = (instrument != nullptr) ? instrument->getMidiOutputName() : String::empty;
+
+    cmds.add(CommandItem::withParams(currentDevice.isEmpty() ? Icons::apply : Icons::close,
+        CommandIDs::SetMidiOutput, TRANS("menu::instrument::midioutput::none")));
+
+    const StringArray devices(MidiOutput::getDevices());
+    for (int i = 0; i < devices.size(); ++i)
+    {
+        const bool isTicked = (devices[i] == currentDevice);
+        cmds.add(CommandItem::withParams(isTicked ? Icons::apply : Icons::saxophone,
+            CommandIDs::SetMidiOutput + 1 + i, devices[i]));
+    }
+
+    this->updateContent(cmds, CommandPanel::SlideLeft);
+}
+
+void InstrumentCommandPanel::initMidiOutputTuningSelection()
+{
+    CommandPanel::Items cmds;
+    cmds.add(CommandItem::withParams(Icons::left, CommandIDs::Back, TRANS("menu::back"))->withTimer());
+
+    const Instrument *instrument = this->instrument.getInstrument();
+    const MidiOutputSender::Ptr sender = (instrument != nullptr) ? instrument->getMidiOutputSender() : nullptr;
+    const int currentMode = (sender != nullptr) ? int(sender->getTuningMode()) : 0;
+
+    const StringArray modeNames(TRANS("menu::instrument::midioutput::tuning::none"),
+        TRANS("menu::instrument::midioutput::tuning::mts"),
+        TRANS("menu::instrument::midioutput::tuning::pitchbend"));
+
+    for (int i = 0; i < modeNames.size(); ++i)
+    {
+        cmds.add(CommandItem::withParams((i == currentMode) ? Icons::apply : Icons::switcher,
+            CommandIDs::SetMidiOutputTuning + i, modeNames[i]));
+    }
+
+    this->updateContent(cmds, CommandPanel::SlideLeft);
+}
@@ -34,5 +34,9 @@ public:
 private:
     
     InstrumentTreeItem &instrument;
+
+    void initDefaultCommands();
+    void initMidiOutputSelection();
+    void initMidiOutputTuningSelection();
     
 };
@@ -35,6 +35,11 @@
 #include "HybridRoll.h"
 #include "Document.h"
 #include "SuccessTooltip.h"
+#include "FailTooltip.h"
+#include "ProjectInfo.h"
+#include "Tuning.h"
+#include "CollaborationSession.h"
+#include "NoteQuery.h"
 #include "MidiTrackActions.h"
 #include "PianoTrackActions.h"
 #include "AutomationTrackActions.h"
@@ -49,7 +54,9 @@
 ProjectCommandPanel::ProjectCommandPanel(ProjectTreeItem &parentProject, AnimationType animationType) :
     project(parentProject),
     haveSetBatchCheckpoint(false),
-    layerNameString(TRANS("defaults::newlayer::name"))
+    layerNameString(TRANS("defaults::newlayer::name")),
+    hostAddress(CollaborationSession::getDefaultBindAddress() + ":" + String(CollaborationSession::getDefaultPort())),
+    sessionAddress("localhost:" + String(CollaborationSession::getDefaultPort()))
 {
     this->initMainMenu(animationType);
 }
@@ -88,6 +95,129 @@ void ProjectCommandPanel::handleCommandMessage(int commandId)
         case CommandIDs::ProjectRenderMenu:
             this->initRenderMenu();
             return;
+
+        case CommandIDs::ProjectTuningMenu:
+            this->initTuningMenu();
+            return;
+
+        case CommandIDs::LoadTuning:
+        {
+#if HELIO_DESKTOP
+            FileChooser fc(TRANS("dialog::tuning::caption"),
+                File::getSpecialLocation(File::userDocumentsDirectory), "*.scl", true);
+
+            if (fc.browseForFileToOpen())
+            {
+                const Tuning tuning(Tuning::loadScalaFile(fc.getResult()));
+                if (tuning.isValid())
+                {
+                    this->project.getProjectInfo()->setTuning(tuning);
+                    App::Helio()->showModalComponent(new SuccessTooltip());
+                }
+                else
+                {
+                    App::Helio()->showModalComponent(new FailTooltip());
+                }
+            }
+#endif
+            this->dismiss();
+            return;
+        }
+
+        case CommandIDs::ResetTuning:
+            this->project.getProjectInfo()->setTuning(Tuning());
+            this->dismiss();
+            return;
+
+        case CommandIDs::ProjectSessionMenu:
+            this->initSessionMenu();
+            return;
+
+        case CommandIDs::HostSession:
+        {
+            Component *inputDialog =
+            new ModalDialogInput(*this,
+                                 this->hostAddress,
+                                 TRANS("dialog::session::host::caption"),
+                                 TRANS("dialog::session::host::proceed"),
+                                 TRANS("dialog::session::cancel"),
+                                 CommandIDs::HostSessionConfirmed,
+                                 CommandIDs::Cancel);
+
+            App::Layout().showModalNonOwnedDialog(inputDialog);
+            return;
+        }
+
+        case CommandIDs::HostSessionConfirmed:
+        {
+            const String bindAddress = this->hostAddress.containsChar(':') ?
+                this->hostAddress.upToLastOccurrenceOf(":", false, false).trim() :
+                this->hostAddress.trim();
+
+            const int port = this->hostAddress.containsChar(':') ?
+                this->hostAddress.fromLastOccurrenceOf(":", false, false).getIntValue() :
+                CollaborationSession::getDefaultPort();
+
+            if (this->project.hostLiveSession(bindAddress, port))
+            {
+                // The peers will need it to join
+                App::Helio()->showTooltip(TRANS("menu::project::session::token") + ": " +
+                    this->project.getLiveSession()->getToken());
+            }
+            else
+            {
+                App::Helio()->showModalComponent(new FailTooltip());
+            }
+
+            this->dismiss();
+            return;
+        }
+
+        case CommandIDs::JoinSession:
+        {
+            Component *inputDialog =
+            new ModalDialogInput(*this,
+                                 this->sessionAddress,
+                                 TRANS("dialog::session::caption"),
+                                 TRANS("dialog::session::proceed"),
+                                 TRANS("dialog::session::cancel"),
+                                 CommandIDs::JoinSessionConfirmed,
+                                 CommandIDs::Cancel);
+
+            App::Layout().showModalNonOwnedDialog(inputDialog);
+            return;
+        }
+
+        case CommandIDs::JoinSessionConfirmed:
+        {
+            // host:port token
+            const String address = this->sessionAddress.trim().upToFirstOccurrenceOf(" ", false, false);
+            const String token = this->sessionAddress.trim().fromFirstOccurrenceOf(" ", false, false).trim();
+
+            const String hostName = address.containsChar(':') ?
+                address.upToLastOccurrenceOf(":", false, false).trim() : address;
+
+            const int port = address.containsChar(':') ?
+                address.fromLastOccurrenceOf(":", false, false).getIntValue() :
+                CollaborationSession::getDefaultPort();
+
+            if (this->project.joinLiveSession(hostName, port, token))
+            {
+                App::Helio()->showModalComponent(new SuccessTooltip());
+            }
+            else
+            {
+                App::Helio()->showModalComponent(new FailTooltip());
+            }
+
+            this->dismiss();
+            return;
+        }
+
+        case CommandIDs::LeaveSession:
+            this->project.leaveLiveSession();
+            this->dismiss();
+            return;
             
         case CommandIDs::ProjectBatchMenu:
             this->initBatchMenu(CommandPanel::SlideLeft);
@@ -185,47 +315,11 @@ void ProjectCommandPanel::handleCommandMessage(int commandId)
             return;
             
         case CommandIDs::RefactorTransposeUp:
-        {
-            Array<MidiTrack *> tracks = this->project.getTracks();
-            bool didCheckpoint = false;
-            
-            for (int i = 0; i < tracks.size(); ++i)
-            {
-                if (PianoSequence *pianoSequence =
-                    dynamic_cast<PianoSequence *>(tracks.getUnchecked(i)->getSequence()))
-                {
-                    if (! didCheckpoint)
-                    {
-                        didCheckpoint = true;
-                        pianoSequence->checkpoint();
-                    }
-                    
-                    pianoSequence->transposeAll(1, false);
-                }
-            }
-        }
+            NoteQueryEngine::transform(this->project, NoteQuery(), NoteTransform().withKeyDelta(1));
             return;
             
         case CommandIDs::RefactorTransposeDown:
-        {
-            Array<MidiTrack *> tracks = this->project.getTracks();
-            bool didCheckpoint = false;
-            
-            for (int i = 0; i < tracks.size(); ++i)
-            {
-                if (PianoSequence *pianoSequence =
-                    dynamic_cast<PianoSequence *>(tracks.getUnchecked(i)->getSequence()))
-                {
-                    if (! didCheckpoint)
-                    {
-                        didCheckpoint = true;
-                        pianoSequence->checkpoint();
-                    }
-
-                    pianoSequence->transposeAll(-1, false);
-                }
-            }
-        }
+            NoteQueryEngine::transform(this->project, NoteQuery(), NoteTransform().withKeyDelta(-1));
             return;
             
         case CommandIDs::ImportMidi:
@@ -249,6 +343,16 @@ void ProjectCommandPanel::handleCommandMessage(int commandId)
             return;
         }
 
+        case CommandIDs::ImportMusicXml:
+            this->project.getDocument()->import("*.musicxml;*.mxl;*.xml");
+            this->getParentComponent()->exitModalState(0);
+            return;
+
+        case CommandIDs::ExportMusicXml:
+            this->project.getDocument()->exportAs("*.musicxml;*.xml", this->project.getName() + ".musicxml");
+            this->getParentComponent()->exitModalState(0);
+            return;
+
         case CommandIDs::UnloadProject:
             App::Workspace().unloadProjectById(this->project.getId());
             this->getParentComponent()->exitModalState(0);
@@ -338,12 +442,21 @@ void ProjectCommandPanel::handleCommandMessage(int commandId)
         return;
     }
     
-    if (commandId >= CommandIDs::AddCustomController &&
-        commandId < (CommandIDs::AddCustomController + NUM_CONTROLLERS_TO_SHOW))
+    const bool isExpressionController =
+        (commandId == CommandIDs::AddCustomController + MidiTrack::pitchBendController ||
+         commandId == CommandIDs::AddCustomController + MidiTrack::channelPressureController);
+
+    if (isExpressionController ||
+        (commandId >= CommandIDs::AddCustomController &&
+         commandId < (CommandIDs::AddCustomController + NUM_CONTROLLERS_TO_SHOW)))
     {
         const int controllerNumber = (commandId - CommandIDs::AddCustomController);
         const String instrumentId = this->lastSelectedInstrument ? this->lastSelectedInstrument->getIdAndHash() : "";
-        const String layerName = TreeItem::createSafeName(MidiMessage::getControllerName(controllerNumber));
+        const String controllerName =
+            (controllerNumber == MidiTrack::pitchBendController) ? TRANS("defaults::pitchbendtrack::name") :
+            (controllerNumber == MidiTrack::channelPressureController) ? TRANS("defaults::pressuretrack::name") :
+            MidiMessage::getControllerName(controllerNumber);
+        const String layerName = TreeItem::createSafeName(controllerName);
         const String autoLayerParams = this->createAutoLayerTempate(layerName, controllerNumber, instrumentId);
         
         this->project.getUndoStack()->beginNewTransaction();
@@ -420,6 +533,11 @@ void ProjectCommandPanel::initMainMenu(AnimationType animationType)
 #endif
 
     cmds.add(CommandItem::withParams(Icons::ellipsis, CommandIDs::ProjectBatchMenu, TRANS("menu::project::refactor"))->withSubmenu());
+
+#if HELIO_DESKTOP
+    cmds.add(CommandItem::withParams(Icons::switcher, CommandIDs::ProjectTuningMenu, TRANS("menu::project::tuning"))->withSubmenu());
+    cmds.add(CommandItem::withParams(Icons::remote, CommandIDs::ProjectSessionMenu, TRANS("menu::project::session"))->withSubmenu());
+#endif
     
 #if JUCE_IOS
     cmds.add(CommandItem::withParams(Icons::commit, CommandIDs::ExportMidi, TRANS("menu::project::render::midi")));
@@ -437,6 +555,7 @@ void ProjectCommandPanel::initNewSubItemsMenu(AnimationType animationType)
     cmds.add(CommandItem::withParams(Icons::layer, CommandIDs::AddMidiTrack, TRANS("menu::project::addlayer")));
 #if HELIO_DESKTOP
     cmds.add(CommandItem::withParams(Icons::open, CommandIDs::ImportMidi, TRANS("menu::project::import::midi")));
+    cmds.add(CommandItem::withParams(Icons::open, CommandIDs::ImportMusicXml, TRANS("menu::project::import::musicxml")));
 #endif
     cmds.add(CommandItem::withParams(Icons::automation, CommandIDs::AddTempoController, TRANS("menu::project::addtempo")));
 
@@ -454,6 +573,11 @@ void ProjectCommandPanel::initSubItemTypeSelectionMenu()
 {
     CommandPanel::Items cmds;
     cmds.add(CommandItem::withParams(Icons::left, CommandIDs::AddItemsMenuBack, TRANS("menu::back"))->withTimer());
+
+    cmds.add(CommandItem::withParams(Icons::automation,
+        CommandIDs::AddCustomController + MidiTrack::pitchBendController, TRANS("defaults::pitchbendtrack::name")));
+    cmds.add(CommandItem::withParams(Icons::automation,
+        CommandIDs::AddCustomController + MidiTrack::channelPressureController, TRANS("defaults::pressuretrack::name")));
     
     for (int i = 0; i < NUM_CONTROLLERS_TO_SHOW; ++i)
     {
@@ -476,6 +600,54 @@ void ProjectCommandPanel::initRenderMenu()
     cmds.add(CommandItem::withParams(Icons::render, CommandIDs::RenderToOGG, TRANS("menu::project::render::ogg")));
     cmds.add(CommandItem::withParams(Icons::render, CommandIDs::RenderToFLAC, TRANS("menu::project::render::flac")));
     cmds.add(CommandItem::withParams(Icons::commit, CommandIDs::ExportMidi, TRANS("menu::project::render::midi")));
+    cmds.add(CommandItem::withParams(Icons::commit, CommandIDs::ExportMusicXml, TRANS("menu::project::render::musicxml")));
+    this->updateContent(cmds, CommandPanel::SlideLeft);
+}
+
+void ProjectCommandPanel::initTuningMenu()
+{
+    CommandPanel::Items cmds;
+    cmds.add(CommandItem::withParams(Icons::left, CommandIDs::Back, TRANS("menu::back"))->withTimer());
+
+    const Tuning tuning(this->project.getProjectInfo()->getTuning());
+    if (! tuning.isEqualTemperament())
+    {
+        cmds.add(CommandItem::withParams(Icons::apply, CommandIDs::ProjectTuningMenu, tuning.getName()));
+    }
+
+    cmds.add(CommandItem::withParams(tuning.isEqualTemperament() ? Icons::apply : Icons::reset,
+        CommandIDs::ResetTuning, TRANS("menu::project::tuning::reset")));
+    cmds.add(CommandItem::withParams(Icons::open, CommandIDs::LoadTuning, TRANS("menu::project::tuning::load")));
+    this->updateContent(cmds, CommandPanel::SlideLeft);
+}
+
+void ProjectCommandPanel::initSessionMenu()
+{
+    CommandPanel::Items cmds;
+    cmds.add(CommandItem::withParams(Icons::left, CommandIDs::Back, TRANS("menu::back"))->withTimer());
+
+    if (const CollaborationSession *session = this->project.getLiveSession())
+    {
+        const String status = (session->isHosting() ?
+            TRANS("menu::project::session::hosting") : TRANS("menu::project::session::joined")) +
+            ", " + TRANS("menu::project::session::peers") + ": " + String(session->getNumPeers());
+
+        cmds.add(CommandItem::withParams(Icons::apply, CommandIDs::ProjectSessionMenu, status));
+
+        if (session->isHosting())
+        {
+            cmds.add(CommandItem::withParams(Icons::login, CommandIDs::ProjectSessionMenu,
+                TRANS("menu::project::session::token") + ": " + session->getToken()));
+        }
+
+        cmds.add(CommandItem::withParams(Icons::close, CommandIDs::LeaveSession, TRANS("menu::project::session::leave")));
+    }
+    else
+    {
+        cmds.add(CommandItem::withParams(Icons::push, CommandIDs::HostSession, TRANS("menu::project::session::host")));
+        cmds.add(CommandItem::withParams(Icons::pull, CommandIDs::JoinSession, TRANS("menu::project::session::join")));
+    }
+
     this->updateContent(cmds, CommandPanel::SlideLeft);
 }
 
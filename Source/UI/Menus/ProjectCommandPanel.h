@@ -36,6 +36,8 @@ public:
 private:
     
     String layerNameString;
+    String hostAddress;
+    String sessionAddress;
     String projectNameRemovalConfirmation;
     
     ProjectTreeItem &project;
@@ -45,6 +47,8 @@ private:
     void initMainMenu(AnimationType animationType);
     void initBatchMenu(AnimationType animationType);
     void initRenderMenu();
+    void initTuningMenu();
+    void initSessionMenu();
     void initInstrumentSelection();
     
     void initNewSubItemsMenu(AnimationType animationType);
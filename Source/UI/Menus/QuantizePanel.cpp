@@ -0,0 +1,254 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "Common.h"
+#include "QuantizePanel.h"
+#include "PianoRoll.h"
+#include "PianoRollToolbox.h"
+#include "PanelBackgroundC.h"
+#include "CommandItemComponent.h"
+#include "InternalClipboard.h"
+#include "Icons.h"
+#include "CommandIDs.h"
+
+#define QUANTIZE_PANEL_WIDTH 280
+#define QUANTIZE_PANEL_ROW_HEIGHT 32
+#define QUANTIZE_PANEL_MARGIN 8
+
+struct GridOption
+{
+    const char *name;
+    float beats;
+};
+
+static const GridOption gridOptions[] =
+{
+    { "1/4", 1.f },
+    { "1/8", 1.f / 2.f },
+    { "1/8T", 1.f / 3.f },
+    { "1/16", 1.f / 4.f },
+    { "1/16T", 1.f / 6.f },
+    { "1/32", 1.f / 8.f }
+};
+
+static const int numGridOptions = numElementsInArray(gridOptions);
+
+static int findGridOption(float gridBeats)
+{
+    for (int i = 0; i < numGridOptions; ++i)
+    {
+        if (fabsf(gridOptions[i].beats - gridBeats) < 0.001f)
+        {
+            return i;
+        }
+    }
+
+    return 3;
+}
+
+static Slider *createSlider(double maximum, double interval)
+{
+    Slider *slider = new Slider(String());
+    slider->setRange(0.0, maximum, interval);
+    slider->setSliderStyle(Slider::LinearHorizontal);
+    slider->setTextBoxStyle(Slider::NoTextBox, true, 0, 0);
+    return slider;
+}
+
+static Label *createLabel()
+{
+    Label *label = new Label(String(), String());
+    label->setFont(Font(16.00f, Font::plain));
+    label->setJustificationType(Justification::centredLeft);
+    label->setEditable(false, false, false);
+    return label;
+}
+
+QuantizePanel::QuantizePanel(PianoRoll &targetRoll) :
+    roll(targetRoll),
+    quantizer(targetRoll.getQuantizer()),
+    hasAppliedChanges(false)
+{
+    this->addAndMakeVisible(this->background = new PanelBackgroundC());
+
+    this->addAndMakeVisible(this->gridLabel = createLabel());
+    this->addAndMakeVisible(this->gridSlider = createSlider(numGridOptions - 1, 1.0));
+    this->addAndMakeVisible(this->strengthLabel = createLabel());
+    this->addAndMakeVisible(this->strengthSlider = createSlider(1.0, 0.01));
+    this->addAndMakeVisible(this->swingLabel = createLabel());
+    this->addAndMakeVisible(this->swingSlider = createSlider(1.0, 0.01));
+    this->addAndMakeVisible(this->windowLabel = createLabel());
+    this->addAndMakeVisible(this->windowSlider = createSlider(1.0, 0.01));
+
+    this->addAndMakeVisible(this->lengthsToggle = new ToggleButton(TRANS("menu::quantize::lengths")));
+    this->addAndMakeVisible(this->grooveToggle = new ToggleButton(TRANS("menu::quantize::groove")));
+
+    this->addAndMakeVisible(this->applyButton = new CommandItemComponent(this, nullptr,
+        CommandItem::withParams(Icons::apply, CommandIDs::ApplyQuantization, TRANS("menu::quantize::apply"))));
+
+    this->gridSlider->setValue(findGridOption(this->quantizer.getGrid()), dontSendNotification);
+    this->strengthSlider->setValue(this->quantizer.getStrength(), dontSendNotification);
+    this->swingSlider->setValue(this->quantizer.getSwing(), dontSendNotification);
+    this->windowSlider->setValue(this->quantizer.getWindow(), dontSendNotification);
+    this->lengthsToggle->setToggleState(this->quantizer.quantizesLengths(), dontSendNotification);
+    this->grooveToggle->setToggleState(this->quantizer.hasGroove(), dontSendNotification);
+
+    // No groove to extract from
+    this->grooveToggle->setEnabled(InternalClipboard::getCurrentContent() != nullptr);
+
+    for (auto slider : { this->gridSlider.get(), this->strengthSlider.get(),
+                         this->swingSlider.get(), this->windowSlider.get() })
+    {
+        slider->addListener(this);
+    }
+
+    this->lengthsToggle->addListener(this);
+    this->grooveToggle->addListener(this);
+
+    this->setSize(QUANTIZE_PANEL_WIDTH, QUANTIZE_PANEL_ROW_HEIGHT * 7 + QUANTIZE_PANEL_MARGIN * 2);
+
+    this->setWantsKeyboardFocus(true);
+    this->updateLabels();
+    this->updatePreview();
+}
+
+QuantizePanel::~QuantizePanel()
+{
+    if (!this->hasAppliedChanges)
+    {
+        PianoRollToolbox::cancelPreviews(this->roll.getLassoSelection());
+    }
+}
+
+void QuantizePanel::resized()
+{
+    this->background->setBounds(this->getLocalBounds());
+
+    Rectangle<int> area(this->getLocalBounds().reduced(QUANTIZE_PANEL_MARGIN));
+    const int labelWidth = area.getWidth() / 2;
+
+    auto layoutRow = [&area, labelWidth](Label *label, Slider *slider)
+    {
+        Rectangle<int> row(area.removeFromTop(QUANTIZE_PANEL_ROW_HEIGHT));
+        label->setBounds(row.removeFromLeft(labelWidth));
+        slider->setBounds(row);
+    };
+
+    layoutRow(this->gridLabel, this->gridSlider);
+    layoutRow(this->strengthLabel, this->strengthSlider);
+    layoutRow(this->swingLabel, this->swingSlider);
+    layoutRow(this->windowLabel, this->windowSlider);
+
+    this->lengthsToggle->setBounds(area.removeFromTop(QUANTIZE_PANEL_ROW_HEIGHT));
+    this->grooveToggle->setBounds(area.removeFromTop(QUANTIZE_PANEL_ROW_HEIGHT));
+    this->applyButton->setBounds(area.removeFromTop(QUANTIZE_PANEL_ROW_HEIGHT));
+}
+
+void QuantizePanel::handleCommandMessage(int commandId)
+{
+    if (commandId == CommandIDs::ApplyQuantization)
+    {
+        this->apply();
+    }
+}
+
+bool QuantizePanel::keyPressed(const KeyPress &key)
+{
+    if (key.isKeyCode(KeyPress::returnKey))
+    {
+        this->apply();
+        return true;
+    }
+
+    return false;
+}
+
+//===----------------------------------------------------------------------===//
+// Listeners
+//===----------------------------------------------------------------------===//
+
+void QuantizePanel::sliderValueChanged(Slider *slider)
+{
+    this->updateLabels();
+    this->updatePreview();
+}
+
+void QuantizePanel::buttonClicked(Button *button)
+{
+    this->updatePreview();
+}
+
+//===----------------------------------------------------------------------===//
+// Preview
+//===----------------------------------------------------------------------===//
+
+Quantizer QuantizePanel::createQuantizer() const
+{
+    const int gridOption = jlimit(0, numGridOptions - 1, int(this->gridSlider->getValue()));
+
+    Quantizer q(Quantizer()
+        .withGrid(gridOptions[gridOption].beats)
+        .withStrength(float(this->strengthSlider->getValue()))
+        .withSwing(float(this->swingSlider->getValue()))
+        .withWindow(float(this->windowSlider->getValue()))
+        .withLengths(this->lengthsToggle->getToggleState()));
+
+    if (this->grooveToggle->getToggleState())
+    {
+        if (XmlElement *xml = InternalClipboard::getCurrentContent())
+        {
+            q = q.withGrooveFromXml(*xml);
+        }
+    }
+
+    return q;
+}
+
+void QuantizePanel::updateLabels()
+{
+    const int gridOption = jlimit(0, numGridOptions - 1, int(this->gridSlider->getValue()));
+    const auto percents = [](Slider *slider) { return String(roundToInt(slider->getValue() * 100.0)) + "%"; };
+
+    this->gridLabel->setText(TRANS("menu::quantize::grid") + ": " + gridOptions[gridOption].name, dontSendNotification);
+    this->strengthLabel->setText(TRANS("menu::quantize::strength") + ": " + percents(this->strengthSlider), dontSendNotification);
+    this->swingLabel->setText(TRANS("menu::quantize::swing") + ": " + percents(this->swingSlider), dontSendNotification);
+    this->windowLabel->setText(TRANS("menu::quantize::window") + ": " + percents(this->windowSlider), dontSendNotification);
+}
+
+void QuantizePanel::updatePreview()
+{
+    this->quantizer = this->createQuantizer();
+    PianoRollToolbox::previewQuantize(this->roll.getLassoSelection(), this->quantizer);
+}
+
+void QuantizePanel::apply()
+{
+    if (this->hasAppliedChanges)
+    {
+        return;
+    }
+
+    this->hasAppliedChanges = true;
+    this->roll.setQuantizer(this->quantizer);
+    PianoRollToolbox::applyPreviews(this->roll.getLassoSelection());
+
+    if (Component *parent = this->getParentComponent())
+    {
+        parent->exitModalState(0);
+    }
+}
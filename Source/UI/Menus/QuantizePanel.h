@@ -0,0 +1,76 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+class PianoRoll;
+class PanelBackgroundC;
+class CommandItemComponent;
+
+#include "Quantizer.h"
+
+// Quantization parameters, previewed live on the selection while dragged;
+// the model only changes, as a single undo action, when applied.
+
+class QuantizePanel :
+    public Component,
+    private Slider::Listener,
+    private Button::Listener
+{
+public:
+
+    explicit QuantizePanel(PianoRoll &targetRoll);
+    ~QuantizePanel() override;
+
+    void resized() override;
+    void handleCommandMessage(int commandId) override;
+    bool keyPressed(const KeyPress &key) override;
+
+private:
+
+    PianoRoll &roll;
+
+    Quantizer quantizer;
+    bool hasAppliedChanges;
+
+    void sliderValueChanged(Slider *slider) override;
+    void buttonClicked(Button *button) override;
+
+    Quantizer createQuantizer() const;
+    void updateLabels();
+    void updatePreview();
+    void apply();
+
+    ScopedPointer<PanelBackgroundC> background;
+
+    ScopedPointer<Label> gridLabel;
+    ScopedPointer<Slider> gridSlider;
+    ScopedPointer<Label> strengthLabel;
+    ScopedPointer<Slider> strengthSlider;
+    ScopedPointer<Label> swingLabel;
+    ScopedPointer<Slider> swingSlider;
+    ScopedPointer<Label> windowLabel;
+    ScopedPointer<Slider> windowSlider;
+
+    ScopedPointer<ToggleButton> lengthsToggle;
+    ScopedPointer<ToggleButton> grooveToggle;
+
+    ScopedPointer<CommandItemComponent> applyButton;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(QuantizePanel)
+};
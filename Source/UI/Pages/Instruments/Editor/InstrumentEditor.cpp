@@ -28,10 +28,13 @@
 
 #include "AudioCore.h"
 
+#define PINS_GRID_CELL_SIZE 32
+
 InstrumentEditor::InstrumentEditor(Instrument &instrumentRef,
                                    WeakReference<AudioCore> audioCoreRef) :
 instrument(instrumentRef),
-audioCore(std::move(audioCoreRef))
+audioCore(std::move(audioCoreRef)),
+isPinsGridOutdated(true)
 {
     this->background = new PanelBackgroundC();
     this->addAndMakeVisible(this->background);
@@ -52,6 +55,9 @@ InstrumentEditor::~InstrumentEditor()
     
     this->draggingConnector = nullptr;
     this->background = nullptr;
+    this->pinsGrid.clear();
+    this->connectors.clear();
+    this->nodes.clear();
     this->deleteAllChildren();
 }
 
@@ -65,48 +71,79 @@ void InstrumentEditor::mouseDown(const MouseEvent &e)
 
 InstrumentEditorNode *InstrumentEditor::getComponentForNode(AudioProcessorGraph::NodeID id) const
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
-    {
-        if (InstrumentEditorNode *const fc = dynamic_cast <InstrumentEditorNode *>(getChildComponent(i))) {
-            if (fc->filterID == id)
-            { return fc; }
-        }
-    }
-    
-    return nullptr;
+    const auto found = this->nodes.find(id);
+    return (found != this->nodes.end()) ? found->second : nullptr;
 }
 
 InstrumentEditorConnector *InstrumentEditor::getComponentForConnection(AudioProcessorGraph::Connection conn) const
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
+    const auto found = this->connectors.find(conn);
+    return (found != this->connectors.end()) ? found->second : nullptr;
+}
+
+InstrumentEditorPin *InstrumentEditor::findPinAt(const int x, const int y) const
+{
+    this->rebuildPinsGridIfNeeded();
+
+    const int cellX = int(floorf(float(x) / PINS_GRID_CELL_SIZE));
+    const int cellY = int(floorf(float(y) / PINS_GRID_CELL_SIZE));
+    const auto found = this->pinsGrid.find(getGridCellKey(cellX, cellY));
+    if (found == this->pinsGrid.end())
     {
-        if (InstrumentEditorConnector *const c =
-            dynamic_cast <InstrumentEditorConnector *>(getChildComponent(i)))
+        return nullptr;
+    }
+
+    for (const auto pin : found->second)
+    {
+        const Point<int> nodePosition(pin->getParentComponent()->getPosition());
+        if (pin->getBounds().translated(nodePosition.getX(), nodePosition.getY()).contains(x, y))
         {
-            if (c->connection == conn)
-            {
-                return c;
-            }
+            return pin;
         }
     }
-    
+
     return nullptr;
 }
 
-InstrumentEditorPin *InstrumentEditor::findPinAt(const int x, const int y) const
+int64 InstrumentEditor::getGridCellKey(int cellX, int cellY) noexcept
 {
-    for (int i = getNumChildComponents(); --i >= 0;)
+    return (int64(cellX) << 32) | int64(uint32(cellY));
+}
+
+void InstrumentEditor::rebuildPinsGridIfNeeded() const
+{
+    if (! this->isPinsGridOutdated)
+    {
+        return;
+    }
+
+    this->pinsGrid.clear();
+
+    for (const auto &it : this->nodes)
     {
-        if (InstrumentEditorNode *fc = dynamic_cast<InstrumentEditorNode *>(getChildComponent(i)))
+        const InstrumentEditorNode *node = it.second;
+        for (int i = 0; i < node->getNumChildComponents(); ++i)
         {
-            if (InstrumentEditorPin *pin = dynamic_cast<InstrumentEditorPin *>(fc->getComponentAt(x - fc->getX(), y - fc->getY())))
+            if (InstrumentEditorPin *pin = dynamic_cast<InstrumentEditorPin *>(node->getChildComponent(i)))
             {
-                return pin;
+                const Rectangle<int> bounds(pin->getBounds().translated(node->getX(), node->getY()));
+                const int cellX1 = int(floorf(float(bounds.getX()) / PINS_GRID_CELL_SIZE));
+                const int cellY1 = int(floorf(float(bounds.getY()) / PINS_GRID_CELL_SIZE));
+                const int cellX2 = int(floorf(float(bounds.getRight()) / PINS_GRID_CELL_SIZE));
+                const int cellY2 = int(floorf(float(bounds.getBottom()) / PINS_GRID_CELL_SIZE));
+
+                for (int cellX = cellX1; cellX <= cellX2; ++cellX)
+                {
+                    for (int cellY = cellY1; cellY <= cellY2; ++cellY)
+                    {
+                        this->pinsGrid[getGridCellKey(cellX, cellY)].add(pin);
+                    }
+                }
             }
         }
     }
-    
-    return nullptr;
+
+    this->isPinsGridOutdated = false;
 }
 
 void InstrumentEditor::resized()
@@ -122,54 +159,102 @@ void InstrumentEditor::changeListenerCallback(ChangeBroadcaster *)
 
 void InstrumentEditor::updateComponents()
 {
-    for (int i = this->getNumChildComponents(); --i >= 0;)
+    // Remove the nodes which are gone from the graph, update the rest
+    Array<AudioProcessorGraph::NodeID> staleNodes;
+    for (const auto &it : this->nodes)
     {
-        if (InstrumentEditorNode *const fc = dynamic_cast<InstrumentEditorNode *>(getChildComponent(i)))
+        if (this->instrument.getNodeForId(it.first) == nullptr)
+        {
+            staleNodes.add(it.first);
+        }
+        else
         {
-            fc->update();
+            it.second->update();
         }
     }
-    
-    for (int i = getNumChildComponents(); --i >= 0;)
+
+    for (const auto nodeId : staleNodes)
     {
-        InstrumentEditorConnector *const cc = dynamic_cast<InstrumentEditorConnector *>(getChildComponent(i));
-        
-        if (cc != nullptr && cc != draggingConnector)
+        const auto found = this->nodes.find(nodeId);
+        delete found->second;
+        this->nodes.erase(found);
+    }
+
+    // Add the new ones
+    for (int i = 0; i < this->instrument.getNumNodes(); ++i)
+    {
+        const AudioProcessorGraph::Node::Ptr f(this->instrument.getNode(i));
+        if (this->nodes.find(f->nodeID) == this->nodes.end())
         {
-            if (! instrument.isConnected(cc->connection))
-            {
-                delete cc;
-            }
-            else
-            {
-                cc->update();
-            }
+            auto const comp = new InstrumentEditorNode(this->instrument, f->nodeID);
+            this->nodes[f->nodeID] = comp;
+            this->addAndMakeVisible(comp);
+            comp->update();
         }
     }
-    
-    for (int i = instrument.getNumNodes(); --i >= 0;)
+
+    // Same for the connectors
+    SparseHashSet<AudioProcessorGraph::Connection, ConnectionHash> actualConnections;
+    const auto &connections = this->instrument.getConnections();
+    for (const auto &c : connections)
     {
-        const AudioProcessorGraph::Node::Ptr f(instrument.getNode(i));
-        if (this->getComponentForNode(f->nodeID) == nullptr)
+        actualConnections.insert(c);
+    }
+
+    Array<InstrumentEditorConnector *> staleConnectors;
+    for (const auto &it : this->connectors)
+    {
+        if (actualConnections.find(it.first) == actualConnections.end())
         {
-            auto const comp = new InstrumentEditorNode(instrument, f->nodeID);
-            addAndMakeVisible(comp);
-            comp->update();
+            staleConnectors.add(it.second);
+        }
+        else
+        {
+            it.second->update();
         }
     }
-    
-    const auto &connections = instrument.getConnections();
-    for (int i = connections.size(); --i >= 0;)
+
+    for (const auto connector : staleConnectors)
+    {
+        this->connectors.erase(connector->connection);
+        delete connector;
+    }
+
+    for (const auto &c : connections)
     {
-        AudioProcessorGraph::Connection c = connections.at(i);
-        if (getComponentForConnection(c) == nullptr)
+        if (this->connectors.find(c) == this->connectors.end())
         {
-            auto const comp = new InstrumentEditorConnector(instrument);
-            addAndMakeVisible(comp);
+            auto const comp = new InstrumentEditorConnector(this->instrument);
+            this->connectors[c] = comp;
+            this->addAndMakeVisible(comp);
             comp->setInput(c.source);
             comp->setOutput(c.destination);
         }
     }
+
+    this->isPinsGridOutdated = true;
+}
+
+void InstrumentEditor::updateNode(AudioProcessorGraph::NodeID id)
+{
+    InstrumentEditorNode *node = this->getComponentForNode(id);
+    if (node == nullptr || this->instrument.getNodeForId(id) == nullptr)
+    {
+        this->updateComponents();
+        return;
+    }
+
+    node->update();
+
+    for (const auto &it : this->connectors)
+    {
+        if (it.first.source.nodeID == id || it.first.destination.nodeID == id)
+        {
+            it.second->update();
+        }
+    }
+
+    this->isPinsGridOutdated = true;
 }
 
 void InstrumentEditor::beginConnectorDrag(
@@ -178,9 +263,21 @@ void InstrumentEditor::beginConnectorDrag(
     const MouseEvent &e)
 {
     draggingConnector = dynamic_cast <InstrumentEditorConnector *>(e.originalComponent);
-    
-    if (draggingConnector == nullptr)
-    { draggingConnector = new InstrumentEditorConnector(instrument); }
+
+    if (draggingConnector != nullptr)
+    {
+        // The connection has just been removed from the graph,
+        // so the connector now belongs to the drag, not to the map
+        const auto found = this->connectors.find(draggingConnector->connection);
+        if (found != this->connectors.end() && found->second == draggingConnector)
+        {
+            this->connectors.erase(found);
+        }
+    }
+    else
+    {
+        draggingConnector = new InstrumentEditorConnector(instrument);
+    }
     
     AudioProcessorGraph::NodeAndChannel source;
     source.nodeID = sourceID;
@@ -24,6 +24,17 @@ class InstrumentEditorConnector;
 class InstrumentEditorPin;
 class AudioCore;
 
+struct ConnectionHash
+{
+    inline HashCode operator()(const AudioProcessorGraph::Connection &key) const noexcept
+    {
+        return ((HashCode(key.source.nodeID) * 73856093) ^
+                (HashCode(key.source.channelIndex) * 19349663) ^
+                (HashCode(key.destination.nodeID) * 83492791) ^
+                HashCode(key.destination.channelIndex)) % HASH_CODE_MAX;
+    }
+};
+
 class InstrumentEditor :
     public Component,
     public ChangeListener
@@ -35,8 +46,13 @@ public:
 
     ~InstrumentEditor() override;
 
+    // Diffs the graph against the existing components:
+    // removes the stale ones, adds the missing ones, updates the rest
     void updateComponents();
 
+    // Only updates the given node and the connectors attached to it
+    void updateNode(AudioProcessorGraph::NodeID id);
+
     InstrumentEditorNode *getComponentForNode(AudioProcessorGraph::NodeID id) const;
     InstrumentEditorConnector *getComponentForConnection(AudioProcessorGraph::Connection conn) const;
     InstrumentEditorPin *findPinAt(const int x, const int y) const;
@@ -63,6 +79,25 @@ private:
     ScopedPointer<Component> background;
     ScopedPointer<InstrumentEditorConnector> draggingConnector;
     WeakReference<AudioCore> audioCore;
-    
+
+    typedef SparseHashMap<AudioProcessorGraph::NodeID, InstrumentEditorNode *> NodesMap;
+    typedef SparseHashMap<AudioProcessorGraph::Connection, InstrumentEditorConnector *, ConnectionHash> ConnectorsMap;
+
+    NodesMap nodes;
+    ConnectorsMap connectors;
+
+    //===------------------------------------------------------------------===//
+    // Pins hit-testing
+    //===------------------------------------------------------------------===//
+
+    // Pins are bucketed into a uniform grid in editor coordinates;
+    // the grid is rebuilt lazily after any node has moved or changed its pins
+    typedef SparseHashMap<int64, Array<InstrumentEditorPin *>> PinsGrid;
+    mutable PinsGrid pinsGrid;
+    mutable bool isPinsGridOutdated;
+
+    void rebuildPinsGridIfNeeded() const;
+    static int64 getGridCellKey(int cellX, int cellY) noexcept;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InstrumentEditor)
 };
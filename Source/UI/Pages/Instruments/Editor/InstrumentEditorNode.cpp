@@ -77,7 +77,7 @@ void InstrumentEditorNode::mouseDrag(const MouseEvent &e)
             (pos.getX() + getWidth() / 2) / static_cast<double>(this->getParentWidth()),
             (pos.getY() + getHeight() / 2) / static_cast<double>(this->getParentHeight()));
 
-        this->getGraphPanel()->updateComponents();
+        this->getGraphPanel()->updateNode(this->filterID);
         
         this->setMouseCursor(MouseCursor::DraggingHandCursor);
     }
@@ -128,7 +128,7 @@ void InstrumentEditorNode::mouseUp(const MouseEvent &e)
     }
     else if (!e.mouseWasClicked())
     {
-        this->getGraphPanel()->updateComponents();
+        this->getGraphPanel()->updateNode(this->filterID);
     }
 }
 
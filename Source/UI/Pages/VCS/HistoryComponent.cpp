@@ -31,6 +31,9 @@
 
 #include "MainLayout.h"
 #include "ModalDialogConfirmation.h"
+
+// squash and prune only what has not been touched for a while
+#define HISTORY_COMPACTION_MIN_AGE_DAYS 30
 //[/MiscUserDefs]
 
 HistoryComponent::HistoryComponent(VersionControl &owner)
@@ -49,6 +52,16 @@ HistoryComponent::HistoryComponent(VersionControl &owner)
     pullButton->setConnectedEdges (Button::ConnectedOnTop);
     pullButton->addListener (this);
 
+    addAndMakeVisible (compactButton = new TextButton (String()));
+    compactButton->setButtonText (TRANS("vcs::history::compact"));
+    compactButton->setConnectedEdges (Button::ConnectedOnTop);
+    compactButton->addListener (this);
+
+    addAndMakeVisible (verifyButton = new TextButton (String()));
+    verifyButton->setButtonText (TRANS("vcs::history::verify"));
+    verifyButton->setConnectedEdges (Button::ConnectedOnTop);
+    verifyButton->addListener (this);
+
     addAndMakeVisible (revisionTreeLabel = new Label (String(),
                                                       TRANS("vcs::history::caption")));
     revisionTreeLabel->setFont (Font (Font::getDefaultSerifFontName(), 21.00f, Font::plain).withTypefaceStyle ("Regular"));
@@ -75,6 +88,8 @@ HistoryComponent::~HistoryComponent()
     revisionViewport = nullptr;
     pushButton = nullptr;
     pullButton = nullptr;
+    compactButton = nullptr;
+    verifyButton = nullptr;
     revisionTreeLabel = nullptr;
     shadow = nullptr;
 
@@ -100,6 +115,8 @@ void HistoryComponent::resized()
     revisionViewport->setBounds (1, 36, getWidth() - 2, getHeight() - 87);
     pushButton->setBounds (getWidth() - 8 - 96, 35 + (getHeight() - 85), 96, 48);
     pullButton->setBounds (0 + 8, 35 + (getHeight() - 85), 96, 48);
+    compactButton->setBounds (0 + (getWidth() - 0) / 2 + -68 - (128 / 2), 35 + (getHeight() - 85), 128, 48);
+    verifyButton->setBounds (0 + (getWidth() - 0) / 2 + 68 - (128 / 2), 35 + (getHeight() - 85), 128, 48);
     revisionTreeLabel->setBounds (0, 14 - (32 / 2), 406, 32);
     shadow->setBounds (0 + 8, 35 + (getHeight() - 85), (getWidth() - 0) - 16, 16);
     //[UserResized] Add your own custom resize handling here..
@@ -144,6 +161,52 @@ void HistoryComponent::buttonClicked (Button* buttonThatWasClicked)
         }
         //[/UserButtonCode_pullButton]
     }
+    else if (buttonThatWasClicked == compactButton)
+    {
+        //[UserButtonCode_compactButton] -- add your button handler code here..
+        Component *confirmationDialog =
+        new ModalDialogConfirmation(*this,
+                                    TRANS("vcs::history::compact::confirmation"),
+                                    TRANS("vcs::history::compact::proceed"),
+                                    TRANS("vcs::history::compact::cancel"),
+                                    CommandIDs::VersionControlCompact,
+                                    CommandIDs::Cancel);
+
+        App::Layout().showModalNonOwnedDialog(confirmationDialog);
+        //[/UserButtonCode_compactButton]
+    }
+    else if (buttonThatWasClicked == verifyButton)
+    {
+        //[UserButtonCode_verifyButton] -- add your button handler code here..
+        // a dry run first: nothing is touched until the user agrees
+        const VCS::HistoryVerifier::Report report(this->vcs.verifyHistory(false));
+
+        if (report.numRepairable > 0)
+        {
+            String message(TRANS("vcs::history::verify::confirmation"));
+
+            if (report.damagedItems.size() > 0)
+            {
+                message << " " << TRANS("vcs::history::verify::damaged") << " " <<
+                    report.damagedItems.joinIntoString(", ");
+            }
+
+            Component *confirmationDialog =
+            new ModalDialogConfirmation(*this,
+                                        message,
+                                        TRANS("vcs::history::verify::proceed"),
+                                        TRANS("vcs::history::verify::cancel"),
+                                        CommandIDs::VersionControlRepair,
+                                        CommandIDs::Cancel);
+
+            App::Layout().showModalNonOwnedDialog(confirmationDialog);
+        }
+        else
+        {
+            this->showVerificationReport(report);
+        }
+        //[/UserButtonCode_verifyButton]
+    }
 
     //[UserbuttonClicked_Post]
     //[/UserbuttonClicked_Post]
@@ -156,6 +219,23 @@ void HistoryComponent::handleCommandMessage (int commandId)
     {
         this->vcs.getRemote()->pull();
     }
+    else if (commandId == CommandIDs::VersionControlCompact)
+    {
+        // the revision tree is rebuilt on the vcs change message
+        const SafePointer<HistoryComponent> safeThis(this);
+        this->vcs.compactHistory(RelativeTime::days(HISTORY_COMPACTION_MIN_AGE_DAYS),
+            [safeThis](const VCS::HistoryCompactor::Report &report)
+            {
+                if (safeThis != nullptr)
+                {
+                    safeThis->showCompactionReport(report);
+                }
+            });
+    }
+    else if (commandId == CommandIDs::VersionControlRepair)
+    {
+        this->showVerificationReport(this->vcs.verifyHistory(true));
+    }
     //[/UserCode_handleCommandMessage]
 }
 
@@ -169,6 +249,29 @@ void HistoryComponent::rebuildRevisionTree()
     alignerProxy->centerTargetToViewport();
 }
 
+void HistoryComponent::showCompactionReport(const VCS::HistoryCompactor::Report &report)
+{
+    App::Layout().showTooltip(TRANS("vcs::history::compact::done") + " " +
+        File::descriptionOfSizeInBytes(jmax(int64(0), report.bytesSaved)));
+}
+
+void HistoryComponent::showVerificationReport(const VCS::HistoryVerifier::Report &report)
+{
+    if (report.damagedItems.size() > 0)
+    {
+        App::Layout().showTooltip(TRANS("vcs::history::verify::damaged") + " " +
+            report.damagedItems.joinIntoString(", "));
+    }
+    else if (report.numDamaged > 0)
+    {
+        App::Layout().showTooltip(TRANS("vcs::history::verify::repaired"));
+    }
+    else
+    {
+        App::Layout().showTooltip(TRANS("vcs::history::verify::ok"));
+    }
+}
+
 //[/MiscUserCode]
 
 #if 0
@@ -197,6 +300,14 @@ BEGIN_JUCER_METADATA
               posRelativeY="fa0c0fc3d6eee313" posRelativeW="fe1cf713999527d3"
               posRelativeH="fe1cf713999527d3" buttonText="" connectedEdges="4"
               needsCallback="1" radioGroupId="0"/>
+  <TEXTBUTTON name="" id="b1e4c02d8a3f6e97" memberName="compactButton" virtualName=""
+              explicitFocusOrder="0" pos="-68Cc 0R 128 48" posRelativeX="fa0c0fc3d6eee313"
+              posRelativeY="fa0c0fc3d6eee313" buttonText="vcs::history::compact"
+              connectedEdges="4" needsCallback="1" radioGroupId="0"/>
+  <TEXTBUTTON name="" id="5d2a7f90c1e83b46" memberName="verifyButton" virtualName=""
+              explicitFocusOrder="0" pos="68Cc 0R 128 48" posRelativeX="fa0c0fc3d6eee313"
+              posRelativeY="fa0c0fc3d6eee313" buttonText="vcs::history::verify"
+              connectedEdges="4" needsCallback="1" radioGroupId="0"/>
   <LABEL name="" id="158da5e6e58ab3ae" memberName="revisionTreeLabel"
          virtualName="" explicitFocusOrder="0" pos="0 14c 406 32" labelText="vcs::history::caption"
          editableSingleClick="0" editableDoubleClick="0" focusDiscardsChanges="0"
@@ -23,6 +23,8 @@ class PushComponent;
 class PullComponent;
 
 #include "Client.h"
+#include "HistoryCompactor.h"
+#include "HistoryVerifier.h"
 //[/Headers]
 
 #include "../../Themes/FramePanel.h"
@@ -51,6 +53,9 @@ private:
 
     //[UserVariables]
 
+    void showCompactionReport(const VCS::HistoryCompactor::Report &report);
+    void showVerificationReport(const VCS::HistoryVerifier::Report &report);
+
     VersionControl &vcs;
 
     SafePointer<PushComponent> pushComponent;
@@ -62,6 +67,8 @@ private:
     ScopedPointer<Viewport> revisionViewport;
     ScopedPointer<TextButton> pushButton;
     ScopedPointer<TextButton> pullButton;
+    ScopedPointer<TextButton> compactButton;
+    ScopedPointer<TextButton> verifyButton;
     ScopedPointer<Label> revisionTreeLabel;
     ScopedPointer<LightShadowDownwards> shadow;
 
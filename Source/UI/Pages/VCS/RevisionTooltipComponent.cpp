@@ -25,6 +25,8 @@
 #include "RevisionItemComponent.h"
 #include "RevisionItem.h"
 #include "Delta.h"
+#include "App.h"
+#include "MainLayout.h"
 
 #if HELIO_DESKTOP
 #    define REVISION_TOOLTIP_ROWS_ONSCREEN (4.5)
@@ -50,6 +52,16 @@ RevisionTooltipComponent::RevisionTooltipComponent(VersionControl &owner, const
     checkoutRevisionButton->setConnectedEdges (Button::ConnectedOnTop);
     checkoutRevisionButton->addListener (this);
 
+    addAndMakeVisible (mergeRevisionButton = new TextButton (String()));
+    mergeRevisionButton->setButtonText (TRANS("vcs::history::merge"));
+    mergeRevisionButton->setConnectedEdges (Button::ConnectedOnTop);
+    mergeRevisionButton->addListener (this);
+
+    addAndMakeVisible (diffRevisionButton = new TextButton (String()));
+    diffRevisionButton->setButtonText (TRANS("vcs::history::diff"));
+    diffRevisionButton->setConnectedEdges (Button::ConnectedOnTop);
+    diffRevisionButton->addListener (this);
+
     addAndMakeVisible (shadow = new ShadowDownwards());
 
     //[UserPreSize]
@@ -103,6 +115,8 @@ RevisionTooltipComponent::~RevisionTooltipComponent()
     panel = nullptr;
     changesList = nullptr;
     checkoutRevisionButton = nullptr;
+    mergeRevisionButton = nullptr;
+    diffRevisionButton = nullptr;
     shadow = nullptr;
 
     //[Destructor]
@@ -126,7 +140,9 @@ void RevisionTooltipComponent::resized()
     background->setBounds (0, 0, getWidth() - 0, getHeight() - 0);
     panel->setBounds (0, 0, getWidth() - 0, getHeight() - 60);
     changesList->setBounds (0, 0, getWidth() - 0, getHeight() - 60);
-    checkoutRevisionButton->setBounds (0 + 5, 0 + (getHeight() - 60), getWidth() - 10, 55);
+    checkoutRevisionButton->setBounds (0 + 5, 0 + (getHeight() - 60), roundFloatToInt ((getWidth() - 0) * 0.3100f), 55);
+    mergeRevisionButton->setBounds (0 + (getWidth() - 0) - 5 - (roundFloatToInt ((getWidth() - 0) * 0.3100f)), 0 + (getHeight() - 60), roundFloatToInt ((getWidth() - 0) * 0.3100f), 55);
+    diffRevisionButton->setBounds (0 + (getWidth() - 0) / 2 - ((roundFloatToInt ((getWidth() - 0) * 0.3100f)) / 2), 0 + (getHeight() - 60), roundFloatToInt ((getWidth() - 0) * 0.3100f), 55);
     shadow->setBounds (0 + 5, 0 + (getHeight() - 60) - 3, getWidth() - 10, 26);
     //[UserResized] Add your own custom resize handling here..
     //[/UserResized]
@@ -144,6 +160,43 @@ void RevisionTooltipComponent::buttonClicked (Button* buttonThatWasClicked)
         this->hide();
         //[/UserButtonCode_checkoutRevisionButton]
     }
+    else if (buttonThatWasClicked == mergeRevisionButton)
+    {
+        //[UserButtonCode_mergeRevisionButton] -- add your button handler code here..
+        Array<VCS::BranchMerge::Conflict> conflicts;
+        if (! this->vcs.mergeBranch(this->revision, conflicts))
+        {
+            App::Layout().showTooltip(TRANS("vcs::history::merge::failed"));
+        }
+        else if (conflicts.size() > 0)
+        {
+            App::Layout().showTooltip(TRANS("vcs::history::merge::conflicts"));
+        }
+        this->hide();
+        //[/UserButtonCode_mergeRevisionButton]
+    }
+    else if (buttonThatWasClicked == diffRevisionButton)
+    {
+        //[UserButtonCode_diffRevisionButton] -- add your button handler code here..
+        // if the overlay already compares the working copy with another revision,
+        // compare that revision with this one, otherwise the working copy with this one
+        const bool comparesWorkingCopy = this->vcs.isDiffOverlayShown() &&
+            ! this->vcs.getDiffOverlayTarget().isValid();
+
+        if (comparesWorkingCopy && this->vcs.getDiffOverlayBase() != this->revision)
+        {
+            this->vcs.showDiffOverlay(this->vcs.getDiffOverlayBase(), this->revision);
+            App::Layout().showTooltip(TRANS("vcs::history::diff::revisions"));
+        }
+        else
+        {
+            this->vcs.showDiffOverlay(this->revision, {});
+            App::Layout().showTooltip(TRANS("vcs::history::diff::workingcopy"));
+        }
+
+        this->hide();
+        //[/UserButtonCode_diffRevisionButton]
+    }
 
     //[UserbuttonClicked_Post]
     //[/UserbuttonClicked_Post]
@@ -249,9 +302,17 @@ BEGIN_JUCER_METADATA
   <GENERICCOMPONENT name="" id="d017e5395434bb4f" memberName="changesList" virtualName=""
                     explicitFocusOrder="0" pos="0 0 0M 60M" class="ListBox" params="&quot;&quot;, this"/>
   <TEXTBUTTON name="" id="d22a0ea951756643" memberName="checkoutRevisionButton"
-              virtualName="" explicitFocusOrder="0" pos="5 0R 10M 55" posRelativeX="c5736d336280caba"
+              virtualName="" explicitFocusOrder="0" pos="5 0R 31% 55" posRelativeX="c5736d336280caba"
               posRelativeY="c5736d336280caba" buttonText="vcs::history::checkout"
               connectedEdges="4" needsCallback="1" radioGroupId="0"/>
+  <TEXTBUTTON name="" id="5a3e1b9c7d04f2e8" memberName="mergeRevisionButton"
+              virtualName="" explicitFocusOrder="0" pos="5Rr 0R 31% 55" posRelativeX="c5736d336280caba"
+              posRelativeY="c5736d336280caba" buttonText="vcs::history::merge"
+              connectedEdges="4" needsCallback="1" radioGroupId="0"/>
+  <TEXTBUTTON name="" id="8c2f41d07e5a9b36" memberName="diffRevisionButton"
+              virtualName="" explicitFocusOrder="0" pos="0Cc 0R 31% 55" posRelativeX="c5736d336280caba"
+              posRelativeY="c5736d336280caba" buttonText="vcs::history::diff"
+              connectedEdges="4" needsCallback="1" radioGroupId="0"/>
   <JUCERCOMP name="" id="34270fb50cf926d8" memberName="shadow" virtualName=""
              explicitFocusOrder="0" pos="5 3R 10M 26" posRelativeX="c5736d336280caba"
              posRelativeY="c5736d336280caba" sourceFile="../../Themes/ShadowDownwards.cpp"
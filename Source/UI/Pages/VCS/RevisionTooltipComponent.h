@@ -80,6 +80,8 @@ private:
     ScopedPointer<FramePanel> panel;
     ScopedPointer<ListBox> changesList;
     ScopedPointer<TextButton> checkoutRevisionButton;
+    ScopedPointer<TextButton> mergeRevisionButton;
+    ScopedPointer<TextButton> diffRevisionButton;
     ScopedPointer<ShadowDownwards> shadow;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RevisionTooltipComponent)
@@ -44,7 +44,6 @@ AutomationEventComponent::AutomationEventComponent(AutomationTrackMap &parent, c
     this->setInterceptsMouseClicks(true, false);
     this->setMouseClickGrabsKeyboardFocus(false);
     this->setPaintingIsUnclipped(true);
-    this->recreateConnector();
     //[/UserPreSize]
 
     setSize (32, 32);
@@ -196,12 +195,15 @@ void AutomationEventComponent::recreateHelper()
 
 void AutomationEventComponent::updateConnector()
 {
-    this->connector->resizeToFit(this->event.getCurvature());
+    if (this->connector != nullptr)
+    {
+        this->connector->resizeToFit(this->event.getCurvature());
+    }
 }
 
 void AutomationEventComponent::updateHelper()
 {
-    if (this->helper && this->nextEventHolder)
+    if (this->helper && this->connector && this->nextEventHolder)
     {
         const float d = this->editor.getHelperDiameter();
         const Point<int> linePos(this->connector->getPosition());
@@ -213,7 +215,12 @@ void AutomationEventComponent::updateHelper()
 
 void AutomationEventComponent::setNextNeighbour(AutomationEventComponent *next)
 {
-    if (next == this->nextEventHolder)
+    // The trailing connector of the last event is the only one
+    // not linked to a neighbour; other lines are drawn by the lane
+    const bool needsConnector = (next != nullptr) || this->isLastEvent();
+
+    if (next == this->nextEventHolder &&
+        needsConnector == (this->connector != nullptr))
     {
         this->updateConnector();
         this->updateHelper();
@@ -221,7 +228,15 @@ void AutomationEventComponent::setNextNeighbour(AutomationEventComponent *next)
     }
 
     this->nextEventHolder = next;
-    this->recreateConnector();
+
+    if (needsConnector)
+    {
+        this->recreateConnector();
+    }
+    else
+    {
+        this->connector = nullptr;
+    }
 
     if (this->nextEventHolder == nullptr)
     {
@@ -234,6 +249,13 @@ void AutomationEventComponent::setNextNeighbour(AutomationEventComponent *next)
 }
 
 
+bool AutomationEventComponent::isLastEvent() const
+{
+    const MidiSequence *sequence = this->event.getSequence();
+    return sequence->size() > 0 && sequence->getUnchecked(sequence->size() - 1) == &this->event;
+}
+
+
 //===----------------------------------------------------------------------===//
 // Editing
 //
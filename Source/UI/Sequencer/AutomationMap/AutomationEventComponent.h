@@ -45,6 +45,7 @@ public:
     void updateConnector();
     void updateHelper();
     void setNextNeighbour(AutomationEventComponent *next);
+    bool isLastEvent() const;
 
     static int compareElements(const AutomationEventComponent *first, const AutomationEventComponent *second)
     {
@@ -24,7 +24,6 @@
 #include "AutomationSequence.h"
 #include "PlayerThread.h"
 #include "HybridRoll.h"
-#include "ComponentConnectorCurve.h"
 #include "MidiTrack.h"
 
 #if HELIO_DESKTOP
@@ -39,6 +38,11 @@
 
 #define DEFAULT_TRACKMAP_HEIGHT 128
 
+#define AUTOMATION_LANE_LINE_THICKNESS (5.f)
+#define AUTOMATION_LANE_MIN_CURVE_WIDTH (4.f)
+#define AUTOMATION_HANDLES_REACH (2.f)
+#define AUTOMATION_MAX_HANDLES_PER_SIDE 16
+
 AutomationTrackMap::AutomationTrackMap(ProjectTreeItem &parentProject,
     HybridRoll &parentRoll, WeakReference<MidiSequence> targetSequence) :
     project(parentProject),
@@ -49,15 +53,13 @@ AutomationTrackMap::AutomationTrackMap(ProjectTreeItem &parentProject,
     rollFirstBeat(0.f),
     rollLastBeat(16.f),
     draggingEvent(nullptr),
-    addNewEventMode(false)
+    addNewEventMode(false),
+    lastMouseX(-1)
 {
     this->setAlwaysOnTop(true);
-    this->setInterceptsMouseClicks(false, true);
+    this->setInterceptsMouseClicks(false, true); // except near the lane, see hitTest
     this->setPaintingIsUnclipped(true);
 
-    this->leadingConnector = new ComponentConnectorCurve(nullptr, nullptr);
-    this->addAndMakeVisible(this->leadingConnector);
-    
     this->setMouseCursor(MouseCursor::CopyingCursor);
     
     this->reloadTrack();
@@ -77,6 +79,133 @@ AutomationTrackMap::~AutomationTrackMap()
 // Component
 //===----------------------------------------------------------------------===//
 
+void AutomationTrackMap::paint(Graphics &g)
+{
+    if (this->sequence == nullptr || this->sequence->size() == 0)
+    {
+        return;
+    }
+
+    // Builds the whole visible part of the lane in a single pass:
+    // all events falling into the same pixel column are collapsed
+    // into one vertical span, and curves are only built for segments
+    // wide enough for the curvature to be visible at all
+
+    const float diameter = this->getEventDiameter();
+    const Rectangle<int> clip(g.getClipBounds());
+    const float firstVisibleBeat = this->getBeatByXPosition(float(clip.getX()) - diameter);
+    const float lastVisibleBeat = this->getBeatByXPosition(float(clip.getRight()) + diameter);
+
+    const int numEvents = this->sequence->size();
+    const int firstIndex = jmax(0, this->getIndexOfFirstEventAfter(firstVisibleBeat) - 1);
+
+    Path line;
+    Path dots;
+
+    Point<float> prev(this->getEventPosition(firstIndex));
+    float prevCurvature = this->getEventAt(firstIndex)->getCurvature();
+
+    if (firstIndex == 0)
+    {
+        line.startNewSubPath(0.f, prev.y);
+        line.lineTo(prev);
+    }
+    else
+    {
+        line.startNewSubPath(prev);
+    }
+
+    const float dotDiameter = diameter - 10.f;
+    dots.addEllipse(prev.x - dotDiameter / 2.f, prev.y - dotDiameter / 2.f, dotDiameter, dotDiameter);
+    float lastDotX = prev.x;
+
+    int column = int(prev.x);
+    float columnMin = prev.y;
+    float columnMax = prev.y;
+
+    int i = firstIndex + 1;
+    for (; i < numEvents; ++i)
+    {
+        const AutomationEvent *event = this->getEventAt(i);
+        const Point<float> p(this->getEventPosition(event->getBeat(), event->getControllerValue()));
+
+        if (int(p.x) == column)
+        {
+            columnMin = jmin(columnMin, p.y);
+            columnMax = jmax(columnMax, p.y);
+            prev = p;
+            prevCurvature = event->getCurvature();
+            continue;
+        }
+
+        if (columnMax > columnMin)
+        {
+            line.lineTo(prev.x, columnMin);
+            line.lineTo(prev.x, columnMax);
+            line.lineTo(prev);
+        }
+
+        addLaneSegment(line, prev, prevCurvature, p);
+
+        if (p.x - lastDotX >= diameter)
+        {
+            dots.addEllipse(p.x - dotDiameter / 2.f, p.y - dotDiameter / 2.f, dotDiameter, dotDiameter);
+            lastDotX = p.x;
+        }
+
+        column = int(p.x);
+        columnMin = p.y;
+        columnMax = p.y;
+        prev = p;
+        prevCurvature = event->getCurvature();
+
+        if (event->getBeat() > lastVisibleBeat)
+        {
+            break;
+        }
+    }
+
+    if (columnMax > columnMin)
+    {
+        line.lineTo(prev.x, columnMin);
+        line.lineTo(prev.x, columnMax);
+        line.lineTo(prev);
+    }
+
+    if (i >= numEvents)
+    {
+        line.lineTo(float(this->getWidth()), prev.y);
+    }
+
+    g.setColour(Colours::white.withAlpha(0.15f));
+    g.strokePath(line, PathStrokeType(AUTOMATION_LANE_LINE_THICKNESS,
+        PathStrokeType::beveled, PathStrokeType::butt));
+
+    g.setColour(Colour(0x2bfefefe));
+    g.fillPath(dots);
+}
+
+bool AutomationTrackMap::hitTest(int x, int y)
+{
+    // Only the lane itself and the handles take the mouse,
+    // so that the clicks on the empty space go through to the roll
+    for (const auto *component : this->eventComponents)
+    {
+        if (component->getBounds().contains(x, y))
+        {
+            return true;
+        }
+    }
+
+    return this->isNearLane(x, y);
+}
+
+void AutomationTrackMap::mouseMove(const MouseEvent &e)
+{
+    this->lastMouseX = e.x;
+    this->updateHandlesAt(e.x);
+}
+
 void AutomationTrackMap::mouseDown(const MouseEvent &e)
 {
     if (e.mods.isLeftButtonDown())
@@ -113,8 +242,6 @@ void AutomationTrackMap::mouseUp(const MouseEvent &e)
 
 void AutomationTrackMap::resized()
 {
-    this->setVisible(false);
-    
     // во избежание глюков - сначала обновляем позиции
     for (int i = 0; i < this->eventComponents.size(); ++i)
     {
@@ -129,10 +256,8 @@ void AutomationTrackMap::resized()
         c->updateConnector();
         c->updateHelper();
     }
-    
-    this->leadingConnector->resizeToFit();
-    
-    this->setVisible(true);
+
+    this->repaint();
 }
 
 void AutomationTrackMap::mouseWheelMove(const MouseEvent &event, const MouseWheelDetails &wheel)
@@ -194,26 +319,45 @@ Rectangle<int> AutomationTrackMap::getEventBounds(AutomationEventComponent *even
 }
 
 Rectangle<int> AutomationTrackMap::getEventBounds(float eventBeat, double controllerValue) const
+{
+    const float diameter = this->getEventDiameter();
+    const Point<float> position(this->getEventPosition(eventBeat, controllerValue));
+    const int x = int(position.x);
+    const int y = int(position.y);
+    
+    return Rectangle<int> (x - int(diameter / 2.f),
+                           y - int(diameter / 2.f),
+                           int(diameter),
+                           int(diameter));
+}
+
+Point<float> AutomationTrackMap::getEventPosition(float eventBeat, double controllerValue) const
 {
     // hardcoded multiplier
     //const double multipliedCV = (controllerValue * 2.0) - 0.5;
     const double multipliedCV = controllerValue;
     
-    const float diameter = this->getEventDiameter();
     const float rollLengthInBeats = (this->rollLastBeat - this->rollFirstBeat);
     const float projectLengthInBeats = (this->projectLastBeat - this->projectFirstBeat);
     
     const float beat = (eventBeat - this->rollFirstBeat);
     const float mapWidth = float(this->getWidth()) * (projectLengthInBeats / rollLengthInBeats);
     
-    const int x = int((mapWidth * (beat / projectLengthInBeats)));
-    const int fullh = this->getAvailableHeight();
-    int y = int((1.0 - multipliedCV) * fullh); // upside down flip
-    
-    return Rectangle<int> (x - int(diameter / 2.f),
-                           y - int(diameter / 2.f),
-                           int(diameter),
-                           int(diameter));
+    const float x = float(int(mapWidth * (beat / projectLengthInBeats)));
+    const float y = float(int((1.0 - multipliedCV) * this->getAvailableHeight())); // upside down flip
+    return { x, y };
+}
+
+Point<float> AutomationTrackMap::getEventPosition(int indexInSequence) const
+{
+    const AutomationEvent *event = this->getEventAt(indexInSequence);
+    return this->getEventPosition(event->getBeat(), event->getControllerValue());
+}
+
+float AutomationTrackMap::getBeatByXPosition(float x) const
+{
+    const float rollLengthInBeats = (this->rollLastBeat - this->rollFirstBeat);
+    return this->rollFirstBeat + (x / float(jmax(1, this->getWidth()))) * rollLengthInBeats;
 }
 
 void AutomationTrackMap::getRowsColsByMousePosition(int x, int y, float &targetValue, float &targetBeat) const
@@ -232,24 +376,235 @@ void AutomationTrackMap::getRowsColsByMousePosition(int x, int y, float &targetV
 }
 
 
-AutomationEventComponent *AutomationTrackMap::getPreviousEventComponent(int indexOfSorted) const
+void AutomationTrackMap::addLaneSegment(Path &path,
+    Point<float> start, float startCurvature, Point<float> end)
 {
-    const int indexOfPrevious = indexOfSorted - 1;
-    
-    return
-        isPositiveAndBelow(indexOfPrevious, this->eventComponents.size()) ?
-        this->eventComponents.getUnchecked(indexOfPrevious) :
-        nullptr;
+    const float dx = end.x - start.x;
+    const float dy = end.y - start.y;
+
+    if (dx > AUTOMATION_LANE_MIN_CURVE_WIDTH && dy != 0.f)
+    {
+        // The same curve shape as in ComponentConnectorCurve
+        const float c = (start.y > end.y) ? startCurvature : (1.f - startCurvature);
+        const float rc = (start.y > end.y) ? (1.f - startCurvature) : startCurvature;
+        path.cubicTo(start.x + dx * rc, start.y + dy * c,
+                     start.x + dx * rc, start.y + dy * c,
+                     end.x, end.y);
+    }
+    else
+    {
+        path.lineTo(end);
+    }
 }
 
-AutomationEventComponent *AutomationTrackMap::getNextEventComponent(int indexOfSorted) const
+bool AutomationTrackMap::isNearLane(int x, int y) const
 {
-    const int indexOfNext = indexOfSorted + 1;
-    
-    return
-        isPositiveAndBelow(indexOfNext, this->eventComponents.size()) ?
-        this->eventComponents.getUnchecked(indexOfNext) :
-        nullptr;
+    if (this->sequence == nullptr || this->sequence->size() == 0)
+    {
+        return false;
+    }
+
+    const int numEvents = this->sequence->size();
+    const int indexAfter = this->getIndexOfFirstEventAfter(this->getBeatByXPosition(float(x)));
+
+    // The lane is flat before the first event and after the last one
+    Path segment;
+    if (indexAfter == 0)
+    {
+        const Point<float> first(this->getEventPosition(0));
+        segment.startNewSubPath(0.f, first.y);
+        segment.lineTo(first);
+    }
+    else if (indexAfter == numEvents)
+    {
+        const Point<float> last(this->getEventPosition(numEvents - 1));
+        segment.startNewSubPath(last);
+        segment.lineTo(float(this->getWidth()), last.y);
+    }
+    else
+    {
+        const Point<float> start(this->getEventPosition(indexAfter - 1));
+        segment.startNewSubPath(start);
+        addLaneSegment(segment, start,
+            this->getEventAt(indexAfter - 1)->getCurvature(),
+            this->getEventPosition(indexAfter));
+    }
+
+    const Point<float> target(float(x), float(y));
+    Point<float> nearest;
+    segment.getNearestPoint(target, nearest);
+    return target.getDistanceFrom(nearest) <= (this->getEventDiameter() / 2.f);
+}
+
+
+//===----------------------------------------------------------------------===//
+// Sorted index
+//===----------------------------------------------------------------------===//
+
+int AutomationTrackMap::getIndexOfFirstEventAfter(float beat) const
+{
+    const auto found = std::upper_bound(this->sequence->begin(), this->sequence->end(), beat,
+        [](float b, const MidiEvent *event) { return b < event->getBeat(); });
+
+    return int(found - this->sequence->begin());
+}
+
+const AutomationEvent *AutomationTrackMap::getEventAt(int indexInSequence) const
+{
+    return static_cast<const AutomationEvent *>(this->sequence->getUnchecked(indexInSequence));
+}
+
+
+//===----------------------------------------------------------------------===//
+// Editing handles
+//===----------------------------------------------------------------------===//
+
+void AutomationTrackMap::updateHandlesAt(int x)
+{
+    if (this->sequence == nullptr || this->isAnyHandleDragged())
+    {
+        return;
+    }
+
+    const int numEvents = this->sequence->size();
+    if (numEvents == 0)
+    {
+        this->clearHandles();
+        return;
+    }
+
+    // The segment under the cursor always has handles on both its ends,
+    // plus whatever events are close enough to be grabbed from here
+    const float reach = this->getEventDiameter() * AUTOMATION_HANDLES_REACH;
+    const int indexAfter = this->getIndexOfFirstEventAfter(this->getBeatByXPosition(float(x)));
+
+    int start = jmax(0, indexAfter - 1);
+    int end = jmin(numEvents, indexAfter + 1);
+
+    while (start > 0 &&
+        (indexAfter - start) < AUTOMATION_MAX_HANDLES_PER_SIDE &&
+        (float(x) - this->getEventPosition(start - 1).x) < reach)
+    {
+        --start;
+    }
+
+    while (end < numEvents &&
+        (end - indexAfter) < AUTOMATION_MAX_HANDLES_PER_SIDE &&
+        (this->getEventPosition(end).x - float(x)) < reach)
+    {
+        ++end;
+    }
+
+    // Nothing to do, if the same events are already handled
+    if (this->eventComponents.size() == (end - start))
+    {
+        bool sameEvents = true;
+
+        for (int i = start; i < end && sameEvents; ++i)
+        {
+            sameEvents = (&this->eventComponents.getUnchecked(i - start)->event == this->getEventAt(i));
+        }
+
+        if (sameEvents)
+        {
+            return;
+        }
+    }
+
+    // Keep the components still in range, so that the one under the cursor survives
+    OwnedArray<AutomationEventComponent> handles;
+
+    for (int i = start; i < end; ++i)
+    {
+        const AutomationEvent &autoEvent = *this->getEventAt(i);
+        const auto found = this->eventsHash.find(autoEvent);
+
+        if (found != this->eventsHash.end())
+        {
+            AutomationEventComponent *component = found->second;
+            this->eventComponents.removeObject(component, false);
+            handles.add(component);
+        }
+        else
+        {
+            auto component = new AutomationEventComponent(*this, autoEvent);
+            this->addAndMakeVisible(component);
+            this->eventsHash[autoEvent] = component;
+            handles.add(component);
+        }
+    }
+
+    for (auto *staleComponent : this->eventComponents)
+    {
+        this->eventsHash.erase(staleComponent->event);
+        this->removeChildComponent(staleComponent);
+    }
+
+    this->eventComponents.clear(true);
+    this->eventComponents.swapWith(handles);
+
+    for (auto *component : this->eventComponents)
+    {
+        component->setBounds(this->getEventBounds(component));
+    }
+
+    this->relinkHandles();
+}
+
+void AutomationTrackMap::updateHandlesAtLastMousePosition()
+{
+    if (this->lastMouseX >= 0)
+    {
+        this->updateHandlesAt(this->lastMouseX);
+    }
+    else
+    {
+        this->relinkHandles();
+    }
+}
+
+void AutomationTrackMap::relinkHandles()
+{
+    if (this->eventComponents.size() == 0)
+    {
+        return;
+    }
+
+    this->eventComponents.sort(*this->eventComponents.getFirst());
+
+    // Connectors are only created between the handles that are neighbours
+    // in the sequence; everything else is drawn by the lane itself
+    for (int i = 0; i < this->eventComponents.size(); ++i)
+    {
+        AutomationEventComponent *component = this->eventComponents.getUnchecked(i);
+        AutomationEventComponent *next = this->eventComponents[i + 1];
+
+        if (next != nullptr &&
+            this->sequence->indexOfSorted(&next->event) != this->sequence->indexOfSorted(&component->event) + 1)
+        {
+            next = nullptr;
+        }
+
+        component->setNextNeighbour(next);
+        component->toFront(false);
+    }
+}
+
+void AutomationTrackMap::clearHandles()
+{
+    for (auto *component : this->eventComponents)
+    {
+        this->removeChildComponent(component);
+    }
+
+    this->eventComponents.clear();
+    this->eventsHash.clear();
+}
+
+bool AutomationTrackMap::isAnyHandleDragged() const
+{
+    return this->draggingEvent != nullptr ||
+        ModifierKeys::getCurrentModifiers().isAnyMouseButtonDown();
 }
 
 
@@ -264,42 +619,21 @@ void AutomationTrackMap::onChangeMidiEvent(const MidiEvent &oldEvent, const Midi
         const AutomationEvent &autoEvent = static_cast<const AutomationEvent &>(oldEvent);
         const AutomationEvent &newAutoEvent = static_cast<const AutomationEvent &>(newEvent);
         
-        if (AutomationEventComponent *component = this->eventsHash[autoEvent])
+        const auto found = this->eventsHash.find(autoEvent);
+        if (found != this->eventsHash.end())
         {
-            // update links and connectors
-            this->eventComponents.sort(*component);
-            const int indexOfSorted = this->eventComponents.indexOfSorted(*component, component);
-            AutomationEventComponent *previousEventComponent(this->getPreviousEventComponent(indexOfSorted));
-            AutomationEventComponent *nextEventComponent(this->getNextEventComponent(indexOfSorted));
-            
-            component->setNextNeighbour(nextEventComponent);
-            //component->setVisible(false);
-            this->updateTempoComponent(component);
-            //component->setVisible(true);
-            
-            if (previousEventComponent)
-            {
-                previousEventComponent->setNextNeighbour(component);
-                
-                if (AutomationEventComponent *oneMorePrevious = this->getPreviousEventComponent(indexOfSorted - 1))
-                {
-                    oneMorePrevious->setNextNeighbour(previousEventComponent);
-                }
-            }
-            
-            if (nextEventComponent)
-            {
-                nextEventComponent->setNextNeighbour(this->getNextEventComponent(indexOfSorted + 1));
-            }
-            
-            this->eventsHash.erase(autoEvent);
+            AutomationEventComponent *component = found->second;
+            this->eventsHash.erase(found);
             this->eventsHash[newAutoEvent] = component;
-            
-            if (indexOfSorted == 0 || indexOfSorted == 1)
-            {
-                this->leadingConnector->retargetAndUpdate(nullptr, this->eventComponents[0]);
-            }
+            this->updateTempoComponent(component);
+            this->relinkHandles();
         }
+        else
+        {
+            this->updateHandlesAtLastMousePosition();
+        }
+
+        this->repaint();
     }
 }
 
@@ -308,37 +642,27 @@ void AutomationTrackMap::onAddMidiEvent(const MidiEvent &event)
     if (event.getSequence() == this->sequence)
     {
         const AutomationEvent &autoEvent = static_cast<const AutomationEvent &>(event);
-        
-        auto component = new AutomationEventComponent(*this, autoEvent);
-        this->addAndMakeVisible(component);
 
-        // update links and connectors
-        const int indexOfSorted = this->eventComponents.addSorted(*component, component);
-        AutomationEventComponent *previousEventComponent(this->getPreviousEventComponent(indexOfSorted));
-        AutomationEventComponent *nextEventComponent(this->getNextEventComponent(indexOfSorted));
-
-        component->setNextNeighbour(nextEventComponent);
-        this->updateTempoComponent(component);
-        component->toFront(false);
-        //this->eventAnimator.fadeIn(component, 150);
-        
-        if (previousEventComponent)
+        if (this->addNewEventMode)
         {
-            previousEventComponent->setNextNeighbour(component);
-        }
+            this->addNewEventMode = false;
 
-        this->eventsHash[autoEvent] = component;
-        
-        if (indexOfSorted == 0)
-        {
-            this->leadingConnector->retargetAndUpdate(nullptr, this->eventComponents[0]);
+            // Handles are not rebuilt while the mouse button is down,
+            // so let the new event have one to be dragged right away
+            auto component = new AutomationEventComponent(*this, autoEvent);
+            this->addAndMakeVisible(component);
+            this->eventComponents.add(component);
+            this->eventsHash[autoEvent] = component;
+            this->updateTempoComponent(component);
+            this->relinkHandles();
+            this->draggingEvent = component;
         }
-        
-        if (this->addNewEventMode)
+        else
         {
-            this->draggingEvent = component;
-            this->addNewEventMode = false;
+            this->updateHandlesAtLastMousePosition();
         }
+
+        this->repaint();
     }
 }
 
@@ -348,32 +672,32 @@ void AutomationTrackMap::onRemoveMidiEvent(const MidiEvent &event)
     {
         const AutomationEvent &autoEvent = static_cast<const AutomationEvent &>(event);
         
-        if (AutomationEventComponent *component = this->eventsHash[autoEvent])
+        const auto found = this->eventsHash.find(autoEvent);
+        if (found != this->eventsHash.end())
         {
-            //this->eventAnimator.fadeOut(component, 150);
+            AutomationEventComponent *component = found->second;
             this->removeChildComponent(component);
-            this->eventsHash.erase(autoEvent);
-            
-            // update links and connectors for neighbors
-            const int indexOfSorted = this->eventComponents.indexOfSorted(*component, component);
-            AutomationEventComponent *previousEventComponent(this->getPreviousEventComponent(indexOfSorted));
-            AutomationEventComponent *nextEventComponent(this->getNextEventComponent(indexOfSorted));
-            
-            if (previousEventComponent)
+            this->eventsHash.erase(found);
+
+            if (this->draggingEvent == component)
             {
-                previousEventComponent->setNextNeighbour(nextEventComponent);
+                this->draggingEvent = nullptr;
             }
-            
+
             this->eventComponents.removeObject(component, true);
-            
-            if (this->eventComponents.size() > 0)
-            {
-                this->leadingConnector->retargetAndUpdate(nullptr, this->eventComponents[0]);
-            }
         }
     }
 }
 
+void AutomationTrackMap::onPostRemoveMidiEvent(MidiSequence *const layer)
+{
+    if (layer == this->sequence)
+    {
+        this->relinkHandles();
+        this->repaint();
+    }
+}
+
 void AutomationTrackMap::onChangeTrackProperties(MidiTrack *const track)
 {
     if (this->sequence != nullptr && track->getSequence() == this->sequence)
@@ -416,18 +740,6 @@ void AutomationTrackMap::onChangeProjectBeatRange(float firstBeat, float lastBea
         this->rollLastBeat = lastBeat;
         this->resized();
     }
-
-    // move first event to the first projects's beat
-//    if (AutomationSequence *autoLayer = dynamic_cast<AutomationSequence *>(this->layer.get()))
-//    {
-//        if (autoLayer->size() > 1)
-//        {
-//            if (AutomationEvent *event = dynamic_cast<AutomationEvent *>(autoLayer->getUnchecked(0)))
-//            {
-//                autoLayer->change(*event, event->withParameters(firstBeat, event->getControllerValue()), false);
-//            }
-//        }
-//    }
 }
 
 void AutomationTrackMap::onChangeViewBeatRange(float firstBeat, float lastBeat)
@@ -451,48 +763,13 @@ void AutomationTrackMap::updateTempoComponent(AutomationEventComponent *componen
 
 void AutomationTrackMap::reloadTrack()
 {
-    for (int i = 0; i < this->eventComponents.size(); ++i)
-    {
-        this->removeChildComponent(this->eventComponents.getUnchecked(i));
-    }
-    
-    this->eventComponents.clear();
-    this->eventsHash.clear();
-    
-    this->setVisible(false);
-    
-    for (int j = 0; j < this->sequence->size(); ++j)
-    {
-        MidiEvent *event = this->sequence->getUnchecked(j);
-        
-        if (AutomationEvent *autoEvent = dynamic_cast<AutomationEvent *>(event))
-        {
-            auto component = new AutomationEventComponent(*this, *autoEvent);
-            this->addAndMakeVisible(component);
-            
-            // update links and connectors
-            const int indexOfSorted = this->eventComponents.addSorted(*component, component);
-            AutomationEventComponent *previousEventComponent(this->getPreviousEventComponent(indexOfSorted));
-            AutomationEventComponent *nextEventComponent(this->getNextEventComponent(indexOfSorted));
-            
-            component->setNextNeighbour(nextEventComponent);
-            //this->updateTempoComponent(component);
-            component->toFront(false);
-            
-            if (previousEventComponent)
-            {
-                previousEventComponent->setNextNeighbour(component);
-            }
-            
-            this->eventsHash[*autoEvent] = component;
-        }
-    }
-    
-    if (this->eventComponents.size() > 0)
+    this->clearHandles();
+    this->draggingEvent = nullptr;
+
+    if (this->lastMouseX >= 0)
     {
-        this->leadingConnector->retargetAndUpdate(nullptr, this->eventComponents[0]);
+        this->updateHandlesAt(this->lastMouseX);
     }
-    
-    this->resized();
-    this->setVisible(true);
+
+    this->repaint();
 }
@@ -24,7 +24,6 @@ class HybridRoll;
 class ProjectTreeItem;
 class AutomationCurveHelper;
 class AutomationEventComponent;
-class ComponentConnectorCurve;
 
 
 class AutomationTrackMapCommon : public Component, public ProjectListener
@@ -50,6 +49,9 @@ public:
     // Component
     //===------------------------------------------------------------------===//
     
+    void paint(Graphics &g) override;
+    bool hitTest(int x, int y) override;
+    void mouseMove(const MouseEvent &e) override;
     void mouseDown(const MouseEvent &e) override;
     void mouseDrag(const MouseEvent &e) override;
     void mouseUp(const MouseEvent &e) override;
@@ -64,6 +66,7 @@ public:
         const MidiEvent &newEvent) override;
     void onAddMidiEvent(const MidiEvent &event) override;
     void onRemoveMidiEvent(const MidiEvent &event) override;
+    void onPostRemoveMidiEvent(MidiSequence *const layer) override;
 
     void onAddTrack(MidiTrack *const track) override;
     void onRemoveTrack(MidiTrack *const track) override;
@@ -79,20 +82,46 @@ protected:
     
     Rectangle<int> getEventBounds(AutomationEventComponent *event) const;
     Rectangle<int> getEventBounds(float eventBeat, double controllerValue) const;
+    Point<float> getEventPosition(float eventBeat, double controllerValue) const;
+    Point<float> getEventPosition(int indexInSequence) const;
+    float getBeatByXPosition(float x) const;
+
+    static void addLaneSegment(Path &path,
+        Point<float> start, float startCurvature, Point<float> end);
+    bool isNearLane(int x, int y) const;
 
     void getRowsColsByMousePosition(int x, int y, float &targetValue, float &targetBeat) const;
     float getEventDiameter() const;
     float getHelperDiameter() const;
     int getAvailableHeight() const;
     
-    AutomationEventComponent *getPreviousEventComponent(int indexOfSorted) const;
-    AutomationEventComponent *getNextEventComponent(int indexOfSorted) const;
-    
     friend class AutomationEventComponent;
     
 private:
     
     void updateTempoComponent(AutomationEventComponent *);
+
+    //===------------------------------------------------------------------===//
+    // Sorted index
+    //===------------------------------------------------------------------===//
+
+    // The sequence keeps its events sorted by beat,
+    // so it is used directly as an index for range queries
+    int getIndexOfFirstEventAfter(float beat) const;
+    const AutomationEvent *getEventAt(int indexInSequence) const;
+
+    //===------------------------------------------------------------------===//
+    // Editing handles
+    //===------------------------------------------------------------------===//
+
+    // The lane itself is rendered as a single path in paint(),
+    // and the event components are only created for the events
+    // around the mouse cursor, so that they can be dragged
+    void updateHandlesAt(int x);
+    void updateHandlesAtLastMousePosition();
+    void relinkHandles();
+    void clearHandles();
+    bool isAnyHandleDragged() const;
     
     float projectFirstBeat;
     float projectLastBeat;
@@ -105,12 +134,12 @@ private:
 
     WeakReference<MidiSequence> sequence;
     
-    ScopedPointer<ComponentConnectorCurve> leadingConnector;
-
     OwnedArray<AutomationEventComponent> eventComponents;
     SparseHashMap<AutomationEvent, AutomationEventComponent *, MidiEventHash> eventsHash;
     
     AutomationEventComponent *draggingEvent;
     bool addNewEventMode;
+
+    int lastMouseX;
     
 };
@@ -0,0 +1,284 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Common.h"
+#include "RevisionDiffOverlay.h"
+#include "ProjectTreeItem.h"
+#include "VersionControlTreeItem.h"
+#include "VersionControl.h"
+
+// Editing the project restarts the comparison after a pause
+#define REVISION_DIFF_OVERLAY_UPDATE_DELAY_MS 350
+
+struct BoundsByXSorter final
+{
+    static int compareElements(const Rectangle<float> &first, const Rectangle<float> &second)
+    {
+        const float diff = first.getX() - second.getX();
+        return (diff > 0.f) - (diff < 0.f);
+    }
+};
+
+RevisionDiffOverlay::RevisionDiffOverlay(ProjectTreeItem &parentProject, Layout &rollLayout) :
+    project(parentProject),
+    layout(rollLayout)
+{
+    this->layers[VCS::RevisionDiff::EventAdded].colour = Colour(0x7032ff64);
+    this->layers[VCS::RevisionDiff::EventRemoved].colour = Colour(0x70ff3c3c);
+    this->layers[VCS::RevisionDiff::EventChanged].colour = Colour(0x70ffc832);
+
+    for (auto &layer : this->layers)
+    {
+        layer.maxWidth = 0.f;
+    }
+
+    this->setWantsKeyboardFocus(false);
+    this->setInterceptsMouseClicks(false, false);
+    this->setAlwaysOnTop(true);
+    this->setVisible(false);
+
+    this->project.addChangeListener(this);
+    this->findVersionControl();
+}
+
+RevisionDiffOverlay::~RevisionDiffOverlay()
+{
+    this->stopTimer();
+    this->diff.cancel();
+
+    if (VersionControl *vcs = (this->vcsItem != nullptr) ? this->vcsItem->getVersionControl() : nullptr)
+    {
+        vcs->removeChangeListener(this);
+    }
+
+    this->project.removeChangeListener(this);
+}
+
+void RevisionDiffOverlay::toggle()
+{
+    if (VersionControl *vcs = this->findVersionControl())
+    {
+        if (vcs->isDiffOverlayShown())
+        {
+            vcs->hideDiffOverlay();
+        }
+        else
+        {
+            vcs->showDiffOverlay({}, {});
+        }
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Layout
+//===----------------------------------------------------------------------===//
+
+void RevisionDiffOverlay::updateBounds()
+{
+    if (Component *parent = this->getParentComponent())
+    {
+        this->setBounds(parent->getLocalBounds());
+    }
+
+    for (auto &layer : this->layers)
+    {
+        layer.bounds.clearQuick();
+        layer.maxWidth = 0.f;
+    }
+
+    if (this->result == nullptr || ! this->isVisible())
+    {
+        return;
+    }
+
+    Array<Rectangle<float>> changeBounds;
+    const Uuid *lastItemId = nullptr;
+    const MidiTrack *track = nullptr;
+
+    for (const auto &change : this->result->changes)
+    {
+        // the changes of an item go in a row
+        if (lastItemId == nullptr || *lastItemId != change.itemId)
+        {
+            lastItemId = &change.itemId;
+            track = this->layout.findDiffOverlayTrack(change.itemId);
+        }
+
+        if (track == nullptr)
+        {
+            continue;
+        }
+
+        changeBounds.clearQuick();
+        this->layout.getDiffOverlayBounds(*track, change, changeBounds);
+
+        Layer &layer = this->layers[change.type];
+        for (const auto &bounds : changeBounds)
+        {
+            layer.bounds.add(bounds);
+            layer.maxWidth = jmax(layer.maxWidth, bounds.getWidth());
+        }
+    }
+
+    BoundsByXSorter sorter;
+    for (auto &layer : this->layers)
+    {
+        layer.bounds.sort(sorter);
+    }
+
+    this->repaint();
+}
+
+void RevisionDiffOverlay::paint(Graphics &g)
+{
+    const Rectangle<float> visibleArea(g.getClipBounds().toFloat());
+
+    for (const auto &layer : this->layers)
+    {
+        // the first rectangle that can reach the visible area
+        const float minX = visibleArea.getX() - layer.maxWidth;
+        int start = 0;
+        int end = layer.bounds.size();
+
+        while (start < end)
+        {
+            const int middle = (start + end) / 2;
+            if (layer.bounds.getReference(middle).getX() < minX)
+            {
+                start = middle + 1;
+            }
+            else
+            {
+                end = middle;
+            }
+        }
+
+        RectangleList<float> visibleBounds;
+
+        for (int i = start; i < layer.bounds.size(); ++i)
+        {
+            const Rectangle<float> &bounds = layer.bounds.getReference(i);
+
+            if (bounds.getX() > visibleArea.getRight())
+            {
+                break;
+            }
+
+            if (bounds.intersects(visibleArea))
+            {
+                visibleBounds.addWithoutMerging(bounds);
+            }
+        }
+
+        g.setColour(layer.colour);
+        g.fillRectList(visibleBounds);
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// Comparison
+//===----------------------------------------------------------------------===//
+
+VersionControl *RevisionDiffOverlay::findVersionControl()
+{
+    if (this->vcsItem == nullptr)
+    {
+        VersionControlTreeItem *item = this->project.findChildOfType<VersionControlTreeItem>();
+        VersionControl *vcs = (item != nullptr) ? item->getVersionControl() : nullptr;
+
+        if (vcs == nullptr)
+        {
+            return nullptr;
+        }
+
+        this->vcsItem = item;
+        vcs->addChangeListener(this);
+    }
+
+    return this->vcsItem->getVersionControl();
+}
+
+void RevisionDiffOverlay::updateFromVersionControl()
+{
+    VersionControl *vcs = this->findVersionControl();
+
+    if (vcs != nullptr && vcs->isDiffOverlayShown())
+    {
+        this->setVisible(true);
+        this->startComparing();
+        return;
+    }
+
+    this->stopTimer();
+    this->diff.cancel();
+    this->result = nullptr;
+    this->setVisible(false);
+    this->updateBounds();
+}
+
+void RevisionDiffOverlay::startComparing()
+{
+    VersionControl *vcs = this->findVersionControl();
+
+    if (vcs == nullptr)
+    {
+        return;
+    }
+
+    this->diff.compare(vcs->getDiffOverlayBase(), vcs->getDiffOverlayTarget(),
+        &this->project, [this](VCS::RevisionDiff::Result::Ptr newResult)
+    {
+        this->applyResult(newResult);
+    });
+}
+
+void RevisionDiffOverlay::applyResult(VCS::RevisionDiff::Result::Ptr newResult)
+{
+    this->result = newResult;
+    this->updateBounds();
+}
+
+void RevisionDiffOverlay::changeListenerCallback(ChangeBroadcaster *source)
+{
+    VersionControl *vcs = this->findVersionControl();
+
+    if (source == vcs)
+    {
+        this->updateFromVersionControl();
+    }
+    else if (vcs != nullptr && vcs->isDiffOverlayShown())
+    {
+        // the working copy has changed, or at least the clips have moved
+        this->startTimer(REVISION_DIFF_OVERLAY_UPDATE_DELAY_MS);
+    }
+}
+
+void RevisionDiffOverlay::timerCallback()
+{
+    this->stopTimer();
+
+    VersionControl *vcs = this->findVersionControl();
+
+    if (vcs != nullptr && ! vcs->getDiffOverlayTarget().isValid())
+    {
+        this->startComparing();
+    }
+    else
+    {
+        this->updateBounds();
+    }
+}
@@ -0,0 +1,100 @@
+/*
+    This file is part of Helio Workstation.
+
+    Helio is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Helio is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Helio. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+class ProjectTreeItem;
+class VersionControl;
+class VersionControlTreeItem;
+class MidiTrack;
+
+#include "RevisionDiff.h"
+#include "SafeTreeItemPointer.h"
+
+// Shows which events have been added, removed or changed between two
+// states of the project, as selected in the version control
+// (the working copy since the head revision, by default).
+//
+// The comparison is done by RevisionDiff in a background thread; the roll
+// only tells where each change is, and the overlay keeps the resulting
+// rectangles sorted, so that painting is a single pass per change type
+// over whatever is visible, no matter how many events the project has.
+
+class RevisionDiffOverlay final :
+    public Component,
+    private ChangeListener, // listens to the project and its version control
+    private Timer
+{
+public:
+
+    class Layout
+    {
+    public:
+
+        virtual ~Layout() {}
+
+        // The track with the given vcs id, if the roll shows it
+        virtual MidiTrack *findDiffOverlayTrack(const Uuid &itemId) const = 0;
+
+        // Where the roll shows a change of the track
+        // (a pattern roll shows a note in every clip of its track)
+        virtual void getDiffOverlayBounds(const MidiTrack &track,
+            const VCS::RevisionDiff::Change &change,
+            Array<Rectangle<float>> &outBounds) const = 0;
+    };
+
+    RevisionDiffOverlay(ProjectTreeItem &parentProject, Layout &rollLayout);
+    ~RevisionDiffOverlay() override;
+
+    // Shows the changes of the working copy since the head revision,
+    // or hides the overlay, if it is shown
+    void toggle();
+
+    // Should be called whenever the roll layout changes
+    void updateBounds();
+
+    void paint(Graphics &g) override;
+
+private:
+
+    VersionControl *findVersionControl();
+    void updateFromVersionControl();
+    void startComparing();
+    void applyResult(VCS::RevisionDiff::Result::Ptr newResult);
+
+    void changeListenerCallback(ChangeBroadcaster *source) override;
+    void timerCallback() override;
+
+    struct Layer
+    {
+        Colour colour;
+        Array<Rectangle<float>> bounds; // sorted by x
+        float maxWidth;
+    };
+
+    Layer layers[3]; // by change type
+
+    ProjectTreeItem &project;
+    Layout &layout;
+
+    SafeTreeItemPointer<VersionControlTreeItem> vcsItem;
+
+    VCS::RevisionDiff diff;
+    VCS::RevisionDiff::Result::Ptr result;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RevisionDiffOverlay)
+};
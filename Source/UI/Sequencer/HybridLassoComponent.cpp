@@ -20,6 +20,14 @@
 #include "HybridLassoComponent.h"
 #include "HelioTheme.h"
 
+// All the lasso sources here are rolls, which keep the selection in Lasso,
+// and it should never be accessed via SelectedItemSet's non-virtual methods:
+static Lasso &getSelectionOf(LassoSource<SelectableComponent *> *source)
+{
+    jassert(dynamic_cast<Lasso *>(&source->getLassoSelection()) != nullptr);
+    return static_cast<Lasso &>(source->getLassoSelection());
+}
+
 HybridLassoComponent::HybridLassoComponent() :
     source(nullptr)
 {
@@ -34,7 +42,7 @@ void HybridLassoComponent::beginLasso(const MouseEvent &e, LassoSource<Selectabl
     if (lassoSource != nullptr)
     {
         source = lassoSource;
-        originalSelection = lassoSource->getLassoSelection().getItemArray();
+        originalSelection = getSelectionOf(lassoSource).getItemArray();
         this->setSize(0, 0);
         this->toFront(false);
         dragStartPos = e.getMouseDownPosition();
@@ -53,19 +61,45 @@ void HybridLassoComponent::dragLasso(const MouseEvent &e)
 
         if (e.mods.isShiftDown())
         {
-            itemsInLasso.removeValuesIn(originalSelection);
+            // Lasso will skip the duplicates itself
             itemsInLasso.addArray(originalSelection);
         }
         else if (e.mods.isAltDown())
         {
-            Array<SelectableComponent *> originalMinusNew(originalSelection);
-            originalMinusNew.removeValuesIn(itemsInLasso);
+            // Symmetric difference of the original selection and the new one:
+            SparseHashSet<SelectableComponent *> itemsInLassoSet;
+            for (auto item : itemsInLasso)
+            {
+                itemsInLassoSet.insert(item);
+            }
+
+            SparseHashSet<SelectableComponent *> originalSelectionSet;
+            for (auto item : this->originalSelection)
+            {
+                originalSelectionSet.insert(item);
+            }
+
+            Array<SelectableComponent *> symmetricDifference;
+            for (auto item : itemsInLasso)
+            {
+                if (originalSelectionSet.find(item) == originalSelectionSet.end())
+                {
+                    symmetricDifference.add(item);
+                }
+            }
+
+            for (auto item : this->originalSelection)
+            {
+                if (itemsInLassoSet.find(item) == itemsInLassoSet.end())
+                {
+                    symmetricDifference.add(item);
+                }
+            }
 
-            itemsInLasso.removeValuesIn(originalSelection);
-            itemsInLasso.addArray(originalMinusNew);
+            itemsInLasso.swapWith(symmetricDifference);
         }
 
-        source->getLassoSelection() = Lasso(itemsInLasso);
+        getSelectionOf(source).setSelection(itemsInLasso);
     }
 }
 
@@ -48,6 +48,7 @@
 #include "MainLayout.h"
 
 #include "Transport.h"
+#include "Metronome.h"
 #include "IconComponent.h"
 
 #include "MainWindow.h"
@@ -1131,6 +1132,13 @@ void HybridRoll::handleCommandMessage(int commandId)
             App::Layout().showModalNonOwnedDialog(dialog);
         }
     }
+    else if (commandId == CommandIDs::ToggleMetronome)
+    {
+        Metronome &metronome = this->getTransport().getMetronome();
+        metronome.setEnabled(! metronome.isEnabled());
+        App::Layout().showTooltip(metronome.isEnabled() ?
+            TRANS("metronome::enabled") : TRANS("metronome::disabled"));
+    }
 }
 
 void HybridRoll::resized()
@@ -43,59 +43,196 @@ public:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SelectionProxyArray);
 };
 
+// The base SelectedItemSet keeps items in a plain array with linear lookups,
+// which makes selecting thousands of events quadratic. Lasso hides those
+// non-virtual accessors with hash-indexed versions, and maintains grouped
+// selections and bounds incrementally, instead of rebuilding them on demand.
+// Note that all the selection changes should go through Lasso, not its base.
+
 class Lasso : public SelectedItemSet<SelectableComponent *>
 {
 public:
 
-    Lasso() : SelectedItemSet() {}
-    
-    explicit Lasso(const ItemArray &items) : SelectedItemSet (items)
-    {
-        this->invalidateCache();
-    }
-    
+    typedef SparseHashMap<String, SelectionProxyArray::Ptr, StringHash> GroupedSelections;
+
+    Lasso() : SelectedItemSet(), boundsAreOutdated(false) {}
+
     void itemSelected(SelectableComponent *item) override
     {
-        this->invalidateCache();
         item->setSelected(true);
     }
 
     void itemDeselected(SelectableComponent *item) override
     {
-        this->invalidateCache();
         item->setSelected(false);
     }
 
-    void needsToCalculateSelectionBounds()
+    //===------------------------------------------------------------------===//
+    // Indexed accessors
+    //===------------------------------------------------------------------===//
+
+    inline bool isSelected(SelectableComponent *item) const noexcept
     {
-        this->bounds = Rectangle<int>();
+        return this->indices.find(item) != this->indices.end();
+    }
+
+    inline int getNumSelected() const noexcept
+    {
+        return this->items.size();
+    }
+
+    inline SelectableComponent *getSelectedItem(int index) const noexcept
+    {
+        return this->items[index];
+    }
+
+    inline const ItemArray &getItemArray() const noexcept
+    {
+        return this->items;
+    }
+
+    inline SelectableComponent **begin() const noexcept
+    {
+        return this->items.begin();
+    }
+
+    inline SelectableComponent **end() const noexcept
+    {
+        return this->items.end();
+    }
+
+    void addToSelection(SelectableComponent *item)
+    {
+        if (! this->isSelected(item))
+        {
+            this->changed();
+            this->addItem(item);
+            this->itemSelected(item);
+        }
+    }
+
+    void deselect(SelectableComponent *item)
+    {
+        if (this->isSelected(item))
+        {
+            this->changed();
+            this->removeItem(item);
+            this->itemDeselected(item);
+        }
+    }
+
+    void deselectAll()
+    {
+        if (this->items.size() > 0)
+        {
+            this->changed();
+            const ItemArray deselectedItems(this->items);
+            this->clearItems();
+
+            for (auto item : deselectedItems)
+            {
+                this->itemDeselected(item);
+            }
+        }
+    }
+
+    void selectOnly(SelectableComponent *item)
+    {
+        if (this->isSelected(item))
+        {
+            ItemArray others;
+
+            for (auto selectedItem : this->items)
+            {
+                if (selectedItem != item)
+                {
+                    others.add(selectedItem);
+                }
+            }
+
+            for (auto other : others)
+            {
+                this->deselect(other);
+            }
+        }
+        else
+        {
+            this->deselectAll();
+            this->addToSelection(item);
+        }
+    }
+
+    // Replaces the whole selection, only notifying the items that changed their state:
+    void setSelection(const ItemArray &newItems)
+    {
+        SparseHashSet<SelectableComponent *> newItemsSet;
+
+        for (auto item : newItems)
+        {
+            newItemsSet.insert(item);
+        }
+
+        ItemArray itemsToDeselect;
+
+        for (auto item : this->items)
+        {
+            if (newItemsSet.find(item) == newItemsSet.end())
+            {
+                itemsToDeselect.add(item);
+            }
+        }
 
-        for (int i = 0; i < this->getNumSelected(); ++i)
+        for (auto item : itemsToDeselect)
         {
-            this->bounds = this->bounds.getUnion(this->getSelectedItem(i)->getBounds());
+            this->deselect(item);
         }
+
+        for (auto item : newItems)
+        {
+            this->addToSelection(item);
+        }
+    }
+
+    //===------------------------------------------------------------------===//
+    // Bounds
+    //===------------------------------------------------------------------===//
+
+    // Items are likely to have moved since the last time, so recalculate all:
+    void needsToCalculateSelectionBounds()
+    {
+        this->recalculateBounds();
     }
 
     Rectangle<int> getSelectionBounds() const
     {
+        if (this->boundsAreOutdated)
+        {
+            this->recalculateBounds();
+        }
+
         return this->bounds;
     }
-    
-    typedef SparseHashMap<String, SelectionProxyArray::Ptr, StringHash> GroupedSelections;
 
+    //===------------------------------------------------------------------===//
+    // Groups
+    //===------------------------------------------------------------------===//
+
+    // Grouped selections are kept up to date on every change,
+    // this is only needed if some items might have changed their group ids:
     void invalidateCache()
     {
-        this->selectionsCache.clear();
-    }
+        const ItemArray selectedItems(this->items);
+        this->clearItems();
 
-    const GroupedSelections &getGroupedSelections() const
-    {
-        if (this->selectionsCache.size() == 0)
+        for (auto item : selectedItems)
         {
-            this->rebuildCache();
+            this->addItem(item);
         }
-        
-        return this->selectionsCache;
+    }
+
+    inline const GroupedSelections &getGroupedSelections() const noexcept
+    {
+        return this->groups;
     }
 
     template<typename T>
@@ -117,30 +254,114 @@ public:
 
 private:
 
-    Rectangle<int> bounds;
-    
-    mutable GroupedSelections selectionsCache;
+    struct ItemInfo
+    {
+        int index;
+        int groupIndex;
+        String groupId;
+    };
+
+    ItemArray items;
+    SparseHashMap<SelectableComponent *, ItemInfo> indices;
+    GroupedSelections groups;
 
-    void rebuildCache() const
+    mutable Rectangle<int> bounds;
+    mutable bool boundsAreOutdated;
+
+    void recalculateBounds() const
     {
-        for (int i = 0; i < this->getNumSelected(); ++i)
+        this->bounds = Rectangle<int>();
+
+        for (auto item : this->items)
         {
-            SelectableComponent *item = this->getSelectedItem(i);
-            const String &groupId(item->getSelectionGroupId());
-            
-            SelectionProxyArray::Ptr targetArray;
-            
-            if (this->selectionsCache.contains(groupId))
-            {
-                targetArray = this->selectionsCache[groupId];
-            }
-            else
-            {
-                targetArray = new SelectionProxyArray();
-            }
-            
-            targetArray->add(item);
-            this->selectionsCache[groupId] = targetArray;
+            this->bounds = this->bounds.getUnion(item->getBounds());
+        }
+
+        this->boundsAreOutdated = false;
+    }
+
+    // Someone might still hold a group array obtained from getGroupedSelections
+    // (e.g. iterating it while the selection changes), so copy it before writing:
+    SelectionProxyArray *getWritableGroup(const String &groupId)
+    {
+        SelectionProxyArray::Ptr &group = this->groups[groupId];
+
+        if (group == nullptr)
+        {
+            group = new SelectionProxyArray();
         }
+        else if (group->getReferenceCount() > 1)
+        {
+            SelectionProxyArray::Ptr copy(new SelectionProxyArray());
+            copy->addArray(*group);
+            group = copy;
+        }
+
+        return group.get();
     }
+
+    void addItem(SelectableComponent *item)
+    {
+        ItemInfo info;
+        info.groupId = item->getSelectionGroupId();
+
+        SelectionProxyArray *group = this->getWritableGroup(info.groupId);
+        info.index = this->items.size();
+        info.groupIndex = group->size();
+
+        this->items.add(item);
+        group->add(item);
+        this->indices[item] = info;
+
+        if (! this->boundsAreOutdated)
+        {
+            this->bounds = this->bounds.getUnion(item->getBounds());
+        }
+    }
+
+    // Both arrays are unordered, so an item is removed by swapping with the last one:
+    void removeItem(SelectableComponent *item)
+    {
+        const auto found = this->indices.find(item);
+        const ItemInfo info(found->second);
+        this->indices.erase(found);
+
+        const int lastIndex = this->items.size() - 1;
+        if (info.index != lastIndex)
+        {
+            SelectableComponent *lastItem = this->items.getUnchecked(lastIndex);
+            this->items.set(info.index, lastItem);
+            this->indices[lastItem].index = info.index;
+        }
+
+        this->items.removeLast();
+
+        SelectionProxyArray *group = this->getWritableGroup(info.groupId);
+        const int lastGroupIndex = group->size() - 1;
+        if (info.groupIndex != lastGroupIndex)
+        {
+            SelectableComponent *lastGroupItem = group->getUnchecked(lastGroupIndex);
+            group->set(info.groupIndex, lastGroupItem);
+            this->indices[lastGroupItem].groupIndex = info.groupIndex;
+        }
+
+        group->removeLast();
+
+        if (group->size() == 0)
+        {
+            this->groups.erase(info.groupId);
+        }
+
+        this->boundsAreOutdated = true;
+    }
+
+    void clearItems()
+    {
+        this->items.clearQuick();
+        this->indices.clear();
+        this->groups.clear();
+        this->bounds = Rectangle<int>();
+        this->boundsAreOutdated = false;
+    }
+
 };
@@ -47,6 +47,8 @@
 #include "DummyClipComponent.h"
 #include "ComponentIDs.h"
 #include "ColourIDs.h"
+#include "TrackedItem.h"
+#include "CommandIDs.h"
 
 #define ROWS_OF_TWO_OCTAVES 24
 #define DEFAULT_CLIP_LENGTH 1.0f
@@ -77,10 +79,18 @@ PatternRoll::PatternRoll(ProjectTreeItem &parentProject,
     this->insertTrackHelper = new MidiTrackHeader(nullptr);
     this->addAndMakeVisible(this->insertTrackHelper);
 
+    this->diffOverlay = new RevisionDiffOverlay(this->project, *this);
+    this->addChildComponent(this->diffOverlay);
+
     this->repaintBackgroundsCache();
     this->reloadRollContent();
 }
 
+PatternRoll::~PatternRoll()
+{
+    this->diffOverlay = nullptr;
+}
+
 void PatternRoll::deleteSelection()
 {
     if (this->selection.getNumSelected() == 0)
@@ -190,6 +200,7 @@ void PatternRoll::reloadRollContent()
     }
 
     this->updateRollSize();
+    this->diffOverlay->updateBounds();
     this->repaint(this->viewport.getViewArea());
 }
 
@@ -309,13 +320,16 @@ Rectangle<float> PatternRoll::getEventBounds(FloatBoundsComponent *mc) const
 
 Rectangle<float> PatternRoll::getEventBounds(const Clip &clip, float clipBeat) const
 {
-    const Pattern *pattern = clip.getPattern();
-    const MidiTrack *track = pattern->getTrack();
-    const MidiSequence *sequence = track->getSequence();
+    return this->getEventBounds(*clip.getPattern()->getTrack(), clipBeat);
+}
+
+Rectangle<float> PatternRoll::getEventBounds(const MidiTrack &track, float clipBeat) const
+{
+    const MidiSequence *sequence = track.getSequence();
     jassert(sequence != nullptr);
 
     const float viewStartOffsetBeat = float(this->firstBar * NUM_BEATS_IN_BAR);
-    const int trackIndex = this->tracks.indexOfSorted(*track, track);
+    const int trackIndex = this->tracks.indexOfSorted(track, &track);
     const float sequenceLength = sequence->getLengthInBeats();
     const float sequenceStartBeat = sequence->getFirstBeat();
 
@@ -328,6 +342,54 @@ Rectangle<float> PatternRoll::getEventBounds(const Clip &clip, float clipBeat) c
         w, float(PATTERN_ROLL_CLIP_HEIGHT));
 }
 
+//===----------------------------------------------------------------------===//
+// Diff overlay
+//===----------------------------------------------------------------------===//
+
+MidiTrack *PatternRoll::findDiffOverlayTrack(const Uuid &itemId) const
+{
+    for (const auto track : this->tracks)
+    {
+        const auto *trackedItem = dynamic_cast<const VCS::TrackedItem *>(track);
+
+        if (trackedItem != nullptr && trackedItem->getUuid() == itemId)
+        {
+            return track;
+        }
+    }
+
+    return nullptr;
+}
+
+void PatternRoll::getDiffOverlayBounds(const MidiTrack &track,
+    const VCS::RevisionDiff::Change &change, Array<Rectangle<float>> &outBounds) const
+{
+    if (change.isClip)
+    {
+        outBounds.add(this->getEventBounds(track, change.beat));
+        return;
+    }
+
+    const Pattern *pattern = track.getPattern();
+    if (pattern == nullptr)
+    {
+        return;
+    }
+
+    // notes are shown in every clip as thin marks, keys from bottom to top
+    const float sequenceStartBeat = track.getSequence()->getFirstBeat();
+    const float keyPosition = 1.f - float(jlimit(0, 127, change.key)) / 128.f;
+    const float w = jmax(1.f, this->barWidth * change.length / NUM_BEATS_IN_BAR);
+
+    for (int i = 0; i < pattern->size(); ++i)
+    {
+        const Rectangle<float> clipBounds(this->getEventBounds(track, pattern->getUnchecked(i)->getStartBeat()));
+        const float x = clipBounds.getX() + this->barWidth * (change.beat - sequenceStartBeat) / NUM_BEATS_IN_BAR;
+        const float y = clipBounds.getY() + clipBounds.getHeight() * keyPosition;
+        outBounds.add({ x, y - 1.f, w, 2.f });
+    }
+}
+
 float PatternRoll::getBeatByComponentPosition(float x) const
 {
     return this->getRoundBeatByXPosition(int(x)); /* - 0.5f ? */
@@ -547,8 +609,6 @@ void PatternRoll::selectEventsInRange(float startBeat, float endBeat, bool shoul
 
 void PatternRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound, const Rectangle<int> &rectangle)
 {
-    bool shouldInvalidateSelectionCache = false;
-
     for (const auto &e : this->clipComponents)
     {
         const auto component = e.second.get();
@@ -560,15 +620,9 @@ void PatternRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound,
         const auto component = e.second.get();
         if (rectangle.intersects(component->getBounds()) && component->isActive())
         {
-            shouldInvalidateSelectionCache = true;
-            itemsFound.addIfNotAlreadyThere(component);
+            itemsFound.add(component);
         }
     }
-
-    if (shouldInvalidateSelectionCache)
-    {
-        this->selection.invalidateCache();
-    }
 }
 
 //===----------------------------------------------------------------------===//
@@ -764,6 +818,11 @@ void PatternRoll::mouseUp(const MouseEvent &e)
 void PatternRoll::handleCommandMessage(int commandId)
 {
     // TODO switch
+    if (commandId == CommandIDs::ToggleDiffOverlay)
+    {
+        this->diffOverlay->toggle();
+    }
+
     HybridRoll::handleCommandMessage(commandId);
 }
 
@@ -782,6 +841,8 @@ void PatternRoll::resized()
         component->setFloatBounds(this->getEventBounds(component));
     }
 
+    this->diffOverlay->updateBounds();
+
     HybridRoll::resized();
 
     HYBRID_ROLL_BULK_REPAINT_END
@@ -35,8 +35,11 @@ class PianoRollCellHighlighter;
 #include "MidiTrack.h"
 #include "Pattern.h"
 #include "Clip.h"
+#include "RevisionDiffOverlay.h"
 
-class PatternRoll : public HybridRoll
+class PatternRoll :
+    public HybridRoll,
+    private RevisionDiffOverlay::Layout
 {
 public:
 
@@ -44,6 +47,8 @@ public:
         Viewport &viewportRef,
         WeakReference<AudioMonitor> clippingDetector);
 
+    ~PatternRoll() override;
+
     void deleteSelection();
     void selectAll() override;
     int getNumRows() const noexcept;
@@ -62,6 +67,7 @@ public:
     void addClip(Pattern *pattern, float beat);
     Rectangle<float> getEventBounds(FloatBoundsComponent *mc) const override;
     Rectangle<float> getEventBounds(const Clip &clip, float beat) const;
+    Rectangle<float> getEventBounds(const MidiTrack &track, float clipBeat) const;
     float getBeatByComponentPosition(float x) const;
     float getBeatByMousePosition(int x) const;
     Pattern *getPatternByMousePosition(int y) const;
@@ -168,5 +174,14 @@ private:
     typedef SparseHashMap<Clip, UniquePointer<ClipComponent>, ClipHash> ClipComponentsMap;
     ClipComponentsMap clipComponents;
 
+private:
+
+    MidiTrack *findDiffOverlayTrack(const Uuid &itemId) const override;
+    void getDiffOverlayBounds(const MidiTrack &track,
+        const VCS::RevisionDiff::Change &change,
+        Array<Rectangle<float>> &outBounds) const override;
+
+    ScopedPointer<RevisionDiffOverlay> diffOverlay;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatternRoll)
 };
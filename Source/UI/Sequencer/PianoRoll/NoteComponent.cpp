@@ -44,7 +44,9 @@ NoteComponent::NoteComponent(PianoRoll &editor, const Note &event, bool ghostMod
       state(None),
       anchor(event),
       groupScalingAnchor(event),
-      firstChangeDone(false)
+      firstChangeDone(false),
+      dragPreview(event),
+      hasDragPreview(false)
 {
     this->updateColours();
     this->toFront(false);
@@ -68,23 +70,41 @@ PianoRoll &NoteComponent::getRoll() const
 
 int NoteComponent::getKey() const
 {
+    if (this->hasDragPreview)
+    {
+        return this->dragPreview.getKey();
+    }
+
     return static_cast<const Note &>(this->midiEvent).getKey();
 }
 
 float NoteComponent::getLength() const
 {
+    if (this->hasDragPreview)
+    {
+        return this->dragPreview.getLength();
+    }
+
     return static_cast<const Note &>(this->midiEvent).getLength();
 }
 
 float NoteComponent::getVelocity() const
 {
+    if (this->hasDragPreview)
+    {
+        return this->dragPreview.getVelocity();
+    }
+
     return static_cast<const Note &>(this->midiEvent).getVelocity();
 }
 
 void NoteComponent::updateColours()
 {
+    Colour baseColour(this->getNote().getColour());
+    this->getRoll().getBlameColourFor(this->getNote(), baseColour);
+
     this->colour = Colours::white
-        .interpolatedWith(this->getNote().getColour(), 0.5f)
+        .interpolatedWith(baseColour, 0.5f)
         .withAlpha(this->ghostMode ? 0.2f : 0.95f)
         .darker(this->selectedState ? 0.5f : 0.f);
 
@@ -128,6 +148,11 @@ void NoteComponent::setSelected(bool selected)
 
 float NoteComponent::getBeat() const
 {
+    if (this->hasDragPreview)
+    {
+        return this->dragPreview.getBeat();
+    }
+
     return this->midiEvent.getBeat();
 }
 
@@ -357,20 +382,10 @@ void NoteComponent::mouseDrag(const MouseEvent &e)
 
         if (lengthChanged)
         {
-            this->checkpointIfNeeded();
-            for (const auto &s : selection.getGroupedSelections())
+            for (int i = 0; i < selection.getNumSelected(); ++i)
             {
-                const auto sequenceSelection(s.second);
-                Array<Note> groupDragBefore, groupDragAfter;
-                
-                for (int i = 0; i < sequenceSelection->size(); ++i)
-                {
-                    NoteComponent *nc = static_cast<NoteComponent *>(sequenceSelection->getUnchecked(i));
-                    groupDragBefore.add(nc->getNote());
-                    groupDragAfter.add(nc->continueResizingRight(deltaLength));
-                }
-                
-                getPianoLayer(sequenceSelection)->changeGroup(groupDragBefore, groupDragAfter, true);
+                NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+                nc->updateDragPreview(nc->continueResizingRight(deltaLength));
             }
         }
         else
@@ -385,20 +400,10 @@ void NoteComponent::mouseDrag(const MouseEvent &e)
         
         if (lengthChanged)
         {
-            this->checkpointIfNeeded();
-            for (const auto &s : selection.getGroupedSelections())
+            for (int i = 0; i < selection.getNumSelected(); ++i)
             {
-                const auto sequenceSelection(s.second);
-                Array<Note> groupDragBefore, groupDragAfter;
-                
-                for (int i = 0; i < sequenceSelection->size(); ++i)
-                {
-                    NoteComponent *nc = static_cast<NoteComponent *>(sequenceSelection->getUnchecked(i));
-                    groupDragBefore.add(nc->getNote());
-                    groupDragAfter.add(nc->continueResizingLeft(deltaLength));
-                }
-                
-                getPianoLayer(sequenceSelection)->changeGroup(groupDragBefore, groupDragAfter, true);
+                NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+                nc->updateDragPreview(nc->continueResizingLeft(deltaLength));
             }
         }
         else
@@ -413,20 +418,10 @@ void NoteComponent::mouseDrag(const MouseEvent &e)
         
         if (scaleFactorChanged)
         {
-            this->checkpointIfNeeded();
-            for (const auto &s : selection.getGroupedSelections())
+            for (int i = 0; i < selection.getNumSelected(); ++i)
             {
-                const auto sequenceSelection(s.second);
-                Array<Note> groupDragBefore, groupDragAfter;
-                
-                for (int i = 0; i < sequenceSelection->size(); ++i)
-                {
-                    NoteComponent *nc = static_cast<NoteComponent *>(sequenceSelection->getUnchecked(i));
-                    groupDragBefore.add(nc->getNote());
-                    groupDragAfter.add(nc->continueGroupScalingRight(groupScaleFactor));
-                }
-                
-                getPianoLayer(sequenceSelection)->changeGroup(groupDragBefore, groupDragAfter, true);
+                NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+                nc->updateDragPreview(nc->continueGroupScalingRight(groupScaleFactor));
             }
         }
         else
@@ -441,20 +436,10 @@ void NoteComponent::mouseDrag(const MouseEvent &e)
         
         if (scaleFactorChanged)
         {
-            this->checkpointIfNeeded();
-            for (const auto &s : selection.getGroupedSelections())
+            for (int i = 0; i < selection.getNumSelected(); ++i)
             {
-                const auto sequenceSelection(s.second);
-                Array<Note> groupDragBefore, groupDragAfter;
-                
-                for (int i = 0; i < sequenceSelection->size(); ++i)
-                {
-                    NoteComponent *nc = static_cast<NoteComponent *>(sequenceSelection->getUnchecked(i));
-                    groupDragBefore.add(nc->getNote());
-                    groupDragAfter.add(nc->continueGroupScalingLeft(groupScaleFactor));
-                }
-                
-                getPianoLayer(sequenceSelection)->changeGroup(groupDragBefore, groupDragAfter, true);
+                NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+                nc->updateDragPreview(nc->continueGroupScalingLeft(groupScaleFactor));
             }
         }
         else
@@ -484,8 +469,6 @@ void NoteComponent::mouseDrag(const MouseEvent &e)
         
         if (eventChanged)
         {
-            this->checkpointIfNeeded();
-            
             this->getRoll().moveHelpers(deltaBeat, deltaKey);
             
             if (shouldSendMidi)
@@ -493,44 +476,19 @@ void NoteComponent::mouseDrag(const MouseEvent &e)
                 this->stopSound();
             }
             
-            for (const auto &s : selection.getGroupedSelections())
+            for (int i = 0; i < selection.getNumSelected(); ++i)
             {
-                const auto sequenceSelection(s.second);
-                Array<Note> groupDragBefore, groupDragAfter;
-                
-                for (int i = 0; i < sequenceSelection->size(); ++i)
-                {
-                    NoteComponent *nc = static_cast<NoteComponent *>(sequenceSelection->getUnchecked(i));
-                    groupDragBefore.add(nc->getNote());
-                    groupDragAfter.add(nc->continueDragging(deltaBeat, deltaKey, shouldSendMidi));
-                }
-                
-                getPianoLayer(sequenceSelection)->changeGroup(groupDragBefore, groupDragAfter, true);
+                NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+                nc->updateDragPreview(nc->continueDragging(deltaBeat, deltaKey, shouldSendMidi));
             }
         }
     }
     else if (this->state == Tuning)
     {
-        this->checkpointIfNeeded();
-        
-        for (const auto &s : selection.getGroupedSelections())
+        for (int i = 0; i < selection.getNumSelected(); ++i)
         {
-            const auto sequenceSelection(s.second);
-            Array<Note> groupTuneBefore, groupTuneAfter;
-            
-            for (int i = 0; i < sequenceSelection->size(); ++i)
-            {
-                NoteComponent *nc = static_cast<NoteComponent *>(sequenceSelection->getUnchecked(i));
-                groupTuneBefore.add(nc->getNote());
-                
-                Note tuned(nc->continueTuning(e));
-                groupTuneAfter.add(tuned);
-                
-                //this->getRoll().setDefaultNoteVelocity(tuned.getVelocity());
-                //this->roll.triggerBatchRepaintFor(nc);
-            }
-            
-            getPianoLayer(sequenceSelection)->changeGroup(groupTuneBefore, groupTuneAfter, true);
+            NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+            nc->updateDragPreview(nc->continueTuning(e));
         }
     }
 }
@@ -566,6 +524,8 @@ void NoteComponent::mouseUp(const MouseEvent &e)
     
     Lasso &selection = this->roll.getLassoSelection();
 
+    this->applyDragPreviews(selection);
+
     if (this->state == ResizingRight)
     {
         //this->updateBounds(this->getRoll().getEventBounds(this)); // анти-лаг (?)
@@ -673,6 +633,44 @@ static inline float fastSine(float x)
     return (16.f * x * (MP_PI_F - x)) / (SQR_PI_5_F - 4.f * x * (MP_PI_F - x));
 }
 
+// The expression curve is decimated to a value range per pixel column,
+// so that the dense recorded curves don't cost more than the sparse ones
+#define EXPRESSION_COLUMNS_CHUNK 256
+
+static void paintExpression(Graphics &g, const Note &note,
+    float x, float y, float width, float height)
+{
+    const NoteExpression *expression = note.getExpression();
+    const NoteExpression::Dimension dimension =
+        expression->hasDimension(NoteExpression::PitchBend) ? NoteExpression::PitchBend :
+        (expression->hasDimension(NoteExpression::Pressure) ? NoteExpression::Pressure : NoteExpression::Timbre);
+
+    const ExpressionCurve &curve = expression->getCurve(dimension);
+    const int numColumns = int(width);
+    if (numColumns <= 0)
+    {
+        return;
+    }
+
+    const float beatsPerColumn = note.getLength() / numColumns;
+    const float valueScale = height / float(ExpressionCurve::maxValue);
+    Range<int> ranges[EXPRESSION_COLUMNS_CHUNK];
+
+    for (int chunkStart = 0; chunkStart < numColumns; chunkStart += EXPRESSION_COLUMNS_CHUNK)
+    {
+        const int chunkSize = jmin(EXPRESSION_COLUMNS_CHUNK, numColumns - chunkStart);
+        curve.getColumnRanges(chunkStart * beatsPerColumn,
+            (chunkStart + chunkSize) * beatsPerColumn, ranges, chunkSize);
+
+        for (int i = 0; i < chunkSize; ++i)
+        {
+            const float top = y + height - ranges[i].getEnd() * valueScale;
+            const float bottom = y + height - ranges[i].getStart() * valueScale;
+            g.drawVerticalLine(int(x) + chunkStart + i, top, jmax(top + 1.f, bottom));
+        }
+    }
+}
+
 void NoteComponent::paintNewLook(Graphics &g)
 {
     const float w = this->floatLocalBounds.getWidth() - .75f; // a small gap between notes
@@ -726,6 +724,12 @@ void NoteComponent::paintNewLook(Graphics &g)
     const float sx = x1 + 2.f;
     const float sw = (w - 2.f) * this->getVelocity();
     g.setColour(this->colourVolume);
+
+    if (this->getNote().hasExpression())
+    {
+        paintExpression(g, this->getNote(), x1 + 1.f, y1 + 1.f, w - 2.f, yh - 2.f);
+    }
+
     g.drawHorizontalLine(this->getHeight() - 2, sx, sw);
     g.drawHorizontalLine(this->getHeight() - 3, sx, sw);
     g.drawHorizontalLine(this->getHeight() - 4, sx, sw);
@@ -1089,6 +1093,68 @@ void NoteComponent::checkpointIfNeeded()
     }
 }
 
+//===----------------------------------------------------------------------===//
+// Drag preview
+//===----------------------------------------------------------------------===//
+
+static inline bool hasParamsChanged(const Note &n1, const Note &n2)
+{
+    return n1.getKey() != n2.getKey() ||
+        n1.getBeat() != n2.getBeat() ||
+        n1.getLength() != n2.getLength() ||
+        n1.getVelocity() != n2.getVelocity();
+}
+
+void NoteComponent::updateDragPreview(const Note &previewNote)
+{
+    this->dragPreview = previewNote;
+    this->hasDragPreview = true;
+    this->setFloatBounds(this->getRoll().getEventBounds(this));
+    this->roll.triggerBatchRepaintFor(this);
+}
+
+void NoteComponent::applyDragPreviews(const Lasso &selection)
+{
+    bool checkpointDone = false;
+
+    for (const auto &s : selection.getGroupedSelections())
+    {
+        const auto sequenceSelection(s.second);
+        Array<Note> groupBefore, groupAfter;
+
+        for (int i = 0; i < sequenceSelection->size(); ++i)
+        {
+            NoteComponent *nc = static_cast<NoteComponent *>(sequenceSelection->getUnchecked(i));
+            if (nc->hasDragPreview && hasParamsChanged(nc->getNote(), nc->dragPreview))
+            {
+                groupBefore.add(nc->getNote());
+                groupAfter.add(nc->dragPreview);
+            }
+        }
+
+        if (groupBefore.size() > 0)
+        {
+            if (! checkpointDone)
+            {
+                this->checkpointIfNeeded();
+                checkpointDone = true;
+            }
+
+            getPianoLayer(sequenceSelection)->changeGroup(groupBefore, groupAfter, true);
+        }
+    }
+
+    for (int i = 0; i < selection.getNumSelected(); ++i)
+    {
+        NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+        if (nc->hasDragPreview)
+        {
+            nc->hasDragPreview = false;
+            nc->setFloatBounds(nc->getRoll().getEventBounds(nc));
+        }
+    }
+}
+
 //===----------------------------------------------------------------------===//
 // Shorthands
 //===----------------------------------------------------------------------===//
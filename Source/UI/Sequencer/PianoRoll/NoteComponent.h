@@ -18,6 +18,7 @@
 #pragma once
 
 class PianoRoll;
+class Lasso;
 
 #include "HybridRollEventComponent.h"
 #include "Note.h"
@@ -139,6 +140,14 @@ protected:
     bool firstChangeDone;
     void checkpointIfNeeded();
 
+    // While a drag gesture is in progress, the selected components
+    // only display the preview state, and the model receives
+    // one changeGroup per sequence when the gesture ends:
+    Note dragPreview;
+    bool hasDragPreview;
+    void updateDragPreview(const Note &previewNote);
+    void applyDragPreviews(const Lasso &selection);
+
     bool shouldGoQuickSelectLayerMode(const ModifierKeys &modifiers) const;
     void setQuickSelectLayerMode(bool value);
 
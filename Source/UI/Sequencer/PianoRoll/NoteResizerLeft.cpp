@@ -149,22 +149,10 @@ void NoteResizerLeft::mouseDrag (const MouseEvent& e)
 
     if (scaleFactorChanged)
     {
-        this->noteComponent->checkpointIfNeeded();
-        for (const auto &s : selection.getGroupedSelections())
+        for (int i = 0; i < selection.getNumSelected(); ++i)
         {
-            const auto sequenceSelection(s.second);
-            Array<Note> groupDragBefore, groupDragAfter;
-
-            for (int i = 0; i < selection.getNumSelected(); ++i)
-            {
-                NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
-                groupDragBefore.add(nc->getNote());
-                groupDragAfter.add(nc->continueGroupScalingLeft(groupScaleFactor));
-            }
-
-            const auto &event = sequenceSelection->getFirstAs<NoteComponent>()->getNote();
-            PianoSequence *pianoLayer = static_cast<PianoSequence *>(event.getSequence());
-            pianoLayer->changeGroup(groupDragBefore, groupDragAfter, true);
+            NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+            nc->updateDragPreview(nc->continueGroupScalingLeft(groupScaleFactor));
         }
     }
 
@@ -177,6 +165,11 @@ void NoteResizerLeft::mouseUp (const MouseEvent& e)
     //[UserCode_mouseUp] -- Add your code here...
     const Lasso &selection = this->roll.getLassoSelection();
 
+    if (this->noteComponent != nullptr)
+    {
+        this->noteComponent->applyDragPreviews(selection);
+    }
+
     for (int i = 0; i < selection.getNumSelected(); i++)
     {
         NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
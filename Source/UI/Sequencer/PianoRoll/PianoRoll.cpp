@@ -27,6 +27,9 @@
 #include "PianoTrackTreeItem.h"
 #include "AutomationTrackTreeItem.h"
 #include "VersionControlTreeItem.h"
+#include "BlameIndex.h"
+#include "MidiTrack.h"
+#include "TrackedItem.h"
 #include "ProjectTreeItem.h"
 #include "ProjectTimeline.h"
 #include "Note.h"
@@ -47,6 +50,7 @@
 #include "InternalClipboard.h"
 #include "HelioCallout.h"
 #include "NotesTuningPanel.h"
+#include "QuantizePanel.h"
 #include "ArpeggiatorEditorPanel.h"
 #include "PianoRollToolbox.h"
 #include "Config.h"
@@ -68,6 +72,7 @@ PianoRoll::PianoRoll(ProjectTreeItem &parentProject,
     draggingNote(nullptr),
     addNewNoteMode(false),
     mouseDownWasTriggered(false),
+    blameOverlayMode(NoBlameOverlay),
     defaultHighlighting() // default pattern (black and white keys)
 {
     this->defaultHighlighting = new HighlightingScheme(0, Scale::getNaturalMajorScale());
@@ -79,9 +84,22 @@ PianoRoll::PianoRoll(ProjectTreeItem &parentProject,
     this->helperHorizontal = new HelperRectangleHorizontal();
     this->addChildComponent(this->helperHorizontal);
 
+    this->diffOverlay = new RevisionDiffOverlay(this->project, *this);
+    this->addChildComponent(this->diffOverlay);
+
     this->reloadRollContent();
 }
 
+PianoRoll::~PianoRoll()
+{
+    this->diffOverlay = nullptr;
+
+    if (this->blameIndex != nullptr)
+    {
+        this->blameIndex->removeChangeListener(this);
+    }
+}
+
 void PianoRoll::deleteSelection()
 {
     if (this->selection.getNumSelected() == 0)
@@ -203,7 +221,8 @@ void PianoRoll::setActiveMidiLayers(Array<MidiSequence *> newLayers, MidiSequenc
 
     this->activeLayers = newLayers;
     this->primaryActiveLayer = primaryLayer;
-    
+
+    this->diffOverlay->updateBounds();
     this->repaint(this->viewport.getViewArea());
 }
 
@@ -231,6 +250,16 @@ void PianoRoll::setRowHeight(const int newRowHeight)
         HYBRID_ROLL_HEADER_HEIGHT + this->numRows * this->rowHeight);
 }
 
+const Quantizer &PianoRoll::getQuantizer() const noexcept
+{
+    return this->quantizer;
+}
+
+void PianoRoll::setQuantizer(const Quantizer &newQuantizer)
+{
+    this->quantizer = newQuantizer;
+}
+
 
 //===----------------------------------------------------------------------===//
 // HybridRoll
@@ -540,13 +569,7 @@ void PianoRoll::onChangeTrackProperties(MidiTrack *const track)
     if (auto sequence = dynamic_cast<const PianoSequence *>(track->getSequence()))
     {
         // TODO only repaint notes of a changed track?
-        for (const auto &e : this->eventComponents)
-        {
-            const auto component = e.second.get();
-            component->updateColours();
-        }
-
-        this->repaint();
+        this->updateNoteColours();
     }
 }
 
@@ -630,8 +653,6 @@ void PianoRoll::selectEventsInRange(float startBeat, float endBeat, bool shouldC
 
 void PianoRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound, const Rectangle<int> &rectangle)
 {
-    this->selection.invalidateCache();
-
     for (const auto &e : this->eventComponents)
     {
         const auto component = e.second.get();
@@ -649,7 +670,7 @@ void PianoRoll::findLassoItemsInArea(Array<SelectableComponent *> &itemsFound, c
         if (rectangle.intersects(component->getBounds()) && component->isActive())
         {
             component->setSelected(true);
-            itemsFound.addIfNotAlreadyThere(component);
+            itemsFound.add(component);
         }
     }
 }
@@ -1112,6 +1133,12 @@ void PianoRoll::handleCommandMessage(int commandId)
             vcsTreeItem->toggleQuickStash();
         }
         break;
+    case CommandIDs::ToggleBlameOverlay:
+        this->toggleBlameOverlay();
+        break;
+    case CommandIDs::ToggleDiffOverlay:
+        this->diffOverlay->toggle();
+        break;
     case CommandIDs::ShowArpeggiatiosPanel:
         // TODO
         break;
@@ -1131,6 +1158,17 @@ void PianoRoll::handleCommandMessage(int commandId)
         PianoRollToolbox::fadeOutVolume(this->getLassoSelection(), 0.35f);
         HYBRID_ROLL_BULK_REPAINT_END
         break;
+    case CommandIDs::QuantizeSelection:
+        HYBRID_ROLL_BULK_REPAINT_START
+        PianoRollToolbox::quantize(this->getLassoSelection(), this->quantizer);
+        HYBRID_ROLL_BULK_REPAINT_END
+        break;
+    case CommandIDs::ShowQuantizePanel:
+        if (this->selection.getNumSelected() > 0)
+        {
+            HelioCallout::emit(new QuantizePanel(*this), this, true);
+        }
+        break;
     default:
         break;
     }
@@ -1138,6 +1176,144 @@ void PianoRoll::handleCommandMessage(int commandId)
     HybridRoll::handleCommandMessage(commandId);
 }
 
+//===----------------------------------------------------------------------===//
+// Blame overlay
+//===----------------------------------------------------------------------===//
+
+bool PianoRoll::getBlameColourFor(const Note &note, Colour &outColour) const
+{
+    if (this->blameOverlayMode == NoBlameOverlay || this->blameIndex == nullptr)
+    {
+        return false;
+    }
+
+    const auto *trackedItem = dynamic_cast<const VCS::TrackedItem *>(note.getSequence()->getTrack());
+    if (trackedItem == nullptr)
+    {
+        return false;
+    }
+
+    const int numRevisions = this->blameIndex->getNumRevisions();
+    VCS::BlameIndex::Entry entry;
+
+    if (! this->blameIndex->findEntry(trackedItem->getUuid(),
+        Serialization::Core::note, note.getId(), entry))
+    {
+        // not committed yet, so it's the newest change there is
+        entry.introducedIn = numRevisions;
+        entry.lastChangedIn = numRevisions;
+    }
+
+    if (this->blameOverlayMode == BlameByAge)
+    {
+        const float age = (numRevisions > 0) ?
+            1.f - jlimit(0.f, 1.f, float(entry.lastChangedIn) / float(numRevisions)) : 0.f;
+
+        outColour = Colour::fromHSV(0.66f * age, 0.75f, 1.f, 1.f);
+        return true;
+    }
+
+    if (entry.lastChangedIn >= numRevisions)
+    {
+        return false;
+    }
+
+    const String revisionId(this->blameIndex->getRevisionId(entry.lastChangedIn));
+    const float hue = float(uint32(revisionId.hashCode()) % 360) / 360.f;
+    outColour = Colour::fromHSV(hue, 0.75f, 1.f, 1.f);
+    return true;
+}
+
+void PianoRoll::toggleBlameOverlay()
+{
+    if (this->blameIndex == nullptr)
+    {
+        if (VersionControlTreeItem *vcsTreeItem = this->project.findChildOfType<VersionControlTreeItem>())
+        {
+            this->blameIndex = vcsTreeItem->getBlameIndex();
+        }
+
+        if (this->blameIndex == nullptr)
+        {
+            return;
+        }
+
+        this->blameIndex->addChangeListener(this);
+    }
+
+    switch (this->blameOverlayMode)
+    {
+    case NoBlameOverlay:
+        this->blameOverlayMode = BlameByAge;
+        App::Layout().showTooltip(TRANS("blame::age"));
+        break;
+    case BlameByAge:
+        this->blameOverlayMode = BlameByRevision;
+        App::Layout().showTooltip(TRANS("blame::revision"));
+        break;
+    default:
+        this->blameOverlayMode = NoBlameOverlay;
+        App::Layout().showTooltip(TRANS("blame::off"));
+        break;
+    }
+
+    this->updateNoteColours();
+}
+
+void PianoRoll::updateNoteColours()
+{
+    for (const auto &e : this->eventComponents)
+    {
+        const auto component = e.second.get();
+        component->updateColours();
+    }
+
+    this->repaint();
+}
+
+void PianoRoll::changeListenerCallback(ChangeBroadcaster *source)
+{
+    if (this->blameIndex != nullptr && source == this->blameIndex.get())
+    {
+        if (this->blameOverlayMode != NoBlameOverlay)
+        {
+            this->updateNoteColours();
+        }
+
+        return;
+    }
+
+    HybridRoll::changeListenerCallback(source);
+}
+
+//===----------------------------------------------------------------------===//
+// Diff overlay
+//===----------------------------------------------------------------------===//
+
+MidiTrack *PianoRoll::findDiffOverlayTrack(const Uuid &itemId) const
+{
+    for (const auto layer : this->activeLayers)
+    {
+        const auto *trackedItem = dynamic_cast<const VCS::TrackedItem *>(layer->getTrack());
+
+        if (trackedItem != nullptr && trackedItem->getUuid() == itemId)
+        {
+            return layer->getTrack();
+        }
+    }
+
+    return nullptr;
+}
+
+void PianoRoll::getDiffOverlayBounds(const MidiTrack &track,
+    const VCS::RevisionDiff::Change &change, Array<Rectangle<float>> &outBounds) const
+{
+    if (! change.isClip)
+    {
+        outBounds.add(this->getEventBounds(change.key, change.beat, change.length));
+    }
+}
+
 void PianoRoll::resized()
 {
     if (!this->isShowing())
@@ -1158,6 +1334,8 @@ void PianoRoll::resized()
         component->setFloatBounds(this->getEventBounds(component));
     }
 
+    this->diffOverlay->updateBounds();
+
     HybridRoll::resized();
 
     HYBRID_ROLL_BULK_REPAINT_END
@@ -34,14 +34,23 @@ class PianoRollCellHighlighter;
 class HelperRectangle;
 class Scale;
 
+namespace VCS
+{
+    class BlameIndex;
+}
+
 #include "HybridRoll.h"
 #include "HelioTheme.h"
 #include "NoteResizerLeft.h"
 #include "NoteResizerRight.h"
 #include "Note.h"
 #include "Clip.h"
+#include "Quantizer.h"
+#include "RevisionDiffOverlay.h"
 
-class PianoRoll : public HybridRoll
+class PianoRoll :
+    public HybridRoll,
+    private RevisionDiffOverlay::Layout
 {
 public:
 
@@ -49,6 +58,8 @@ public:
               Viewport &viewportRef,
               WeakReference<AudioMonitor> clippingDetector);
 
+    ~PianoRoll() override;
+
     void deleteSelection();
     
     int getNumActiveLayers() const noexcept;
@@ -58,6 +69,10 @@ public:
         MidiSequence *primaryLayer);
 
     void setRowHeight(const int newRowHeight);
+
+    // The last used quantization settings
+    const Quantizer &getQuantizer() const noexcept;
+    void setQuantizer(const Quantizer &newQuantizer);
     inline int getRowHeight() const
     { return this->rowHeight; }
 
@@ -76,6 +91,20 @@ public:
     
     void showGhostNoteFor(NoteComponent *targetNoteComponent);
     void hideAllGhostNotes();
+
+    //===------------------------------------------------------------------===//
+    // Blame overlay
+    //===------------------------------------------------------------------===//
+
+    enum BlameOverlayMode
+    {
+        NoBlameOverlay = 0,
+        BlameByAge = 1,     // from blue (the oldest revisions) to red (the newest)
+        BlameByRevision = 2 // a distinct hue for each revision
+    };
+
+    // Returns false if the note should keep its track's colour
+    bool getBlameColourFor(const Note &note, Colour &outColour) const;
     
     //===------------------------------------------------------------------===//
     // SmoothZoomListener
@@ -184,6 +213,8 @@ private:
     int numRows;
     int rowHeight;
 
+    Quantizer quantizer;
+
 private:
 
     class HighlightingScheme final
@@ -230,6 +261,24 @@ private:
     void focusToRegionAnimated(int startKey, int endKey, float startBeat, float endBeat);
     class FocusToRegionAnimator;
     ScopedPointer<Timer> focusToRegionAnimator;
+
+private:
+
+    void toggleBlameOverlay();
+    void updateNoteColours();
+    void changeListenerCallback(ChangeBroadcaster *source) override;
+
+    BlameOverlayMode blameOverlayMode;
+    WeakReference<VCS::BlameIndex> blameIndex;
+
+private:
+
+    MidiTrack *findDiffOverlayTrack(const Uuid &itemId) const override;
+    void getDiffOverlayBounds(const MidiTrack &track,
+        const VCS::RevisionDiff::Change &change,
+        Array<Rectangle<float>> &outBounds) const override;
+
+    ScopedPointer<RevisionDiffOverlay> diffOverlay;
     
 private:
     
@@ -29,6 +29,7 @@
 #include "MidiTrack.h"
 #include "InternalClipboard.h"
 #include "Arpeggiator.h"
+#include "Quantizer.h"
 #include "Transport.h"
 #include <float.h>
 #include <math.h>
@@ -689,6 +690,93 @@ void PianoRollToolbox::snapSelection(Lasso &selection, float snapsPerBeat, bool
     applyPianoChanges(groupBefore, groupAfter, didCheckpoint, shouldCheckpoint);
 }
 
+static Array<Note> getSelectedNotes(const Lasso &selection)
+{
+    Array<Note> notes;
+    notes.ensureStorageAllocated(selection.getNumSelected());
+
+    for (int i = 0; i < selection.getNumSelected(); ++i)
+    {
+        NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+        notes.add(nc->getNote());
+    }
+
+    return notes;
+}
+
+static inline bool hasPositionChanged(const Note &n1, const Note &n2)
+{
+    return n1.getBeat() != n2.getBeat() ||
+        n1.getLength() != n2.getLength() ||
+        n1.getVelocity() != n2.getVelocity();
+}
+
+void PianoRollToolbox::quantize(Lasso &selection, const Quantizer &quantizer, bool shouldCheckpoint)
+{
+    if (selection.getNumSelected() == 0)
+    {
+        return;
+    }
+
+    bool didCheckpoint = false;
+
+    const Array<Note> notes(getSelectedNotes(selection));
+    const Array<Note> quantizedNotes(quantizer.process(notes));
+
+    PianoChangeGroup groupBefore, groupAfter;
+
+    for (int i = 0; i < notes.size(); ++i)
+    {
+        if (hasPositionChanged(notes.getReference(i), quantizedNotes.getReference(i)))
+        {
+            groupBefore.add(notes.getReference(i));
+            groupAfter.add(quantizedNotes.getReference(i));
+        }
+    }
+
+    applyPianoChanges(groupBefore, groupAfter, didCheckpoint, shouldCheckpoint);
+}
+
+void PianoRollToolbox::previewQuantize(Lasso &selection, const Quantizer &quantizer)
+{
+    if (selection.getNumSelected() == 0)
+    {
+        return;
+    }
+
+    // The model is not changed while previewing,
+    // so the quantization always starts from the original notes
+    const Array<Note> quantizedNotes(quantizer.process(getSelectedNotes(selection)));
+
+    for (int i = 0; i < selection.getNumSelected(); ++i)
+    {
+        NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+        nc->updateDragPreview(quantizedNotes.getReference(i));
+    }
+}
+
+void PianoRollToolbox::applyPreviews(Lasso &selection)
+{
+    if (NoteComponent *nc = selection.getFirstAs<NoteComponent>())
+    {
+        nc->applyDragPreviews(selection);
+    }
+}
+
+void PianoRollToolbox::cancelPreviews(Lasso &selection)
+{
+    for (int i = 0; i < selection.getNumSelected(); ++i)
+    {
+        NoteComponent *nc = static_cast<NoteComponent *>(selection.getSelectedItem(i));
+        if (nc->hasDragPreview)
+        {
+            nc->hasDragPreview = false;
+            nc->setFloatBounds(nc->getRoll().getEventBounds(nc));
+            nc->getRoll().triggerBatchRepaintFor(nc);
+        }
+    }
+}
+
 
 void PianoRollToolbox::removeOverlaps(Lasso &selection, bool shouldCheckpoint)
 {
@@ -19,6 +19,7 @@
 
 class Transport;
 class Arpeggiator;
+class Quantizer;
 class ProjectTreeItem;
 class Lasso;
 class MidiSequence;
@@ -51,6 +52,13 @@ public:
                                       bool shouldCheckpoint = true);
     
     static void snapSelection(Lasso &selection, float snapsPerBeat, bool shouldCheckpoint = true);
+
+    static void quantize(Lasso &selection, const Quantizer &quantizer, bool shouldCheckpoint = true);
+
+    // Only displays the result, until applied as a single undo action or cancelled
+    static void previewQuantize(Lasso &selection, const Quantizer &quantizer);
+    static void applyPreviews(Lasso &selection);
+    static void cancelPreviews(Lasso &selection);
     static void removeOverlaps(Lasso &selection, bool shouldCheckpoint = true);
     static void removeDuplicates(Lasso &selection, bool shouldCheckpoint = true);
     
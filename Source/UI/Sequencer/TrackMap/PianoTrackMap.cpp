@@ -25,69 +25,21 @@
 #include "AnnotationEvent.h"
 #include "MidiTrack.h"
 
-class TrackMapNoteComponent : public Component
-{
-public:
-
-    TrackMapNoteComponent(PianoTrackMap &parent, const Note &event) :
-        note(event),
-        map(parent),
-        dx(0.f),
-        dw(0.f)
-    {
-        this->updateColour();
-        this->setInterceptsMouseClicks(false, false);
-        this->setPaintingIsUnclipped(true);
-    }
-
-    inline int getKey() const noexcept           { return this->note.getKey(); }
-    inline float getBeat() const noexcept        { return this->note.getBeat(); }
-    inline float getLength() const noexcept      { return this->note.getLength(); }
-    inline float getVelocity() const noexcept    { return this->note.getVelocity(); }
-    inline void updateColour()
-    {
-        this->colour = this->note.getColour().
-            interpolatedWith(Colours::white, .35f).
-            withAlpha(.55f);
-    }
-
-    void setRealBounds(float x, int y, float w, int h)
-    {
-        this->dx = x - floorf(x);
-        this->dw = ceilf(w) - w;
-        this->setBounds(int(floorf(x)), y, int(ceilf(w)), h);
-    }
-    
-    void paint(Graphics &g) override
-    {
-        g.setColour(this->colour);
-        g.drawHorizontalLine(0, this->dx, float(this->getWidth()) - this->dw);
-    }
-
-private:
-
-    const Note &note;
-    PianoTrackMap &map;
-    
-    Colour colour;
-
-    float dx;
-    float dw;
-
-};
+#define PIANO_TRACK_MAP_NUM_KEYS 128
+#define PIANO_TRACK_MAP_MIN_IMAGE_WIDTH 256
+#define PIANO_TRACK_MAP_MAX_IMAGE_WIDTH 8192
 
 PianoTrackMap::PianoTrackMap(ProjectTreeItem &parentProject, HybridRoll &parentRoll) :
     project(parentProject),
     roll(parentRoll),
+    isImageOutdated(true),
     projectFirstBeat(0.f),
     projectLastBeat(0.f),
     rollFirstBeat(0.f),
-    rollLastBeat(0.f),
-    componentHeight(1.f)
+    rollLastBeat(0.f)
 {
     this->setInterceptsMouseClicks(false, false);
     this->setPaintingIsUnclipped(true);
-    this->reloadTrackMap();
     this->project.addListener(this);
 }
 
@@ -102,16 +54,26 @@ PianoTrackMap::~PianoTrackMap()
 
 void PianoTrackMap::resized()
 {
-    this->componentHeight = float(this->getHeight()) / 128.f; // TODO remove hard-coded value
-    
-    this->setVisible(false);
-
-    for (const auto &e : this->componentsMap)
+    // Only re-rasterize when the scale changes significantly,
+    // otherwise the existing image will be simply stretched:
+    if (this->image.isValid() &&
+        this->image.getWidth() != this->getImageWidthForCurrentSize())
     {
-        this->applyNoteBounds(e.second.get());
+        this->isImageOutdated = true;
     }
+}
+
+void PianoTrackMap::paint(Graphics &g)
+{
+    this->renderImageIfNeeded();
 
-    this->setVisible(true);
+    if (this->image.isValid())
+    {
+        const float scaleX = float(this->getWidth()) / float(this->image.getWidth());
+        const float scaleY = float(this->getHeight()) / float(this->image.getHeight());
+        g.setImageResamplingQuality(Graphics::lowResamplingQuality);
+        g.drawImageTransformed(this->image, AffineTransform::scale(scaleX, scaleY));
+    }
 }
 
 //===----------------------------------------------------------------------===//
@@ -122,14 +84,7 @@ void PianoTrackMap::onChangeMidiEvent(const MidiEvent &oldEvent, const MidiEvent
 {
     if (oldEvent.isTypeOf(MidiEvent::Note))
     {
-        const Note &note = static_cast<const Note &>(oldEvent);
-        const Note &newNote = static_cast<const Note &>(newEvent);
-        if (const auto component = this->componentsMap[note].release())
-        {
-            this->componentsMap.erase(note);
-            this->componentsMap[newNote] = UniquePointer<TrackMapNoteComponent>(component);
-            this->applyNoteBounds(component);
-        }
+        this->invalidateImage();
     }
 }
 
@@ -137,14 +92,7 @@ void PianoTrackMap::onAddMidiEvent(const MidiEvent &event)
 {
     if (event.isTypeOf(MidiEvent::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-
-        auto component = new TrackMapNoteComponent(*this, note);
-        this->componentsMap[note] = UniquePointer<TrackMapNoteComponent>(component);
-
-        this->addAndMakeVisible(component);
-        this->applyNoteBounds(component);
-        component->toFront(false);
+        this->invalidateImage();
     }
 }
 
@@ -152,32 +100,19 @@ void PianoTrackMap::onRemoveMidiEvent(const MidiEvent &event)
 {
     if (event.isTypeOf(MidiEvent::Note))
     {
-        const Note &note = static_cast<const Note &>(event);
-        if (const auto deletedComponent = this->componentsMap[note].get())
-        {
-            this->componentsMap.erase(note);
-        }
+        this->invalidateImage();
     }
 }
 
 void PianoTrackMap::onChangeTrackProperties(MidiTrack *const track)
 {
     if (!dynamic_cast<const PianoSequence *>(track->getSequence())) { return; }
-
-    this->setVisible(false);
-
-    for (const auto &e : this->componentsMap)
-    {
-        e.second->updateColour();
-    }
-
-    this->setVisible(true);
-    this->repaint();
+    this->invalidateImage();
 }
 
 void PianoTrackMap::onReloadProjectContent(const Array<MidiTrack *> &tracks)
 {
-    this->reloadTrackMap();
+    this->invalidateImage();
 }
 
 void PianoTrackMap::onAddTrack(MidiTrack *const track)
@@ -186,7 +121,7 @@ void PianoTrackMap::onAddTrack(MidiTrack *const track)
 
     if (track->getSequence()->size() > 0)
     {
-        this->reloadTrackMap();
+        this->invalidateImage();
     }
 }
 
@@ -194,13 +129,9 @@ void PianoTrackMap::onRemoveTrack(MidiTrack *const track)
 {
     if (!dynamic_cast<const PianoSequence *>(track->getSequence())) { return; }
 
-    for (int i = 0; i < track->getSequence()->size(); ++i)
+    if (track->getSequence()->size() > 0)
     {
-        const Note &note = static_cast<const Note &>(*track->getSequence()->getUnchecked(i));
-        if (const auto deletedComponent = this->componentsMap[note].get())
-        {
-            this->componentsMap.erase(note);
-        }
+        this->invalidateImage();
     }
 }
 
@@ -214,7 +145,7 @@ void PianoTrackMap::onChangeProjectBeatRange(float firstBeat, float lastBeat)
     {
         this->rollFirstBeat = firstBeat;
         this->rollLastBeat = lastBeat;
-        this->resized();
+        this->invalidateImage();
     }
 }
 
@@ -222,49 +153,81 @@ void PianoTrackMap::onChangeViewBeatRange(float firstBeat, float lastBeat)
 {
     this->rollFirstBeat = firstBeat;
     this->rollLastBeat = lastBeat;
-    this->resized();
+    this->invalidateImage();
 }
 
 //===----------------------------------------------------------------------===//
 // Private
 //===----------------------------------------------------------------------===//
 
-void PianoTrackMap::reloadTrackMap()
+void PianoTrackMap::invalidateImage()
 {
-    this->componentsMap.clear();
+    // Rendering is deferred until the next paint,
+    // so that a burst of changes only costs a single pass:
+    this->isImageOutdated = true;
+    this->repaint();
+}
 
-    this->setVisible(false);
+int PianoTrackMap::getImageWidthForCurrentSize() const noexcept
+{
+    return jlimit(PIANO_TRACK_MAP_MIN_IMAGE_WIDTH,
+        PIANO_TRACK_MAP_MAX_IMAGE_WIDTH,
+        nextPowerOfTwo(this->getWidth()));
+}
+
+void PianoTrackMap::renderImageIfNeeded()
+{
+    if (! this->isImageOutdated)
+    {
+        return;
+    }
+
+    this->isImageOutdated = false;
+
+    const int imageWidth = this->getImageWidthForCurrentSize();
+    if (this->image.getWidth() != imageWidth)
+    {
+        this->image = Image(Image::ARGB, imageWidth, PIANO_TRACK_MAP_NUM_KEYS, true);
+    }
+    else
+    {
+        this->image.clear(this->image.getBounds());
+    }
+
+    const float rollLengthInBeats = (this->rollLastBeat - this->rollFirstBeat);
+    if (rollLengthInBeats <= 0.f)
+    {
+        return;
+    }
+
+    const float beatWidth = float(imageWidth) / rollLengthInBeats;
+
+    Graphics g(this->image);
+    Colour lastColour;
 
     const auto &tracks = this->project.getTracks();
     for (auto track : tracks)
     {
-        for (int j = 0; j < track->getSequence()->size(); ++j)
+        if (!dynamic_cast<const PianoSequence *>(track->getSequence())) { continue; }
+
+        for (const auto event : *track->getSequence())
         {
-            MidiEvent *event = track->getSequence()->getUnchecked(j);
+            const Note *note = static_cast<const Note *>(event);
+
+            const Colour colour = note->getColour().
+                interpolatedWith(Colours::white, .35f).
+                withAlpha(.55f);
 
-            if (Note *note = dynamic_cast<Note *>(event))
+            if (colour != lastColour)
             {
-                auto noteComponent = new TrackMapNoteComponent(*this, *note);
-                this->componentsMap[*note] = UniquePointer<TrackMapNoteComponent>(noteComponent);
-                this->addAndMakeVisible(noteComponent);
+                g.setColour(colour);
+                lastColour = colour;
             }
+
+            const float x = (note->getBeat() - this->rollFirstBeat) * beatWidth;
+            const float w = jmax(1.f, note->getLength() * beatWidth);
+            const int y = PIANO_TRACK_MAP_NUM_KEYS - 1 - note->getKey();
+            g.fillRect(x, float(y), w, 1.f);
         }
     }
-
-    this->resized();
-    this->setVisible(true);
-}
-
-void PianoTrackMap::applyNoteBounds(TrackMapNoteComponent *nc)
-{
-    const float rollLengthInBeats = (this->rollLastBeat - this->rollFirstBeat);
-    const float projectLengthInBeats = (this->projectLastBeat - this->projectFirstBeat);
-
-    const float beat = (nc->getBeat() - this->rollFirstBeat);
-    const float mapWidth = float(this->getWidth()) * (projectLengthInBeats / rollLengthInBeats);
-
-    const float x = (mapWidth * (beat / projectLengthInBeats));
-    const float w = (mapWidth * (nc->getLength() / projectLengthInBeats));
-    const int y = this->getHeight() - int(nc->getKey() * this->componentHeight);
-    nc->setRealBounds(x, y, jmax(1.f, w), 1);
 }
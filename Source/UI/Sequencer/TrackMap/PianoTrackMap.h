@@ -22,7 +22,6 @@
 
 class HybridRoll;
 class ProjectTreeItem;
-class TrackMapNoteComponent;
 
 class PianoTrackMap :
     public Component,
@@ -38,6 +37,7 @@ public:
     //===------------------------------------------------------------------===//
 
     void resized() override;
+    void paint(Graphics &g) override;
 
     //===------------------------------------------------------------------===//
     // ProjectListener
@@ -57,8 +57,15 @@ public:
 
 private:
 
-    void applyNoteBounds(TrackMapNoteComponent *nc);
-    void reloadTrackMap();
+    // Notes are rasterized into the image once per content change,
+    // and any further resizing, scrolling or zooming animations
+    // just scale the image, so that their cost doesn't depend on the notes count:
+    void invalidateImage();
+    void renderImageIfNeeded();
+    int getImageWidthForCurrentSize() const noexcept;
+
+    Image image;
+    bool isImageOutdated;
 
     float projectFirstBeat;
     float projectLastBeat;
@@ -66,12 +73,8 @@ private:
     float rollFirstBeat;
     float rollLastBeat;
     
-    float componentHeight;
-    
     HybridRoll &roll;
     ProjectTreeItem &project;
     
-    SparseHashMap<Note, UniquePointer<TrackMapNoteComponent>, MidiEventHash> componentsMap;
-    
     JUCE_LEAK_DETECTOR(PianoTrackMap)
 };
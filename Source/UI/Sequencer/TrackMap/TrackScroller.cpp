@@ -149,10 +149,7 @@ void TrackScroller::xyMoveByUser()
         this->helperRectangle->setBounds(hp.withTop(0).withBottom(this->getHeight()));
         this->screenRange->setRealBounds(p);
 
-        for (int i = 0; i < this->trackMaps.size(); ++i)
-        {
-            this->trackMaps.getUnchecked(i)->setBounds(this->getMapBounds());
-        }
+        this->updateTrackMapsBounds();
     }
 }
 
@@ -174,10 +171,7 @@ void TrackScroller::xMoveByUser()
         this->helperRectangle->setBounds(hp.withTop(0).withBottom(this->getHeight()));
         this->screenRange->setRealBounds(p);
 
-        for (int i = 0; i < this->trackMaps.size(); ++i)
-        {
-            this->trackMaps.getUnchecked(i)->setBounds(this->getMapBounds());
-        }
+        this->updateTrackMapsBounds();
     }
 }
 
@@ -202,10 +196,7 @@ void TrackScroller::resizeByUser()
         this->helperRectangle->setBounds(hp.withTop(0).withBottom(this->getHeight()));
         this->screenRange->setRealBounds(p);
 
-        for (int i = 0; i < this->trackMaps.size(); ++i)
-        {
-            this->trackMaps.getUnchecked(i)->setBounds(this->getMapBounds());
-        }
+        this->updateTrackMapsBounds();
     }
 }
 
@@ -227,10 +218,7 @@ void TrackScroller::resized()
     this->helperRectangle->setBounds(hp.withTop(0).withBottom(this->getHeight()));
     this->screenRange->setRealBounds(p);
     
-    for (int i = 0; i < this->trackMaps.size(); ++i)
-    {
-        this->trackMaps.getUnchecked(i)->setBounds(this->getMapBounds());
-    }
+    this->updateTrackMapsBounds();
     
     this->background->setBounds(0, 0, this->getWidth(), this->getHeight());
 }
@@ -357,14 +345,26 @@ void TrackScroller::timerCallback()
     this->helperRectangle->setBounds(helperBounds.withTop(0).withBottom(this->getHeight()));
     this->screenRange->setRealBounds(targetAreaBounds);
 
-    for (int i = 0; i < this->trackMaps.size(); ++i)
-    {
-        this->trackMaps.getUnchecked(i)->setBounds(targetMapBounds.toType<int>());
-    }
-
     if (shouldStop)
     {
         this->stopTimer();
+        this->updateTrackMapsBounds();
+    }
+    else
+    {
+        // Maps are laid out only once, at their final bounds,
+        // and the animation only transforms them, no matter how much content they have:
+        const auto transform = AffineTransform::translation(-mb.getX(), -mb.getY())
+            .scaled(targetMapBounds.getWidth() / jmax(1.f, mb.getWidth()),
+                targetMapBounds.getHeight() / jmax(1.f, mb.getHeight()))
+            .translated(targetMapBounds.getX(), targetMapBounds.getY());
+
+        for (int i = 0; i < this->trackMaps.size(); ++i)
+        {
+            Component *map = this->trackMaps.getUnchecked(i);
+            map->setBounds(mb.toType<int>());
+            map->setTransform(transform);
+        }
     }
 }
 
@@ -380,10 +380,7 @@ void TrackScroller::handleAsyncUpdate()
     this->helperRectangle->setBounds(hp.withTop(0).withBottom(this->getHeight()));
     this->screenRange->setRealBounds(p);
     
-    for (int i = 0; i < this->trackMaps.size(); ++i)
-    {
-        this->trackMaps.getUnchecked(i)->setBounds(this->getMapBounds());
-    }
+    this->updateTrackMapsBounds();
     
     this->indicator->parentSizeChanged(); // a hack: also update indicator position
 }
@@ -457,6 +454,18 @@ Rectangle<int> TrackScroller::getMapBounds() const
     return Rectangle<int>(0, 0, 0, 0);
 }
 
+void TrackScroller::updateTrackMapsBounds()
+{
+    const auto mapBounds = this->getMapBounds();
+
+    for (int i = 0; i < this->trackMaps.size(); ++i)
+    {
+        Component *map = this->trackMaps.getUnchecked(i);
+        map->setTransform(AffineTransform());
+        map->setBounds(mapBounds);
+    }
+}
+
 void TrackScroller::HorizontalDragHelper::MoveConstrainer::
     applyBoundsToComponent(Component &component, Rectangle<int> bounds)
 {
@@ -167,6 +167,7 @@ private:
     OwnedArray<Component> trackMaps;
 
     void disconnectIndicator();
+    void updateTrackMapsBounds();
     Rectangle<float> getIndicatorBounds() const;
     Rectangle<int> getMapBounds() const;
     